@@ -0,0 +1,34 @@
+/*
+ * Bit sliced AES using NEON
+ *
+ * Copyright (C) ST-Ericsson SA 2012
+ * License terms:  GNU General Public License (GPL), version 2
+ */
+#ifndef __ARM_CRYPTO_AESBS_H
+#define __ARM_CRYPTO_AESBS_H
+
+#include <linux/types.h>
+
+#define AESBS_BLOCKS		8
+#define AESBS_BYTES		(AESBS_BLOCKS * 16)
+#define AESBS_MAX_ROUNDS	14
+
+/*
+ * Round keys in bit sliced form: for round key r, the 16 bytes at
+ * rk[r * 128 + i * 16] hold bit plane i, byte k being 0xff if bit i of
+ * byte k of the round key is set and 0x00 otherwise.
+ */
+struct aesbs_key {
+	u8	rk[(AESBS_MAX_ROUNDS + 1) * AESBS_BYTES];
+	int	rounds;
+};
+
+/*
+ * Encrypt or decrypt AESBS_BLOCKS consecutive blocks; src and dst may be
+ * the same buffer. Both must be called between kernel_neon_begin() and
+ * kernel_neon_end().
+ */
+void aesbs_encrypt8(const struct aesbs_key *key, u8 *dst, const u8 *src);
+void aesbs_decrypt8(const struct aesbs_key *key, u8 *dst, const u8 *src);
+
+#endif /* __ARM_CRYPTO_AESBS_H */
@@ -0,0 +1,373 @@
+/*
+ * Bit sliced AES core using NEON
+ *
+ * Copyright (C) ST-Ericsson SA 2012
+ * License terms:  GNU General Public License (GPL), version 2
+ *
+ * Eight blocks are transposed into eight 128-bit bit planes, plane i
+ * holding bit i of every byte of all eight blocks. SubBytes then becomes
+ * a fixed boolean circuit evaluated on 128 bytes at once (the 113 gate
+ * circuit of Boyar and Peralta), ShiftRows a byte permutation of each
+ * plane and MixColumns a few rotations and XORs, so that nothing depends
+ * on table lookups indexed by key or data.
+ *
+ * This file is built with -mfpu=neon; the glue code makes sure it is only
+ * entered between kernel_neon_begin() and kernel_neon_end().
+ */
+#include <arm_neon.h>
+
+#include "aesbs.h"
+
+#define XOR(a, b)	veorq_u8(a, b)
+#define AND(a, b)	vandq_u8(a, b)
+#define NOT(a)		vmvnq_u8(a)
+
+static const u8 shift_rows_idx[16] __aligned(16) = {
+	0, 5, 10, 15, 4, 9, 14, 3, 8, 13, 2, 7, 12, 1, 6, 11
+};
+
+static const u8 inv_shift_rows_idx[16] __aligned(16) = {
+	0, 13, 10, 7, 4, 1, 14, 11, 8, 5, 2, 15, 12, 9, 6, 3
+};
+
+#define SWAPMOVE(a, b, n, m)	do {					\
+	uint8x16_t __t = AND(XOR(vshrq_n_u8(a, n), b), m);		\
+	b = XOR(b, __t);						\
+	a = XOR(a, vshlq_n_u8(__t, n));					\
+} while (0)
+
+/*
+ * Convert eight blocks to bit planes and back; the transposition is its
+ * own inverse.
+ */
+static inline void bitslice(uint8x16_t x[8])
+{
+	const uint8x16_t m0 = vdupq_n_u8(0x55);
+	const uint8x16_t m1 = vdupq_n_u8(0x33);
+	const uint8x16_t m2 = vdupq_n_u8(0x0f);
+
+	SWAPMOVE(x[0], x[1], 1, m0);
+	SWAPMOVE(x[2], x[3], 1, m0);
+	SWAPMOVE(x[4], x[5], 1, m0);
+	SWAPMOVE(x[6], x[7], 1, m0);
+
+	SWAPMOVE(x[0], x[2], 2, m1);
+	SWAPMOVE(x[1], x[3], 2, m1);
+	SWAPMOVE(x[4], x[6], 2, m1);
+	SWAPMOVE(x[5], x[7], 2, m1);
+
+	SWAPMOVE(x[0], x[4], 4, m2);
+	SWAPMOVE(x[1], x[5], 4, m2);
+	SWAPMOVE(x[2], x[6], 4, m2);
+	SWAPMOVE(x[3], x[7], 4, m2);
+}
+
+static inline void add_round_key(uint8x16_t x[8], const u8 *rk)
+{
+	int i;
+
+	for (i = 0; i < 8; i++)
+		x[i] = XOR(x[i], vld1q_u8(rk + 16 * i));
+}
+
+/* The circuit numbers bits from the most significant one: u0 is bit 7 */
+static inline void sub_bytes(uint8x16_t x[8])
+{
+	const uint8x16_t u0 = x[7], u1 = x[6], u2 = x[5], u3 = x[4];
+	const uint8x16_t u4 = x[3], u5 = x[2], u6 = x[1], u7 = x[0];
+
+	const uint8x16_t t1 = XOR(u0, u3);
+	const uint8x16_t t2 = XOR(u0, u5);
+	const uint8x16_t t3 = XOR(u0, u6);
+	const uint8x16_t t4 = XOR(u3, u5);
+	const uint8x16_t t5 = XOR(u4, u6);
+	const uint8x16_t t6 = XOR(t1, t5);
+	const uint8x16_t t7 = XOR(u1, u2);
+	const uint8x16_t t8 = XOR(u7, t6);
+	const uint8x16_t t9 = XOR(u7, t7);
+	const uint8x16_t t10 = XOR(t6, t7);
+	const uint8x16_t t11 = XOR(u1, u5);
+	const uint8x16_t t12 = XOR(u2, u5);
+	const uint8x16_t t13 = XOR(t3, t4);
+	const uint8x16_t t14 = XOR(t6, t11);
+	const uint8x16_t t15 = XOR(t5, t11);
+	const uint8x16_t t16 = XOR(t5, t12);
+	const uint8x16_t t17 = XOR(t9, t16);
+	const uint8x16_t t18 = XOR(u3, u7);
+	const uint8x16_t t19 = XOR(t7, t18);
+	const uint8x16_t t20 = XOR(t1, t19);
+	const uint8x16_t t21 = XOR(u6, u7);
+	const uint8x16_t t22 = XOR(t7, t21);
+	const uint8x16_t t23 = XOR(t2, t22);
+	const uint8x16_t t24 = XOR(t2, t10);
+	const uint8x16_t t25 = XOR(t20, t17);
+	const uint8x16_t t26 = XOR(t3, t16);
+	const uint8x16_t t27 = XOR(t1, t12);
+	const uint8x16_t m1 = AND(t13, t6);
+	const uint8x16_t m2 = AND(t23, t8);
+	const uint8x16_t m3 = XOR(t14, m1);
+	const uint8x16_t m4 = AND(t19, u7);
+	const uint8x16_t m5 = XOR(m4, m1);
+	const uint8x16_t m6 = AND(t3, t16);
+	const uint8x16_t m7 = AND(t22, t9);
+	const uint8x16_t m8 = XOR(t26, m6);
+	const uint8x16_t m9 = AND(t20, t17);
+	const uint8x16_t m10 = XOR(m9, m6);
+	const uint8x16_t m11 = AND(t1, t15);
+	const uint8x16_t m12 = AND(t4, t27);
+	const uint8x16_t m13 = XOR(m12, m11);
+	const uint8x16_t m14 = AND(t2, t10);
+	const uint8x16_t m15 = XOR(m14, m11);
+	const uint8x16_t m16 = XOR(m3, m2);
+	const uint8x16_t m17 = XOR(m5, t24);
+	const uint8x16_t m18 = XOR(m8, m7);
+	const uint8x16_t m19 = XOR(m10, m15);
+	const uint8x16_t m20 = XOR(m16, m13);
+	const uint8x16_t m21 = XOR(m17, m15);
+	const uint8x16_t m22 = XOR(m18, m13);
+	const uint8x16_t m23 = XOR(m19, t25);
+	const uint8x16_t m24 = XOR(m22, m23);
+	const uint8x16_t m25 = AND(m22, m20);
+	const uint8x16_t m26 = XOR(m21, m25);
+	const uint8x16_t m27 = XOR(m20, m21);
+	const uint8x16_t m28 = XOR(m23, m25);
+	const uint8x16_t m29 = AND(m28, m27);
+	const uint8x16_t m30 = AND(m26, m24);
+	const uint8x16_t m31 = AND(m20, m23);
+	const uint8x16_t m32 = AND(m27, m31);
+	const uint8x16_t m33 = XOR(m27, m25);
+	const uint8x16_t m34 = AND(m21, m22);
+	const uint8x16_t m35 = AND(m24, m34);
+	const uint8x16_t m36 = XOR(m24, m25);
+	const uint8x16_t m37 = XOR(m21, m29);
+	const uint8x16_t m38 = XOR(m32, m33);
+	const uint8x16_t m39 = XOR(m23, m30);
+	const uint8x16_t m40 = XOR(m35, m36);
+	const uint8x16_t m41 = XOR(m38, m40);
+	const uint8x16_t m42 = XOR(m37, m39);
+	const uint8x16_t m43 = XOR(m37, m38);
+	const uint8x16_t m44 = XOR(m39, m40);
+	const uint8x16_t m45 = XOR(m42, m41);
+	const uint8x16_t m46 = AND(m44, t6);
+	const uint8x16_t m47 = AND(m40, t8);
+	const uint8x16_t m48 = AND(m39, u7);
+	const uint8x16_t m49 = AND(m43, t16);
+	const uint8x16_t m50 = AND(m38, t9);
+	const uint8x16_t m51 = AND(m37, t17);
+	const uint8x16_t m52 = AND(m42, t15);
+	const uint8x16_t m53 = AND(m45, t27);
+	const uint8x16_t m54 = AND(m41, t10);
+	const uint8x16_t m55 = AND(m44, t13);
+	const uint8x16_t m56 = AND(m40, t23);
+	const uint8x16_t m57 = AND(m39, t19);
+	const uint8x16_t m58 = AND(m43, t3);
+	const uint8x16_t m59 = AND(m38, t22);
+	const uint8x16_t m60 = AND(m37, t20);
+	const uint8x16_t m61 = AND(m42, t1);
+	const uint8x16_t m62 = AND(m45, t4);
+	const uint8x16_t m63 = AND(m41, t2);
+	const uint8x16_t l0 = XOR(m61, m62);
+	const uint8x16_t l1 = XOR(m50, m56);
+	const uint8x16_t l2 = XOR(m46, m48);
+	const uint8x16_t l3 = XOR(m47, m55);
+	const uint8x16_t l4 = XOR(m54, m58);
+	const uint8x16_t l5 = XOR(m49, m61);
+	const uint8x16_t l6 = XOR(m62, l5);
+	const uint8x16_t l7 = XOR(m46, l3);
+	const uint8x16_t l8 = XOR(m51, m59);
+	const uint8x16_t l9 = XOR(m52, m53);
+	const uint8x16_t l10 = XOR(m53, l4);
+	const uint8x16_t l11 = XOR(m60, l2);
+	const uint8x16_t l12 = XOR(m48, m51);
+	const uint8x16_t l13 = XOR(m50, l0);
+	const uint8x16_t l14 = XOR(m52, m61);
+	const uint8x16_t l15 = XOR(m55, l1);
+	const uint8x16_t l16 = XOR(m56, l0);
+	const uint8x16_t l17 = XOR(m57, l1);
+	const uint8x16_t l18 = XOR(m58, l8);
+	const uint8x16_t l19 = XOR(m63, l4);
+	const uint8x16_t l20 = XOR(l0, l1);
+	const uint8x16_t l21 = XOR(l1, l7);
+	const uint8x16_t l22 = XOR(l3, l12);
+	const uint8x16_t l23 = XOR(l18, l2);
+	const uint8x16_t l24 = XOR(l15, l9);
+	const uint8x16_t l25 = XOR(l6, l10);
+	const uint8x16_t l26 = XOR(l7, l9);
+	const uint8x16_t l27 = XOR(l8, l10);
+	const uint8x16_t l28 = XOR(l11, l14);
+	const uint8x16_t l29 = XOR(l11, l17);
+	const uint8x16_t s0 = XOR(l6, l24);
+	const uint8x16_t s1 = XOR(l16, l26);
+	const uint8x16_t s2 = XOR(l19, l28);
+	const uint8x16_t s3 = XOR(l6, l21);
+	const uint8x16_t s4 = XOR(l20, l22);
+	const uint8x16_t s5 = XOR(l25, l29);
+	const uint8x16_t s6 = XOR(l13, l27);
+	const uint8x16_t s7 = XOR(l6, l23);
+
+	x[7] = s0;
+	x[6] = NOT(s1);
+	x[5] = NOT(s2);
+	x[4] = s3;
+	x[3] = s4;
+	x[2] = s5;
+	x[1] = NOT(s6);
+	x[0] = NOT(s7);
+}
+
+/*
+ * The inverse S-box is S^-1(x) = A(S(A(x) ^ 0x05)) ^ 0x05, A being the
+ * linear part of the inverse affine transformation.
+ */
+static inline void inv_affine(uint8x16_t x[8])
+{
+	uint8x16_t y[8];
+	int i;
+
+	for (i = 0; i < 8; i++)
+		y[i] = XOR(XOR(x[(i + 2) % 8], x[(i + 5) % 8]), x[(i + 7) % 8]);
+	for (i = 0; i < 8; i++)
+		x[i] = y[i];
+	x[0] = NOT(x[0]);
+	x[2] = NOT(x[2]);
+}
+
+static inline void inv_sub_bytes(uint8x16_t x[8])
+{
+	inv_affine(x);
+	sub_bytes(x);
+	inv_affine(x);
+}
+
+static inline void shift_rows(uint8x16_t x[8], const u8 *idx)
+{
+	const uint8x8_t lo = vld1_u8(idx);
+	const uint8x8_t hi = vld1_u8(idx + 8);
+	uint8x8x2_t t;
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		t.val[0] = vget_low_u8(x[i]);
+		t.val[1] = vget_high_u8(x[i]);
+		x[i] = vcombine_u8(vtbl2_u8(t, lo), vtbl2_u8(t, hi));
+	}
+}
+
+/* Rotate the rows of each column up by one and by two positions */
+static inline uint8x16_t rot8(uint8x16_t x)
+{
+	uint32x4_t w = vreinterpretq_u32_u8(x);
+
+	return vreinterpretq_u8_u32(vsliq_n_u32(vshrq_n_u32(w, 8), w, 24));
+}
+
+static inline uint8x16_t rot16(uint8x16_t x)
+{
+	return vreinterpretq_u8_u16(vrev32q_u16(vreinterpretq_u16_u8(x)));
+}
+
+/* Multiplication by x in GF(2^8), one bit plane at a time */
+static inline void xtime(uint8x16_t y[8], const uint8x16_t x[8])
+{
+	y[0] = x[7];
+	y[1] = XOR(x[0], x[7]);
+	y[2] = x[1];
+	y[3] = XOR(x[2], x[7]);
+	y[4] = XOR(x[3], x[7]);
+	y[5] = x[4];
+	y[6] = x[5];
+	y[7] = x[6];
+}
+
+/* b[r] = 2 (a[r] ^ a[r + 1]) ^ a[r + 1] ^ a[r + 2] ^ a[r + 3] */
+static inline void mix_columns(uint8x16_t x[8])
+{
+	uint8x16_t r[8], t[8], t2[8];
+	int i;
+
+	for (i = 0; i < 8; i++) {
+		r[i] = rot8(x[i]);
+		t[i] = XOR(x[i], r[i]);
+	}
+	xtime(t2, t);
+	for (i = 0; i < 8; i++)
+		x[i] = XOR(XOR(t2[i], r[i]), rot16(t[i]));
+}
+
+/*
+ * InvMixColumns is MixColumns preceded by a[r] ^= 4 (a[r] ^ a[r + 2]),
+ * which is cheaper than multiplying by 9, 11, 13 and 14 directly.
+ */
+static inline void inv_mix_columns(uint8x16_t x[8])
+{
+	uint8x16_t t[8], t2[8];
+	int i;
+
+	for (i = 0; i < 8; i++)
+		t[i] = XOR(x[i], rot16(x[i]));
+	xtime(t2, t);
+	xtime(t, t2);
+	for (i = 0; i < 8; i++)
+		x[i] = XOR(x[i], t[i]);
+	mix_columns(x);
+}
+
+static inline void load(uint8x16_t x[8], const u8 *src)
+{
+	int i;
+
+	for (i = 0; i < 8; i++)
+		x[i] = vld1q_u8(src + 16 * i);
+	bitslice(x);
+}
+
+static inline void store(uint8x16_t x[8], u8 *dst)
+{
+	int i;
+
+	bitslice(x);
+	for (i = 0; i < 8; i++)
+		vst1q_u8(dst + 16 * i, x[i]);
+}
+
+void aesbs_encrypt8(const struct aesbs_key *key, u8 *dst, const u8 *src)
+{
+	const u8 *rk = key->rk;
+	uint8x16_t x[8];
+	int r;
+
+	load(x, src);
+	add_round_key(x, rk);
+	for (r = 1; r < key->rounds; r++) {
+		rk += AESBS_BYTES;
+		sub_bytes(x);
+		shift_rows(x, shift_rows_idx);
+		mix_columns(x);
+		add_round_key(x, rk);
+	}
+	sub_bytes(x);
+	shift_rows(x, shift_rows_idx);
+	add_round_key(x, rk + AESBS_BYTES);
+	store(x, dst);
+}
+
+void aesbs_decrypt8(const struct aesbs_key *key, u8 *dst, const u8 *src)
+{
+	const u8 *rk = key->rk + key->rounds * AESBS_BYTES;
+	uint8x16_t x[8];
+	int r;
+
+	load(x, src);
+	add_round_key(x, rk);
+	for (r = 1; r < key->rounds; r++) {
+		rk -= AESBS_BYTES;
+		shift_rows(x, inv_shift_rows_idx);
+		inv_sub_bytes(x);
+		add_round_key(x, rk);
+		inv_mix_columns(x);
+	}
+	shift_rows(x, inv_shift_rows_idx);
+	inv_sub_bytes(x);
+	add_round_key(x, key->rk);
+	store(x, dst);
+}
@@ -0,0 +1,757 @@
+/*
+ * Glue code for the bit sliced NEON AES implementation
+ *
+ * Copyright (C) ST-Ericsson SA 2012
+ * License terms:  GNU General Public License (GPL), version 2
+ *
+ * The bit sliced core always processes eight blocks, so only the modes
+ * that can keep it busy use it: ECB, CBC decryption, CTR and XTS. CBC
+ * encryption is inherently serial and goes through a plain "aes" cipher,
+ * as do the CTR tail and the XTS tweak.
+ *
+ * The synchronous "__driver-*" algorithms require NEON and are wrapped
+ * in asynchronous ones that defer to cryptd in interrupt context, in the
+ * same way as the AES-NI glue on x86.
+ */
+#include <linux/hardirq.h>
+#include <linux/types.h>
+#include <linux/crypto.h>
+#include <linux/module.h>
+#include <linux/err.h>
+#include <crypto/algapi.h>
+#include <crypto/aes.h>
+#include <crypto/b128ops.h>
+#include <crypto/cryptd.h>
+#include <crypto/gf128mul.h>
+#include <asm/neon.h>
+
+#include "aesbs.h"
+
+#define AES_BLOCK_MASK	(~(AES_BLOCK_SIZE-1))
+
+typedef void (*aesbs_fn_t)(const struct aesbs_key *key, u8 *dst,
+			   const u8 *src);
+
+struct aesbs_ctx {
+	struct aesbs_key	key;
+	struct crypto_cipher	*cipher;
+};
+
+struct aesbs_xts_ctx {
+	struct aesbs_ctx	data;
+	struct crypto_cipher	*tweak;
+};
+
+struct async_aes_ctx {
+	struct cryptd_ablkcipher *cryptd_tfm;
+};
+
+static void aesbs_convert_key(struct aesbs_key *bs,
+			      const struct crypto_aes_ctx *rk)
+{
+	int r, k, i;
+
+	bs->rounds = 6 + rk->key_length / 4;
+	for (r = 0; r <= bs->rounds; r++) {
+		for (k = 0; k < AES_BLOCK_SIZE; k++) {
+			u8 b = rk->key_enc[4 * r + k / 4] >> (8 * (k % 4));
+			u8 *plane = bs->rk + r * AESBS_BYTES + k;
+
+			for (i = 0; i < 8; i++)
+				plane[i * AES_BLOCK_SIZE] = (b >> i) & 1 ? 0xff : 0;
+		}
+	}
+}
+
+static int aesbs_set_key_common(struct crypto_tfm *tfm,
+				struct aesbs_ctx *ctx, const u8 *in_key,
+				unsigned int key_len)
+{
+	struct crypto_aes_ctx rk;
+	int err;
+
+	err = crypto_aes_expand_key(&rk, in_key, key_len);
+	if (err) {
+		tfm->crt_flags |= CRYPTO_TFM_RES_BAD_KEY_LEN;
+		return err;
+	}
+	aesbs_convert_key(&ctx->key, &rk);
+	memset(&rk, 0, sizeof(rk));
+
+	return crypto_cipher_setkey(ctx->cipher, in_key, key_len);
+}
+
+static int aesbs_set_key(struct crypto_tfm *tfm, const u8 *in_key,
+			 unsigned int key_len)
+{
+	return aesbs_set_key_common(tfm, crypto_tfm_ctx(tfm), in_key, key_len);
+}
+
+static int aesbs_xts_set_key(struct crypto_tfm *tfm, const u8 *in_key,
+			     unsigned int key_len)
+{
+	struct aesbs_xts_ctx *ctx = crypto_tfm_ctx(tfm);
+	int err;
+
+	/* the key consists of two keys of equal size concatenated */
+	if (key_len % 2) {
+		tfm->crt_flags |= CRYPTO_TFM_RES_BAD_KEY_LEN;
+		return -EINVAL;
+	}
+	key_len /= 2;
+
+	err = aesbs_set_key_common(tfm, &ctx->data, in_key, key_len);
+	if (err)
+		return err;
+
+	return crypto_cipher_setkey(ctx->tweak, in_key + key_len, key_len);
+}
+
+static int aesbs_init(struct crypto_tfm *tfm)
+{
+	struct aesbs_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	ctx->cipher = crypto_alloc_cipher("aes", 0, 0);
+	if (IS_ERR(ctx->cipher))
+		return PTR_ERR(ctx->cipher);
+	return 0;
+}
+
+static void aesbs_exit(struct crypto_tfm *tfm)
+{
+	struct aesbs_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	crypto_free_cipher(ctx->cipher);
+}
+
+static int aesbs_xts_init(struct crypto_tfm *tfm)
+{
+	struct aesbs_xts_ctx *ctx = crypto_tfm_ctx(tfm);
+	int err;
+
+	err = aesbs_init(tfm);
+	if (err)
+		return err;
+
+	ctx->tweak = crypto_alloc_cipher("aes", 0, 0);
+	if (IS_ERR(ctx->tweak)) {
+		crypto_free_cipher(ctx->data.cipher);
+		return PTR_ERR(ctx->tweak);
+	}
+	return 0;
+}
+
+static void aesbs_xts_exit(struct crypto_tfm *tfm)
+{
+	struct aesbs_xts_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	crypto_free_cipher(ctx->tweak);
+	aesbs_exit(tfm);
+}
+
+/*
+ * The helpers below process n bytes, a multiple of AES_BLOCK_SIZE no
+ * larger than AESBS_BYTES, in one call to the core. Short batches go
+ * through a bounce buffer. The chaining modes use it for full batches as
+ * well, which keeps in-place requests simple at the cost of a copy that
+ * is small next to the cipher itself.
+ */
+static void aesbs_ecb8(const struct aesbs_key *key, u8 *dst, const u8 *src,
+		       unsigned int n, aesbs_fn_t fn)
+{
+	u8 buf[AESBS_BYTES];
+
+	if (n == AESBS_BYTES) {
+		fn(key, dst, src);
+		return;
+	}
+	memcpy(buf, src, n);
+	fn(key, buf, buf);
+	memcpy(dst, buf, n);
+}
+
+static void aesbs_cbc_decrypt8(const struct aesbs_key *key, u8 *dst,
+			       const u8 *src, unsigned int n, u8 *iv)
+{
+	u8 buf[AESBS_BYTES];
+
+	memcpy(buf, src, n);
+	aesbs_decrypt8(key, buf, buf);
+	crypto_xor(buf, iv, AES_BLOCK_SIZE);
+	crypto_xor(buf + AES_BLOCK_SIZE, src, n - AES_BLOCK_SIZE);
+	memcpy(iv, src + n - AES_BLOCK_SIZE, AES_BLOCK_SIZE);
+	memcpy(dst, buf, n);
+}
+
+static void aesbs_ctr8(const struct aesbs_key *key, u8 *dst, const u8 *src,
+		       unsigned int n, u8 *ctrblk)
+{
+	u8 buf[AESBS_BYTES];
+	unsigned int i;
+
+	for (i = 0; i < n; i += AES_BLOCK_SIZE) {
+		memcpy(buf + i, ctrblk, AES_BLOCK_SIZE);
+		crypto_inc(ctrblk, AES_BLOCK_SIZE);
+	}
+	aesbs_encrypt8(key, buf, buf);
+	crypto_xor(buf, src, n);
+	memcpy(dst, buf, n);
+}
+
+static void aesbs_xts8(const struct aesbs_key *key, u8 *dst, const u8 *src,
+		       unsigned int n, be128 *t, aesbs_fn_t fn)
+{
+	be128 tweaks[AESBS_BLOCKS];
+	u8 buf[AESBS_BYTES];
+	unsigned int i;
+
+	for (i = 0; i < n / AES_BLOCK_SIZE; i++) {
+		tweaks[i] = *t;
+		gf128mul_x_ble(t, t);
+	}
+	memcpy(buf, src, n);
+	crypto_xor(buf, (u8 *)tweaks, n);
+	fn(key, buf, buf);
+	crypto_xor(buf, (u8 *)tweaks, n);
+	memcpy(dst, buf, n);
+}
+
+static int aesbs_ecb_crypt(struct blkcipher_desc *desc,
+			   struct scatterlist *dst, struct scatterlist *src,
+			   unsigned int nbytes, aesbs_fn_t fn)
+{
+	struct aesbs_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	struct blkcipher_walk walk;
+	int err;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt_block(desc, &walk, AESBS_BYTES);
+
+	while ((nbytes = walk.nbytes)) {
+		u8 *s = walk.src.virt.addr, *d = walk.dst.virt.addr;
+
+		kernel_neon_begin();
+		while (nbytes >= AES_BLOCK_SIZE) {
+			unsigned int n = min_t(unsigned int, AESBS_BYTES,
+					       nbytes & AES_BLOCK_MASK);
+
+			aesbs_ecb8(&ctx->key, d, s, n, fn);
+			s += n;
+			d += n;
+			nbytes -= n;
+		}
+		kernel_neon_end();
+		err = blkcipher_walk_done(desc, &walk, nbytes);
+	}
+
+	return err;
+}
+
+static int aesbs_ecb_encrypt(struct blkcipher_desc *desc,
+			     struct scatterlist *dst, struct scatterlist *src,
+			     unsigned int nbytes)
+{
+	return aesbs_ecb_crypt(desc, dst, src, nbytes, aesbs_encrypt8);
+}
+
+static int aesbs_ecb_decrypt(struct blkcipher_desc *desc,
+			     struct scatterlist *dst, struct scatterlist *src,
+			     unsigned int nbytes)
+{
+	return aesbs_ecb_crypt(desc, dst, src, nbytes, aesbs_decrypt8);
+}
+
+static int aesbs_cbc_encrypt(struct blkcipher_desc *desc,
+			     struct scatterlist *dst, struct scatterlist *src,
+			     unsigned int nbytes)
+{
+	struct aesbs_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	struct blkcipher_walk walk;
+	int err;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt(desc, &walk);
+
+	while ((nbytes = walk.nbytes)) {
+		u8 *s = walk.src.virt.addr, *d = walk.dst.virt.addr;
+		u8 *iv = walk.iv;
+
+		while (nbytes >= AES_BLOCK_SIZE) {
+			crypto_xor(iv, s, AES_BLOCK_SIZE);
+			crypto_cipher_encrypt_one(ctx->cipher, d, iv);
+			memcpy(iv, d, AES_BLOCK_SIZE);
+			s += AES_BLOCK_SIZE;
+			d += AES_BLOCK_SIZE;
+			nbytes -= AES_BLOCK_SIZE;
+		}
+		err = blkcipher_walk_done(desc, &walk, nbytes);
+	}
+
+	return err;
+}
+
+static int aesbs_cbc_decrypt(struct blkcipher_desc *desc,
+			     struct scatterlist *dst, struct scatterlist *src,
+			     unsigned int nbytes)
+{
+	struct aesbs_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	struct blkcipher_walk walk;
+	int err;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt_block(desc, &walk, AESBS_BYTES);
+
+	while ((nbytes = walk.nbytes)) {
+		u8 *s = walk.src.virt.addr, *d = walk.dst.virt.addr;
+
+		kernel_neon_begin();
+		while (nbytes >= AES_BLOCK_SIZE) {
+			unsigned int n = min_t(unsigned int, AESBS_BYTES,
+					       nbytes & AES_BLOCK_MASK);
+
+			aesbs_cbc_decrypt8(&ctx->key, d, s, n, walk.iv);
+			s += n;
+			d += n;
+			nbytes -= n;
+		}
+		kernel_neon_end();
+		err = blkcipher_walk_done(desc, &walk, nbytes);
+	}
+
+	return err;
+}
+
+static int aesbs_ctr_crypt(struct blkcipher_desc *desc,
+			   struct scatterlist *dst, struct scatterlist *src,
+			   unsigned int nbytes)
+{
+	struct aesbs_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	struct blkcipher_walk walk;
+	int err;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt_block(desc, &walk, AESBS_BYTES);
+
+	while ((nbytes = walk.nbytes) >= AES_BLOCK_SIZE) {
+		u8 *s = walk.src.virt.addr, *d = walk.dst.virt.addr;
+
+		kernel_neon_begin();
+		while (nbytes >= AES_BLOCK_SIZE) {
+			unsigned int n = min_t(unsigned int, AESBS_BYTES,
+					       nbytes & AES_BLOCK_MASK);
+
+			aesbs_ctr8(&ctx->key, d, s, n, walk.iv);
+			s += n;
+			d += n;
+			nbytes -= n;
+		}
+		kernel_neon_end();
+		err = blkcipher_walk_done(desc, &walk, nbytes);
+	}
+	if (walk.nbytes) {
+		u8 keystream[AES_BLOCK_SIZE];
+
+		crypto_cipher_encrypt_one(ctx->cipher, keystream, walk.iv);
+		crypto_xor(keystream, walk.src.virt.addr, walk.nbytes);
+		memcpy(walk.dst.virt.addr, keystream, walk.nbytes);
+		crypto_inc(walk.iv, AES_BLOCK_SIZE);
+		err = blkcipher_walk_done(desc, &walk, 0);
+	}
+
+	return err;
+}
+
+static int aesbs_xts_crypt(struct blkcipher_desc *desc,
+			   struct scatterlist *dst, struct scatterlist *src,
+			   unsigned int nbytes, aesbs_fn_t fn)
+{
+	struct aesbs_xts_ctx *ctx = crypto_blkcipher_ctx(desc->tfm);
+	struct blkcipher_walk walk;
+	be128 t;
+	int err;
+
+	blkcipher_walk_init(&walk, dst, src, nbytes);
+	err = blkcipher_walk_virt_block(desc, &walk, AESBS_BYTES);
+	if (!walk.nbytes)
+		return err;
+
+	/* the first tweak is the IV encrypted with the second key */
+	crypto_cipher_encrypt_one(ctx->tweak, (u8 *)&t, walk.iv);
+
+	while ((nbytes = walk.nbytes)) {
+		u8 *s = walk.src.virt.addr, *d = walk.dst.virt.addr;
+
+		kernel_neon_begin();
+		while (nbytes >= AES_BLOCK_SIZE) {
+			unsigned int n = min_t(unsigned int, AESBS_BYTES,
+					       nbytes & AES_BLOCK_MASK);
+
+			aesbs_xts8(&ctx->data.key, d, s, n, &t, fn);
+			s += n;
+			d += n;
+			nbytes -= n;
+		}
+		kernel_neon_end();
+		err = blkcipher_walk_done(desc, &walk, nbytes);
+	}
+
+	return err;
+}
+
+static int aesbs_xts_encrypt(struct blkcipher_desc *desc,
+			     struct scatterlist *dst, struct scatterlist *src,
+			     unsigned int nbytes)
+{
+	return aesbs_xts_crypt(desc, dst, src, nbytes, aesbs_encrypt8);
+}
+
+static int aesbs_xts_decrypt(struct blkcipher_desc *desc,
+			     struct scatterlist *dst, struct scatterlist *src,
+			     unsigned int nbytes)
+{
+	return aesbs_xts_crypt(desc, dst, src, nbytes, aesbs_decrypt8);
+}
+
+static struct crypto_alg blk_ecb_alg = {
+	.cra_name		= "__ecb-aes-neonbs",
+	.cra_driver_name	= "__driver-ecb-aes-neonbs",
+	.cra_priority		= 0,
+	.cra_flags		= CRYPTO_ALG_TYPE_BLKCIPHER,
+	.cra_blocksize		= AES_BLOCK_SIZE,
+	.cra_ctxsize		= sizeof(struct aesbs_ctx),
+	.cra_alignmask		= 0,
+	.cra_type		= &crypto_blkcipher_type,
+	.cra_module		= THIS_MODULE,
+	.cra_list		= LIST_HEAD_INIT(blk_ecb_alg.cra_list),
+	.cra_init		= aesbs_init,
+	.cra_exit		= aesbs_exit,
+	.cra_u = {
+		.blkcipher = {
+			.min_keysize	= AES_MIN_KEY_SIZE,
+			.max_keysize	= AES_MAX_KEY_SIZE,
+			.setkey		= aesbs_set_key,
+			.encrypt	= aesbs_ecb_encrypt,
+			.decrypt	= aesbs_ecb_decrypt,
+		},
+	},
+};
+
+static struct crypto_alg blk_cbc_alg = {
+	.cra_name		= "__cbc-aes-neonbs",
+	.cra_driver_name	= "__driver-cbc-aes-neonbs",
+	.cra_priority		= 0,
+	.cra_flags		= CRYPTO_ALG_TYPE_BLKCIPHER,
+	.cra_blocksize		= AES_BLOCK_SIZE,
+	.cra_ctxsize		= sizeof(struct aesbs_ctx),
+	.cra_alignmask		= 0,
+	.cra_type		= &crypto_blkcipher_type,
+	.cra_module		= THIS_MODULE,
+	.cra_list		= LIST_HEAD_INIT(blk_cbc_alg.cra_list),
+	.cra_init		= aesbs_init,
+	.cra_exit		= aesbs_exit,
+	.cra_u = {
+		.blkcipher = {
+			.min_keysize	= AES_MIN_KEY_SIZE,
+			.max_keysize	= AES_MAX_KEY_SIZE,
+			.ivsize		= AES_BLOCK_SIZE,
+			.setkey		= aesbs_set_key,
+			.encrypt	= aesbs_cbc_encrypt,
+			.decrypt	= aesbs_cbc_decrypt,
+		},
+	},
+};
+
+static struct crypto_alg blk_ctr_alg = {
+	.cra_name		= "__ctr-aes-neonbs",
+	.cra_driver_name	= "__driver-ctr-aes-neonbs",
+	.cra_priority		= 0,
+	.cra_flags		= CRYPTO_ALG_TYPE_BLKCIPHER,
+	.cra_blocksize		= 1,
+	.cra_ctxsize		= sizeof(struct aesbs_ctx),
+	.cra_alignmask		= 0,
+	.cra_type		= &crypto_blkcipher_type,
+	.cra_module		= THIS_MODULE,
+	.cra_list		= LIST_HEAD_INIT(blk_ctr_alg.cra_list),
+	.cra_init		= aesbs_init,
+	.cra_exit		= aesbs_exit,
+	.cra_u = {
+		.blkcipher = {
+			.min_keysize	= AES_MIN_KEY_SIZE,
+			.max_keysize	= AES_MAX_KEY_SIZE,
+			.ivsize		= AES_BLOCK_SIZE,
+			.setkey		= aesbs_set_key,
+			.encrypt	= aesbs_ctr_crypt,
+			.decrypt	= aesbs_ctr_crypt,
+		},
+	},
+};
+
+static struct crypto_alg blk_xts_alg = {
+	.cra_name		= "__xts-aes-neonbs",
+	.cra_driver_name	= "__driver-xts-aes-neonbs",
+	.cra_priority		= 0,
+	.cra_flags		= CRYPTO_ALG_TYPE_BLKCIPHER,
+	.cra_blocksize		= AES_BLOCK_SIZE,
+	.cra_ctxsize		= sizeof(struct aesbs_xts_ctx),
+	.cra_alignmask		= 0,
+	.cra_type		= &crypto_blkcipher_type,
+	.cra_module		= THIS_MODULE,
+	.cra_list		= LIST_HEAD_INIT(blk_xts_alg.cra_list),
+	.cra_init		= aesbs_xts_init,
+	.cra_exit		= aesbs_xts_exit,
+	.cra_u = {
+		.blkcipher = {
+			.min_keysize	= 2 * AES_MIN_KEY_SIZE,
+			.max_keysize	= 2 * AES_MAX_KEY_SIZE,
+			.ivsize		= AES_BLOCK_SIZE,
+			.setkey		= aesbs_xts_set_key,
+			.encrypt	= aesbs_xts_encrypt,
+			.decrypt	= aesbs_xts_decrypt,
+		},
+	},
+};
+
+static int ablk_set_key(struct crypto_ablkcipher *tfm, const u8 *key,
+			unsigned int key_len)
+{
+	struct async_aes_ctx *ctx = crypto_ablkcipher_ctx(tfm);
+	struct crypto_ablkcipher *child = &ctx->cryptd_tfm->base;
+	int err;
+
+	crypto_ablkcipher_clear_flags(child, CRYPTO_TFM_REQ_MASK);
+	crypto_ablkcipher_set_flags(child, crypto_ablkcipher_get_flags(tfm)
+				    & CRYPTO_TFM_REQ_MASK);
+	err = crypto_ablkcipher_setkey(child, key, key_len);
+	crypto_ablkcipher_set_flags(tfm, crypto_ablkcipher_get_flags(child)
+				    & CRYPTO_TFM_RES_MASK);
+	return err;
+}
+
+static int ablk_encrypt(struct ablkcipher_request *req)
+{
+	struct crypto_ablkcipher *tfm = crypto_ablkcipher_reqtfm(req);
+	struct async_aes_ctx *ctx = crypto_ablkcipher_ctx(tfm);
+
+	if (in_interrupt()) {
+		struct ablkcipher_request *cryptd_req =
+			ablkcipher_request_ctx(req);
+		memcpy(cryptd_req, req, sizeof(*req));
+		ablkcipher_request_set_tfm(cryptd_req, &ctx->cryptd_tfm->base);
+		return crypto_ablkcipher_encrypt(cryptd_req);
+	} else {
+		struct blkcipher_desc desc;
+		desc.tfm = cryptd_ablkcipher_child(ctx->cryptd_tfm);
+		desc.info = req->info;
+		desc.flags = 0;
+		return crypto_blkcipher_crt(desc.tfm)->encrypt(
+			&desc, req->dst, req->src, req->nbytes);
+	}
+}
+
+static int ablk_decrypt(struct ablkcipher_request *req)
+{
+	struct crypto_ablkcipher *tfm = crypto_ablkcipher_reqtfm(req);
+	struct async_aes_ctx *ctx = crypto_ablkcipher_ctx(tfm);
+
+	if (in_interrupt()) {
+		struct ablkcipher_request *cryptd_req =
+			ablkcipher_request_ctx(req);
+		memcpy(cryptd_req, req, sizeof(*req));
+		ablkcipher_request_set_tfm(cryptd_req, &ctx->cryptd_tfm->base);
+		return crypto_ablkcipher_decrypt(cryptd_req);
+	} else {
+		struct blkcipher_desc desc;
+		desc.tfm = cryptd_ablkcipher_child(ctx->cryptd_tfm);
+		desc.info = req->info;
+		desc.flags = 0;
+		return crypto_blkcipher_crt(desc.tfm)->decrypt(
+			&desc, req->dst, req->src, req->nbytes);
+	}
+}
+
+static void ablk_exit(struct crypto_tfm *tfm)
+{
+	struct async_aes_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	cryptd_free_ablkcipher(ctx->cryptd_tfm);
+}
+
+static int ablk_init_common(struct crypto_tfm *tfm, const char *drv_name)
+{
+	struct async_aes_ctx *ctx = crypto_tfm_ctx(tfm);
+	struct cryptd_ablkcipher *cryptd_tfm;
+
+	cryptd_tfm = cryptd_alloc_ablkcipher(drv_name, 0, 0);
+	if (IS_ERR(cryptd_tfm))
+		return PTR_ERR(cryptd_tfm);
+
+	ctx->cryptd_tfm = cryptd_tfm;
+	tfm->crt_ablkcipher.reqsize = sizeof(struct ablkcipher_request) +
+		crypto_ablkcipher_reqsize(&cryptd_tfm->base);
+	return 0;
+}
+
+static int ablk_ecb_init(struct crypto_tfm *tfm)
+{
+	return ablk_init_common(tfm, "__driver-ecb-aes-neonbs");
+}
+
+static int ablk_cbc_init(struct crypto_tfm *tfm)
+{
+	return ablk_init_common(tfm, "__driver-cbc-aes-neonbs");
+}
+
+static int ablk_ctr_init(struct crypto_tfm *tfm)
+{
+	return ablk_init_common(tfm, "__driver-ctr-aes-neonbs");
+}
+
+static int ablk_xts_init(struct crypto_tfm *tfm)
+{
+	return ablk_init_common(tfm, "__driver-xts-aes-neonbs");
+}
+
+static struct crypto_alg ablk_ecb_alg = {
+	.cra_name		= "ecb(aes)",
+	.cra_driver_name	= "ecb-aes-neonbs",
+	.cra_priority		= 250,
+	.cra_flags		= CRYPTO_ALG_TYPE_ABLKCIPHER|CRYPTO_ALG_ASYNC,
+	.cra_blocksize		= AES_BLOCK_SIZE,
+	.cra_ctxsize		= sizeof(struct async_aes_ctx),
+	.cra_alignmask		= 0,
+	.cra_type		= &crypto_ablkcipher_type,
+	.cra_module		= THIS_MODULE,
+	.cra_list		= LIST_HEAD_INIT(ablk_ecb_alg.cra_list),
+	.cra_init		= ablk_ecb_init,
+	.cra_exit		= ablk_exit,
+	.cra_u = {
+		.ablkcipher = {
+			.min_keysize	= AES_MIN_KEY_SIZE,
+			.max_keysize	= AES_MAX_KEY_SIZE,
+			.setkey		= ablk_set_key,
+			.encrypt	= ablk_encrypt,
+			.decrypt	= ablk_decrypt,
+		},
+	},
+};
+
+static struct crypto_alg ablk_cbc_alg = {
+	.cra_name		= "cbc(aes)",
+	.cra_driver_name	= "cbc-aes-neonbs",
+	.cra_priority		= 250,
+	.cra_flags		= CRYPTO_ALG_TYPE_ABLKCIPHER|CRYPTO_ALG_ASYNC,
+	.cra_blocksize		= AES_BLOCK_SIZE,
+	.cra_ctxsize		= sizeof(struct async_aes_ctx),
+	.cra_alignmask		= 0,
+	.cra_type		= &crypto_ablkcipher_type,
+	.cra_module		= THIS_MODULE,
+	.cra_list		= LIST_HEAD_INIT(ablk_cbc_alg.cra_list),
+	.cra_init		= ablk_cbc_init,
+	.cra_exit		= ablk_exit,
+	.cra_u = {
+		.ablkcipher = {
+			.min_keysize	= AES_MIN_KEY_SIZE,
+			.max_keysize	= AES_MAX_KEY_SIZE,
+			.ivsize		= AES_BLOCK_SIZE,
+			.setkey		= ablk_set_key,
+			.encrypt	= ablk_encrypt,
+			.decrypt	= ablk_decrypt,
+		},
+	},
+};
+
+static struct crypto_alg ablk_ctr_alg = {
+	.cra_name		= "ctr(aes)",
+	.cra_driver_name	= "ctr-aes-neonbs",
+	.cra_priority		= 250,
+	.cra_flags		= CRYPTO_ALG_TYPE_ABLKCIPHER|CRYPTO_ALG_ASYNC,
+	.cra_blocksize		= 1,
+	.cra_ctxsize		= sizeof(struct async_aes_ctx),
+	.cra_alignmask		= 0,
+	.cra_type		= &crypto_ablkcipher_type,
+	.cra_module		= THIS_MODULE,
+	.cra_list		= LIST_HEAD_INIT(ablk_ctr_alg.cra_list),
+	.cra_init		= ablk_ctr_init,
+	.cra_exit		= ablk_exit,
+	.cra_u = {
+		.ablkcipher = {
+			.min_keysize	= AES_MIN_KEY_SIZE,
+			.max_keysize	= AES_MAX_KEY_SIZE,
+			.ivsize		= AES_BLOCK_SIZE,
+			.setkey		= ablk_set_key,
+			.encrypt	= ablk_encrypt,
+			.decrypt	= ablk_encrypt,
+			.geniv		= "chainiv",
+		},
+	},
+};
+
+static struct crypto_alg ablk_xts_alg = {
+	.cra_name		= "xts(aes)",
+	.cra_driver_name	= "xts-aes-neonbs",
+	.cra_priority		= 250,
+	.cra_flags		= CRYPTO_ALG_TYPE_ABLKCIPHER|CRYPTO_ALG_ASYNC,
+	.cra_blocksize		= AES_BLOCK_SIZE,
+	.cra_ctxsize		= sizeof(struct async_aes_ctx),
+	.cra_alignmask		= 0,
+	.cra_type		= &crypto_ablkcipher_type,
+	.cra_module		= THIS_MODULE,
+	.cra_list		= LIST_HEAD_INIT(ablk_xts_alg.cra_list),
+	.cra_init		= ablk_xts_init,
+	.cra_exit		= ablk_exit,
+	.cra_u = {
+		.ablkcipher = {
+			.min_keysize	= 2 * AES_MIN_KEY_SIZE,
+			.max_keysize	= 2 * AES_MAX_KEY_SIZE,
+			.ivsize		= AES_BLOCK_SIZE,
+			.setkey		= ablk_set_key,
+			.encrypt	= ablk_encrypt,
+			.decrypt	= ablk_decrypt,
+		},
+	},
+};
+
+static struct crypto_alg *aesbs_algs[] = {
+	&blk_ecb_alg, &blk_cbc_alg, &blk_ctr_alg, &blk_xts_alg,
+	&ablk_ecb_alg, &ablk_cbc_alg, &ablk_ctr_alg, &ablk_xts_alg,
+};
+
+static int __init aesbs_mod_init(void)
+{
+	int i, err;
+
+	if (!cpu_has_neon()) {
+		pr_info("aes-neonbs: NEON is not available.\n");
+		return -ENODEV;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(aesbs_algs); i++) {
+		err = crypto_register_alg(aesbs_algs[i]);
+		if (err)
+			goto unregister;
+	}
+	return 0;
+
+unregister:
+	while (--i >= 0)
+		crypto_unregister_alg(aesbs_algs[i]);
+	return err;
+}
+
+static void __exit aesbs_mod_exit(void)
+{
+	int i;
+
+	for (i = ARRAY_SIZE(aesbs_algs) - 1; i >= 0; i--)
+		crypto_unregister_alg(aesbs_algs[i]);
+}
+
+module_init(aesbs_mod_init);
+module_exit(aesbs_mod_exit);
+
+MODULE_DESCRIPTION("Bit sliced AES in ECB/CBC/CTR/XTS modes using NEON");
+MODULE_LICENSE("GPL");
+MODULE_ALIAS("ecb(aes)");
+MODULE_ALIAS("cbc(aes)");
+MODULE_ALIAS("ctr(aes)");
+MODULE_ALIAS("xts(aes)");
@@ -0,0 +1,220 @@
+/*
+ * CRC32c (Castagnoli) using NEON
+ *
+ * Copyright (C) ST-Ericsson SA 2012
+ * License terms:  GNU General Public License (GPL), version 2
+ *
+ * Same interface as crypto/crc32c.c.  Buffers of at least
+ * crc32_neon_min_len bytes are folded with NEON by arch/arm/lib/crc32-neon.c,
+ * the rest and the last len % 16 bytes go through a byte table.  NEON cannot
+ * be used in interrupt context, where the table is used for everything.
+ */
+#define pr_fmt(fmt)	KBUILD_MODNAME ": " fmt
+
+#include <crypto/internal/hash.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <asm/crc32.h>
+#include <asm/neon.h>
+
+#define CHKSUM_BLOCK_SIZE	1
+#define CHKSUM_DIGEST_SIZE	4
+
+#define CRC32C_POLY_LE		0x82f63b78
+
+struct chksum_ctx {
+	u32 key;
+};
+
+struct chksum_desc_ctx {
+	u32 crc;
+};
+
+static u32 crc32c_table[256];
+
+static u32 crc32c_neon(u32 crc, const u8 *data, unsigned int length)
+{
+	if (crc32_neon_usable(length)) {
+		crc = crc32_neon_update(crc, data, length,
+					&crc32_neon_c_consts);
+		data += length & ~15;
+		length &= 15;
+	}
+
+	while (length--)
+		crc = crc32c_table[(crc ^ *data++) & 0xff] ^ (crc >> 8);
+
+	return crc;
+}
+
+/*
+ * testmgr checks the algorithm when it is registered, with vectors too
+ * short for NEON. Check the NEON path against the table from
+ * crc32_neon_min_len up, once arch/arm/lib/crc32-neon.c has set it.
+ */
+static int __init crc32c_neon_selftest(void)
+{
+	unsigned int len, off, i;
+	u32 seed = 0, want;
+	u8 *buf;
+	int err = 0;
+
+	if (crc32_neon_min_len > PAGE_SIZE - 16)
+		return 0;
+
+	buf = kmalloc(PAGE_SIZE, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+	crc32_neon_test_fill(buf, PAGE_SIZE);
+
+	for (len = crc32_neon_min_len; len <= PAGE_SIZE - 16; len += 61)
+		for (off = 0; off < 16; off += 5) {
+			want = crc32_neon_test_seed(&seed);
+			for (i = 0; i < len; i++)
+				want = crc32c_table[(want ^ buf[off + i]) &
+						    0xff] ^ (want >> 8);
+			if (crc32c_neon(seed, buf + off, len) != want) {
+				pr_err("self-test failed: len %u offset %u\n",
+				       len, off);
+				err = -EINVAL;
+				goto out;
+			}
+		}
+out:
+	kfree(buf);
+	return err;
+}
+
+static int chksum_init(struct shash_desc *desc)
+{
+	struct chksum_ctx *mctx = crypto_shash_ctx(desc->tfm);
+	struct chksum_desc_ctx *ctx = shash_desc_ctx(desc);
+
+	ctx->crc = mctx->key;
+
+	return 0;
+}
+
+static int chksum_setkey(struct crypto_shash *tfm, const u8 *key,
+			 unsigned int keylen)
+{
+	struct chksum_ctx *mctx = crypto_shash_ctx(tfm);
+
+	if (keylen != sizeof(mctx->key)) {
+		crypto_shash_set_flags(tfm, CRYPTO_TFM_RES_BAD_KEY_LEN);
+		return -EINVAL;
+	}
+	mctx->key = le32_to_cpu(*(__le32 *)key);
+	return 0;
+}
+
+static int chksum_update(struct shash_desc *desc, const u8 *data,
+			 unsigned int length)
+{
+	struct chksum_desc_ctx *ctx = shash_desc_ctx(desc);
+
+	ctx->crc = crc32c_neon(ctx->crc, data, length);
+	return 0;
+}
+
+static int chksum_final(struct shash_desc *desc, u8 *out)
+{
+	struct chksum_desc_ctx *ctx = shash_desc_ctx(desc);
+
+	*(__le32 *)out = ~cpu_to_le32p(&ctx->crc);
+	return 0;
+}
+
+static int __chksum_finup(u32 *crcp, const u8 *data, unsigned int len, u8 *out)
+{
+	*(__le32 *)out = ~cpu_to_le32(crc32c_neon(*crcp, data, len));
+	return 0;
+}
+
+static int chksum_finup(struct shash_desc *desc, const u8 *data,
+			unsigned int len, u8 *out)
+{
+	struct chksum_desc_ctx *ctx = shash_desc_ctx(desc);
+
+	return __chksum_finup(&ctx->crc, data, len, out);
+}
+
+static int chksum_digest(struct shash_desc *desc, const u8 *data,
+			 unsigned int length, u8 *out)
+{
+	struct chksum_ctx *mctx = crypto_shash_ctx(desc->tfm);
+
+	return __chksum_finup(&mctx->key, data, length, out);
+}
+
+static int crc32c_cra_init(struct crypto_tfm *tfm)
+{
+	struct chksum_ctx *mctx = crypto_tfm_ctx(tfm);
+
+	mctx->key = ~0;
+	return 0;
+}
+
+static struct shash_alg alg = {
+	.digestsize		=	CHKSUM_DIGEST_SIZE,
+	.setkey			=	chksum_setkey,
+	.init			=	chksum_init,
+	.update			=	chksum_update,
+	.final			=	chksum_final,
+	.finup			=	chksum_finup,
+	.digest			=	chksum_digest,
+	.descsize		=	sizeof(struct chksum_desc_ctx),
+	.base			=	{
+		.cra_name		=	"crc32c",
+		.cra_driver_name	=	"crc32c-neon",
+		.cra_priority		=	200,
+		.cra_blocksize		=	CHKSUM_BLOCK_SIZE,
+		.cra_alignmask		=	3,
+		.cra_ctxsize		=	sizeof(struct chksum_ctx),
+		.cra_module		=	THIS_MODULE,
+		.cra_init		=	crc32c_cra_init,
+	}
+};
+
+static int __init crc32c_neon_mod_init(void)
+{
+	u32 crc;
+	int i, j;
+	int err;
+
+	if (!cpu_has_neon())
+		return -ENODEV;
+
+	for (i = 0; i < 256; i++) {
+		crc = i;
+		for (j = 0; j < 8; j++)
+			crc = (crc >> 1) ^ ((crc & 1) ? CRC32C_POLY_LE : 0);
+		crc32c_table[i] = crc;
+	}
+
+	err = crc32c_neon_selftest();
+	if (err)
+		return err;
+
+	return crypto_register_shash(&alg);
+}
+
+static void __exit crc32c_neon_mod_fini(void)
+{
+	crypto_unregister_shash(&alg);
+}
+
+/* Built in, this has to run after the late_initcall in crc32-neon.c */
+#ifdef MODULE
+module_init(crc32c_neon_mod_init);
+#else
+late_initcall_sync(crc32c_neon_mod_init);
+#endif
+module_exit(crc32c_neon_mod_fini);
+
+MODULE_DESCRIPTION("CRC32c (Castagnoli) using NEON");
+MODULE_LICENSE("GPL");
+MODULE_ALIAS("crc32c");
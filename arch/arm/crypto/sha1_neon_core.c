@@ -0,0 +1,55 @@
+/*
+ * SHA-1 message schedule using NEON
+ *
+ * Copyright (C) ST-Ericsson SA 2012
+ * License terms:  GNU General Public License (GPL), version 2
+ *
+ * Four schedule words are computed per step. W[t + 3] depends on W[t],
+ * so that lane is first computed with W[t] taken as zero and then fixed
+ * up with rol(W[t], 1) once W[t] is known.
+ *
+ * This file is built with -mfpu=neon; see sha1_neon_glue.c.
+ */
+#include <arm_neon.h>
+
+#include "sha_neon.h"
+
+static inline uint32x4_t rol1(uint32x4_t x)
+{
+	return vsliq_n_u32(vshrq_n_u32(x, 31), x, 1);
+}
+
+static inline uint32x4_t load_be(const u8 *p)
+{
+	return vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p)));
+}
+
+void sha1_neon_schedule(u32 wk[80], const u8 *data)
+{
+	static const u32 k[4] = { 0x5a827999, 0x6ed9eba1, 0x8f1bbcdc,
+				  0xca62c1d6 };
+	const uint32x4_t zero = vdupq_n_u32(0);
+	uint32x4_t w[4], x;
+	int t;
+
+		for (t = 0; t < 16; t += 4) {
+		w[t / 4] = load_be(data + 4 * t);
+		vst1q_u32(wk + t, vaddq_u32(w[t / 4], vdupq_n_u32(k[0])));
+	}
+
+	/* w[0] .. w[3] hold W[t - 16] .. W[t - 1] */
+	for (t = 16; t < 80; t += 4) {
+		const uint32x4_t w16 = w[0], w12 = w[1], w8 = w[2], w4 = w[3];
+
+		x = veorq_u32(vextq_u32(w4, zero, 1), w8);
+		x = veorq_u32(x, vextq_u32(w16, w12, 2));
+		x = rol1(veorq_u32(x, w16));
+		x = veorq_u32(x, rol1(vextq_u32(zero, x, 1)));
+
+		w[0] = w12;
+		w[1] = w8;
+		w[2] = w4;
+		w[3] = x;
+		vst1q_u32(wk + t, vaddq_u32(x, vdupq_n_u32(k[t / 20])));
+	}
+}
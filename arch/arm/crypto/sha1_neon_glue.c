@@ -0,0 +1,231 @@
+/*
+ * Glue code for the SHA-1 Secure Hash Algorithm using NEON
+ *
+ * Copyright (C) ST-Ericsson SA 2012
+ * License terms:  GNU General Public License (GPL), version 2
+ *
+ * The message schedule is expanded four words at a time with NEON (see
+ * sha1_neon_core.c), the rounds run on the integer pipeline with W + K
+ * already in place. NEON cannot be used in interrupt context, where the
+ * schedule is expanded with integer code instead.
+ */
+#define pr_fmt(fmt)	KBUILD_MODNAME ": " fmt
+
+#include <crypto/internal/hash.h>
+#include <crypto/sha.h>
+#include <linux/bitops.h>
+#include <linux/hardirq.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/string.h>
+#include <linux/types.h>
+#include <asm/byteorder.h>
+#include <asm/neon.h>
+#include <asm/unaligned.h>
+
+#include "sha_neon.h"
+
+static const u32 sha1_k[4] = {
+	0x5a827999, 0x6ed9eba1, 0x8f1bbcdc, 0xca62c1d6
+};
+
+static void sha1_schedule(u32 wk[80], const u8 *data)
+{
+	u32 w[16], x;
+	int t;
+
+	for (t = 0; t < 80; t++) {
+		if (t < 16)
+			x = get_unaligned_be32(data + 4 * t);
+		else
+			x = rol32(w[(t + 13) & 15] ^ w[(t + 8) & 15] ^
+				  w[(t + 2) & 15] ^ w[t & 15], 1);
+		w[t & 15] = x;
+		wk[t] = x + sha1_k[t / 20];
+	}
+}
+
+#define SHA1_ROUND(f)	do {						\
+	u32 tmp = rol32(a, 5) + (f) + e + wk[t];			\
+	e = d;								\
+	d = c;								\
+	c = rol32(b, 30);						\
+	b = a;								\
+	a = tmp;							\
+} while (0)
+
+static void sha1_rounds(u32 *state, const u32 *wk)
+{
+	u32 a = state[0], b = state[1], c = state[2], d = state[3];
+	u32 e = state[4];
+	int t;
+
+	for (t = 0; t < 20; t++)
+		SHA1_ROUND(d ^ (b & (c ^ d)));
+	for (; t < 40; t++)
+		SHA1_ROUND(b ^ c ^ d);
+	for (; t < 60; t++)
+		SHA1_ROUND((b & c) | (d & (b | c)));
+	for (; t < 80; t++)
+		SHA1_ROUND(b ^ c ^ d);
+
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+	state[4] += e;
+}
+
+static void sha1_neon_blocks(u32 *state, const u8 *data, unsigned int blocks)
+{
+	bool neon = !in_interrupt();
+	u32 wk[80];
+
+	if (neon)
+		kernel_neon_begin();
+	while (blocks--) {
+		if (neon)
+			sha1_neon_schedule(wk, data);
+		else
+			sha1_schedule(wk, data);
+		sha1_rounds(state, wk);
+		data += SHA1_BLOCK_SIZE;
+	}
+	if (neon)
+		kernel_neon_end();
+
+	memset(wk, 0, sizeof(wk));
+}
+
+static int sha1_neon_init(struct shash_desc *desc)
+{
+	struct sha1_state *sctx = shash_desc_ctx(desc);
+
+	*sctx = (struct sha1_state){
+		.state = { SHA1_H0, SHA1_H1, SHA1_H2, SHA1_H3, SHA1_H4 },
+	};
+
+	return 0;
+}
+
+static int sha1_neon_update(struct shash_desc *desc, const u8 *data,
+			    unsigned int len)
+{
+	struct sha1_state *sctx = shash_desc_ctx(desc);
+	unsigned int partial = sctx->count % SHA1_BLOCK_SIZE;
+	unsigned int blocks;
+
+	sctx->count += len;
+
+	if (partial + len < SHA1_BLOCK_SIZE) {
+		memcpy(sctx->buffer + partial, data, len);
+		return 0;
+	}
+
+	if (partial) {
+		unsigned int fill = SHA1_BLOCK_SIZE - partial;
+
+		memcpy(sctx->buffer + partial, data, fill);
+		sha1_neon_blocks(sctx->state, sctx->buffer, 1);
+		data += fill;
+		len -= fill;
+	}
+
+	blocks = len / SHA1_BLOCK_SIZE;
+	if (blocks) {
+		sha1_neon_blocks(sctx->state, data, blocks);
+		data += blocks * SHA1_BLOCK_SIZE;
+		len -= blocks * SHA1_BLOCK_SIZE;
+	}
+
+	memcpy(sctx->buffer, data, len);
+
+	return 0;
+}
+
+/* Add padding and return the message digest. */
+static int sha1_neon_final(struct shash_desc *desc, u8 *out)
+{
+	struct sha1_state *sctx = shash_desc_ctx(desc);
+	unsigned int i, index, padlen;
+	__be32 *dst = (__be32 *)out;
+	__be64 bits;
+	static const u8 padding[SHA1_BLOCK_SIZE] = { 0x80, };
+
+	bits = cpu_to_be64(sctx->count << 3);
+
+	/* Pad out to 56 mod 64 and append length */
+	index = sctx->count % SHA1_BLOCK_SIZE;
+	padlen = (index < 56) ? (56 - index) : ((SHA1_BLOCK_SIZE+56) - index);
+	sha1_neon_update(desc, padding, padlen);
+	sha1_neon_update(desc, (const u8 *)&bits, sizeof(bits));
+
+	/* Store state in digest */
+	for (i = 0; i < 5; i++)
+		dst[i] = cpu_to_be32(sctx->state[i]);
+
+	/* Wipe context */
+	memset(sctx, 0, sizeof(*sctx));
+
+	return 0;
+}
+
+static int sha1_neon_export(struct shash_desc *desc, void *out)
+{
+	struct sha1_state *sctx = shash_desc_ctx(desc);
+
+	memcpy(out, sctx, sizeof(*sctx));
+
+	return 0;
+}
+
+static int sha1_neon_import(struct shash_desc *desc, const void *in)
+{
+	struct sha1_state *sctx = shash_desc_ctx(desc);
+
+	memcpy(sctx, in, sizeof(*sctx));
+
+	return 0;
+}
+
+static struct shash_alg alg = {
+	.digestsize	=	SHA1_DIGEST_SIZE,
+	.init		=	sha1_neon_init,
+	.update		=	sha1_neon_update,
+	.final		=	sha1_neon_final,
+	.export		=	sha1_neon_export,
+	.import		=	sha1_neon_import,
+	.descsize	=	sizeof(struct sha1_state),
+	.statesize	=	sizeof(struct sha1_state),
+	.base		=	{
+		.cra_name	=	"sha1",
+		.cra_driver_name=	"sha1-neon",
+		.cra_priority	=	250,
+		.cra_flags	=	CRYPTO_ALG_TYPE_SHASH,
+		.cra_blocksize	=	SHA1_BLOCK_SIZE,
+		.cra_module	=	THIS_MODULE,
+	}
+};
+
+static int __init sha1_neon_mod_init(void)
+{
+	if (!cpu_has_neon()) {
+		pr_info("NEON is not available.\n");
+		return -ENODEV;
+	}
+
+	return crypto_register_shash(&alg);
+}
+
+static void __exit sha1_neon_mod_fini(void)
+{
+	crypto_unregister_shash(&alg);
+}
+
+module_init(sha1_neon_mod_init);
+module_exit(sha1_neon_mod_fini);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("SHA1 Secure Hash Algorithm, NEON accelerated");
+
+MODULE_ALIAS("sha1");
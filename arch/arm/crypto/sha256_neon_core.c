@@ -0,0 +1,82 @@
+/*
+ * SHA-256 message schedule using NEON
+ *
+ * Copyright (C) ST-Ericsson SA 2012
+ * License terms:  GNU General Public License (GPL), version 2
+ *
+ * Four schedule words are computed per step. The W[t - 16], W[t - 15]
+ * and W[t - 7] terms only reach back to earlier steps and are done on
+ * all four lanes; sigma1 of W[t - 2] needs the first half of the current
+ * step for its second half, so it is done two lanes at a time.
+ *
+ * This file is built with -mfpu=neon; see sha256_neon_glue.c.
+ */
+#include <arm_neon.h>
+
+#include "sha_neon.h"
+
+static const u32 sha256_k[64] __aligned(16) = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+#define ROR(x, n)	vsriq_n_u32(vshlq_n_u32(x, 32 - (n)), x, n)
+#define ROR2(x, n)	vsri_n_u32(vshl_n_u32(x, 32 - (n)), x, n)
+
+static inline uint32x4_t sigma0(uint32x4_t x)
+{
+	return veorq_u32(veorq_u32(ROR(x, 7), ROR(x, 18)), vshrq_n_u32(x, 3));
+}
+
+static inline uint32x2_t sigma1(uint32x2_t x)
+{
+	return veor_u32(veor_u32(ROR2(x, 17), ROR2(x, 19)), vshr_n_u32(x, 10));
+}
+
+static inline uint32x4_t load_be(const u8 *p)
+{
+	return vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(p)));
+}
+
+void sha256_neon_schedule(u32 wk[64], const u8 *data)
+{
+	uint32x4_t w[4], x;
+	uint32x2_t lo, hi;
+	int t;
+
+	for (t = 0; t < 16; t += 4) {
+		w[t / 4] = load_be(data + 4 * t);
+		vst1q_u32(wk + t, vaddq_u32(w[t / 4], vld1q_u32(sha256_k + t)));
+	}
+
+	/* w[0] .. w[3] hold W[t - 16] .. W[t - 1] */
+	for (t = 16; t < 64; t += 4) {
+		const uint32x4_t w16 = w[0], w12 = w[1], w8 = w[2], w4 = w[3];
+
+		x = vaddq_u32(w16, sigma0(vextq_u32(w16, w12, 1)));
+		x = vaddq_u32(x, vextq_u32(w8, w4, 1));
+		lo = vadd_u32(vget_low_u32(x), sigma1(vget_high_u32(w4)));
+		hi = vadd_u32(vget_high_u32(x), sigma1(lo));
+		x = vcombine_u32(lo, hi);
+
+		w[0] = w12;
+		w[1] = w8;
+		w[2] = w4;
+		w[3] = x;
+		vst1q_u32(wk + t, vaddq_u32(x, vld1q_u32(sha256_k + t)));
+	}
+}
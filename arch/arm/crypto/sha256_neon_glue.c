@@ -0,0 +1,325 @@
+/*
+ * Glue code for the SHA-224/SHA-256 Secure Hash Algorithms using NEON
+ *
+ * Copyright (C) ST-Ericsson SA 2012
+ * License terms:  GNU General Public License (GPL), version 2
+ *
+ * As for SHA-1, the message schedule is expanded with NEON (see
+ * sha256_neon_core.c) and the rounds run on the integer pipeline with
+ * W + K already in place. In interrupt context the schedule is expanded
+ * with integer code instead.
+ */
+#define pr_fmt(fmt)	KBUILD_MODNAME ": " fmt
+
+#include <crypto/internal/hash.h>
+#include <crypto/sha.h>
+#include <linux/bitops.h>
+#include <linux/hardirq.h>
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/string.h>
+#include <linux/types.h>
+#include <asm/byteorder.h>
+#include <asm/neon.h>
+#include <asm/unaligned.h>
+
+#include "sha_neon.h"
+
+static const u32 sha256_k[64] = {
+	0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+	0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+	0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+	0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+	0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+	0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+	0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+	0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+	0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+	0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+	0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+	0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+	0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+	0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+	0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+	0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+static inline u32 s0(u32 x)
+{
+	return ror32(x, 7) ^ ror32(x, 18) ^ (x >> 3);
+}
+
+static inline u32 s1(u32 x)
+{
+	return ror32(x, 17) ^ ror32(x, 19) ^ (x >> 10);
+}
+
+static inline u32 e0(u32 x)
+{
+	return ror32(x, 2) ^ ror32(x, 13) ^ ror32(x, 22);
+}
+
+static inline u32 e1(u32 x)
+{
+	return ror32(x, 6) ^ ror32(x, 11) ^ ror32(x, 25);
+}
+
+static void sha256_schedule(u32 wk[64], const u8 *data)
+{
+	u32 w[16], x;
+	int t;
+
+	for (t = 0; t < 64; t++) {
+		if (t < 16)
+			x = get_unaligned_be32(data + 4 * t);
+		else
+			x = s1(w[(t + 14) & 15]) + w[(t + 9) & 15] +
+			    s0(w[(t + 1) & 15]) + w[t & 15];
+		w[t & 15] = x;
+		wk[t] = x + sha256_k[t];
+	}
+}
+
+static void sha256_rounds(u32 *state, const u32 *wk)
+{
+	u32 a = state[0], b = state[1], c = state[2], d = state[3];
+	u32 e = state[4], f = state[5], g = state[6], h = state[7];
+	u32 t1, t2;
+	int t;
+
+	for (t = 0; t < 64; t++) {
+		t1 = h + e1(e) + (g ^ (e & (f ^ g))) + wk[t];
+		t2 = e0(a) + ((a & b) | (c & (a | b)));
+		h = g;
+		g = f;
+		f = e;
+		e = d + t1;
+		d = c;
+		c = b;
+		b = a;
+		a = t1 + t2;
+	}
+
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+	state[4] += e;
+	state[5] += f;
+	state[6] += g;
+	state[7] += h;
+}
+
+static void sha256_neon_blocks(u32 *state, const u8 *data,
+			       unsigned int blocks)
+{
+	bool neon = !in_interrupt();
+	u32 wk[64];
+
+	if (neon)
+		kernel_neon_begin();
+	while (blocks--) {
+		if (neon)
+			sha256_neon_schedule(wk, data);
+		else
+			sha256_schedule(wk, data);
+		sha256_rounds(state, wk);
+		data += SHA256_BLOCK_SIZE;
+	}
+	if (neon)
+		kernel_neon_end();
+
+	memset(wk, 0, sizeof(wk));
+}
+
+static int sha224_neon_init(struct shash_desc *desc)
+{
+	struct sha256_state *sctx = shash_desc_ctx(desc);
+
+	*sctx = (struct sha256_state){
+		.state = { SHA224_H0, SHA224_H1, SHA224_H2, SHA224_H3,
+			   SHA224_H4, SHA224_H5, SHA224_H6, SHA224_H7 },
+	};
+
+	return 0;
+}
+
+static int sha256_neon_init(struct shash_desc *desc)
+{
+	struct sha256_state *sctx = shash_desc_ctx(desc);
+
+	*sctx = (struct sha256_state){
+		.state = { SHA256_H0, SHA256_H1, SHA256_H2, SHA256_H3,
+			   SHA256_H4, SHA256_H5, SHA256_H6, SHA256_H7 },
+	};
+
+	return 0;
+}
+
+static int sha256_neon_update(struct shash_desc *desc, const u8 *data,
+			      unsigned int len)
+{
+	struct sha256_state *sctx = shash_desc_ctx(desc);
+	unsigned int partial = sctx->count % SHA256_BLOCK_SIZE;
+	unsigned int blocks;
+
+	sctx->count += len;
+
+	if (partial + len < SHA256_BLOCK_SIZE) {
+		memcpy(sctx->buf + partial, data, len);
+		return 0;
+	}
+
+	if (partial) {
+		unsigned int fill = SHA256_BLOCK_SIZE - partial;
+
+		memcpy(sctx->buf + partial, data, fill);
+		sha256_neon_blocks(sctx->state, sctx->buf, 1);
+		data += fill;
+		len -= fill;
+	}
+
+	blocks = len / SHA256_BLOCK_SIZE;
+	if (blocks) {
+		sha256_neon_blocks(sctx->state, data, blocks);
+		data += blocks * SHA256_BLOCK_SIZE;
+		len -= blocks * SHA256_BLOCK_SIZE;
+	}
+
+	memcpy(sctx->buf, data, len);
+
+	return 0;
+}
+
+static int sha256_neon_final(struct shash_desc *desc, u8 *out)
+{
+	struct sha256_state *sctx = shash_desc_ctx(desc);
+	__be32 *dst = (__be32 *)out;
+	__be64 bits;
+	unsigned int index, pad_len;
+	int i;
+	static const u8 padding[SHA256_BLOCK_SIZE] = { 0x80, };
+
+	/* Save number of bits */
+	bits = cpu_to_be64(sctx->count << 3);
+
+	/* Pad out to 56 mod 64. */
+	index = sctx->count % SHA256_BLOCK_SIZE;
+	pad_len = (index < 56) ? (56 - index) : ((64+56) - index);
+	sha256_neon_update(desc, padding, pad_len);
+
+	/* Append length (before padding) */
+	sha256_neon_update(desc, (const u8 *)&bits, sizeof(bits));
+
+	/* Store state in digest */
+	for (i = 0; i < 8; i++)
+		dst[i] = cpu_to_be32(sctx->state[i]);
+
+	/* Zeroize sensitive information. */
+	memset(sctx, 0, sizeof(*sctx));
+
+	return 0;
+}
+
+static int sha224_neon_final(struct shash_desc *desc, u8 *hash)
+{
+	u8 D[SHA256_DIGEST_SIZE];
+
+	sha256_neon_final(desc, D);
+
+	memcpy(hash, D, SHA224_DIGEST_SIZE);
+	memset(D, 0, SHA256_DIGEST_SIZE);
+
+	return 0;
+}
+
+static int sha256_neon_export(struct shash_desc *desc, void *out)
+{
+	struct sha256_state *sctx = shash_desc_ctx(desc);
+
+	memcpy(out, sctx, sizeof(*sctx));
+
+	return 0;
+}
+
+static int sha256_neon_import(struct shash_desc *desc, const void *in)
+{
+	struct sha256_state *sctx = shash_desc_ctx(desc);
+
+	memcpy(sctx, in, sizeof(*sctx));
+
+	return 0;
+}
+
+static struct shash_alg sha256_alg = {
+	.digestsize	=	SHA256_DIGEST_SIZE,
+	.init		=	sha256_neon_init,
+	.update		=	sha256_neon_update,
+	.final		=	sha256_neon_final,
+	.export		=	sha256_neon_export,
+	.import		=	sha256_neon_import,
+	.descsize	=	sizeof(struct sha256_state),
+	.statesize	=	sizeof(struct sha256_state),
+	.base		=	{
+		.cra_name	=	"sha256",
+		.cra_driver_name=	"sha256-neon",
+		.cra_priority	=	250,
+		.cra_flags	=	CRYPTO_ALG_TYPE_SHASH,
+		.cra_blocksize	=	SHA256_BLOCK_SIZE,
+		.cra_module	=	THIS_MODULE,
+	}
+};
+
+static struct shash_alg sha224_alg = {
+	.digestsize	=	SHA224_DIGEST_SIZE,
+	.init		=	sha224_neon_init,
+	.update		=	sha256_neon_update,
+	.final		=	sha224_neon_final,
+	.export		=	sha256_neon_export,
+	.import		=	sha256_neon_import,
+	.descsize	=	sizeof(struct sha256_state),
+	.statesize	=	sizeof(struct sha256_state),
+	.base		=	{
+		.cra_name	=	"sha224",
+		.cra_driver_name=	"sha224-neon",
+		.cra_priority	=	250,
+		.cra_flags	=	CRYPTO_ALG_TYPE_SHASH,
+		.cra_blocksize	=	SHA224_BLOCK_SIZE,
+		.cra_module	=	THIS_MODULE,
+	}
+};
+
+static int __init sha256_neon_mod_init(void)
+{
+	int ret;
+
+	if (!cpu_has_neon()) {
+		pr_info("NEON is not available.\n");
+		return -ENODEV;
+	}
+
+	ret = crypto_register_shash(&sha224_alg);
+	if (ret < 0)
+		return ret;
+
+	ret = crypto_register_shash(&sha256_alg);
+	if (ret < 0)
+		crypto_unregister_shash(&sha224_alg);
+
+	return ret;
+}
+
+static void __exit sha256_neon_mod_fini(void)
+{
+	crypto_unregister_shash(&sha256_alg);
+	crypto_unregister_shash(&sha224_alg);
+}
+
+module_init(sha256_neon_mod_init);
+module_exit(sha256_neon_mod_fini);
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("SHA-224 and SHA-256 Secure Hash Algorithms, NEON accelerated");
+
+MODULE_ALIAS("sha224");
+MODULE_ALIAS("sha256");
@@ -0,0 +1,20 @@
+/*
+ * NEON message schedules for SHA-1 and SHA-256
+ *
+ * Copyright (C) ST-Ericsson SA 2012
+ * License terms:  GNU General Public License (GPL), version 2
+ */
+#ifndef __ARM_CRYPTO_SHA_NEON_H
+#define __ARM_CRYPTO_SHA_NEON_H
+
+#include <linux/types.h>
+
+/*
+ * Expand one 64 byte block into W[t] + K[t] for every round, leaving
+ * only the round function itself to the integer pipeline. Must be called
+ * between kernel_neon_begin() and kernel_neon_end().
+ */
+void sha1_neon_schedule(u32 wk[80], const u8 *data);
+void sha256_neon_schedule(u32 wk[64], const u8 *data);
+
+#endif /* __ARM_CRYPTO_SHA_NEON_H */
@@ -0,0 +1,65 @@
+/*
+ *  arch/arm/include/asm/crc32.h
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef __ASM_ARM_CRC32_H
+#define __ASM_ARM_CRC32_H
+
+#include <linux/types.h>
+
+/*
+ * Folding constants for a bit reflected CRC32, see crc32-neon.c.  k1/k2
+ * fold by 512 bits, k3/k4 by 128 bits, k5 from 64 to 32 bits; mu and poly
+ * are the Barrett reduction constants.
+ */
+struct crc32_neon_consts {
+	u64	k1, k2, k3, k4, k5;
+	u64	mu, poly;
+};
+
+/* NEON core: len >= 64 and a multiple of 16, NEON enabled by the caller */
+u32 crc32_neon_fold(u32 crc, const u8 *p, size_t len,
+		    const struct crc32_neon_consts *c);
+
+#ifndef __ARM_NEON__
+#include <linux/hardirq.h>
+
+extern const struct crc32_neon_consts crc32_neon_le_consts;
+extern const struct crc32_neon_consts crc32_neon_c_consts;
+
+/* Shortest buffer worth the NEON path, ~0 until calibrated */
+extern size_t crc32_neon_min_len;
+
+/*
+ * Update crc over the largest multiple of 16 bytes of p[0..len) and
+ * return it; the caller does the remaining len & 15 bytes.
+ */
+u32 crc32_neon_update(u32 crc, const u8 *p, size_t len,
+		      const struct crc32_neon_consts *c);
+
+static inline bool crc32_neon_usable(size_t len)
+{
+	return len >= crc32_neon_min_len && !in_interrupt();
+}
+
+/* Self-test fixture shared by crc32-neon.c and the crc32c module */
+static inline void crc32_neon_test_fill(u8 *buf, size_t len)
+{
+	size_t i;
+
+	for (i = 0; i < len; i++)
+		buf[i] = i * 131 + (i >> 8);
+}
+
+/* Next of a repeatable sequence of initial CRC values */
+static inline u32 crc32_neon_test_seed(u32 *seed)
+{
+	*seed = *seed * 1103515245 + 12345;
+	return *seed;
+}
+#endif
+
+#endif /* __ASM_ARM_CRC32_H */
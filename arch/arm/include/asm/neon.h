@@ -0,0 +1,33 @@
+/*
+ *  arch/arm/include/asm/neon.h
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef __ASM_ARM_NEON_H
+#define __ASM_ARM_NEON_H
+
+#include <asm/hwcap.h>
+
+#define cpu_has_neon()		(!!(elf_hwcap & HWCAP_NEON))
+
+/*
+ * kernel_neon_begin() saves the user NEON/VFP state and enables the unit
+ * for the caller until kernel_neon_end(). Preemption is disabled in
+ * between and neither may be used in interrupt context. The pair may
+ * nest; only the outermost one saves the state and disables the unit.
+ *
+ * The NEON code itself must live in a separate compilation unit built
+ * with -mfpu=neon, so that GCC cannot move NEON instructions outside the
+ * begin/end pair. Calling kernel_neon_begin() from such a unit is caught
+ * at build time.
+ */
+#ifdef __ARM_NEON__
+#define kernel_neon_begin()	BUILD_BUG()
+#else
+void kernel_neon_begin(void);
+#endif
+void kernel_neon_end(void);
+
+#endif /* __ASM_ARM_NEON_H */
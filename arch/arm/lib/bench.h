@@ -0,0 +1,58 @@
+/*
+ * Helpers for the self-timing NEON test modules
+ *
+ * Copyright (C) ST-Ericsson SA 2012
+ * License terms:  GNU General Public License (GPL), version 2
+ *
+ * neon-copy-bench.c and neon-csum-test.c run their checks and timings
+ * from module_init and print the results.  Once done they fail to load
+ * with BENCH_DONE, as there is nothing to keep loaded.
+ */
+#ifndef __ARM_LIB_BENCH_H
+#define __ARM_LIB_BENCH_H
+
+#include <linux/errno.h>
+#include <linux/hrtimer.h>
+#include <linux/math64.h>
+#include <linux/types.h>
+
+#define BENCH_DONE		(-EAGAIN)
+
+/* Bytes per timed run, enough for the clock resolution not to matter */
+#define BENCH_MIN_BYTES		(8 * 1024 * 1024)
+
+struct bench_timer {
+	ktime_t	start;
+	u64	bytes;
+};
+
+/* Repeatable pseudo random test data */
+static inline u32 bench_rand(u32 *seed)
+{
+	*seed = *seed * 1103515245 + 12345;
+	return *seed;
+}
+
+static inline void bench_start(struct bench_timer *t)
+{
+	t->bytes = 0;
+	t->start = ktime_get();
+}
+
+/* Adds len processed bytes, true until BENCH_MIN_BYTES have been */
+static inline bool bench_more(struct bench_timer *t, size_t len)
+{
+	t->bytes += len;
+	return t->bytes < BENCH_MIN_BYTES;
+}
+
+/* Bytes per ns times scale: 100 gives 1/100 GB/s, 1000 gives MB/s */
+static inline unsigned long bench_stop(struct bench_timer *t,
+				       unsigned int scale)
+{
+	s64 ns = ktime_to_ns(ktime_sub(ktime_get(), t->start));
+
+	return ns > 0 ? div64_u64(t->bytes * scale, ns) : 0;
+}
+
+#endif /* __ARM_LIB_BENCH_H */
@@ -0,0 +1,142 @@
+/*
+ * CRC32 folding with NEON polynomial multiplies
+ *
+ * Copyright (C) ST-Ericsson SA 2012
+ * License terms:  GNU General Public License (GPL), version 2
+ *
+ * The buffer is folded 512 bits at a time into four 128-bit remainders,
+ * which are folded into one and then reduced to 32 bits by Barrett
+ * reduction, as in Intel's "Fast CRC Computation for Generic Polynomials
+ * Using PCLMULQDQ Instruction".  ARMv7 has no 64x64 bit carry-less
+ * multiply, so it is built from eight VMULL.P8 (Camara, Goncalves, Lopez,
+ * Dahab: "Fast Software Polynomial Multiplication on ARM Processors using
+ * the NEON Engine").
+ *
+ * Works on bit reflected CRCs of any 32-bit polynomial; the constants are
+ * in crc32-neon.c.  Little endian only.
+ *
+ * This file is built with -mfpu=neon.
+ */
+#include <linux/types.h>
+#include <asm/crc32.h>
+#include <arm_neon.h>
+
+static inline uint8x16_t pmull8(poly8x8_t a, poly8x8_t b)
+{
+	return vreinterpretq_u8_p16(vmull_p8(a, b));
+}
+
+/*
+ * Fold the high half of t into the low one above the given number of
+ * bytes, keeping only what belongs to the high half.
+ */
+static inline uint64x2_t fold_half(uint8x16_t t, uint64_t keep)
+{
+	uint64x1_t lo = vget_low_u64(vreinterpretq_u64_u8(t));
+	uint64x1_t hi = vget_high_u64(vreinterpretq_u64_u8(t));
+
+	lo = veor_u64(lo, vand_u64(hi, vcreate_u64(~keep)));
+	hi = vand_u64(hi, vcreate_u64(keep));
+	return vcombine_u64(lo, hi);
+}
+
+/* 64 x 64 -> 128 bit carry-less multiply */
+static inline uint64x2_t clmul(uint64x1_t a64, uint64x1_t b64)
+{
+	const poly8x8_t a = vreinterpret_p8_u64(a64);
+	const poly8x8_t b = vreinterpret_p8_u64(b64);
+	uint8x16_t l, m, n, k, d;
+	uint64x2_t t0, t1, t2, t3;
+
+	l = veorq_u8(pmull8(vext_p8(a, a, 1), b),	/* A1*B */
+		     pmull8(a, vext_p8(b, b, 1)));	/* A*B1 */
+	m = veorq_u8(pmull8(vext_p8(a, a, 2), b),	/* A2*B */
+		     pmull8(a, vext_p8(b, b, 2)));	/* A*B2 */
+	n = veorq_u8(pmull8(vext_p8(a, a, 3), b),	/* A3*B */
+		     pmull8(a, vext_p8(b, b, 3)));	/* A*B3 */
+	k = pmull8(a, vext_p8(b, b, 4));		/* A*B4 */
+	d = pmull8(a, b);				/* A*B */
+
+	t0 = fold_half(l, 0x0000ffffffffffffULL);
+	t1 = fold_half(m, 0x00000000ffffffffULL);
+	t2 = fold_half(n, 0x000000000000ffffULL);
+	t3 = fold_half(k, 0);
+
+	/* Shift each partial product into place: by 8, 16, 24, 32 bits */
+	l = vextq_u8(vreinterpretq_u8_u64(t0), vreinterpretq_u8_u64(t0), 15);
+	m = vextq_u8(vreinterpretq_u8_u64(t1), vreinterpretq_u8_u64(t1), 14);
+	n = vextq_u8(vreinterpretq_u8_u64(t2), vreinterpretq_u8_u64(t2), 13);
+	k = vextq_u8(vreinterpretq_u8_u64(t3), vreinterpretq_u8_u64(t3), 12);
+
+	d = veorq_u8(d, veorq_u8(l, m));
+	d = veorq_u8(d, veorq_u8(n, k));
+	return vreinterpretq_u64_u8(d);
+}
+
+/* x.lo * k.lo ^ x.hi * k.hi */
+static inline uint64x2_t fold(uint64x2_t x, uint64x2_t k)
+{
+	return veorq_u64(clmul(vget_low_u64(x), vget_low_u64(k)),
+			 clmul(vget_high_u64(x), vget_high_u64(k)));
+}
+
+static inline uint64x2_t load(const u8 *p)
+{
+	return vreinterpretq_u64_u8(vld1q_u8(p));
+}
+
+u32 crc32_neon_fold(u32 crc, const u8 *p, size_t len,
+		    const struct crc32_neon_consts *c)
+{
+	const uint64x2_t k12 = vcombine_u64(vcreate_u64(c->k1),
+					    vcreate_u64(c->k2));
+	const uint64x2_t k34 = vcombine_u64(vcreate_u64(c->k3),
+					    vcreate_u64(c->k4));
+	const uint64x2_t mask32 = vcombine_u64(vcreate_u64(0xffffffff),
+					       vcreate_u64(0));
+	const uint64x2_t zero = vdupq_n_u64(0);
+	uint64x2_t x0, x1, x2, x3, t;
+
+	x0 = veorq_u64(load(p), vcombine_u64(vcreate_u64(crc),
+					     vcreate_u64(0)));
+	x1 = load(p + 16);
+	x2 = load(p + 32);
+	x3 = load(p + 48);
+	p += 64;
+	len -= 64;
+
+	while (len >= 64) {
+		x0 = veorq_u64(fold(x0, k12), load(p));
+		x1 = veorq_u64(fold(x1, k12), load(p + 16));
+		x2 = veorq_u64(fold(x2, k12), load(p + 32));
+		x3 = veorq_u64(fold(x3, k12), load(p + 48));
+		p += 64;
+		len -= 64;
+	}
+
+	x0 = veorq_u64(fold(x0, k34), x1);
+	x0 = veorq_u64(fold(x0, k34), x2);
+	x0 = veorq_u64(fold(x0, k34), x3);
+
+	while (len >= 16) {
+		x0 = veorq_u64(fold(x0, k34), load(p));
+		p += 16;
+		len -= 16;
+	}
+
+	/* 128 -> 64 bits: x.lo * k4 ^ x.hi */
+	x0 = veorq_u64(clmul(vget_low_u64(x0), vcreate_u64(c->k4)),
+		       vcombine_u64(vget_high_u64(x0), vcreate_u64(0)));
+
+	/* 64 -> 32 bits: (x & 0xffffffff) * k5 ^ x >> 32 */
+	t = clmul(vget_low_u64(vandq_u64(x0, mask32)), vcreate_u64(c->k5));
+	x0 = veorq_u64(t, vreinterpretq_u64_u8(vextq_u8(
+		vreinterpretq_u8_u64(x0), vreinterpretq_u8_u64(zero), 4)));
+
+	/* Barrett reduction */
+	t = clmul(vget_low_u64(vandq_u64(x0, mask32)), vcreate_u64(c->mu));
+	t = clmul(vget_low_u64(vandq_u64(t, mask32)), vcreate_u64(c->poly));
+	x0 = veorq_u64(x0, t);
+
+	return vgetq_lane_u32(vreinterpretq_u32_u64(x0), 1);
+}
@@ -0,0 +1,203 @@
+/*
+ * CRC32 and CRC32C using NEON
+ *
+ * Copyright (C) ST-Ericsson SA 2012
+ * License terms:  GNU General Public License (GPL), version 2
+ *
+ * Glue for the folding code in crc32-neon-core.c.  Saving the NEON state
+ * and the final reduction cost about as much as a few hundred bytes of
+ * table driven CRC, so the NEON path stays off until a late_initcall has
+ * checked it against a bitwise reference and measured where it starts to
+ * beat crc32_le() on this CPU.
+ */
+#define pr_fmt(fmt)	"crc32-neon: " fmt
+
+#include <linux/crc32.h>
+#include <linux/hrtimer.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/ktime.h>
+#include <linux/module.h>
+#include <linux/slab.h>
+#include <linux/types.h>
+#include <asm/crc32.h>
+#include <asm/neon.h>
+
+/*
+ * Constants for the bit reflected polynomial P (33 bits with x^32):
+ * k1 = x^(4*128+32), k2 = x^(4*128-32), k3 = x^(128+32), k4 = x^(128-32)
+ * and k5 = x^64, all mod P, bit reflected and shifted left by one;
+ * mu = x^64 / P and poly = P, bit reflected.
+ */
+const struct crc32_neon_consts crc32_neon_le_consts = {
+	.k1	= 0x154442bd4ULL,
+	.k2	= 0x1c6e41596ULL,
+	.k3	= 0x1751997d0ULL,
+	.k4	= 0x0ccaa009eULL,
+	.k5	= 0x163cd6124ULL,
+	.mu	= 0x1f7011641ULL,
+	.poly	= 0x1db710641ULL,
+};
+EXPORT_SYMBOL_GPL(crc32_neon_le_consts);
+
+const struct crc32_neon_consts crc32_neon_c_consts = {
+	.k1	= 0x0740eef02ULL,
+	.k2	= 0x09e4addf8ULL,
+	.k3	= 0x0f20c0dfeULL,
+	.k4	= 0x14cd00bd6ULL,
+	.k5	= 0x0dd45aab8ULL,
+	.mu	= 0x0dea713f1ULL,
+	.poly	= 0x105ec76f1ULL,
+};
+EXPORT_SYMBOL_GPL(crc32_neon_c_consts);
+
+size_t crc32_neon_min_len = ~(size_t)0;
+EXPORT_SYMBOL_GPL(crc32_neon_min_len);
+
+static int min_len = -1;
+module_param(min_len, int, 0444);
+MODULE_PARM_DESC(min_len,
+		 "Use NEON from this length on, 0 to disable, -1 to calibrate");
+
+u32 crc32_neon_update(u32 crc, const u8 *p, size_t len,
+		      const struct crc32_neon_consts *c)
+{
+	kernel_neon_begin();
+	crc = crc32_neon_fold(crc, p, len & ~15, c);
+	kernel_neon_end();
+	return crc;
+}
+EXPORT_SYMBOL_GPL(crc32_neon_update);
+
+static u32 __init crc32_bitwise(u32 crc, const u8 *p, size_t len, u32 poly)
+{
+	int i;
+
+	while (len--) {
+		crc ^= *p++;
+		for (i = 0; i < 8; i++)
+			crc = (crc >> 1) ^ ((crc & 1) ? poly : 0);
+	}
+	return crc;
+}
+
+static int __init crc32_neon_selftest(const u8 *buf)
+{
+	static const struct {
+		const struct crc32_neon_consts	*consts;
+		u32				poly;
+		const char			*name;
+	} algs[] __initconst = {
+		{ &crc32_neon_le_consts, 0xedb88320, "crc32" },
+		{ &crc32_neon_c_consts,  0x82f63b78, "crc32c" },
+	};
+	size_t len, off;
+	u32 seed = 0;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(algs); i++)
+		for (len = 64; len <= 1024; len += 16)
+			for (off = 0; off < 16; off += 5) {
+				u32 want, got;
+
+				crc32_neon_test_seed(&seed);
+				want = crc32_bitwise(seed, buf + off, len,
+						     algs[i].poly);
+				got = crc32_neon_update(seed, buf + off, len,
+							algs[i].consts);
+				if (got != want) {
+					pr_err("%s self-test failed: len %zu "
+					       "offset %zu\n", algs[i].name,
+					       len, off);
+					return -EINVAL;
+				}
+			}
+	return 0;
+}
+
+/*
+ * The self-test above calls the folding code directly, before crc32_le()
+ * uses it. Check crc32_le() itself once the threshold is set, from there
+ * up, with the table driven tail and unaligned starts.
+ */
+static int __init crc32_neon_check(const u8 *buf)
+{
+	size_t len, off;
+	u32 seed = 0;
+
+	for (len = crc32_neon_min_len; len <= PAGE_SIZE - 16; len += 61)
+		for (off = 0; off < 16; off += 5) {
+			crc32_neon_test_seed(&seed);
+			if (crc32_le(seed, buf + off, len) !=
+			    crc32_bitwise(seed, buf + off, len, 0xedb88320)) {
+				pr_err("crc32_le() check failed: len %zu "
+				       "offset %zu\n", len, off);
+				return -EINVAL;
+			}
+		}
+	return 0;
+}
+
+/* Best of a few runs, in ns for 16 calls */
+static s64 __init crc32_neon_time(const u8 *buf, size_t len, bool neon)
+{
+	s64 best = LLONG_MAX;
+	int run, i;
+
+	for (run = 0; run < 4; run++) {
+		ktime_t start = ktime_get();
+
+		for (i = 0; i < 16; i++) {
+			if (neon)
+				crc32_neon_update(0, buf, len,
+						  &crc32_neon_le_consts);
+			else
+				crc32_le(0, buf, len);
+		}
+		best = min(best, ktime_to_ns(ktime_sub(ktime_get(), start)));
+	}
+	return best;
+}
+
+static int __init crc32_neon_init(void)
+{
+	size_t len;
+	u8 *buf;
+
+	if (!cpu_has_neon() || !min_len)
+		return 0;
+
+	buf = kmalloc(PAGE_SIZE, GFP_KERNEL);
+	if (!buf)
+		return -ENOMEM;
+	crc32_neon_test_fill(buf, PAGE_SIZE);
+
+	if (crc32_neon_selftest(buf))
+		goto out;
+
+	if (min_len > 0) {
+		crc32_neon_min_len = max_t(size_t, min_len, 64);
+		pr_info("using NEON from %zu bytes\n", crc32_neon_min_len);
+		goto check;
+	}
+
+	/* crc32_le() is table driven until crc32_neon_min_len is set */
+	for (len = 64; len <= PAGE_SIZE; len *= 2)
+		if (crc32_neon_time(buf, len, true) <
+		    crc32_neon_time(buf, len, false))
+			break;
+
+	if (len > PAGE_SIZE) {
+		pr_info("table driven CRC is faster, NEON not used\n");
+		goto out;
+	}
+	crc32_neon_min_len = len;
+	pr_info("calibrated, using NEON from %zu bytes\n", len);
+check:
+	if (crc32_neon_check(buf))
+		crc32_neon_min_len = ~(size_t)0;
+out:
+	kfree(buf);
+	return 0;
+}
+late_initcall(crc32_neon_init);
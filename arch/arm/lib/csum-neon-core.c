@@ -0,0 +1,105 @@
+/*
+ * Internet checksum using NEON
+ *
+ * Copyright (C) ST-Ericsson SA 2012
+ * License terms:  GNU General Public License (GPL), version 2
+ *
+ * The 16-bit words are added pairwise into 32-bit lanes with VPADAL, 64
+ * bytes per iteration, and the lanes into 64-bit ones every 64 KB, before
+ * they could overflow.  The end-around carries are all added back when
+ * folding the 64-bit total to 32 bits, which gives a sum congruent to the
+ * one of csum_partial() modulo 0xffff.
+ *
+ * The words are taken from the start of the buffer whatever its alignment,
+ * so unlike csumpartial.S no byte rotation is needed for odd addresses.
+ * Little endian only.
+ *
+ * This file is built with -mfpu=neon.
+ */
+#include <linux/compiler.h>
+#include <linux/types.h>
+#include <arm_neon.h>
+
+#include "csum-neon.h"
+
+#define CSUM_NEON_BLOCK		(64 * 1024)
+
+static __always_inline u32 csum_neon(const u8 *src, u8 *dst, size_t len,
+				     u32 sum, bool copy)
+{
+	uint64x2_t acc = vdupq_n_u64(0);
+	uint32x4_t a0, a1;
+	uint8x16_t q0, q1, q2, q3;
+	size_t block;
+	u64 total;
+
+	while (len >= 16) {
+		block = len > CSUM_NEON_BLOCK ? CSUM_NEON_BLOCK : len & ~15;
+		len -= block;
+		a0 = vdupq_n_u32(0);
+		a1 = vdupq_n_u32(0);
+
+		for (; block >= 64; block -= 64) {
+			q0 = vld1q_u8(src);
+			q1 = vld1q_u8(src + 16);
+			q2 = vld1q_u8(src + 32);
+			q3 = vld1q_u8(src + 48);
+			if (copy) {
+				vst1q_u8(dst, q0);
+				vst1q_u8(dst + 16, q1);
+				vst1q_u8(dst + 32, q2);
+				vst1q_u8(dst + 48, q3);
+				dst += 64;
+			}
+			a0 = vpadalq_u16(a0, vreinterpretq_u16_u8(q0));
+			a1 = vpadalq_u16(a1, vreinterpretq_u16_u8(q1));
+			a0 = vpadalq_u16(a0, vreinterpretq_u16_u8(q2));
+			a1 = vpadalq_u16(a1, vreinterpretq_u16_u8(q3));
+			src += 64;
+		}
+
+		for (; block; block -= 16) {
+			q0 = vld1q_u8(src);
+			if (copy) {
+				vst1q_u8(dst, q0);
+				dst += 16;
+			}
+			a0 = vpadalq_u16(a0, vreinterpretq_u16_u8(q0));
+			src += 16;
+		}
+
+		acc = vpadalq_u32(acc, a0);
+		acc = vpadalq_u32(acc, a1);
+	}
+
+	total = (u64)sum + vgetq_lane_u64(acc, 0) + vgetq_lane_u64(acc, 1);
+
+	for (; len >= 2; len -= 2) {
+		total += src[0] | src[1] << 8;
+		if (copy) {
+			dst[0] = src[0];
+			dst[1] = src[1];
+			dst += 2;
+		}
+		src += 2;
+	}
+	if (len) {
+		total += src[0];
+		if (copy)
+			dst[0] = src[0];
+	}
+
+	total = (total & 0xffffffff) + (total >> 32);
+	total = (total & 0xffffffff) + (total >> 32);
+	return total;
+}
+
+u32 __csum_partial_neon(const u8 *buff, size_t len, u32 sum)
+{
+	return csum_neon(buff, NULL, len, sum, false);
+}
+
+u32 __csum_partial_copy_neon(const u8 *src, u8 *dst, size_t len, u32 sum)
+{
+	return csum_neon(src, dst, len, sum, true);
+}
@@ -0,0 +1,74 @@
+/*
+ * NEON csum_partial() and csum_partial_copy_nocheck()
+ *
+ * Copyright (C) ST-Ericsson SA 2012
+ * License terms:  GNU General Public License (GPL), version 2
+ *
+ * csumpartial.S and csumpartialcopy.S check the length against
+ * csum_neon_min on entry and branch here for large buffers, see
+ * neon-min-len.c; the neon-csum-test module reports where NEON starts to
+ * win.
+ *
+ * Packets are mostly checksummed from process context on receive, when
+ * they are copied to user space (skb_copy_and_csum_datagram_iovec()).
+ * In interrupt context, NAPI polling included, the integer code is used
+ * at any length.  csum_partial_copy_from_user() stays on the integer code
+ * as a fault on the source cannot be taken with NEON enabled.
+ */
+#include <linux/hardirq.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <asm/checksum.h>
+#include <asm/neon.h>
+
+#include "csum-neon.h"
+#include "neon-min-len.h"
+
+size_t csum_neon_min = ~(size_t)0;
+EXPORT_SYMBOL_GPL(csum_neon_min);
+
+static struct neon_min_len min_len = {
+	.min	= &csum_neon_min,
+	.len	= 256,
+	.what	= "checksums",
+};
+module_param_cb(min_len, &neon_min_len_ops, &min_len, 0644);
+MODULE_PARM_DESC(min_len, "Checksum with NEON from this length on, 0 to disable");
+
+__wsum csum_partial_neon(const void *buff, int len, __wsum sum)
+{
+	if (in_interrupt())
+		return __csum_partial_arm(buff, len, sum);
+
+	kernel_neon_begin();
+	sum = (__force __wsum)__csum_partial_neon(buff, len, (__force u32)sum);
+	kernel_neon_end();
+	return sum;
+}
+EXPORT_SYMBOL_GPL(csum_partial_neon);
+
+__wsum csum_partial_copy_neon(const void *src, void *dst, int len, __wsum sum)
+{
+	if (in_interrupt())
+		return __csum_partial_copy_arm(src, dst, len, sum);
+
+	kernel_neon_begin();
+	sum = (__force __wsum)__csum_partial_copy_neon(src, dst, len,
+						       (__force u32)sum);
+	kernel_neon_end();
+	return sum;
+}
+EXPORT_SYMBOL_GPL(csum_partial_copy_neon);
+
+EXPORT_SYMBOL_GPL(__csum_partial_arm);
+EXPORT_SYMBOL_GPL(__csum_partial_copy_arm);
+
+static int __init csum_neon_init(void)
+{
+	if (cpu_has_neon())
+		neon_min_len_init(&min_len);
+	return 0;
+}
+late_initcall(csum_neon_init);
@@ -0,0 +1,33 @@
+/*
+ *  linux/arch/arm/lib/csum-neon.h
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef __ARM_LIB_CSUM_NEON_H
+#define __ARM_LIB_CSUM_NEON_H
+
+#include <linux/types.h>
+
+/*
+ * csum_partial() and csum_partial_copy_nocheck() branch to the NEON
+ * versions for buffers of at least this many bytes; ~0 disables them.
+ */
+extern size_t csum_neon_min;
+
+/* The integer code, past the size check */
+__wsum __csum_partial_arm(const void *buff, int len, __wsum sum);
+__wsum __csum_partial_copy_arm(const void *src, void *dst, int len,
+			       __wsum sum);
+
+/* NEON versions, falling back to the above in interrupt context */
+__wsum csum_partial_neon(const void *buff, int len, __wsum sum);
+__wsum csum_partial_copy_neon(const void *src, void *dst, int len,
+			      __wsum sum);
+
+/* NEON cores, NEON enabled by the caller */
+u32 __csum_partial_neon(const u8 *buff, size_t len, u32 sum);
+u32 __csum_partial_copy_neon(const u8 *src, u8 *dst, size_t len, u32 sum);
+
+#endif /* __ARM_LIB_CSUM_NEON_H */
@@ -0,0 +1,60 @@
+/*
+ * Large memory copies using NEON
+ *
+ * Copyright (C) ST-Ericsson SA 2012
+ * License terms:  GNU General Public License (GPL), version 2
+ *
+ * 64 bytes per iteration through four Q registers, with PLD running
+ * PREFETCH_DISTANCE bytes ahead of the loads.  VLD1/VST1 with byte
+ * elements have no alignment requirement, so neither pointer is aligned
+ * first.  The last n % 16 bytes are done by one more 16 byte copy ending at
+ * the end of the buffer, overlapping what was already copied.
+ *
+ * This must not call memcpy(), which may be what called it.
+ *
+ * This file is built with -mfpu=neon.
+ */
+#include <linux/types.h>
+#include <asm/cache.h>
+#include <arm_neon.h>
+
+#include "memcpy-neon.h"
+
+#define PREFETCH_DISTANCE	(8 * L1_CACHE_BYTES)
+
+void __memcpy_neon(void *dst, const void *src, size_t n)
+{
+	u8 *d = dst;
+	const u8 *s = src;
+	u8 *end = d + n;
+	const u8 *send = s + n;
+	uint8x16_t q0, q1, q2, q3;
+	int i;
+
+	while (n >= 64) {
+		for (i = 0; i < 64; i += L1_CACHE_BYTES)
+			__builtin_prefetch(s + PREFETCH_DISTANCE + i);
+
+		q0 = vld1q_u8(s);
+		q1 = vld1q_u8(s + 16);
+		q2 = vld1q_u8(s + 32);
+		q3 = vld1q_u8(s + 48);
+		vst1q_u8(d, q0);
+		vst1q_u8(d + 16, q1);
+		vst1q_u8(d + 32, q2);
+		vst1q_u8(d + 48, q3);
+		s += 64;
+		d += 64;
+		n -= 64;
+	}
+
+	while (n >= 16) {
+		vst1q_u8(d, vld1q_u8(s));
+		s += 16;
+		d += 16;
+		n -= 16;
+	}
+
+	if (n)
+		vst1q_u8(end - 16, vld1q_u8(send - 16));
+}
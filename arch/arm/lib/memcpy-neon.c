@@ -0,0 +1,75 @@
+/*
+ * NEON memcpy() and copy_page()
+ *
+ * Copyright (C) ST-Ericsson SA 2012
+ * License terms:  GNU General Public License (GPL), version 2
+ *
+ * memcpy.S and copy_page.S check the length against memcpy_neon_min on
+ * entry and branch here for large copies, see neon-min-len.c.  The
+ * neon-copy-bench module reports where NEON starts to win.
+ *
+ * copy_to_user() gets the NEON copy through memcpy() with
+ * CONFIG_UACCESS_WITH_MEMCPY, which pins the destination page first, so
+ * the NEON section never takes a fault.
+ *
+ * NEON cannot be used in interrupt context, where the integer code is used
+ * at any length.
+ */
+#include <linux/hardirq.h>
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/moduleparam.h>
+#include <asm/neon.h>
+#include <asm/page.h>
+
+#include "memcpy-neon.h"
+#include "neon-min-len.h"
+
+size_t memcpy_neon_min = ~(size_t)0;
+EXPORT_SYMBOL_GPL(memcpy_neon_min);
+
+static struct neon_min_len min_len = {
+	.min	= &memcpy_neon_min,
+	.len	= 512,
+	.floor	= 64,
+	.what	= "copies",
+};
+module_param_cb(min_len, &neon_min_len_ops, &min_len, 0644);
+MODULE_PARM_DESC(min_len, "Copy with NEON from this length on, 0 to disable");
+
+void *memcpy_neon(void *dst, const void *src, size_t n)
+{
+	if (in_interrupt())
+		return __memcpy_arm(dst, src, n);
+
+	kernel_neon_begin();
+	__memcpy_neon(dst, src, n);
+	kernel_neon_end();
+	return dst;
+}
+EXPORT_SYMBOL_GPL(memcpy_neon);
+
+void copy_page_neon(void *to, const void *from)
+{
+	if (in_interrupt()) {
+		__copy_page_arm(to, from);
+		return;
+	}
+
+	kernel_neon_begin();
+	__memcpy_neon(to, from, PAGE_SIZE);
+	kernel_neon_end();
+}
+EXPORT_SYMBOL_GPL(copy_page_neon);
+
+EXPORT_SYMBOL_GPL(__memcpy_arm);
+EXPORT_SYMBOL_GPL(__copy_page_arm);
+
+static int __init memcpy_neon_init(void)
+{
+	if (cpu_has_neon())
+		neon_min_len_init(&min_len);
+	return 0;
+}
+late_initcall(memcpy_neon_init);
@@ -0,0 +1,30 @@
+/*
+ *  linux/arch/arm/lib/memcpy-neon.h
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef __ARM_LIB_MEMCPY_NEON_H
+#define __ARM_LIB_MEMCPY_NEON_H
+
+#include <linux/types.h>
+
+/*
+ * memcpy() and copy_page() branch to the NEON versions for copies of at
+ * least this many bytes; ~0 keeps them on the integer code.
+ */
+extern size_t memcpy_neon_min;
+
+/* The integer code, past the size check */
+void *__memcpy_arm(void *dst, const void *src, size_t n);
+void __copy_page_arm(void *to, const void *from);
+
+/* NEON versions, falling back to the above in interrupt context */
+void *memcpy_neon(void *dst, const void *src, size_t n);
+void copy_page_neon(void *to, const void *from);
+
+/* NEON core, n >= 16, NEON enabled by the caller */
+void __memcpy_neon(void *dst, const void *src, size_t n);
+
+#endif /* __ARM_LIB_MEMCPY_NEON_H */
@@ -0,0 +1,200 @@
+/*
+ * Throughput of the integer and NEON copy routines
+ *
+ * Copyright (C) ST-Ericsson SA 2012
+ * License terms:  GNU General Public License (GPL), version 2
+ *
+ * Loading the module times each variant of memcpy(), copy_page() and
+ * copy_to_user() over a range of sizes and prints GB/s per size, e.g.
+ *
+ *   neon-copy-bench:  size      int     neon   memcpy
+ *   neon-copy-bench:  4096     1.23     2.34     2.34
+ *
+ * "memcpy" is memcpy() itself, i.e. whichever variant memcpy_neon.min_len
+ * selects; a good threshold is the smallest size at which "neon" is
+ * ahead.  Buffers stay in the cache up to its size, so the larger sizes
+ * are the ones that show memory bandwidth.  copy_to_user() is timed by
+ * switching memcpy_neon_min for the whole system, so run this on an
+ * otherwise idle system.
+ */
+#define pr_fmt(fmt)	KBUILD_MODNAME ": " fmt
+
+#include <linux/err.h>
+#include <linux/gfp.h>
+#include <linux/kernel.h>
+#include <linux/mm.h>
+#include <linux/mman.h>
+#include <linux/module.h>
+#include <linux/sched.h>
+#include <linux/string.h>
+#include <linux/uaccess.h>
+#include <asm/neon.h>
+#include <asm/page.h>
+
+#include "bench.h"
+#include "memcpy-neon.h"
+
+#define BUF_SIZE	(64 * 1024)
+
+typedef void (*copy_fn_t)(void *dst, const void *src, size_t n);
+
+static int copy_faults;
+
+static void copy_int(void *dst, const void *src, size_t n)
+{
+	__memcpy_arm(dst, src, n);
+}
+
+static void copy_neon(void *dst, const void *src, size_t n)
+{
+	memcpy_neon(dst, src, n);
+}
+
+static void copy_memcpy(void *dst, const void *src, size_t n)
+{
+	memcpy(dst, src, n);
+}
+
+static void copy_page_int(void *dst, const void *src, size_t n)
+{
+	for (; n; n -= PAGE_SIZE, dst += PAGE_SIZE, src += PAGE_SIZE)
+		__copy_page_arm(dst, src);
+}
+
+static void copy_page_n(void *dst, const void *src, size_t n)
+{
+	for (; n; n -= PAGE_SIZE, dst += PAGE_SIZE, src += PAGE_SIZE)
+		copy_page_neon(dst, src);
+}
+
+static void copy_user(void *dst, const void *src, size_t n)
+{
+	if (__copy_to_user((void __user *)dst, src, n))
+		copy_faults++;
+}
+
+/* Throughput in 1/100 GB/s */
+static unsigned long bench(copy_fn_t fn, void *dst, const void *src,
+			   size_t size)
+{
+	struct bench_timer t;
+
+	fn(dst, src, size);		/* warm up caches and TLB */
+
+	bench_start(&t);
+	do {
+		fn(dst, src, size);
+	} while (bench_more(&t, size));
+	return bench_stop(&t, 100);
+}
+
+static void print_row(size_t size, const unsigned long *gbps, int n)
+{
+	char line[64];
+	int i, len;
+
+	len = snprintf(line, sizeof(line), "%6zu", size);
+	for (i = 0; i < n; i++)
+		len += snprintf(line + len, sizeof(line) - len, " %5lu.%02lu",
+				gbps[i] / 100, gbps[i] % 100);
+	pr_info("%s\n", line);
+}
+
+static void bench_memcpy(void *dst, const void *src)
+{
+	unsigned long gbps[3];
+	size_t size;
+
+	pr_info("memcpy, GB/s\n");
+	pr_info("  size      int     neon   memcpy\n");
+	for (size = 64; size <= BUF_SIZE; size *= 4) {
+		gbps[0] = bench(copy_int, dst, src, size);
+		gbps[1] = bench(copy_neon, dst, src, size);
+		gbps[2] = bench(copy_memcpy, dst, src, size);
+		print_row(size, gbps, 3);
+	}
+}
+
+static void bench_copy_page(void *dst, const void *src)
+{
+	unsigned long gbps[2];
+	size_t size;
+
+	pr_info("copy_page, GB/s\n");
+	pr_info("  size      int     neon\n");
+	for (size = PAGE_SIZE; size <= BUF_SIZE; size *= 4) {
+		gbps[0] = bench(copy_page_int, dst, src, size);
+		gbps[1] = bench(copy_page_n, dst, src, size);
+		print_row(size, gbps, 2);
+	}
+}
+
+static int bench_copy_to_user(const void *src)
+{
+	size_t saved = memcpy_neon_min;
+	unsigned long gbps[2];
+	unsigned long addr;
+	size_t size;
+
+	down_write(&current->mm->mmap_sem);
+	addr = do_mmap(NULL, 0, BUF_SIZE, PROT_READ | PROT_WRITE,
+		       MAP_PRIVATE | MAP_ANONYMOUS, 0);
+	up_write(&current->mm->mmap_sem);
+	if (IS_ERR_VALUE(addr))
+		return addr;
+
+	pr_info("copy_to_user, GB/s\n");
+	pr_info("  size      int     neon\n");
+	for (size = 64; size <= BUF_SIZE; size *= 4) {
+		memcpy_neon_min = ~(size_t)0;
+		gbps[0] = bench(copy_user, (void *)addr, src, size);
+		memcpy_neon_min = 64;
+		gbps[1] = bench(copy_user, (void *)addr, src, size);
+		memcpy_neon_min = saved;
+		print_row(size, gbps, 2);
+	}
+
+	down_write(&current->mm->mmap_sem);
+	do_munmap(current->mm, addr, BUF_SIZE);
+	up_write(&current->mm->mmap_sem);
+
+	if (copy_faults) {
+		pr_err("copy_to_user failed %d times\n", copy_faults);
+		return -EFAULT;
+	}
+	return 0;
+}
+
+static int __init neon_copy_bench_init(void)
+{
+	void *src, *dst;
+	int ret;
+
+	if (!cpu_has_neon())
+		return -ENODEV;
+
+	src = (void *)__get_free_pages(GFP_KERNEL, get_order(BUF_SIZE));
+	dst = (void *)__get_free_pages(GFP_KERNEL, get_order(BUF_SIZE));
+	if (!src || !dst) {
+		ret = -ENOMEM;
+		goto out;
+	}
+	memset(src, 0x5a, BUF_SIZE);
+
+	bench_memcpy(dst, src);
+	bench_copy_page(dst, src);
+	ret = bench_copy_to_user(src);
+
+	if (!ret)
+		ret = BENCH_DONE;
+out:
+	if (dst)
+		free_pages((unsigned long)dst, get_order(BUF_SIZE));
+	if (src)
+		free_pages((unsigned long)src, get_order(BUF_SIZE));
+	return ret;
+}
+module_init(neon_copy_bench_init);
+
+MODULE_DESCRIPTION("Throughput of the integer and NEON copy routines");
+MODULE_LICENSE("GPL");
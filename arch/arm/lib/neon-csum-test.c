@@ -0,0 +1,157 @@
+/*
+ * Checks and throughput of the NEON checksum routines
+ *
+ * Copyright (C) ST-Ericsson SA 2012
+ * License terms:  GNU General Public License (GPL), version 2
+ *
+ * Loading the module compares csum_partial_neon() and
+ * csum_partial_copy_neon() with the integer code over all lengths up to
+ * a few cache lines and a selection of longer ones, at every source and
+ * destination alignment modulo 8.  If they agree, both are timed on
+ * packet sized buffers and on a 64 KB GSO buffer and GB/s is printed per
+ * size; a good csum_neon.min_len is the smallest size at which "neon" is
+ * ahead.
+ */
+#define pr_fmt(fmt)	KBUILD_MODNAME ": " fmt
+
+#include <linux/gfp.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+#include <linux/string.h>
+#include <asm/checksum.h>
+#include <asm/neon.h>
+
+#include "bench.h"
+#include "csum-neon.h"
+
+#define BUF_SIZE	(64 * 1024)
+
+static const int check_lens[] = {
+	511, 512, 513, 1023, 1499, 1500, 1514, 4095, 4096, 9000,
+	BUF_SIZE - 8,
+};
+
+static const int bench_lens[] = { 64, 128, 256, 576, 1024, 1500, BUF_SIZE };
+
+static u32 seed = 1;
+
+static int check_one(u8 *src, u8 *dst, int len)
+{
+	__wsum sum = (__force __wsum)bench_rand(&seed);
+	__wsum want, got;
+
+	want = __csum_partial_arm(src, len, sum);
+	got = csum_partial_neon(src, len, sum);
+	if (csum_fold(got) != csum_fold(want)) {
+		pr_err("csum_partial: len %d src %p: %04x, expected %04x\n",
+		       len, src, csum_fold(got), csum_fold(want));
+		return -EINVAL;
+	}
+
+	memset(dst, 0, len);
+	got = csum_partial_copy_neon(src, dst, len, sum);
+	if (csum_fold(got) != csum_fold(want) || memcmp(dst, src, len)) {
+		pr_err("csum_partial_copy: len %d src %p dst %p failed\n",
+		       len, src, dst);
+		return -EINVAL;
+	}
+	return 0;
+}
+
+static int check(u8 *src, u8 *dst)
+{
+	int so, dof, len, i, ret;
+
+	for (so = 0; so < 8; so++)
+		for (dof = 0; dof < 8; dof++) {
+			for (len = 0; len <= 256; len++) {
+				ret = check_one(src + so, dst + dof, len);
+				if (ret)
+					return ret;
+			}
+			for (i = 0; i < ARRAY_SIZE(check_lens); i++) {
+				ret = check_one(src + so, dst + dof,
+						check_lens[i]);
+				if (ret)
+					return ret;
+			}
+		}
+	return 0;
+}
+
+static __wsum sink;
+
+/* Throughput in 1/100 GB/s */
+static unsigned long bench(bool neon, bool copy, u8 *src, u8 *dst, int len)
+{
+	struct bench_timer t;
+
+	bench_start(&t);
+	do {
+		if (copy)
+			sink = neon ? csum_partial_copy_neon(src, dst, len, 0) :
+				      __csum_partial_copy_arm(src, dst, len, 0);
+		else
+			sink = neon ? csum_partial_neon(src, len, 0) :
+				      __csum_partial_arm(src, len, 0);
+	} while (bench_more(&t, len));
+	return bench_stop(&t, 100);
+}
+
+static void bench_all(u8 *src, u8 *dst)
+{
+	unsigned long r[4];
+	int i;
+
+	pr_info("GB/s       csum_partial   csum_partial_copy\n");
+	pr_info("  size      int     neon      int     neon\n");
+	for (i = 0; i < ARRAY_SIZE(bench_lens); i++) {
+		r[0] = bench(false, false, src, dst, bench_lens[i]);
+		r[1] = bench(true, false, src, dst, bench_lens[i]);
+		r[2] = bench(false, true, src, dst, bench_lens[i]);
+		r[3] = bench(true, true, src, dst, bench_lens[i]);
+		pr_info("%6d %5lu.%02lu %5lu.%02lu %5lu.%02lu %5lu.%02lu\n",
+			bench_lens[i], r[0] / 100, r[0] % 100,
+			r[1] / 100, r[1] % 100, r[2] / 100, r[2] % 100,
+			r[3] / 100, r[3] % 100);
+	}
+}
+
+static int __init neon_csum_test_init(void)
+{
+	u8 *src, *dst;
+	int i, ret;
+
+	if (!cpu_has_neon())
+		return -ENODEV;
+
+	src = (u8 *)__get_free_pages(GFP_KERNEL, get_order(BUF_SIZE));
+	dst = (u8 *)__get_free_pages(GFP_KERNEL, get_order(BUF_SIZE));
+	if (!src || !dst) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	/* Runs of 0xff make the carries matter */
+	for (i = 0; i < BUF_SIZE; i++)
+		src[i] = (i & 0x300) ? bench_rand(&seed) >> 24 : 0xff;
+
+	ret = check(src, dst);
+	if (ret)
+		goto out;
+	pr_info("NEON checksums match the integer code\n");
+
+	bench_all(src, dst);
+
+	ret = BENCH_DONE;
+out:
+	if (dst)
+		free_pages((unsigned long)dst, get_order(BUF_SIZE));
+	if (src)
+		free_pages((unsigned long)src, get_order(BUF_SIZE));
+	return ret;
+}
+module_init(neon_csum_test_init);
+
+MODULE_DESCRIPTION("Checks and throughput of the NEON checksum routines");
+MODULE_LICENSE("GPL");
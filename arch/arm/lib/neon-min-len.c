@@ -0,0 +1,62 @@
+/*
+ * Length thresholds of the NEON library routines
+ *
+ * Copyright (C) ST-Ericsson SA 2012
+ * License terms:  GNU General Public License (GPL), version 2
+ *
+ * Switching NEON on costs a save of the user VFP state, which the integer
+ * code easily beats on short buffers, so memcpy-neon.c and csum-neon.c
+ * only branch to NEON from a length set by their min_len parameters.
+ */
+#define pr_fmt(fmt)	"neon: " fmt
+
+#include <linux/init.h>
+#include <linux/kernel.h>
+#include <linux/module.h>
+
+#include "neon-min-len.h"
+
+static void neon_min_len_apply(struct neon_min_len *t)
+{
+	*t->min = t->len ? max(t->len, t->floor) : ~(size_t)0;
+}
+
+static int neon_min_len_set(const char *val, const struct kernel_param *kp)
+{
+	struct neon_min_len *t = kp->arg;
+	unsigned int len;
+	int ret;
+
+	ret = kstrtouint(val, 0, &len);
+	if (ret)
+		return ret;
+
+	t->len = len;
+	if (t->ready)
+		neon_min_len_apply(t);
+	return 0;
+}
+
+static int neon_min_len_get(char *buffer, const struct kernel_param *kp)
+{
+	const struct neon_min_len *t = kp->arg;
+
+	return sprintf(buffer, "%u", t->len);
+}
+
+struct kernel_param_ops neon_min_len_ops = {
+	.set	= neon_min_len_set,
+	.get	= neon_min_len_get,
+};
+
+/*
+ * Called from a late_initcall on CPUs with NEON: vfp_init() is one too,
+ * and arch/arm/vfp is linked first.
+ */
+void __init neon_min_len_init(struct neon_min_len *t)
+{
+	t->ready = true;
+	neon_min_len_apply(t);
+	if (t->len)
+		pr_info("using NEON for %s from %zu bytes\n", t->what, *t->min);
+}
@@ -0,0 +1,33 @@
+/*
+ *  linux/arch/arm/lib/neon-min-len.h
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+#ifndef __ARM_LIB_NEON_MIN_LEN_H
+#define __ARM_LIB_NEON_MIN_LEN_H
+
+#include <linux/moduleparam.h>
+#include <linux/types.h>
+
+/*
+ * The length from which a library routine branches to its NEON version.
+ * The assembly entry point compares against *min, which stays at ~0 until
+ * neon_min_len_init() and then follows the min_len parameter bound with
+ * neon_min_len_ops; a min_len of 0 keeps the integer code.
+ */
+struct neon_min_len {
+	size_t		*min;
+	unsigned int	len;
+	/* Shortest length the NEON version takes */
+	unsigned int	floor;
+	const char	*what;
+	bool		ready;
+};
+
+extern struct kernel_param_ops neon_min_len_ops;
+
+void neon_min_len_init(struct neon_min_len *t);
+
+#endif /* __ARM_LIB_NEON_MIN_LEN_H */
@@ -0,0 +1,127 @@
+/*
+ * NEON inner loops for xor_blocks()
+ *
+ * Copyright (C) ST-Ericsson SA 2012
+ * License terms:  GNU General Public License (GPL), version 2
+ *
+ * Each loop iteration handles 64 bytes per source, which is the smallest
+ * unit xor_blocks() is ever asked to process (it works on whole pages in
+ * practice). The wrappers in asm/xor.h take care of kernel_neon_begin()
+ * and of falling back to the integer code in interrupt context.
+ *
+ * This file is built with -mfpu=neon.
+ */
+#include <linux/module.h>
+#include <linux/raid/xor.h>
+#include <arm_neon.h>
+
+MODULE_LICENSE("GPL");
+
+#define LOAD(p, x)							\
+	do {								\
+		x##0 = vld1q_u8((u8 *)(p));				\
+		x##1 = vld1q_u8((u8 *)(p) + 16);			\
+		x##2 = vld1q_u8((u8 *)(p) + 32);			\
+		x##3 = vld1q_u8((u8 *)(p) + 48);			\
+	} while (0)
+
+#define XOR(p)								\
+	do {								\
+		v0 = veorq_u8(v0, vld1q_u8((u8 *)(p)));			\
+		v1 = veorq_u8(v1, vld1q_u8((u8 *)(p) + 16));		\
+		v2 = veorq_u8(v2, vld1q_u8((u8 *)(p) + 32));		\
+		v3 = veorq_u8(v3, vld1q_u8((u8 *)(p) + 48));		\
+	} while (0)
+
+#define STORE(p)							\
+	do {								\
+		vst1q_u8((u8 *)(p), v0);				\
+		vst1q_u8((u8 *)(p) + 16, v1);				\
+		vst1q_u8((u8 *)(p) + 32, v2);				\
+		vst1q_u8((u8 *)(p) + 48, v3);				\
+	} while (0)
+
+#define NEXT(p)		((p) = (unsigned long *)((u8 *)(p) + 64))
+
+static void xor_neon_2(unsigned long bytes, unsigned long *p1,
+		       unsigned long *p2)
+{
+	uint8x16_t v0, v1, v2, v3;
+	unsigned long lines = bytes / 64;
+
+	do {
+		LOAD(p1, v);
+		XOR(p2);
+		STORE(p1);
+		NEXT(p1);
+		NEXT(p2);
+	} while (--lines);
+}
+
+static void xor_neon_3(unsigned long bytes, unsigned long *p1,
+		       unsigned long *p2, unsigned long *p3)
+{
+	uint8x16_t v0, v1, v2, v3;
+	unsigned long lines = bytes / 64;
+
+	do {
+		LOAD(p1, v);
+		XOR(p2);
+		XOR(p3);
+		STORE(p1);
+		NEXT(p1);
+		NEXT(p2);
+		NEXT(p3);
+	} while (--lines);
+}
+
+static void xor_neon_4(unsigned long bytes, unsigned long *p1,
+		       unsigned long *p2, unsigned long *p3,
+		       unsigned long *p4)
+{
+	uint8x16_t v0, v1, v2, v3;
+	unsigned long lines = bytes / 64;
+
+	do {
+		LOAD(p1, v);
+		XOR(p2);
+		XOR(p3);
+		XOR(p4);
+		STORE(p1);
+		NEXT(p1);
+		NEXT(p2);
+		NEXT(p3);
+		NEXT(p4);
+	} while (--lines);
+}
+
+static void xor_neon_5(unsigned long bytes, unsigned long *p1,
+		       unsigned long *p2, unsigned long *p3,
+		       unsigned long *p4, unsigned long *p5)
+{
+	uint8x16_t v0, v1, v2, v3;
+	unsigned long lines = bytes / 64;
+
+	do {
+		LOAD(p1, v);
+		XOR(p2);
+		XOR(p3);
+		XOR(p4);
+		XOR(p5);
+		STORE(p1);
+		NEXT(p1);
+		NEXT(p2);
+		NEXT(p3);
+		NEXT(p4);
+		NEXT(p5);
+	} while (--lines);
+}
+
+struct xor_block_template const xor_block_neon_inner = {
+	.name	= "__inner_neon__",
+	.do_2	= xor_neon_2,
+	.do_3	= xor_neon_3,
+	.do_4	= xor_neon_4,
+	.do_5	= xor_neon_5,
+};
+EXPORT_SYMBOL(xor_block_neon_inner);
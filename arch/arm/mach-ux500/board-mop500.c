@@ -1130,6 +1130,9 @@ static struct platform_device *snowball_platform_devs[] __initdata = {
 	&u8500_mcde_device,
 #endif
 	&u8500_b2r2_device,
+#ifdef CONFIG_U8500_SHRM_STANDIN
+	&u8500_shrm_device,
+#endif
 };
 
 static void __init mop500_init_machine(void)
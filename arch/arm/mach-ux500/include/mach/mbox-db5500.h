@@ -8,6 +8,8 @@
 #ifndef __INC_STE_MBOX_H
 #define __INC_STE_MBOX_H
 
+#include <linux/ktime.h>
+
 #define MBOX_BUF_SIZE 16
 #define MBOX_NAME_SIZE 8
 
@@ -20,12 +22,27 @@
   */
 typedef void mbox_recv_cb_t (u32 mbox_msg, void *priv);
 
+/**
+  * mbox_recv_batch_cb_t - Definition of the batched mailbox callback.
+  * @mbox_msgs:	The mailbox messages, in order of reception.
+  * @count:	Number of messages.
+  * @priv:	The clients private data as specified in the call to
+  *		mbox_setup_batch.
+  *
+  * This function will be called with all messages read from the mailbox
+  * in one go, up to the receive budget.
+  */
+typedef void mbox_recv_batch_cb_t (const u32 *mbox_msgs, int count,
+				   void *priv);
+
 /**
   * struct mbox - Mailbox instance struct
   * @list:		Linked list head.
   * @pdev:		Pointer to device struct.
   * @cb:		Callback function. Will be called
   *			when new data is received.
+  * @batch_cb:		Batched callback function, used instead of @cb
+  *			when set.
   * @client_data:	Clients private data. Will be sent back
   *			in the callback function.
   * @virtbase_peer:	Virtual address for outgoing mailbox.
@@ -43,11 +60,19 @@ typedef void mbox_recv_cb_t (u32 mbox_msg, void *priv);
   * @irq:		mailbox interrupt.
   * @allocated:		Indicates whether this particular mailbox
   *			id has been allocated by someone.
+  * @stat_tx_words:	Messages written to the peer FIFO.
+  * @stat_rx_words:	Messages read from the local FIFO.
+  * @stat_irqs:		Interrupts handled.
+  * @stat_fifo_full:	Sends finding the internal buffer full.
+  * @stat_rx_budget:	Interrupts that hit the receive budget.
+  * @stat_snap:		Counters at the previous debugfs read, for rates.
+  * @stat_snap_time:	Time of the previous debugfs read.
   */
 struct mbox {
 	struct list_head list;
 	struct platform_device *pdev;
 	mbox_recv_cb_t *cb;
+	mbox_recv_batch_cb_t *batch_cb;
 	void *client_data;
 	void __iomem *virtbase_peer;
 	void __iomem *virtbase_local;
@@ -62,6 +87,13 @@ struct mbox {
 	bool allocated;
 #if defined(CONFIG_DEBUG_FS)
 	struct dentry *dentry;
+	u32 stat_tx_words;
+	u32 stat_rx_words;
+	u32 stat_irqs;
+	u32 stat_fifo_full;
+	u32 stat_rx_budget;
+	u32 stat_snap[3];
+	ktime_t stat_snap_time;
 #endif
 };
 
@@ -77,6 +109,18 @@ struct mbox {
   */
 struct mbox *mbox_setup(u8 mbox_id, mbox_recv_cb_t *mbox_cb, void *priv);
 
+/**
+  * mbox_setup_batch - Set up a mailbox delivering messages in batches.
+  * @mbox_id:	The ID number of the mailbox, as for mbox_setup.
+  * @mbox_cb:	Pointer to the callback function to be called with the new
+  *		messages received.
+  * @priv:	Client user data which will be returned in the callback.
+  *
+  * Returns a mailbox instance to be specified in subsequent calls to mbox_send.
+  */
+struct mbox *mbox_setup_batch(u8 mbox_id, mbox_recv_batch_cb_t *mbox_cb,
+			      void *priv);
+
 /**
   * mbox_send - Send a mailbox message.
   * @mbox:	Mailbox instance (returned by mbox_setup)
@@ -89,5 +133,19 @@ struct mbox *mbox_setup(u8 mbox_id, mbox_recv_cb_t *mbox_cb, void *priv);
   * specify "block" in order to block until send is possible).
   */
 int mbox_send(struct mbox *mbox, u32 mbox_msg, bool block);
+
+/**
+  * mbox_send_batch - Send several mailbox messages.
+  * @mbox:	Mailbox instance (returned by mbox_setup)
+  * @mbox_msgs:	The mailbox messages to send, in order.
+  * @count:	Number of messages.
+  * @block:	Specifies whether this call will block until all messages are
+  *		buffered, or return when the mailbox buffer is full.
+  *
+  * Returns the number of messages buffered, which is less than @count only
+  * for a non-blocking call finding the buffer full, or a negative error code.
+  */
+int mbox_send_batch(struct mbox *mbox, const u32 *mbox_msgs, int count,
+		    bool block);
 void mbox_state_reset(void);
 #endif /*INC_STE_MBOX_H*/
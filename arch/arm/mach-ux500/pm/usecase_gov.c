@@ -20,8 +20,11 @@
 #include <linux/cpufreq.h>
 #include <linux/mfd/dbx500-prcmu.h>
 #include <linux/cpufreq-dbx500.h>
+#include <linux/input.h>
+#include <linux/slab.h>
 
 #include "../../../../drivers/cpuidle/cpuidle-dbx500.h"
+#include "usecase_model.h"
 
 
 #define CPULOAD_MEAS_DELAY	3000 /* 3 secondes of delta */
@@ -51,6 +54,7 @@ struct hotplug_cpu_info {
 	unsigned int load[LOAD_MONITOR];
 	unsigned int io[LOAD_MONITOR];
 	unsigned int idx;
+	unsigned int last;
 };
 
 static DEFINE_PER_CPU(struct hotplug_cpu_info, hotplug_info);
@@ -71,6 +75,24 @@ static unsigned long max_instant = 85;
 static u32 exit_irq_per_s = 1000;
 static u64 old_num_irqs;
 
+/* Load prediction, see usecase_model.c */
+static unsigned long predictive = 1;
+static unsigned long sample_ms = 50;
+static unsigned long rise_weight = 512;
+static unsigned long fall_weight = 128;
+static unsigned long up_load = 85;
+static unsigned long down_load = 40;
+static unsigned long down_delay_ms = 1000;
+static unsigned long boost_ms = 500;
+/* Feed the model the scheduler's utilization instead, if tracked */
+static unsigned long sched_util;
+
+static struct uc_model_state uc_state;
+static bool input_seen;
+/* Time of the last input event, for work_input_boost */
+static unsigned long input_ms;
+static struct work_struct work_input_boost;
+
 static DEFINE_MUTEX(usecase_mutex);
 static bool user_config_updated;
 static enum ux500_uc current_uc = UX500_UC_MAX;
@@ -209,6 +231,7 @@ static unsigned long determine_cpu_load(void)
 		if (info->idx >= LOAD_MONITOR)
 			info->idx = 0;
 
+		info->last = load;
 		total_load += load;
 	}
 
@@ -291,7 +314,10 @@ static void init_cpu_load_trend(void)
 			info->io[j] = 100;
 		}
 		info->idx = 0;
+		info->last = 0;
 	}
+
+	uc_model_reset(&uc_state);
 }
 
 static u32 get_num_interrupts_per_s(void)
@@ -313,10 +339,10 @@ static u32 get_num_interrupts_per_s(void)
 	pr_debug("%s: total num irqs: %lld, previous %lld\n",
 					__func__, num_irqs, old_num_irqs);
 
-	if (old_num_irqs > 0) {
-		delta = (u32)ktime_to_ms(ktime_sub(now, last)) / 1000;
-		irqs = ((u32)(num_irqs - old_num_irqs)) / delta;
-	}
+	/* The predictive mode samples well below one second */
+	delta = (u32)ktime_to_ms(ktime_sub(now, last));
+	if (old_num_irqs > 0 && delta)
+		irqs = (u32)div_u64((num_irqs - old_num_irqs) * 1000, delta);
 
 	old_num_irqs = num_irqs;
 	last = now;
@@ -435,6 +461,11 @@ exit:
 	user_config_updated = false;
 }
 
+static unsigned long usecase_period_ms(void)
+{
+	return predictive ? max(sample_ms, 10UL) : CPULOAD_MEAS_DELAY;
+}
+
 void usecase_update_governor_state(void)
 {
 	bool cancel_work = false;
@@ -449,7 +480,7 @@ void usecase_update_governor_state(void)
 		 */
 		if (is_early_suspend && !is_work_scheduled) {
 			schedule_delayed_work_on(0, &work_usecase,
-				msecs_to_jiffies(CPULOAD_MEAS_DELAY));
+				msecs_to_jiffies(usecase_period_ms()));
 			is_work_scheduled = true;
 		} else if (!is_early_suspend && is_work_scheduled) {
 			/* Exiting from early suspend. */
@@ -495,6 +526,97 @@ static void usecase_lateresume_callback(struct early_suspend *h)
 	usecase_update_governor_state();
 }
 
+static void usecase_model_params(struct uc_model_params *p)
+{
+	p->rise_weight = rise_weight;
+	p->fall_weight = fall_weight;
+	p->up_load = up_load;
+	p->down_load = down_load;
+	p->down_delay_ms = down_delay_ms;
+	p->boost_ms = boost_ms;
+	p->exit_irq_per_s = exit_irq_per_s;
+}
+
+/*
+ * Apply a performance decision. Called with usecase_mutex held;
+ * set_cpu_config() will not update the config unless it has been changed.
+ */
+static void usecase_apply(bool inc_perf, bool dec_perf)
+{
+	if (dec_perf) {
+		if (usecase_conf[UX500_UC_USER].enable)
+			set_cpu_config(UX500_UC_USER);
+		else if (usecase_conf[UX500_UC_AUTO].enable)
+			set_cpu_config(UX500_UC_AUTO);
+	} else if (inc_perf) {
+		set_cpu_config(UX500_UC_NORMAL);
+	}
+}
+
+/*
+ * The busy time of the cpu over the last sample, or with sched_util set the
+ * scheduler's decaying average of the time the tasks queued on it have run,
+ * which follows them as they wake and sleep.
+ */
+static unsigned int usecase_cpu_load(int cpu)
+{
+#ifdef CONFIG_SCHED_UTIL_TRACKING
+	if (sched_util)
+		return (sched_cpu_util(cpu) * 100) >> SCHED_UTIL_SHIFT;
+#endif
+	return per_cpu(hotplug_info, cpu).last;
+}
+
+/*
+ * Predictive mode: every sample_ms the load of each cpu, as given by
+ * usecase_cpu_load(), feeds the model, which reacts within one or two
+ * samples to a burst.
+ */
+static void usecase_predictive_sample(void)
+{
+	unsigned int load[UC_MODEL_MAX_CPUS] = { 0 };
+	struct uc_model_params params;
+	enum uc_model_decision decision;
+	unsigned long now_ms = jiffies_to_msecs(jiffies);
+	unsigned long total;
+	u32 irqs_per_s;
+	bool input;
+	int cpu;
+
+	/* Updates the busy time of each cpu */
+	determine_cpu_load();
+
+	total = 0;
+	for_each_online_cpu(cpu)
+		if (cpu < UC_MODEL_MAX_CPUS) {
+			load[cpu] = usecase_cpu_load(cpu);
+			total += load[cpu];
+		}
+
+	irqs_per_s = get_num_interrupts_per_s();
+	input = xchg(&input_seen, false);
+
+	/* The load the model is given, in the format read by usecase_replay */
+	hp_printk("usecase-gov: sample %lu %lu %u %d\n",
+		  now_ms, total, irqs_per_s, input);
+
+	mutex_lock(&usecase_mutex);
+
+	usecase_model_params(&params);
+	decision = uc_model_sample(&params, &uc_state, now_ms, load,
+				   UC_MODEL_MAX_CPUS, irqs_per_s);
+
+	/* Pick up a changed user config without leaving power save */
+	if (decision == UC_MODEL_KEEP && user_config_updated &&
+	    current_uc != UX500_UC_NORMAL)
+		decision = UC_MODEL_DEC_PERF;
+
+	usecase_apply(decision == UC_MODEL_INC_PERF,
+		      decision == UC_MODEL_DEC_PERF);
+
+	mutex_unlock(&usecase_mutex);
+}
+
 static void delayed_usecase_work(struct work_struct *work)
 {
 	unsigned long avg, load, trend, balance;
@@ -502,6 +624,11 @@ static void delayed_usecase_work(struct work_struct *work)
 	bool dec_perf = false;
 	u32 irqs_per_s;
 
+	if (predictive) {
+		usecase_predictive_sample();
+		goto reschedule;
+	}
+
 	/* determine loadavg  */
 	avg = determine_loadavg();
 	hp_printk("loadavg = %lu lower th %lu upper th %lu\n",
@@ -552,27 +679,120 @@ static void delayed_usecase_work(struct work_struct *work)
 		dec_perf = true;
 	}
 
-	/*
-	 * set_cpu_config() will not update the config unless it has been
-	 * changed.
-	 */
-	if (dec_perf) {
-		if (usecase_conf[UX500_UC_USER].enable)
-			set_cpu_config(UX500_UC_USER);
-		else if (usecase_conf[UX500_UC_AUTO].enable)
-			set_cpu_config(UX500_UC_AUTO);
-	} else if (inc_perf) {
-		set_cpu_config(UX500_UC_NORMAL);
-	}
+	usecase_apply(inc_perf, dec_perf);
 
 	mutex_unlock(&usecase_mutex);
 
+reschedule:
 	/* reprogramm scheduled work */
 	schedule_delayed_work_on(0, &work_usecase,
-				msecs_to_jiffies(CPULOAD_MEAS_DELAY));
+				msecs_to_jiffies(usecase_period_ms()));
 
 }
 
+/*
+ * Input boost: a key press or touch while the governor saves power brings
+ * full performance back at once instead of at the next sample. The event
+ * handler runs in atomic context, so the model is updated here, under
+ * usecase_mutex like every other update of uc_state.
+ */
+static void usecase_input_boost_work(struct work_struct *work)
+{
+	struct uc_model_params params;
+
+	mutex_lock(&usecase_mutex);
+	if (predictive && is_work_scheduled) {
+		usecase_model_params(&params);
+		if (uc_model_input(&params, &uc_state, ACCESS_ONCE(input_ms)))
+			usecase_apply(true, false);
+	}
+	mutex_unlock(&usecase_mutex);
+}
+
+static void usecase_input_event(struct input_handle *handle,
+				unsigned int type, unsigned int code,
+				int value)
+{
+	if (!predictive || !is_work_scheduled)
+		return;
+
+	input_seen = true;
+	input_ms = jiffies_to_msecs(jiffies);
+	schedule_work(&work_input_boost);
+}
+
+static int usecase_input_connect(struct input_handler *handler,
+				 struct input_dev *dev,
+				 const struct input_device_id *id)
+{
+	struct input_handle *handle;
+	int err;
+
+	handle = kzalloc(sizeof(*handle), GFP_KERNEL);
+	if (!handle)
+		return -ENOMEM;
+
+	handle->dev = dev;
+	handle->handler = handler;
+	handle->name = "usecase";
+
+	err = input_register_handle(handle);
+	if (err)
+		goto err_free;
+
+	err = input_open_device(handle);
+	if (err)
+		goto err_unregister;
+
+	return 0;
+
+err_unregister:
+	input_unregister_handle(handle);
+err_free:
+	kfree(handle);
+	return err;
+}
+
+static void usecase_input_disconnect(struct input_handle *handle)
+{
+	input_close_device(handle);
+	input_unregister_handle(handle);
+	kfree(handle);
+}
+
+/*
+ * Touchscreens, multi-touch or single-touch, and keys; not sensors that
+ * report EV_ABS on their own.
+ */
+static const struct input_device_id usecase_input_ids[] = {
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT |
+			 INPUT_DEVICE_ID_MATCH_ABSBIT,
+		.evbit = { BIT_MASK(EV_ABS) },
+		.absbit = { [BIT_WORD(ABS_MT_POSITION_X)] =
+			    BIT_MASK(ABS_MT_POSITION_X) },
+	},
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT |
+			 INPUT_DEVICE_ID_MATCH_KEYBIT,
+		.evbit = { BIT_MASK(EV_KEY) },
+		.keybit = { [BIT_WORD(BTN_TOUCH)] = BIT_MASK(BTN_TOUCH) },
+	},
+	{
+		.flags = INPUT_DEVICE_ID_MATCH_EVBIT,
+		.evbit = { BIT_MASK(EV_KEY) },
+	},
+	{ },
+};
+
+static struct input_handler usecase_input_handler = {
+	.event		= usecase_input_event,
+	.connect	= usecase_input_connect,
+	.disconnect	= usecase_input_disconnect,
+	.name		= "usecase",
+	.id_table	= usecase_input_ids,
+};
+
 static struct dentry *usecase_dir;
 
 #ifdef CONFIG_DEBUG_FS
@@ -602,6 +822,15 @@ define_set(trend_unbalance);
 define_set(min_trend);
 define_set(max_instant);
 define_set(debug);
+define_set(predictive);
+define_set(sample_ms);
+define_set(rise_weight);
+define_set(fall_weight);
+define_set(up_load);
+define_set(down_load);
+define_set(down_delay_ms);
+define_set(boost_ms);
+define_set(sched_util);
 
 #define define_print(_name) \
 static ssize_t print_##_name(struct seq_file *s, void *p) \
@@ -616,6 +845,15 @@ define_print(trend_unbalance);
 define_print(min_trend);
 define_print(max_instant);
 define_print(debug);
+define_print(predictive);
+define_print(sample_ms);
+define_print(rise_weight);
+define_print(fall_weight);
+define_print(up_load);
+define_print(down_load);
+define_print(down_delay_ms);
+define_print(boost_ms);
+define_print(sched_util);
 
 #define define_open(_name) \
 static ssize_t open_##_name(struct inode *inode, struct file *file) \
@@ -630,6 +868,15 @@ define_open(trend_unbalance);
 define_open(min_trend);
 define_open(max_instant);
 define_open(debug);
+define_open(predictive);
+define_open(sample_ms);
+define_open(rise_weight);
+define_open(fall_weight);
+define_open(up_load);
+define_open(down_load);
+define_open(down_delay_ms);
+define_open(boost_ms);
+define_open(sched_util);
 
 #define define_dbg_file(_name) \
 static const struct file_operations fops_##_name = { \
@@ -649,6 +896,15 @@ define_dbg_file(trend_unbalance);
 define_dbg_file(min_trend);
 define_dbg_file(max_instant);
 define_dbg_file(debug);
+define_dbg_file(predictive);
+define_dbg_file(sample_ms);
+define_dbg_file(rise_weight);
+define_dbg_file(fall_weight);
+define_dbg_file(up_load);
+define_dbg_file(down_load);
+define_dbg_file(down_delay_ms);
+define_dbg_file(boost_ms);
+define_dbg_file(sched_util);
 
 struct dbg_file {
 	struct dentry **file;
@@ -671,6 +927,15 @@ static struct dbg_file debug_entry[] = {
 	define_dbg_entry(min_trend),
 	define_dbg_entry(max_instant),
 	define_dbg_entry(debug),
+	define_dbg_entry(predictive),
+	define_dbg_entry(sample_ms),
+	define_dbg_entry(rise_weight),
+	define_dbg_entry(fall_weight),
+	define_dbg_entry(up_load),
+	define_dbg_entry(down_load),
+	define_dbg_entry(down_delay_ms),
+	define_dbg_entry(boost_ms),
+	define_dbg_entry(sched_util),
 };
 
 static int setup_debugfs(void)
@@ -948,6 +1213,7 @@ static int __init init_usecase_devices(void)
 	/* register delayed queuework */
 	INIT_DELAYED_WORK_DEFERRABLE(&work_usecase,
 				     delayed_usecase_work);
+	INIT_WORK(&work_input_boost, usecase_input_boost_work);
 
 	init_cpu_load_trend();
 
@@ -962,6 +1228,9 @@ static int __init init_usecase_devices(void)
 
 	prcmu_qos_add_requirement(PRCMU_QOS_ARM_OPP, "usecase", 25);
 
+	if (input_register_handler(&usecase_input_handler))
+		pr_warn("usecase-gov: no input boost\n");
+
 	return 0;
 error2:
 	debugfs_remove_recursive(usecase_dir);
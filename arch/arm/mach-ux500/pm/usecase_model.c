@@ -0,0 +1,128 @@
+/*
+ * Copyright (C) ST-Ericsson SA 2012
+ * License terms: GNU General Public License (GPL) version 2
+ *
+ * Load prediction for the use-case governor.
+ *
+ * The busy time of each cpu is averaged with an EWMA that follows a rising
+ * load faster than a falling one, and the average is extrapolated one
+ * sample ahead while it is rising. Performance goes up as soon as the
+ * prediction crosses up_load or an input event arrives, and only comes
+ * down after the prediction stayed below down_load for down_delay_ms.
+ */
+
+#include "usecase_model.h"
+
+#define UC_MODEL_FULL	(100 * UC_MODEL_SCALE)
+
+/* now_ms is a wrapping millisecond clock */
+static int uc_time_before(unsigned long a, unsigned long b)
+{
+	return (long)(a - b) < 0;
+}
+
+static unsigned long uc_ewma(unsigned long avg, unsigned long sample,
+			     unsigned long weight)
+{
+	if (weight > UC_MODEL_SCALE)
+		weight = UC_MODEL_SCALE;
+
+	return (avg * (UC_MODEL_SCALE - weight) + sample * weight) /
+		UC_MODEL_SCALE;
+}
+
+void uc_model_reset(struct uc_model_state *st)
+{
+	unsigned int i;
+
+	for (i = 0; i < UC_MODEL_MAX_CPUS; i++)
+		st->avg[i] = 0;
+	st->predicted = 0;
+	st->boosted = 0;
+	st->low = 0;
+}
+
+/*
+ * Starts or extends the input boost. Returns non zero if the boost was not
+ * active yet, i.e. the caller has to raise performance now.
+ */
+int uc_model_input(const struct uc_model_params *p,
+		   struct uc_model_state *st, unsigned long now_ms)
+{
+	int was_boosted = st->boosted &&
+		uc_time_before(now_ms, st->boost_until_ms);
+
+	st->boost_until_ms = now_ms + p->boost_ms;
+	st->boosted = 1;
+	st->low = 0;
+
+	return !was_boosted;
+}
+
+/*
+ * Feeds the busy percentage of nr_cpus cpus, offline ones as 0, measured
+ * over the last sampling period.
+ */
+enum uc_model_decision uc_model_sample(const struct uc_model_params *p,
+				       struct uc_model_state *st,
+				       unsigned long now_ms,
+				       const unsigned int *load,
+				       unsigned int nr_cpus,
+				       unsigned long irqs_per_s)
+{
+	unsigned long total = 0;
+	unsigned int i;
+
+	if (nr_cpus > UC_MODEL_MAX_CPUS)
+		nr_cpus = UC_MODEL_MAX_CPUS;
+
+	for (i = 0; i < UC_MODEL_MAX_CPUS; i++) {
+		unsigned long prev = st->avg[i];
+		unsigned long sample, avg, pred;
+
+		sample = 0;
+		if (i < nr_cpus)
+			sample = (load[i] > 100 ? 100 : load[i]) *
+				UC_MODEL_SCALE;
+
+		avg = uc_ewma(prev, sample, sample > prev ?
+			      p->rise_weight : p->fall_weight);
+		st->avg[i] = avg;
+
+		/* Extrapolate one period ahead along a rising slope */
+		pred = avg;
+		if (avg > prev)
+			pred += avg - prev;
+		if (pred > UC_MODEL_FULL)
+			pred = UC_MODEL_FULL;
+
+		total += pred;
+	}
+	st->predicted = total / UC_MODEL_SCALE;
+
+	if (st->boosted) {
+		if (uc_time_before(now_ms, st->boost_until_ms))
+			return UC_MODEL_INC_PERF;
+		st->boosted = 0;
+	}
+
+	if (irqs_per_s > p->exit_irq_per_s || st->predicted > p->up_load) {
+		st->low = 0;
+		return UC_MODEL_INC_PERF;
+	}
+
+	if (st->predicted >= p->down_load) {
+		st->low = 0;
+		return UC_MODEL_KEEP;
+	}
+
+	if (!st->low) {
+		st->low = 1;
+		st->low_since_ms = now_ms;
+	}
+
+	if (uc_time_before(now_ms, st->low_since_ms + p->down_delay_ms))
+		return UC_MODEL_KEEP;
+
+	return UC_MODEL_DEC_PERF;
+}
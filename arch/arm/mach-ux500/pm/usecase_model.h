@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) ST-Ericsson SA 2012
+ * License terms: GNU General Public License (GPL) version 2
+ *
+ * Load prediction for the use-case governor. It has no kernel
+ * dependencies so that tools/power/ux500/usecase_replay can run the same
+ * decisions on recorded load traces.
+ */
+
+#ifndef __UX500_USECASE_MODEL_H
+#define __UX500_USECASE_MODEL_H
+
+#define UC_MODEL_MAX_CPUS	4
+/* Fixed point scale of the load averages and the EWMA weights */
+#define UC_MODEL_SCALE		1024
+
+enum uc_model_decision {
+	UC_MODEL_KEEP,
+	UC_MODEL_INC_PERF,
+	UC_MODEL_DEC_PERF,
+};
+
+struct uc_model_params {
+	/* EWMA weight of a sample above resp. below the average, of 1024 */
+	unsigned long rise_weight;
+	unsigned long fall_weight;
+	/* Predicted load, in percent summed over the cpus */
+	unsigned long up_load;
+	unsigned long down_load;
+	/* Time the prediction has to stay below down_load to save power */
+	unsigned long down_delay_ms;
+	/* Time performance is held after an input event */
+	unsigned long boost_ms;
+	unsigned long exit_irq_per_s;
+};
+
+struct uc_model_state {
+	/* Per cpu busy time average, percent scaled by UC_MODEL_SCALE */
+	unsigned long avg[UC_MODEL_MAX_CPUS];
+	unsigned long predicted;
+	unsigned long boost_until_ms;
+	unsigned long low_since_ms;
+	int boosted;
+	int low;
+};
+
+void uc_model_reset(struct uc_model_state *st);
+int uc_model_input(const struct uc_model_params *p,
+		   struct uc_model_state *st, unsigned long now_ms);
+enum uc_model_decision uc_model_sample(const struct uc_model_params *p,
+				       struct uc_model_state *st,
+				       unsigned long now_ms,
+				       const unsigned int *load,
+				       unsigned int nr_cpus,
+				       unsigned long irqs_per_s);
+
+#endif
@@ -15,6 +15,7 @@
 #include <linux/mutex.h>
 #include <linux/spinlock.h>
 #include <linux/sched.h>
+#include <linux/uio.h>
 #include <linux/modem/shrm/shrm_driver.h>
 #include <linux/modem/shrm/shrm_private.h>
 #include <linux/modem/shrm/shrm_config.h>
@@ -100,13 +101,18 @@ int shrm_get_cdev_l2header(u8 idx)
 	return -EINVAL;
 }
 
+/**
+ * shrm_char_reset_queues() - drop the messages received before a modem reset
+ * @shrm:	pointer to the shrm device information structure
+ *
+ * The receive handlers must be stopped. The readers may still run, so
+ * their pointers are left alone: the messages queued so far are marked,
+ * and the reader drops them before it looks for the next message.
+ */
 void shrm_char_reset_queues(struct shrm_dev *shrm)
 {
 	struct isadev_context *isadev;
 	struct isa_driver_context *isa_context;
-	struct queue_element *cur_msg = NULL;
-	struct list_head *cur_msg_ptr = NULL;
-	struct list_head *msg_ptr;
 	struct message_queue *q;
 	int no_dev;
 
@@ -116,26 +122,14 @@ void shrm_char_reset_queues(struct shrm_dev *shrm)
 		isadev = &isa_context->isadev[no_dev];
 		q = &isadev->dl_queue;
 
-		spin_lock_bh(&q->update_lock);
-		/* empty out the msg queue */
-		list_for_each_safe(cur_msg_ptr, msg_ptr, &q->msg_list) {
-			cur_msg = list_entry(cur_msg_ptr,
-					struct queue_element, entry);
-			list_del(cur_msg_ptr);
-			kfree(cur_msg);
-		}
-
-		/* reset the msg queue pointers */
-		q->size = SIZE_OF_FIFO;
-		q->readptr = 0;
-		q->writeptr = 0;
-		q->no = 0;
+		q->flush_tail = q->head;
+		/* pairs with the atomic_xchg() in get_size_of_new_msg() */
+		smp_wmb();
+		atomic_set(&q->flush, 1);
 
 		/* wake up the blocking read/select */
 		atomic_set(&q->q_rp, 1);
 		wake_up_interruptible(&q->wq_readable);
-
-		spin_unlock_bh(&q->update_lock);
 	}
 }
 
@@ -158,12 +152,12 @@ static int create_queue(struct message_queue *q, u32 devicetype,
 	q->size = SIZE_OF_FIFO;
 	q->readptr = 0;
 	q->writeptr = 0;
-	q->no = 0;
+	q->head = 0;
+	q->tail = 0;
 	q->shrm = shrm;
-	spin_lock_init(&q->update_lock);
-	INIT_LIST_HEAD(&q->msg_list);
 	init_waitqueue_head(&q->wq_readable);
 	atomic_set(&q->q_rp, 0);
+	atomic_set(&q->flush, 0);
 
 	return 0;
 }
@@ -178,125 +172,144 @@ static void delete_queue(struct message_queue *q)
 /**
  * add_msg_to_queue() - Add a message inside queue
  * @q:		message queue
+ * @data:	the message
  * @size:	size in bytes
  *
- * This function tries to allocate n_bytes of size in FIFO q.
- * It returns negative number when no memory can be allocated
- * currently.
+ * This function copies the message into the FIFO of queue q and hands it
+ * to the reader. It returns negative number when the FIFO or the message
+ * descriptors are full, in which case the message is dropped.
+ *
+ * Must only be called from the receive handler of the queue. Messages
+ * are passed to the reader without locking, the barriers pair with
+ * those in get_size_of_new_msg() and remove_msg_from_queue().
  */
-int add_msg_to_queue(struct message_queue *q, u32 size)
+int add_msg_to_queue(struct message_queue *q, const void *data, u32 size)
 {
-	struct queue_element *new_msg = NULL;
+	struct queue_element *new_msg;
 	struct shrm_dev *shrm = q->shrm;
+	u32 head = q->head;
+	u32 readptr = ACCESS_ONCE(q->readptr);
+	u32 used;
+	u32 part;
 
 	dev_dbg(shrm->dev, "%s IN q->writeptr=%d\n", __func__, q->writeptr);
-	new_msg = kmalloc(sizeof(struct queue_element), GFP_ATOMIC);
-	if (new_msg == NULL) {
-		dev_err(shrm->dev, "unable to allocate memory\n");
-		return -ENOMEM;
+
+	/* check for overflow condition */
+	used = (q->writeptr + q->size - readptr) % q->size;
+	if (head - ACCESS_ONCE(q->tail) >= SHRM_QUEUE_ELEMS ||
+			used + size >= q->size) {
+		dev_err(shrm->dev, "Buffer overflow !!\n");
+		return -ENOBUFS;
 	}
+	/* the reader must be done with the space before we overwrite it */
+	smp_mb();
+
+	new_msg = &q->elem[head & (SHRM_QUEUE_ELEMS - 1)];
 	new_msg->offset = q->writeptr;
 	new_msg->size = size;
-	new_msg->no = q->no++;
 
-	/* check for overflow condition */
-	if (q->readptr <= q->writeptr) {
-		if (((q->writeptr-q->readptr) + size) >= q->size) {
-			dev_err(shrm->dev, "Buffer overflow !!\n");
-			BUG_ON(((q->writeptr-q->readptr) + size) >= q->size);
-		}
-	} else {
-		if ((q->writeptr + size) >= q->readptr) {
-			dev_err(shrm->dev, "Buffer overflow !!\n");
-			BUG_ON((q->writeptr + size) >= q->readptr);
-		}
-	}
+	/* Copy the message, the second part at the top of fifo */
+	part = min(size, q->size - q->writeptr);
+	memcpy(q->fifo_base + q->writeptr, data, part);
+	memcpy(q->fifo_base, (const u8 *)data + part, size - part);
 	q->writeptr = (q->writeptr + size) % q->size;
-	if (list_empty(&q->msg_list)) {
-		list_add_tail(&new_msg->entry, &q->msg_list);
-		/* There can be 2 blocking calls read  and another select */
-		atomic_set(&q->q_rp, 1);
+
+	/* publish the message after its contents */
+	smp_wmb();
+	q->head = head + 1;
+
+	/* There can be 2 blocking calls read  and another select */
+	atomic_set(&q->q_rp, 1);
+	smp_mb();
+	if (waitqueue_active(&q->wq_readable))
 		wake_up_interruptible(&q->wq_readable);
-	} else
-		list_add_tail(&new_msg->entry, &q->msg_list);
 
 	dev_dbg(shrm->dev, "%s OUT\n", __func__);
 	return 0;
 }
 
+/*
+ * Release the space of the messages before @tail to the receive handler.
+ * If the queue is then empty, the event is cleared to block the select
+ * and read calls of the queue.
+ */
+static void release_msgs(struct message_queue *q, u32 readptr, u32 tail)
+{
+	struct shrm_dev *shrm = q->shrm;
+
+	q->readptr = readptr;
+	q->tail = tail;
+
+	if (tail == ACCESS_ONCE(q->head)) {
+		dev_dbg(shrm->dev, "Queue is empty setting RP= 0\n");
+		atomic_set(&q->q_rp, 0);
+		/* a message added meanwhile must leave the event set */
+		smp_mb();
+		if (tail != ACCESS_ONCE(q->head))
+			atomic_set(&q->q_rp, 1);
+	}
+}
+
 /**
  * remove_msg_from_queue() - To remove a message from the msg queue.
  * @q:	message queue
  *
- * This function delets a message from the message list associated with message
- * queue q and also updates read ptr.
- * If the message list is empty, then, event is set to block the select and
- * read calls of the paricular queue.
- *
- * The message list is FIFO style and message is always added to tail and
- * removed from head.
+ * This function deletes the oldest message from message queue q and
+ * also updates read ptr, releasing its space to the receive handler.
  */
 int remove_msg_from_queue(struct message_queue *q)
 {
-	struct queue_element *old_msg = NULL;
+	struct queue_element *old_msg;
 	struct shrm_dev *shrm = q->shrm;
-	struct list_head *msg_ptr = NULL;
-	struct list_head *old_msg_ptr = NULL;
+	u32 tail = q->tail;
 
 	dev_dbg(shrm->dev, "%s IN q->readptr %d\n", __func__, q->readptr);
 
-	list_for_each_safe(old_msg_ptr, msg_ptr, &q->msg_list) {
-		old_msg = list_entry(old_msg_ptr, struct queue_element, entry);
-		if (old_msg == NULL) {
-			dev_err(shrm->dev, "no message found\n");
-			return -EFAULT;
-		}
-		list_del(old_msg_ptr);
-		q->readptr = (q->readptr + old_msg->size)%q->size;
-		kfree(old_msg);
-		break;
-	}
-	if (list_empty(&q->msg_list)) {
-		dev_dbg(shrm->dev, "List is empty setting RP= 0\n");
-		atomic_set(&q->q_rp, 0);
+	if (tail == ACCESS_ONCE(q->head)) {
+		dev_err(shrm->dev, "no message found\n");
+		return -EFAULT;
 	}
+	old_msg = &q->elem[tail & (SHRM_QUEUE_ELEMS - 1)];
+
+	/* finish reading the message before releasing its space */
+	smp_mb();
+	release_msgs(q, (old_msg->offset + old_msg->size) % q->size, tail + 1);
 
 	dev_dbg(shrm->dev, "%s OUT\n", __func__);
 	return 0;
 }
 
 /**
- * get_size_of_new_msg() - retrieve new message from message list
+ * get_size_of_new_msg() - retrieve new message from message queue
  * @q:	message queue
  *
- * This function will retrieve most recent message from the corresponding
- * queue list. New message is always retrieved from head side.
- * It returns new message no, offset if FIFO and size.
+ * This function will retrieve the oldest message from the corresponding
+ * queue, which always starts at the queue read ptr, after dropping the
+ * messages received before the last reset of the queue.
+ * It returns its size, or 0 when the queue is empty.
  */
 int get_size_of_new_msg(struct message_queue *q)
 {
-	struct queue_element *new_msg = NULL;
-	struct list_head *msg_list;
-	struct shrm_dev *shrm = q->shrm;
-	int size = 0;
-
-	dev_dbg(shrm->dev, "%s IN\n", __func__);
-
-	spin_lock_bh(&q->update_lock);
-	list_for_each(msg_list, &q->msg_list) {
-		new_msg = list_entry(msg_list, struct queue_element, entry);
-		if (new_msg == NULL) {
-			spin_unlock_bh(&q->update_lock);
-			dev_err(shrm->dev, "no message found\n");
-			return -EFAULT;
+	struct queue_element *last;
+	u32 tail = q->tail;
+	u32 flush_tail;
+
+	if (unlikely(atomic_read(&q->flush)) && atomic_xchg(&q->flush, 0)) {
+		flush_tail = ACCESS_ONCE(q->flush_tail);
+		if (flush_tail != tail) {
+			last = &q->elem[(flush_tail - 1) & (SHRM_QUEUE_ELEMS - 1)];
+			release_msgs(q, (last->offset + last->size) % q->size,
+				     flush_tail);
+			tail = flush_tail;
 		}
-		size = new_msg->size;
-		break;
 	}
-	spin_unlock_bh(&q->update_lock);
 
-	dev_dbg(shrm->dev, "%s OUT\n", __func__);
-	return size;
+	if (tail == ACCESS_ONCE(q->head))
+		return 0;
+	/* read the descriptor and message only after seeing it published */
+	smp_rmb();
+
+	return q->elem[tail & (SHRM_QUEUE_ELEMS - 1)].size;
 }
 
 /**
@@ -339,6 +352,61 @@ static u32 isa_select(struct file *filp,
 	return mask;
 }
 
+/**
+ * isa_wait_msg() - wait for a message in the queue
+ * @q:		message queue
+ *
+ * Blocks until there is a message to read, and returns 0 or a negative
+ * error code.
+ */
+static int isa_wait_msg(struct message_queue *q)
+{
+	struct shrm_dev *shrm = q->shrm;
+
+	if (shrm->msr_flag) {
+		atomic_set(&q->q_rp, 0);
+		return -ENODEV;
+	}
+
+	if (msg_queue_empty(q)) {
+		dev_dbg(shrm->dev, "Waiting for Data\n");
+		if (wait_event_interruptible(q->wq_readable,
+				atomic_read(&q->q_rp) == 1))
+			return -ERESTARTSYS;
+	}
+
+	if (shrm->msr_flag) {
+		atomic_set(&q->q_rp, 0);
+		return -ENODEV;
+	}
+
+	return 0;
+}
+
+/**
+ * isa_copy_msg() - copy the oldest message to user space and remove it
+ * @q:		message queue
+ * @buf:	user buffer pointer
+ * @msgsize:	size of the message, from get_size_of_new_msg()
+ */
+static int isa_copy_msg(struct message_queue *q, char __user *buf,
+			u32 msgsize)
+{
+	struct shrm_dev *shrm = q->shrm;
+	u32 size;
+
+	/* Copy the message, the second part at the top of fifo */
+	size = min(msgsize, q->size - q->readptr);
+	if (copy_to_user(buf, q->fifo_base + q->readptr, size) ||
+			copy_to_user(buf + size, q->fifo_base,
+				msgsize - size)) {
+		dev_err(shrm->dev, "copy_to_user failed\n");
+		return -EFAULT;
+	}
+
+	return remove_msg_from_queue(q);
+}
+
 /**
  * isa_read() - Read from device
  * @filp:	file descriptor
@@ -353,9 +421,7 @@ static u32 isa_select(struct file *filp,
  */
 ssize_t isa_read(struct file *filp, char __user *buf, size_t len, loff_t *ppos)
 {
-	u32 size = 0;
 	int ret;
-	char *psrc;
 	struct isadev_context *isadev = (struct isadev_context *)
 							filp->private_data;
 	struct shrm_dev *shrm = isadev->dl_queue.shrm;
@@ -369,70 +435,69 @@ ssize_t isa_read(struct file *filp, char __user *buf, size_t len, loff_t *ppos)
 
 	q = &isadev->dl_queue;
 
-	if (shrm->msr_flag) {
-		atomic_set(&q->q_rp, 0);
-		return -ENODEV;
-	}
-
-	spin_lock_bh(&q->update_lock);
-	if (list_empty(&q->msg_list)) {
-		spin_unlock_bh(&q->update_lock);
-		dev_dbg(shrm->dev, "Waiting for Data\n");
-		if (wait_event_interruptible(q->wq_readable,
-				atomic_read(&q->q_rp) == 1))
-			return -ERESTARTSYS;
-	} else
-		spin_unlock_bh(&q->update_lock);
-
-	if (shrm->msr_flag) {
-		atomic_set(&q->q_rp, 0);
-		return -ENODEV;
-	}
+	ret = isa_wait_msg(q);
+	if (ret < 0)
+		return ret;
 
 	msgsize = get_size_of_new_msg(q);
 
 	if (len < msgsize)
 		return -EINVAL;
 
-	if ((q->readptr+msgsize) >= q->size) {
-		dev_dbg(shrm->dev, "Inside Loop Back\n");
-		psrc = (char *)buf;
-		size = (q->size-q->readptr);
-		/* Copy First Part of msg */
-		if (copy_to_user(psrc,
-				(u8 *)(q->fifo_base+q->readptr),
-				size)) {
-			dev_err(shrm->dev, "copy_to_user failed\n");
-			return -EFAULT;
-		}
-		psrc += size;
-		/* Copy Second Part of msg at the top of fifo */
-		if (copy_to_user(psrc,
-				(u8 *)(q->fifo_base),
-				(msgsize-size))) {
-			dev_err(shrm->dev, "copy_to_user failed\n");
-			return -EFAULT;
-		}
-	} else {
-		if (copy_to_user(buf,
-				(u8 *)(q->fifo_base + q->readptr),
-				msgsize)) {
-			dev_err(shrm->dev, "copy_to_user failed\n");
-			return -EFAULT;
-		}
-	}
-	spin_lock_bh(&q->update_lock);
-	ret = remove_msg_from_queue(q);
-	if (ret < 0) {
-		dev_err(shrm->dev,
-				"Remove msg from message queue failed\n");
-		msgsize = ret;
-	}
-	spin_unlock_bh(&q->update_lock);
+	ret = isa_copy_msg(q, buf, msgsize);
+	if (ret < 0)
+		return ret;
+
 	dev_dbg(shrm->dev, "%s OUT\n", __func__);
 	return msgsize;
 }
 
+/**
+ * isa_aio_read() - Read several messages from device
+ * @iocb:	kernel I/O control block
+ * @iov:	user buffers
+ * @nr_segs:	number of user buffers
+ * @pos:	not used
+ *
+ * Backs readv(): each buffer in @iov receives one message, in order, so
+ * a reader gets all queued messages with a single system call. Like
+ * isa_read() it blocks until the first message is available, then
+ * returns as soon as the queue is empty or the next message does not fit
+ * its buffer. Returns the total size of the messages read.
+ */
+static ssize_t isa_aio_read(struct kiocb *iocb, const struct iovec *iov,
+			    unsigned long nr_segs, loff_t pos)
+{
+	struct isadev_context *isadev = iocb->ki_filp->private_data;
+	struct message_queue *q = &isadev->dl_queue;
+	unsigned long seg;
+	ssize_t total = 0;
+	u32 msgsize;
+	int ret;
+
+	ret = isa_wait_msg(q);
+	if (ret < 0)
+		return ret;
+
+	for (seg = 0; seg < nr_segs; seg++) {
+		msgsize = get_size_of_new_msg(q);
+		if (!msgsize)
+			break;
+		if (iov[seg].iov_len < msgsize) {
+			if (!total)
+				return -EINVAL;
+			break;
+		}
+
+		ret = isa_copy_msg(q, iov[seg].iov_base, msgsize);
+		if (ret < 0)
+			return total ? total : ret;
+		total += msgsize;
+	}
+
+	return total;
+}
+
 /**
  * isa_write() - Write to shrm char device
  * @filp:	file descriptor
@@ -776,6 +841,7 @@ const struct file_operations isa_fops = {
 	.unlocked_ioctl = isa_ioctl,
 	.mmap = isa_mmap,
 	.read = isa_read,
+	.aio_read = isa_aio_read,
 	.write = isa_write,
 	.poll = isa_select,
 };
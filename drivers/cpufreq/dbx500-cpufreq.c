@@ -12,6 +12,11 @@
 #include <linux/cpufreq.h>
 #include <linux/delay.h>
 #include <linux/slab.h>
+#include <linux/sched.h>
+#include <linux/string.h>
+#include <linux/irq_work.h>
+#include <linux/workqueue.h>
+#include <linux/moduleparam.h>
 #include <linux/mfd/dbx500-prcmu.h>
 #include <mach/id.h>
 
@@ -76,6 +81,171 @@ static enum arm_opp db5500_idx2opp[] = {
 
 static enum arm_opp *idx2opp;
 
+/* Last frequency set, and the highest, in kHz */
+static unsigned int cur_freq;
+static unsigned int max_freq;
+
+#ifdef CONFIG_ARM_DBX500_CPUFREQ_SCHED_UTIL
+/*
+ * The scheduler reports the utilization of each cpu as it changes.  When
+ * it calls for a higher frequency than the current one the OPP is raised
+ * at once, rather than at the governor's next sample, which leaves the
+ * governor to bring it down again.  The report comes under the runqueue
+ * lock and prcmu_set_arm_opp() sleeps, so the change is made from a work
+ * item, kicked through irq_work.
+ *
+ * A cpu busy sched_util_up percent of the time asks for the maximum
+ * frequency, a less busy one for proportionally less.  Utilization
+ * measured at a low frequency overstates the work, which only makes the
+ * ramp up steeper.
+ *
+ * Only governors that sample the load bring the frequency down again, so
+ * nothing is raised under any other: performance already runs at the
+ * maximum, and powersave or userspace would be left at the raised OPP.
+ */
+static unsigned int sched_util_up = 80;
+module_param(sched_util_up, uint, 0644);
+MODULE_PARM_DESC(sched_util_up,
+		 "Utilization (%) that asks for the max frequency, 0 = off");
+
+static DEFINE_PER_CPU(unsigned long, sched_util);
+static struct workqueue_struct *sched_util_wq;
+/* policy->max, past which asking is pointless */
+static unsigned int sched_util_limit;
+/* Set while the policy has one of sched_util_governors */
+static bool sched_util_governed;
+
+static const char * const sched_util_governors[] = {
+	"ondemand",
+	"conservative",
+};
+
+static bool sched_util_governor_ok(struct cpufreq_governor *governor)
+{
+	int i;
+
+	if (!governor)
+		return false;
+
+	for (i = 0; i < ARRAY_SIZE(sched_util_governors); i++)
+		if (!strcmp(governor->name, sched_util_governors[i]))
+			return true;
+	return false;
+}
+
+static unsigned int sched_util_freq(unsigned long util)
+{
+	unsigned int up = ACCESS_ONCE(sched_util_up);
+	unsigned long freq;
+
+	if (!up || !ACCESS_ONCE(sched_util_governed))
+		return 0;
+
+	freq = (max_freq >> SCHED_UTIL_SHIFT) * util * 100 / up;
+	return min_t(unsigned long, freq, ACCESS_ONCE(sched_util_limit));
+}
+
+static int sched_util_policy_notifier(struct notifier_block *nb,
+				      unsigned long event, void *data)
+{
+	struct cpufreq_policy *policy = data;
+
+	if (event == CPUFREQ_NOTIFY) {
+		sched_util_limit = policy->max;
+		sched_util_governed = sched_util_governor_ok(policy->governor);
+	}
+
+	return NOTIFY_OK;
+}
+
+static struct notifier_block sched_util_policy_nb = {
+	.notifier_call = sched_util_policy_notifier,
+};
+
+static void sched_util_raise(struct work_struct *work)
+{
+	struct cpufreq_policy *policy;
+	unsigned long util = 0;
+	unsigned int freq;
+	int cpu;
+
+	/* Both cpus share the policy; the busier one decides */
+	for_each_online_cpu(cpu)
+		util = max(util, per_cpu(sched_util, cpu));
+
+	freq = sched_util_freq(util);
+	if (freq <= ACCESS_ONCE(cur_freq))
+		return;
+
+	policy = cpufreq_cpu_get(0);
+	if (!policy)
+		return;
+
+	/*
+	 * CPUFREQ_NOTIFY comes before a new governor is started, check the
+	 * one running.  Clamped to the policy, so usecase limits still apply.
+	 */
+	if (sched_util_governor_ok(policy->governor))
+		cpufreq_driver_target(policy, freq, CPUFREQ_RELATION_L);
+	cpufreq_cpu_put(policy);
+}
+
+static DECLARE_WORK(sched_util_work, sched_util_raise);
+
+static void sched_util_kick(struct irq_work *work)
+{
+	queue_work(sched_util_wq, &sched_util_work);
+}
+
+static struct irq_work sched_util_irq_work = {
+	.func = sched_util_kick,
+};
+
+static void sched_util_changed(struct sched_util_hook *hook, int cpu,
+			       unsigned long util)
+{
+	per_cpu(sched_util, cpu) = util;
+
+	if (sched_util_freq(util) > ACCESS_ONCE(cur_freq))
+		irq_work_queue(&sched_util_irq_work);
+}
+
+static struct sched_util_hook sched_util_hook = {
+	.func = sched_util_changed,
+};
+
+static void __init dbx500_cpufreq_sched_util_init(void)
+{
+	struct cpufreq_policy *policy;
+	int cpu;
+
+	sched_util_wq = alloc_workqueue("dbx500-cpufreq", WQ_HIGHPRI, 1);
+	if (!sched_util_wq) {
+		pr_err("dbx500-cpufreq : Failed to create workqueue\n");
+		return;
+	}
+
+	sched_util_limit = max_freq;
+	cpufreq_register_notifier(&sched_util_policy_nb,
+				  CPUFREQ_POLICY_NOTIFIER);
+
+	/* The driver is registered, the first policy was set without us */
+	policy = cpufreq_cpu_get(0);
+	if (policy) {
+		sched_util_limit = policy->max;
+		sched_util_governed = sched_util_governor_ok(policy->governor);
+		cpufreq_cpu_put(policy);
+	}
+
+	for_each_possible_cpu(cpu)
+		sched_set_util_hook(cpu, &sched_util_hook);
+}
+#else
+static inline void dbx500_cpufreq_sched_util_init(void)
+{
+}
+#endif
+
 static struct freq_attr *dbx500_cpufreq_attr[] = {
 	&cpufreq_freq_attr_scaling_available_freqs,
 	NULL,
@@ -121,6 +291,8 @@ static int dbx500_cpufreq_target(struct cpufreq_policy *policy,
 		return -EINVAL;
 	}
 
+	cur_freq = freqs.new;
+
 	/* post change notification */
 	for_each_cpu(freqs.cpu, policy->cpus)
 		cpufreq_notify_transition(&freqs, CPUFREQ_POSTCHANGE);
@@ -276,6 +448,8 @@ static int __cpuinit dbx500_cpufreq_init(struct cpufreq_policy *policy)
 	policy->min = policy->cpuinfo.min_freq;
 	policy->max = policy->cpuinfo.max_freq;
 	policy->cur = dbx500_cpufreq_getspeed(policy->cpu);
+	cur_freq = policy->cur;
+	max_freq = policy->cpuinfo.max_freq;
 
 	for (i = 0; freq_table[i].frequency != policy->cur; i++)
 		;
@@ -310,6 +484,7 @@ static struct cpufreq_driver dbx500_cpufreq_driver = {
 static int __init dbx500_cpufreq_register(void)
 {
 	int i;
+	int ret;
 
 	if (!initialized)
 		dbx500_cpufreq_early_init();
@@ -319,6 +494,10 @@ static int __init dbx500_cpufreq_register(void)
 	for (i = 0; freq_table[i].frequency != CPUFREQ_TABLE_END; i++)
 		pr_info("  %d Mhz\n", freq_table[i].frequency / 1000);
 
-	return cpufreq_register_driver(&dbx500_cpufreq_driver);
+	ret = cpufreq_register_driver(&dbx500_cpufreq_driver);
+	if (!ret)
+		dbx500_cpufreq_sched_util_init();
+
+	return ret;
 }
 device_initcall(dbx500_cpufreq_register);
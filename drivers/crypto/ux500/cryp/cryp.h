@@ -11,7 +11,7 @@
 #ifndef _CRYP_H_
 #define _CRYP_H_
 
-#include <linux/completion.h>
+#include <linux/crypto.h>
 #include <linux/dmaengine.h>
 #include <linux/klist.h>
 #include <linux/mutex.h>
@@ -202,7 +202,6 @@ struct cryp_device_context {
 
 struct cryp_dma {
 	dma_cap_mask_t mask;
-	struct completion cryp_dma_complete;
 	struct dma_chan *chan_cryp2mem;
 	struct dma_chan *chan_mem2cryp;
 	struct stedma40_chan_cfg *cfg_cryp2mem;
@@ -222,12 +221,14 @@ struct cryp_dma {
  * @clk: Pointer to the device's clock control.
  * @pwr_regulator: Pointer to the device's power control.
  * @power_status: Current status of the power.
- * @ctx_lock: Lock for current_ctx.
+ * @ctx_lock: Lock for current_ctx, taken with bottom halves off as the
+ *	      queue tasklet and the DMA callback take it too.
  * @current_ctx: Pointer to the currently allocated context.
+ * @current_req: Asynchronous request the device is working on, if any.
  * @list_node: For inclusion into a klist.
  * @dma: The dma structure holding channel configuration.
  * @power_state: TRUE = power state on, FALSE = power state off.
- * @power_state_spinlock: Spinlock for power_state.
+ * @power_state_spinlock: Spinlock for power_state, bottom halves off.
  * @restore_dev_ctx: TRUE = saved ctx, FALSE = no saved ctx.
  */
 struct cryp_device_data {
@@ -238,6 +239,7 @@ struct cryp_device_data {
 	int power_status;
 	struct spinlock ctx_lock;
 	struct cryp_ctx *current_ctx;
+	struct ablkcipher_request *current_req;
 	struct klist_node list_node;
 	struct cryp_dma dma;
 	bool power_state;
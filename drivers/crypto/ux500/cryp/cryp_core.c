@@ -18,13 +18,19 @@
 #include <linux/io.h>
 #include <linux/irqreturn.h>
 #include <linux/klist.h>
+#include <linux/ktime.h>
+#include <linux/math64.h>
 #include <linux/module.h>
 #include <linux/platform_device.h>
 #include <linux/regulator/dbx500-prcmu.h>
 #include <linux/semaphore.h>
+#include <linux/slab.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
 
 #include <crypto/aes.h>
 #include <crypto/algapi.h>
+#include <crypto/internal/skcipher.h>
 #include <crypto/ctr.h>
 #include <crypto/des.h>
 #include <crypto/scatterwalk.h>
@@ -40,7 +46,19 @@
 #define CRYP_MAX_KEY_SIZE	32
 #define BYTES_PER_WORD		4
 
+#define CRYP_QUEUE_LENGTH	50
+
 static int cryp_mode;
+static int cryp_fallback_qlen = 2;
+static bool cryp_calibrate = true;
+
+/*
+ * Requests shorter than the threshold of their mode are handled by the
+ * software fallback, since powering up and programming the engine costs
+ * more than the crypto work itself. Measured at boot by cryp_calibrate_work
+ * and tunable through sysfs.
+ */
+static int cryp_sw_threshold[CRYP_ALGO_AES_XTS + 1];
 static atomic_t session_id;
 
 static struct stedma40_chan_cfg *mem_to_engine;
@@ -51,10 +69,16 @@ static struct stedma40_chan_cfg *engine_to_mem;
  *
  * @device_list: A list of registered devices to choose from.
  * @device_allocation: A semaphore initialized with number of devices.
+ * @queue: DMA mode requests waiting for a free device.
+ * @queue_lock: Lock for queue.
+ * @queue_tasklet: Hands queued requests to free devices.
  */
 struct cryp_driver_data {
 	struct klist device_list;
 	struct semaphore device_allocation;
+	struct crypto_queue queue;
+	spinlock_t queue_lock;
+	struct tasklet_struct queue_tasklet;
 };
 
 /**
@@ -71,6 +95,8 @@ struct cryp_driver_data {
  * @updated: Updated flag.
  * @dev_ctx: Device dependent context.
  * @device: Pointer to the device.
+ * @session_id: Session the device context was saved in.
+ * @fallback: Software implementation used when the engine is congested.
  */
 struct cryp_ctx {
 	struct cryp_config config;
@@ -86,6 +112,19 @@ struct cryp_ctx {
 	struct cryp_device_context dev_ctx;
 	struct cryp_device_data *device;
 	u32 session_id;
+	struct crypto_ablkcipher *fallback;
+};
+
+/**
+ * struct cryp_req_ctx - Per request context for queued (DMA mode) requests
+ * @config: Crypto mode, captured when the request is queued.
+ * @blocksize: Size of blocks.
+ * @fallback_req: Subrequest for the software fallback, must be last.
+ */
+struct cryp_req_ctx {
+	struct cryp_config config;
+	u32 blocksize;
+	struct ablkcipher_request fallback_req;
 };
 
 static struct cryp_driver_data driver_data;
@@ -422,19 +461,12 @@ static int cryp_setup_context(struct cryp_ctx *ctx,
 	return 0;
 }
 
-static int cryp_get_device_data(struct cryp_ctx *ctx,
-				struct cryp_device_data **device_data)
+static int cryp_select_device(struct cryp_ctx *ctx,
+			      struct cryp_device_data **device_data)
 {
-	int ret;
 	struct klist_iter device_iterator;
 	struct klist_node *device_node;
 	struct cryp_device_data *local_device_data = NULL;
-	pr_debug(DEV_DBG_NAME " [%s]", __func__);
-
-	/* Wait until a device is available */
-	ret = down_interruptible(&driver_data.device_allocation);
-	if (ret)
-		return ret;  /* Interrupted */
 
 	/* Select a device */
 	klist_iter_init(&driver_data.device_list, &device_iterator);
@@ -443,25 +475,25 @@ static int cryp_get_device_data(struct cryp_ctx *ctx,
 	while (device_node) {
 		local_device_data = container_of(device_node,
 					   struct cryp_device_data, list_node);
-		spin_lock(&local_device_data->ctx_lock);
+		spin_lock_bh(&local_device_data->ctx_lock);
 		/* current_ctx allocates a device, NULL = unallocated */
 		if (local_device_data->current_ctx) {
 			device_node = klist_next(&device_iterator);
 		} else {
 			local_device_data->current_ctx = ctx;
 			ctx->device = local_device_data;
-			spin_unlock(&local_device_data->ctx_lock);
+			spin_unlock_bh(&local_device_data->ctx_lock);
 			break;
 		}
-		spin_unlock(&local_device_data->ctx_lock);
+		spin_unlock_bh(&local_device_data->ctx_lock);
 	}
 	klist_iter_exit(&device_iterator);
 
 	if (!device_node) {
 		/**
 		 * No free device found.
-		 * Since we allocated a device with down_interruptible, this
-		 * should not be able to happen.
+		 * Since the caller allocated a device from device_allocation,
+		 * this should not be able to happen.
 		 * Number of available devices, which are contained in
 		 * device_allocation, is therefore decremented by not doing
 		 * an up(device_allocation).
@@ -474,6 +506,20 @@ static int cryp_get_device_data(struct cryp_ctx *ctx,
 	return 0;
 }
 
+static int cryp_get_device_data(struct cryp_ctx *ctx,
+				struct cryp_device_data **device_data)
+{
+	int ret;
+	pr_debug(DEV_DBG_NAME " [%s]", __func__);
+
+	/* Wait until a device is available */
+	ret = down_interruptible(&driver_data.device_allocation);
+	if (ret)
+		return ret;  /* Interrupted */
+
+	return cryp_select_device(ctx, device_data);
+}
+
 static void cryp_dma_setup_channel(struct cryp_device_data *device_data,
 				   struct device *dev)
 {
@@ -491,16 +537,16 @@ static void cryp_dma_setup_channel(struct cryp_device_data *device_data,
 		dma_request_channel(device_data->dma.mask,
 				    stedma40_filter,
 				    device_data->dma.cfg_cryp2mem);
-
-	init_completion(&device_data->dma.cryp_dma_complete);
 }
 
+static void ablk_dma_complete(struct cryp_device_data *device_data, int err);
+
 static void cryp_dma_out_callback(void *data)
 {
 	struct cryp_ctx *ctx = (struct cryp_ctx *) data;
 	dev_dbg(ctx->device->dev, "[%s]: ", __func__);
 
-	complete(&ctx->device->dma.cryp_dma_complete);
+	ablk_dma_complete(ctx->device, 0);
 }
 
 static int cryp_set_dma_transfer(struct cryp_ctx *ctx,
@@ -544,6 +590,12 @@ static int cryp_set_dma_transfer(struct cryp_ctx *ctx,
 					     ctx->device->dma.sg_src_len,
 					     direction,
 					     DMA_CTRL_ACK);
+		if (!desc) {
+			dma_unmap_sg(channel->device->dev,
+				     ctx->device->dma.sg_src,
+				     ctx->device->dma.nents_src, direction);
+			return -EFAULT;
+		}
 		break;
 
 	case DMA_FROM_DEVICE:
@@ -570,6 +622,12 @@ static int cryp_set_dma_transfer(struct cryp_ctx *ctx,
 					     direction,
 					     DMA_CTRL_ACK |
 					     DMA_PREP_INTERRUPT);
+		if (!desc) {
+			dma_unmap_sg(channel->device->dev,
+				     ctx->device->dma.sg_dst,
+				     ctx->device->dma.nents_dst, direction);
+			return -EFAULT;
+		}
 
 		desc->callback = cryp_dma_out_callback;
 		desc->callback_param = ctx;
@@ -659,18 +717,18 @@ static int cryp_disable_power(struct device *dev,
 
 	dev_dbg(dev, "[%s]", __func__);
 
-	spin_lock(&device_data->power_state_spinlock);
+	spin_lock_bh(&device_data->power_state_spinlock);
 	if (!device_data->power_state)
 		goto out;
 
-	spin_lock(&device_data->ctx_lock);
+	spin_lock_bh(&device_data->ctx_lock);
 	if (save_device_context && device_data->current_ctx) {
 		cryp_save_device_context(device_data,
 				&device_data->current_ctx->dev_ctx,
 				cryp_mode);
 		device_data->restore_dev_ctx = true;
 	}
-	spin_unlock(&device_data->ctx_lock);
+	spin_unlock_bh(&device_data->ctx_lock);
 
 	clk_disable(device_data->clk);
 	ret = ux500_regulator_atomic_disable(device_data->pwr_regulator);
@@ -682,7 +740,7 @@ static int cryp_disable_power(struct device *dev,
 	device_data->power_state = false;
 
 out:
-	spin_unlock(&device_data->power_state_spinlock);
+	spin_unlock_bh(&device_data->power_state_spinlock);
 
 	return ret;
 }
@@ -696,7 +754,7 @@ static int cryp_enable_power(
 
 	dev_dbg(dev, "[%s]", __func__);
 
-	spin_lock(&device_data->power_state_spinlock);
+	spin_lock_bh(&device_data->power_state_spinlock);
 	if (!device_data->power_state) {
 		ret = ux500_regulator_atomic_enable(device_data->pwr_regulator);
 		if (ret) {
@@ -717,16 +775,16 @@ static int cryp_enable_power(
 	}
 
 	if (device_data->restore_dev_ctx) {
-		spin_lock(&device_data->ctx_lock);
+		spin_lock_bh(&device_data->ctx_lock);
 		if (restore_device_context && device_data->current_ctx) {
 			device_data->restore_dev_ctx = false;
 			cryp_restore_device_context(device_data,
 					&device_data->current_ctx->dev_ctx);
 		}
-		spin_unlock(&device_data->ctx_lock);
+		spin_unlock_bh(&device_data->ctx_lock);
 	}
 out:
-	spin_unlock(&device_data->power_state_spinlock);
+	spin_unlock_bh(&device_data->power_state_spinlock);
 
 	return ret;
 }
@@ -810,30 +868,38 @@ static int get_nents(struct scatterlist *sg, int nbytes)
 	return nents;
 }
 
-static int ablk_dma_crypt(struct ablkcipher_request *areq)
+/**
+ * ablk_dma_start - Program a device and start the DMA for a queued request.
+ * @areq: The request.
+ * @device_data: The device allocated for the request.
+ *
+ * Called from the queue tasklet. On success the request is completed from
+ * the DMA callback, see ablk_dma_complete().
+ */
+static int ablk_dma_start(struct ablkcipher_request *areq,
+			  struct cryp_device_data *device_data)
 {
 	struct crypto_ablkcipher *cipher = crypto_ablkcipher_reqtfm(areq);
 	struct cryp_ctx *ctx = crypto_ablkcipher_ctx(cipher);
-	struct cryp_device_data *device_data;
-
-	int bytes_written = 0;
-	int bytes_read = 0;
+	struct cryp_req_ctx *rctx = ablkcipher_request_ctx(areq);
 	int ret;
 
 	pr_debug(DEV_DBG_NAME " [%s]", __func__);
 
+	ctx->config.algodir = rctx->config.algodir;
+	ctx->config.algomode = rctx->config.algomode;
+	ctx->blocksize = rctx->blocksize;
+	ctx->iv = areq->info;
 	ctx->datalen = areq->nbytes;
 	ctx->outlen = areq->nbytes;
-
-	ret = cryp_get_device_data(ctx, &device_data);
-	if (ret)
-		return ret;
+	/* Each request carries its own IV, always reload key and IV. */
+	ctx->updated = 0;
 
 	ret = cryp_enable_power(device_data->dev, device_data, false);
 	if (ret) {
 		dev_err(device_data->dev, "[%s]: "
 			"cryp_enable_power() failed!", __func__);
-		goto out;
+		return ret;
 	}
 
 	ret = cryp_setup_context(ctx, device_data);
@@ -841,44 +907,341 @@ static int ablk_dma_crypt(struct ablkcipher_request *areq)
 		goto out_power;
 
 	/* We have the device now, so store the nents in the dma struct. */
-	ctx->device->dma.nents_src = get_nents(areq->src, ctx->datalen);
-	ctx->device->dma.nents_dst = get_nents(areq->dst, ctx->outlen);
+	device_data->dma.nents_src = get_nents(areq->src, ctx->datalen);
+	device_data->dma.nents_dst = get_nents(areq->dst, ctx->outlen);
 
 	/* Enable DMA in- and output. */
 	cryp_configure_for_dma(device_data, CRYP_DMA_ENABLE_BOTH_DIRECTIONS);
 
-	bytes_written = cryp_dma_write(ctx, areq->src, ctx->datalen);
-	bytes_read = cryp_dma_read(ctx, areq->dst, bytes_written);
+	/*
+	 * The output channel is set up first so that its completion callback,
+	 * which finishes the request, cannot race with a failing input setup.
+	 */
+	ret = cryp_dma_read(ctx, areq->dst, ctx->outlen);
+	if (ret < 0)
+		goto out_power;
 
-	wait_for_completion(&ctx->device->dma.cryp_dma_complete);
-	cryp_dma_done(ctx);
+	ret = cryp_dma_write(ctx, areq->src, ctx->datalen);
+	if (ret < 0) {
+		struct dma_chan *chan = device_data->dma.chan_cryp2mem;
 
-	cryp_save_device_context(device_data, &ctx->dev_ctx, cryp_mode);
-	ctx->updated = 1;
+		chan->device->device_control(chan, DMA_TERMINATE_ALL, 0);
+		dma_unmap_sg(chan->device->dev, device_data->dma.sg_dst,
+			     device_data->dma.sg_dst_len, DMA_FROM_DEVICE);
+		goto out_power;
+	}
+
+	return 0;
 
 out_power:
 	if (cryp_disable_power(device_data->dev, device_data, false))
 		dev_err(device_data->dev, "[%s]: "
 			"cryp_disable_power() failed!", __func__);
+	return ret;
+}
 
-out:
-	spin_lock(&device_data->ctx_lock);
+/**
+ * cryp_release_device - Return a device allocated by the queue tasklet.
+ * @device_data: The device.
+ */
+static void cryp_release_device(struct cryp_device_data *device_data)
+{
+	spin_lock_bh(&device_data->ctx_lock);
+	if (device_data->current_ctx)
+		device_data->current_ctx->device = NULL;
 	device_data->current_ctx = NULL;
-	ctx->device = NULL;
-	spin_unlock(&device_data->ctx_lock);
+	device_data->current_req = NULL;
+	spin_unlock_bh(&device_data->ctx_lock);
 
 	/*
-	 * The down_interruptible part for this semaphore is called in
-	 * cryp_get_device_data.
+	 * The down_trylock part for this semaphore is called in
+	 * cryp_queue_tasklet.
 	 */
 	up(&driver_data.device_allocation);
+}
+
+/**
+ * ablk_finish - Release a device and complete the request it worked on.
+ * @device_data: The device.
+ * @err: Result to report to the owner of the request.
+ *
+ * The device is released and the next queued request is started before
+ * the owner is told, so the engine stays busy while the owner processes
+ * the result.
+ */
+static void ablk_finish(struct cryp_device_data *device_data, int err)
+{
+	struct ablkcipher_request *areq = device_data->current_req;
+
+	cryp_release_device(device_data);
+	tasklet_schedule(&driver_data.queue_tasklet);
+
+	areq->base.complete(&areq->base, err);
+}
 
-	if (unlikely(bytes_written != bytes_read))
-		return -EPERM;
+/**
+ * ablk_dma_complete - Finish the request a device is working on.
+ * @device_data: The device.
+ * @err: Result to report to the owner of the request.
+ *
+ * Runs in the DMA tasklet.
+ */
+static void ablk_dma_complete(struct cryp_device_data *device_data, int err)
+{
+	cryp_dma_done(device_data->current_ctx);
+
+	if (cryp_disable_power(device_data->dev, device_data, false))
+		dev_err(device_data->dev, "[%s]: "
+			"cryp_disable_power() failed!", __func__);
+
+	ablk_finish(device_data, err);
+}
+
+static int ablk_fallback_crypt(struct ablkcipher_request *areq);
+
+#ifdef CONFIG_CRYPTO_DEV_UX500_STANDIN
+/*
+ * Stand-in for the engine. cryp_standin_devices devices without registers,
+ * clock or regulator take the place of the platform devices. The queue
+ * tasklet hands them requests like it does to the engine; each runs its
+ * request on the software fallback from a workqueue and then completes it
+ * like the output DMA callback would. The throughput of the stand-in
+ * engines over the time they were busy is in the standin_stats attribute.
+ */
+static int cryp_standin_devices = 2;
+module_param(cryp_standin_devices, int, 0);
+MODULE_PARM_DESC(cryp_standin_devices, "Number of stand-in engines "
+		 "(default 2)");
+
+/**
+ * struct cryp_standin - A stand-in engine
+ * @device_data: The device the queue tasklet allocates.
+ * @work: Runs the request of the device.
+ */
+struct cryp_standin {
+	struct cryp_device_data device_data;
+	struct work_struct work;
+};
+
+static struct platform_device *cryp_standin_pdev;
+static struct cryp_standin *cryp_standin;
+static atomic64_t cryp_standin_requests;
+static atomic64_t cryp_standin_bytes;
+static atomic64_t cryp_standin_ns;
+
+static void cryp_standin_work(struct work_struct *work)
+{
+	struct cryp_standin *standin =
+		container_of(work, struct cryp_standin, work);
+	struct ablkcipher_request *areq = standin->device_data.current_req;
+	ktime_t start = ktime_get();
+	int ret;
+
+	ret = ablk_fallback_crypt(areq);
+
+	atomic64_add(ktime_to_ns(ktime_sub(ktime_get(), start)),
+		     &cryp_standin_ns);
+	atomic64_add(areq->nbytes, &cryp_standin_bytes);
+	atomic64_inc(&cryp_standin_requests);
+
+	/* Complete in softirq context, like the DMA callback */
+	local_bh_disable();
+	ablk_finish(&standin->device_data, ret);
+	local_bh_enable();
+}
+
+/**
+ * cryp_standin_start - Start a queued request on a stand-in engine.
+ * @areq: The request.
+ * @device_data: The device allocated for the request.
+ */
+static int cryp_standin_start(struct ablkcipher_request *areq,
+			      struct cryp_device_data *device_data)
+{
+	struct crypto_ablkcipher *cipher = crypto_ablkcipher_reqtfm(areq);
+	struct cryp_ctx *ctx = crypto_ablkcipher_ctx(cipher);
+	struct cryp_standin *standin =
+		container_of(device_data, struct cryp_standin, device_data);
+
+	if (!ctx->fallback)
+		return -ENODEV;
+
+	queue_work(system_unbound_wq, &standin->work);
 
 	return 0;
 }
 
+static ssize_t cryp_standin_show_stats(struct device *dev,
+				       struct device_attribute *attr,
+				       char *buf)
+{
+	u64 requests = atomic64_read(&cryp_standin_requests);
+	u64 bytes = atomic64_read(&cryp_standin_bytes);
+	u64 ns = atomic64_read(&cryp_standin_ns);
+
+	return sprintf(buf, "%llu requests %llu bytes %llu MB/s\n",
+		       requests, bytes, ns ? div64_u64(bytes * 1000, ns) : 0);
+}
+
+static DEVICE_ATTR(standin_stats, 0444, cryp_standin_show_stats, NULL);
+#else
+static inline int cryp_standin_start(struct ablkcipher_request *areq,
+				     struct cryp_device_data *device_data)
+{
+	return -ENODEV;
+}
+#endif
+
+/**
+ * cryp_queue_tasklet - Hand queued requests to free devices.
+ * @data: Unused.
+ *
+ * Only one instance runs at a time, which is what keeps two requests for
+ * the same transform from being programmed into two devices at once.
+ */
+static void cryp_queue_tasklet(unsigned long data)
+{
+	struct crypto_async_request *async_req;
+	struct crypto_async_request *backlog;
+	struct ablkcipher_request *areq;
+	struct cryp_device_data *device_data;
+	struct cryp_ctx *ctx;
+	int ret;
+
+	for (;;) {
+		if (down_trylock(&driver_data.device_allocation))
+			return; /* All busy, ablk_dma_complete reschedules */
+
+		spin_lock_bh(&driver_data.queue_lock);
+		if (!driver_data.queue.qlen)
+			goto out_idle;
+
+		/* The transform context can only be on one device at a time */
+		async_req = list_first_entry(&driver_data.queue.list,
+					     struct crypto_async_request, list);
+		ctx = crypto_tfm_ctx(async_req->tfm);
+		if (ctx->device)
+			goto out_idle;
+
+		backlog = crypto_get_backlog(&driver_data.queue);
+		async_req = crypto_dequeue_request(&driver_data.queue);
+		spin_unlock_bh(&driver_data.queue_lock);
+
+		if (backlog)
+			backlog->complete(backlog, -EINPROGRESS);
+
+		areq = ablkcipher_request_cast(async_req);
+
+		ret = cryp_select_device(ctx, &device_data);
+		if (ret) {
+			areq->base.complete(&areq->base, ret);
+			continue;
+		}
+
+		device_data->current_req = areq;
+		if (IS_ENABLED(CONFIG_CRYPTO_DEV_UX500_STANDIN))
+			ret = cryp_standin_start(areq, device_data);
+		else
+			ret = ablk_dma_start(areq, device_data);
+		if (ret) {
+			cryp_release_device(device_data);
+			areq->base.complete(&areq->base, ret);
+		}
+	}
+
+out_idle:
+	spin_unlock_bh(&driver_data.queue_lock);
+	up(&driver_data.device_allocation);
+}
+
+/**
+ * ablk_fallback_crypt - Run a request through the software implementation.
+ * @areq: The request.
+ */
+static int ablk_fallback_crypt(struct ablkcipher_request *areq)
+{
+	struct crypto_ablkcipher *cipher = crypto_ablkcipher_reqtfm(areq);
+	struct cryp_ctx *ctx = crypto_ablkcipher_ctx(cipher);
+	struct cryp_req_ctx *rctx = ablkcipher_request_ctx(areq);
+	struct ablkcipher_request *subreq = &rctx->fallback_req;
+
+	ablkcipher_request_set_tfm(subreq, ctx->fallback);
+	ablkcipher_request_set_callback(subreq, areq->base.flags,
+					NULL, NULL);
+	ablkcipher_request_set_crypt(subreq, areq->src, areq->dst,
+				     areq->nbytes, areq->info);
+
+	if (rctx->config.algodir == CRYP_ALGORITHM_ENCRYPT)
+		return crypto_ablkcipher_encrypt(subreq);
+
+	return crypto_ablkcipher_decrypt(subreq);
+}
+
+/**
+ * ablk_use_software - Check if a request is too short for the engine.
+ * @areq: The request.
+ *
+ * Also prepares the request context for ablk_fallback_crypt().
+ */
+static bool ablk_use_software(struct ablkcipher_request *areq)
+{
+	struct crypto_ablkcipher *cipher = crypto_ablkcipher_reqtfm(areq);
+	struct cryp_ctx *ctx = crypto_ablkcipher_ctx(cipher);
+	struct cryp_req_ctx *rctx = ablkcipher_request_ctx(areq);
+
+	/* Only transforms with a fallback have a request context */
+	if (!ctx->fallback ||
+	    areq->nbytes >= cryp_sw_threshold[ctx->config.algomode])
+		return false;
+
+	rctx->config = ctx->config;
+	rctx->blocksize = ctx->blocksize;
+
+	return true;
+}
+
+/**
+ * ablk_dma_crypt - Queue a request for the DMA driven engine.
+ * @areq: The request.
+ *
+ * Returns -EINPROGRESS (or -EBUSY when backlogged) and completes the request
+ * asynchronously. If the engine already has cryp_fallback_qlen requests
+ * waiting, the request is instead handled synchronously in software.
+ */
+static int ablk_dma_crypt(struct ablkcipher_request *areq)
+{
+	struct crypto_ablkcipher *cipher = crypto_ablkcipher_reqtfm(areq);
+	struct cryp_ctx *ctx = crypto_ablkcipher_ctx(cipher);
+	struct cryp_req_ctx *rctx = ablkcipher_request_ctx(areq);
+	bool congested;
+	int ret;
+
+	pr_debug(DEV_DBG_NAME " [%s]", __func__);
+
+	if (!areq->nbytes)
+		return 0;
+
+	if (ablk_use_software(areq))
+		return ablk_fallback_crypt(areq);
+
+	rctx->config = ctx->config;
+	rctx->blocksize = ctx->blocksize;
+
+	spin_lock_bh(&driver_data.queue_lock);
+	congested = ctx->fallback && cryp_fallback_qlen > 0 &&
+		driver_data.queue.qlen >= cryp_fallback_qlen;
+	if (!congested)
+		ret = ablkcipher_enqueue_request(&driver_data.queue, areq);
+	spin_unlock_bh(&driver_data.queue_lock);
+
+	if (congested)
+		return ablk_fallback_crypt(areq);
+
+	tasklet_schedule(&driver_data.queue_tasklet);
+
+	return ret;
+}
+
 static int ablk_crypt(struct ablkcipher_request *areq)
 {
 	struct ablkcipher_walk walk;
@@ -892,6 +1255,13 @@ static int ablk_crypt(struct ablkcipher_request *areq)
 
 	pr_debug(DEV_DBG_NAME " [%s]", __func__);
 
+	/* The stand-in only takes queued requests */
+	if (IS_ENABLED(CONFIG_CRYPTO_DEV_UX500_STANDIN))
+		return ablk_dma_crypt(areq);
+
+	if (ablk_use_software(areq))
+		return ablk_fallback_crypt(areq);
+
 	ret = cryp_get_device_data(ctx, &device_data);
 	if (ret)
 		goto out;
@@ -939,10 +1309,10 @@ out_power:
 			"cryp_disable_power() failed!", __func__);
 out:
 	/* Release the device */
-	spin_lock(&device_data->ctx_lock);
+	spin_lock_bh(&device_data->ctx_lock);
 	device_data->current_ctx = NULL;
 	ctx->device = NULL;
-	spin_unlock(&device_data->ctx_lock);
+	spin_unlock_bh(&device_data->ctx_lock);
 
 	/*
 	 * The down_interruptible part for this semaphore is called in
@@ -985,6 +1355,9 @@ static int aes_ablkcipher_setkey(struct crypto_ablkcipher *cipher,
 
 	ctx->updated = 0;
 
+	if (ctx->fallback)
+		return crypto_ablkcipher_setkey(ctx->fallback, key, keylen);
+
 	return 0;
 }
 
@@ -1202,10 +1575,10 @@ out:
 			"cryp_disable_power() failed!", __func__);
 
 	/* Release the device */
-	spin_lock(&device_data->ctx_lock);
+	spin_lock_bh(&device_data->ctx_lock);
 	device_data->current_ctx = NULL;
 	ctx->device = NULL;
-	spin_unlock(&device_data->ctx_lock);
+	spin_unlock_bh(&device_data->ctx_lock);
 
 	/*
 	 * The down_interruptible part for this semaphore is called in
@@ -1672,6 +2045,43 @@ static struct crypto_alg des3_alg = {
 	}
 };
 
+/**
+ * cryp_aes_cra_init - Set up the request context and the software fallback
+ * @tfm: The transform being created.
+ *
+ * A transform without a fallback still works, its requests are then always
+ * queued for the engine.
+ */
+static int cryp_aes_cra_init(struct crypto_tfm *tfm)
+{
+	struct cryp_ctx *ctx = crypto_tfm_ctx(tfm);
+	const char *name = tfm->__crt_alg->cra_name;
+
+	ctx->fallback = crypto_alloc_ablkcipher(name, 0,
+			CRYPTO_ALG_ASYNC | CRYPTO_ALG_NEED_FALLBACK);
+	if (IS_ERR(ctx->fallback)) {
+		pr_debug(DEV_DBG_NAME " [%s]: no fallback for %s", __func__,
+			 name);
+		ctx->fallback = NULL;
+	}
+
+	tfm->crt_ablkcipher.reqsize = sizeof(struct cryp_req_ctx);
+	if (ctx->fallback)
+		tfm->crt_ablkcipher.reqsize +=
+			crypto_ablkcipher_reqsize(ctx->fallback);
+
+	return 0;
+}
+
+static void cryp_aes_cra_exit(struct crypto_tfm *tfm)
+{
+	struct cryp_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	if (ctx->fallback)
+		crypto_free_ablkcipher(ctx->fallback);
+	ctx->fallback = NULL;
+}
+
 /**
  * struct crypto_alg aes_ecb_alg
  */
@@ -1680,11 +2090,14 @@ static struct crypto_alg aes_ecb_alg = {
 	.cra_driver_name	=	"ecb-aes-ux500",
 	.cra_priority		=	100,
 	.cra_flags		=	CRYPTO_ALG_TYPE_ABLKCIPHER |
-					CRYPTO_ALG_ASYNC,
+					CRYPTO_ALG_ASYNC |
+					CRYPTO_ALG_NEED_FALLBACK,
 	.cra_blocksize		=	AES_BLOCK_SIZE,
 	.cra_ctxsize		=	sizeof(struct cryp_ctx),
 	.cra_alignmask		=	3,
 	.cra_type		=	&crypto_ablkcipher_type,
+	.cra_init		=	cryp_aes_cra_init,
+	.cra_exit		=	cryp_aes_cra_exit,
 	.cra_module		=	THIS_MODULE,
 	.cra_list		=	LIST_HEAD_INIT(aes_ecb_alg.cra_list),
 	.cra_u			=	{
@@ -1706,11 +2119,14 @@ static struct crypto_alg aes_cbc_alg = {
 	.cra_driver_name	=	"cbc-aes-ux500",
 	.cra_priority		=	100,
 	.cra_flags		=	CRYPTO_ALG_TYPE_ABLKCIPHER |
-					CRYPTO_ALG_ASYNC,
+					CRYPTO_ALG_ASYNC |
+					CRYPTO_ALG_NEED_FALLBACK,
 	.cra_blocksize		=	AES_BLOCK_SIZE,
 	.cra_ctxsize		=	sizeof(struct cryp_ctx),
 	.cra_alignmask		=	3,
 	.cra_type		=	&crypto_ablkcipher_type,
+	.cra_init		=	cryp_aes_cra_init,
+	.cra_exit		=	cryp_aes_cra_exit,
 	.cra_module		=	THIS_MODULE,
 	.cra_list		=	LIST_HEAD_INIT(aes_cbc_alg.cra_list),
 	.cra_u			=	{
@@ -1733,11 +2149,14 @@ static struct crypto_alg aes_ctr_alg = {
 	.cra_driver_name	=	"ctr-aes-ux500",
 	.cra_priority		=	100,
 	.cra_flags		=	CRYPTO_ALG_TYPE_ABLKCIPHER |
-					CRYPTO_ALG_ASYNC,
+					CRYPTO_ALG_ASYNC |
+					CRYPTO_ALG_NEED_FALLBACK,
 	.cra_blocksize		=	AES_BLOCK_SIZE,
 	.cra_ctxsize		=	sizeof(struct cryp_ctx),
 	.cra_alignmask		=	3,
 	.cra_type		=	&crypto_ablkcipher_type,
+	.cra_init		=	cryp_aes_cra_init,
+	.cra_exit		=	cryp_aes_cra_exit,
 	.cra_module		=	THIS_MODULE,
 	.cra_list		=	LIST_HEAD_INIT(aes_ctr_alg.cra_list),
 	.cra_u			=	{
@@ -1874,6 +2293,19 @@ static struct crypto_alg *ux500_cryp_algs[] = {
 	&des3_cbc_alg,
 };
 
+/**
+ * cryp_alg_supported - Check if an algorithm can be registered.
+ * @alg: The algorithm.
+ *
+ * The stand-in runs requests on the software fallback, which only the AES
+ * modes have.
+ */
+static bool cryp_alg_supported(struct crypto_alg *alg)
+{
+	return !IS_ENABLED(CONFIG_CRYPTO_DEV_UX500_STANDIN) ||
+		alg->cra_init == cryp_aes_cra_init;
+}
+
 /**
  * cryp_algs_register_all -
  */
@@ -1886,6 +2318,8 @@ static int cryp_algs_register_all(void)
 	pr_debug("[%s]", __func__);
 
 	for (i = 0; i < ARRAY_SIZE(ux500_cryp_algs); i++) {
+		if (!cryp_alg_supported(ux500_cryp_algs[i]))
+			continue;
 		ret = crypto_register_alg(ux500_cryp_algs[i]);
 		if (ret) {
 			count = i;
@@ -1897,7 +2331,8 @@ static int cryp_algs_register_all(void)
 	return 0;
 unreg:
 	for (i = 0; i < count; i++)
-		crypto_unregister_alg(ux500_cryp_algs[i]);
+		if (cryp_alg_supported(ux500_cryp_algs[i]))
+			crypto_unregister_alg(ux500_cryp_algs[i]);
 	return ret;
 }
 
@@ -1911,9 +2346,188 @@ static void cryp_algs_unregister_all(void)
 	pr_debug(DEV_DBG_NAME " [%s]", __func__);
 
 	for (i = 0; i < ARRAY_SIZE(ux500_cryp_algs); i++)
-		crypto_unregister_alg(ux500_cryp_algs[i]);
+		if (cryp_alg_supported(ux500_cryp_algs[i]))
+			crypto_unregister_alg(ux500_cryp_algs[i]);
 }
 
+#define CRYP_CALIBRATE_MIN	16
+#define CRYP_CALIBRATE_MAX	4096
+#define CRYP_CALIBRATE_LOOPS	64
+
+static const struct {
+	struct crypto_alg *alg;
+	enum cryp_algo_mode mode;
+} cryp_calibrate_algs[] = {
+	{ &aes_ecb_alg, CRYP_ALGO_AES_ECB },
+	{ &aes_cbc_alg, CRYP_ALGO_AES_CBC },
+	{ &aes_ctr_alg, CRYP_ALGO_AES_CTR },
+};
+
+struct cryp_calibrate_result {
+	struct completion completion;
+	int err;
+};
+
+static void cryp_calibrate_done(struct crypto_async_request *req, int err)
+{
+	struct cryp_calibrate_result *res = req->data;
+
+	if (err == -EINPROGRESS)
+		return;
+
+	res->err = err;
+	complete(&res->completion);
+}
+
+/**
+ * cryp_calibrate_time - Time CRYP_CALIBRATE_LOOPS requests of one size.
+ * @tfm: The transform to time.
+ * @buf: Data buffer, encrypted in place.
+ * @len: Request size.
+ *
+ * Returns the elapsed time in ns, or a negative error code.
+ */
+static s64 cryp_calibrate_time(struct crypto_ablkcipher *tfm, u8 *buf,
+			       unsigned int len)
+{
+	struct ablkcipher_request *req;
+	struct cryp_calibrate_result res;
+	struct scatterlist sg;
+	u8 iv[AES_BLOCK_SIZE];
+	ktime_t start;
+	s64 elapsed;
+	int ret = 0;
+	int i;
+
+	req = ablkcipher_request_alloc(tfm, GFP_KERNEL);
+	if (!req)
+		return -ENOMEM;
+
+	init_completion(&res.completion);
+	ablkcipher_request_set_callback(req, CRYPTO_TFM_REQ_MAY_BACKLOG,
+					cryp_calibrate_done, &res);
+	sg_init_one(&sg, buf, len);
+
+	start = ktime_get();
+	for (i = 0; i < CRYP_CALIBRATE_LOOPS && !ret; i++) {
+		memset(iv, 0, sizeof(iv));
+		ablkcipher_request_set_crypt(req, &sg, &sg, len, iv);
+		ret = crypto_ablkcipher_encrypt(req);
+		if (ret == -EINPROGRESS || ret == -EBUSY) {
+			wait_for_completion(&res.completion);
+			INIT_COMPLETION(res.completion);
+			ret = res.err;
+		}
+	}
+	elapsed = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	ablkcipher_request_free(req);
+
+	return ret ? ret : elapsed;
+}
+
+/**
+ * cryp_calibrate_mode - Find where the engine starts to beat software.
+ * @alg: Engine implementation of the mode.
+ * @mode: The mode.
+ * @buf: Scratch buffer of CRYP_CALIBRATE_MAX bytes.
+ *
+ * The threshold is the smallest measured size from which the engine is
+ * faster for all larger measured sizes.
+ */
+static void cryp_calibrate_mode(struct crypto_alg *alg,
+				enum cryp_algo_mode mode, u8 *buf)
+{
+	static const u8 key[AES_KEYSIZE_128];
+	struct crypto_ablkcipher *hw;
+	struct crypto_ablkcipher *sw;
+	int threshold = CRYP_CALIBRATE_MAX * 2;
+	unsigned int len;
+	s64 hw_ns, sw_ns;
+
+	hw = crypto_alloc_ablkcipher(alg->cra_driver_name, 0, 0);
+	if (IS_ERR(hw))
+		return;
+
+	sw = crypto_alloc_ablkcipher(alg->cra_name, 0,
+			CRYPTO_ALG_ASYNC | CRYPTO_ALG_NEED_FALLBACK);
+	if (IS_ERR(sw))
+		goto out_hw;
+
+	if (crypto_ablkcipher_setkey(hw, key, sizeof(key)) ||
+	    crypto_ablkcipher_setkey(sw, key, sizeof(key)))
+		goto out_sw;
+
+	/* Time the engine itself, not the dispatcher */
+	cryp_sw_threshold[mode] = 0;
+
+	for (len = CRYP_CALIBRATE_MIN; len <= CRYP_CALIBRATE_MAX; len *= 2) {
+		hw_ns = cryp_calibrate_time(hw, buf, len);
+		sw_ns = cryp_calibrate_time(sw, buf, len);
+		if (hw_ns < 0 || sw_ns < 0) {
+			threshold = 0;
+			break;
+		}
+
+		pr_debug(DEV_DBG_NAME " [%s] %s %u bytes: hw %lld ns, "
+			 "sw %lld ns", __func__, alg->cra_name, len,
+			 hw_ns, sw_ns);
+
+		if (hw_ns > sw_ns)
+			threshold = CRYP_CALIBRATE_MAX * 2;
+		else if (threshold > CRYP_CALIBRATE_MAX)
+			threshold = len;
+	}
+
+	if (threshold == CRYP_CALIBRATE_MIN)
+		threshold = 0;
+
+	cryp_sw_threshold[mode] = threshold;
+	pr_info("ux500_cryp: %s: software below %d bytes\n", alg->cra_name,
+		threshold);
+
+out_sw:
+	crypto_free_ablkcipher(sw);
+out_hw:
+	crypto_free_ablkcipher(hw);
+}
+
+static void cryp_calibrate_all(struct work_struct *work)
+{
+	u8 *buf;
+	int i;
+
+	buf = kzalloc(CRYP_CALIBRATE_MAX, GFP_KERNEL);
+	if (!buf)
+		return;
+
+	for (i = 0; i < ARRAY_SIZE(cryp_calibrate_algs); i++)
+		cryp_calibrate_mode(cryp_calibrate_algs[i].alg,
+				    cryp_calibrate_algs[i].mode, buf);
+
+	kfree(buf);
+}
+
+static DECLARE_WORK(cryp_calibrate_work, cryp_calibrate_all);
+
+static DEVICE_INT_ATTR(sw_threshold_ecb_aes, 0644,
+		       cryp_sw_threshold[CRYP_ALGO_AES_ECB]);
+static DEVICE_INT_ATTR(sw_threshold_cbc_aes, 0644,
+		       cryp_sw_threshold[CRYP_ALGO_AES_CBC]);
+static DEVICE_INT_ATTR(sw_threshold_ctr_aes, 0644,
+		       cryp_sw_threshold[CRYP_ALGO_AES_CTR]);
+
+static struct attribute *cryp_attrs[] = {
+	&dev_attr_sw_threshold_ecb_aes.attr.attr,
+	&dev_attr_sw_threshold_cbc_aes.attr.attr,
+	&dev_attr_sw_threshold_ctr_aes.attr.attr,
+	NULL
+};
+
+static const struct attribute_group cryp_attr_group = {
+	.attrs = cryp_attrs,
+};
+
 static int ux500_cryp_probe(struct platform_device *pdev)
 {
 	int ret;
@@ -2045,9 +2659,15 @@ static int ux500_cryp_probe(struct platform_device *pdev)
 		goto out_power;
 	}
 
+	if (sysfs_create_group(&dev->kobj, &cryp_attr_group))
+		dev_warn(dev, "[%s]: sysfs_create_group() failed!", __func__);
+
 	if (cryp_disable_power(&pdev->dev, device_data, false))
 		dev_err(dev, "[%s]: cryp_disable_power() failed!", __func__);
 
+	if (cryp_calibrate)
+		schedule_work(&cryp_calibrate_work);
+
 	return 0;
 
 out_power:
@@ -2085,22 +2705,24 @@ static int ux500_cryp_remove(struct platform_device *pdev)
 		return -ENOMEM;
 	}
 
+	cancel_work_sync(&cryp_calibrate_work);
+
 	/* Try to decrease the number of available devices. */
 	if (down_trylock(&driver_data.device_allocation))
 		return -EBUSY;
 
 	/* Check that the device is free */
-	spin_lock(&device_data->ctx_lock);
+	spin_lock_bh(&device_data->ctx_lock);
 	/* current_ctx allocates a device, NULL = unallocated */
 	if (device_data->current_ctx) {
 		/* The device is busy */
-		spin_unlock(&device_data->ctx_lock);
+		spin_unlock_bh(&device_data->ctx_lock);
 		/* Return the device to the pool. */
 		up(&driver_data.device_allocation);
 		return -EBUSY;
 	}
 
-	spin_unlock(&device_data->ctx_lock);
+	spin_unlock_bh(&device_data->ctx_lock);
 
 	/* Remove the device from the list */
 	if (klist_node_attached(&device_data->list_node))
@@ -2110,6 +2732,8 @@ static int ux500_cryp_remove(struct platform_device *pdev)
 	if (list_empty(&driver_data.device_list.k_list))
 		cryp_algs_unregister_all();
 
+	sysfs_remove_group(&pdev->dev.kobj, &cryp_attr_group);
+
 	res_irq = platform_get_resource(pdev, IORESOURCE_IRQ, 0);
 	if (!res_irq)
 		dev_err(&pdev->dev, "[%s]: IORESOURCE_IRQ, unavailable",
@@ -2152,7 +2776,7 @@ static void ux500_cryp_shutdown(struct platform_device *pdev)
 	}
 
 	/* Check that the device is free */
-	spin_lock(&device_data->ctx_lock);
+	spin_lock_bh(&device_data->ctx_lock);
 	/* current_ctx allocates a device, NULL = unallocated */
 	if (!device_data->current_ctx) {
 		if (down_trylock(&driver_data.device_allocation))
@@ -2165,7 +2789,7 @@ static void ux500_cryp_shutdown(struct platform_device *pdev)
 		 */
 		device_data->current_ctx++;
 	}
-	spin_unlock(&device_data->ctx_lock);
+	spin_unlock_bh(&device_data->ctx_lock);
 
 	/* Remove the device from the list */
 	if (klist_node_attached(&device_data->list_node))
@@ -2214,10 +2838,10 @@ static int ux500_cryp_suspend(struct platform_device *pdev, pm_message_t state)
 	else
 		disable_irq(res_irq->start);
 
-	spin_lock(&device_data->ctx_lock);
+	spin_lock_bh(&device_data->ctx_lock);
 	if (!device_data->current_ctx)
 		device_data->current_ctx++;
-	spin_unlock(&device_data->ctx_lock);
+	spin_unlock_bh(&device_data->ctx_lock);
 
 	if (device_data->current_ctx == ++temp_ctx) {
 		if (down_interruptible(&driver_data.device_allocation))
@@ -2250,15 +2874,17 @@ static int ux500_cryp_resume(struct platform_device *pdev)
 		return -ENOMEM;
 	}
 
-	spin_lock(&device_data->ctx_lock);
+	spin_lock_bh(&device_data->ctx_lock);
 	if (device_data->current_ctx == ++temp_ctx)
 		device_data->current_ctx = NULL;
-	spin_unlock(&device_data->ctx_lock);
+	spin_unlock_bh(&device_data->ctx_lock);
 
 
-	if (!device_data->current_ctx)
+	if (!device_data->current_ctx) {
 		up(&driver_data.device_allocation);
-	else
+		/* Restart requests queued while suspended */
+		tasklet_schedule(&driver_data.queue_tasklet);
+	} else
 		ret = cryp_enable_power(&pdev->dev, device_data, true);
 
 	if (ret)
@@ -2285,19 +2911,125 @@ static struct platform_driver cryp_driver = {
 	}
 };
 
+#ifdef CONFIG_CRYPTO_DEV_UX500_STANDIN
+static void cryp_standin_remove(void)
+{
+	int i;
+
+	cryp_algs_unregister_all();
+	sysfs_remove_group(&cryp_standin_pdev->dev.kobj, &cryp_attr_group);
+	device_remove_file(&cryp_standin_pdev->dev, &dev_attr_standin_stats);
+
+	for (i = 0; i < cryp_standin_devices; i++) {
+		cancel_work_sync(&cryp_standin[i].work);
+		klist_remove(&cryp_standin[i].device_data.list_node);
+	}
+
+	kfree(cryp_standin);
+	platform_device_unregister(cryp_standin_pdev);
+}
+
+/**
+ * cryp_standin_probe - Set up the stand-in engines in place of the devices.
+ *
+ * Calibration is skipped, it would find the stand-in slower than software
+ * at every size and leave it nothing to do.
+ */
+static int cryp_standin_probe(void)
+{
+	struct cryp_device_data *device_data;
+	struct device *dev;
+	int ret;
+	int i;
+
+	if (cryp_standin_devices < 1)
+		return -EINVAL;
+
+	cryp_standin_pdev = platform_device_register_simple("cryp1-standin",
+							    -1, NULL, 0);
+	if (IS_ERR(cryp_standin_pdev))
+		return PTR_ERR(cryp_standin_pdev);
+	dev = &cryp_standin_pdev->dev;
+
+	cryp_standin = kcalloc(cryp_standin_devices, sizeof(*cryp_standin),
+			       GFP_KERNEL);
+	if (!cryp_standin) {
+		ret = -ENOMEM;
+		goto out_pdev;
+	}
+
+	for (i = 0; i < cryp_standin_devices; i++) {
+		device_data = &cryp_standin[i].device_data;
+		device_data->dev = dev;
+		spin_lock_init(&device_data->ctx_lock);
+		spin_lock_init(&device_data->power_state_spinlock);
+		INIT_WORK(&cryp_standin[i].work, cryp_standin_work);
+
+		klist_add_tail(&device_data->list_node,
+			       &driver_data.device_list);
+		up(&driver_data.device_allocation);
+	}
+
+	atomic_set(&session_id, 1);
+
+	ret = cryp_algs_register_all();
+	if (ret) {
+		dev_err(dev, "[%s]: cryp_algs_register_all() failed!",
+			__func__);
+		goto out_list;
+	}
+
+	if (sysfs_create_group(&dev->kobj, &cryp_attr_group) ||
+	    device_create_file(dev, &dev_attr_standin_stats))
+		dev_warn(dev, "[%s]: sysfs attributes failed!", __func__);
+
+	dev_info(dev, "%d stand-in engines\n", cryp_standin_devices);
+
+	return 0;
+
+out_list:
+	for (i = 0; i < cryp_standin_devices; i++)
+		klist_remove(&cryp_standin[i].device_data.list_node);
+	kfree(cryp_standin);
+out_pdev:
+	platform_device_unregister(cryp_standin_pdev);
+	return ret;
+}
+#else
+static inline int cryp_standin_probe(void)
+{
+	return -ENODEV;
+}
+
+static inline void cryp_standin_remove(void)
+{
+}
+#endif
+
 static int __init ux500_cryp_mod_init(void)
 {
 	pr_debug("[%s] is called!", __func__);
 	klist_init(&driver_data.device_list, NULL, NULL);
 	/* Initialize the semaphore to 0 devices (locked state) */
 	sema_init(&driver_data.device_allocation, 0);
+	crypto_init_queue(&driver_data.queue, CRYP_QUEUE_LENGTH);
+	spin_lock_init(&driver_data.queue_lock);
+	tasklet_init(&driver_data.queue_tasklet, cryp_queue_tasklet, 0);
+
+	if (IS_ENABLED(CONFIG_CRYPTO_DEV_UX500_STANDIN))
+		return cryp_standin_probe();
+
 	return platform_driver_register(&cryp_driver);
 }
 
 static void __exit ux500_cryp_mod_fini(void)
 {
 	pr_debug("[%s] is called!", __func__);
-	platform_driver_unregister(&cryp_driver);
+	if (IS_ENABLED(CONFIG_CRYPTO_DEV_UX500_STANDIN))
+		cryp_standin_remove();
+	else
+		platform_driver_unregister(&cryp_driver);
+	tasklet_kill(&driver_data.queue_tasklet);
 	return;
 }
 
@@ -2305,6 +3037,12 @@ module_init(ux500_cryp_mod_init);
 module_exit(ux500_cryp_mod_fini);
 
 module_param(cryp_mode, int, 0);
+module_param(cryp_fallback_qlen, int, 0644);
+MODULE_PARM_DESC(cryp_fallback_qlen, "Queued DMA requests before new ones "
+		 "are handled in software, 0 = never (default 2)");
+module_param(cryp_calibrate, bool, 0);
+MODULE_PARM_DESC(cryp_calibrate, "Measure the software/engine crossover "
+		 "at probe (default on)");
 
 MODULE_DESCRIPTION("Driver for ST-Ericsson UX500 CRYP crypto engine.");
 MODULE_ALIAS("aes-all");
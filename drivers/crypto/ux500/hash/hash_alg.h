@@ -298,7 +298,6 @@ struct hash_config {
 /**
  * struct hash_dma - Structure used for dma.
  * @mask:		DMA capabilities bitmap mask.
- * @complete:		Used to maintain state for a "completion".
  * @chan_mem2hash:	DMA channel.
  * @cfg_mem2hash:	DMA channel configuration.
  * @sg_len:		Scatterlist length.
@@ -307,7 +306,6 @@ struct hash_config {
  */
 struct hash_dma {
 	dma_cap_mask_t		mask;
-	struct completion	complete;
 	struct dma_chan		*chan_mem2hash;
 	void			*cfg_mem2hash;
 	int			sg_len;
@@ -326,6 +324,7 @@ struct hash_dma {
  * @device:	Pointer to the device structure.
  * @dma_mode:	Used in special cases (workaround), e.g. need to change to
  *		cpu mode, if not supported/working in dma mode.
+ * @fallback:	Software implementation used when the engine is congested.
  */
 struct hash_ctx {
 	u8			*key;
@@ -336,6 +335,7 @@ struct hash_ctx {
 	int			digestsize;
 	struct hash_device_data	*device;
 	bool			dma_mode;
+	struct crypto_shash	*fallback;
 };
 
 /**
@@ -343,10 +343,13 @@ struct hash_ctx {
  * @base:		Pointer to the hardware base address.
  * @list_node:		For inclusion in klist.
  * @dev:		Pointer to the device dev structure.
- * @ctx_lock:		Spinlock for current_ctx.
+ * @ctx_lock:		Spinlock for current_ctx, taken with bottom halves
+ *			off as the queue tasklet and the DMA callback
+ *			take it too.
  * @current_ctx:	Pointer to the currently allocated context.
+ * @current_req:	Asynchronous request the device is working on, if any.
  * @power_state:	TRUE = power state on, FALSE = power state off.
- * @power_state_lock:	Spinlock for power_state.
+ * @power_state_lock:	Spinlock for power_state, bottom halves off.
  * @regulator:		Pointer to the device's power control.
  * @clk:		Pointer to the device's clock control.
  * @restore_dev_state:	TRUE = saved state, FALSE = no saved state.
@@ -358,6 +361,7 @@ struct hash_device_data {
 	struct device			*dev;
 	struct spinlock			ctx_lock;
 	struct hash_ctx			*current_ctx;
+	struct ahash_request		*current_req;
 	bool				power_state;
 	struct spinlock			power_state_lock;
 	struct ux500_regulator		*regulator;
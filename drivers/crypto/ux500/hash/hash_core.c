@@ -11,15 +11,21 @@
  */
 
 #include <linux/clk.h>
+#include <linux/completion.h>
 #include <linux/device.h>
 #include <linux/err.h>
 #include <linux/init.h>
 #include <linux/io.h>
 #include <linux/klist.h>
+#include <linux/ktime.h>
 #include <linux/kernel.h>
+#include <linux/math64.h>
 #include <linux/module.h>
 #include <linux/platform_device.h>
 #include <linux/crypto.h>
+#include <linux/interrupt.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
 
 #include <linux/regulator/dbx500-prcmu.h>
 #include <linux/dmaengine.h>
@@ -41,6 +47,26 @@ static int hash_mode;
 module_param(hash_mode, int, 0);
 MODULE_PARM_DESC(hash_mode, "CPU or DMA mode. CPU = 0 (default), DMA = 1");
 
+static int hash_fallback_qlen = 2;
+module_param(hash_fallback_qlen, int, 0644);
+MODULE_PARM_DESC(hash_fallback_qlen, "Queued DMA requests before new ones "
+		 "are handled in software, 0 = never (default 2)");
+
+static bool hash_calibrate = true;
+module_param(hash_calibrate, bool, 0);
+MODULE_PARM_DESC(hash_calibrate, "Measure the software/engine crossover "
+		 "at probe (default on)");
+
+/*
+ * Digests of messages shorter than the threshold of their algorithm are
+ * calculated by the software fallback, where setting up the engine costs
+ * more than the hashing. Measured at boot by hash_calibrate_work and
+ * tunable through sysfs; the HMAC variants use the threshold of their hash.
+ */
+static int hash_sw_threshold[HASH_ALGO_SHA256 + 1];
+
+#define HASH_QUEUE_LENGTH	50
+
 /**
  * Pre-calculated empty message digests.
  */
@@ -77,10 +103,16 @@ static u8 zero_message_hmac_sha256[SHA256_DIGEST_SIZE] = {
  *
  * @device_list:	A list of registered devices to choose from.
  * @device_allocation:	A semaphore initialized with number of devices.
+ * @queue:		DMA mode requests waiting for a free device.
+ * @queue_lock:		Lock for queue.
+ * @queue_tasklet:	Hands queued requests to free devices.
  */
 struct hash_driver_data {
 	struct klist		device_list;
 	struct semaphore	device_allocation;
+	struct crypto_queue	queue;
+	spinlock_t		queue_lock;
+	struct tasklet_struct	queue_tasklet;
 };
 
 static struct hash_driver_data	driver_data;
@@ -107,10 +139,11 @@ static void hash_messagepad(struct hash_device_data *device_data,
  */
 static void release_hash_device(struct hash_device_data *device_data)
 {
-	spin_lock(&device_data->ctx_lock);
+	spin_lock_bh(&device_data->ctx_lock);
 	device_data->current_ctx->device = NULL;
 	device_data->current_ctx = NULL;
-	spin_unlock(&device_data->ctx_lock);
+	device_data->current_req = NULL;
+	spin_unlock_bh(&device_data->ctx_lock);
 
 	/*
 	 * The down_interruptible part for this semaphore is called in
@@ -131,15 +164,15 @@ static void hash_dma_setup_channel(struct hash_device_data *device_data,
 		dma_request_channel(device_data->dma.mask,
 				platform_data->dma_filter,
 				device_data->dma.cfg_mem2hash);
-
-	init_completion(&device_data->dma.complete);
 }
 
+static void hash_dma_complete(struct hash_device_data *device_data);
+
 static void hash_dma_callback(void *data)
 {
 	struct hash_ctx *ctx = (struct hash_ctx *) data;
 
-	complete(&ctx->device->dma.complete);
+	hash_dma_complete(ctx->device);
 }
 
 static int hash_set_dma_transfer(struct hash_ctx *ctx, struct scatterlist *sg,
@@ -298,7 +331,7 @@ static int hash_disable_power(
 	int ret = 0;
 	struct device *dev = device_data->dev;
 
-	spin_lock(&device_data->power_state_lock);
+	spin_lock_bh(&device_data->power_state_lock);
 	if (!device_data->power_state)
 		goto out;
 
@@ -316,7 +349,7 @@ static int hash_disable_power(
 	device_data->power_state = false;
 
 out:
-	spin_unlock(&device_data->power_state_lock);
+	spin_unlock_bh(&device_data->power_state_lock);
 
 	return ret;
 }
@@ -336,7 +369,7 @@ static int hash_enable_power(
 	int ret = 0;
 	struct device *dev = device_data->dev;
 
-	spin_lock(&device_data->power_state_lock);
+	spin_lock_bh(&device_data->power_state_lock);
 	if (!device_data->power_state) {
 		ret = ux500_regulator_atomic_enable(device_data->regulator);
 		if (ret) {
@@ -363,58 +396,50 @@ static int hash_enable_power(
 		}
 	}
 out:
-	spin_unlock(&device_data->power_state_lock);
+	spin_unlock_bh(&device_data->power_state_lock);
 
 	return ret;
 }
 
 /**
- * hash_get_device_data - Checks for an available hash device and return it.
+ * hash_select_device - Allocates a free hash device to a context.
  * @hash_ctx:		Structure for the hash context.
  * @device_data:	Structure for the hash device.
  *
- * This function check for an available hash device and return it to
- * the caller.
- * Note! Caller need to release the device, calling up().
+ * The caller must already have taken one count of device_allocation.
  */
-static int hash_get_device_data(struct hash_ctx *ctx,
-				struct hash_device_data **device_data)
+static int hash_select_device(struct hash_ctx *ctx,
+			      struct hash_device_data **device_data)
 {
-	int			ret;
 	struct klist_iter	device_iterator;
 	struct klist_node	*device_node;
 	struct hash_device_data *local_device_data = NULL;
 
-	/* Wait until a device is available */
-	ret = down_interruptible(&driver_data.device_allocation);
-	if (ret)
-		return ret;  /* Interrupted */
-
 	/* Select a device */
 	klist_iter_init(&driver_data.device_list, &device_iterator);
 	device_node = klist_next(&device_iterator);
 	while (device_node) {
 		local_device_data = container_of(device_node,
 					   struct hash_device_data, list_node);
-		spin_lock(&local_device_data->ctx_lock);
+		spin_lock_bh(&local_device_data->ctx_lock);
 		/* current_ctx allocates a device, NULL = unallocated */
 		if (local_device_data->current_ctx) {
 			device_node = klist_next(&device_iterator);
 		} else {
 			local_device_data->current_ctx = ctx;
 			ctx->device = local_device_data;
-			spin_unlock(&local_device_data->ctx_lock);
+			spin_unlock_bh(&local_device_data->ctx_lock);
 			break;
 		}
-		spin_unlock(&local_device_data->ctx_lock);
+		spin_unlock_bh(&local_device_data->ctx_lock);
 	}
 	klist_iter_exit(&device_iterator);
 
 	if (!device_node) {
 		/**
 		 * No free device found.
-		 * Since we allocated a device with down_interruptible, this
-		 * should not be able to happen.
+		 * Since the caller allocated a device from device_allocation,
+		 * this should not be able to happen.
 		 * Number of available devices, which are contained in
 		 * device_allocation, is therefore decremented by not doing
 		 * an up(device_allocation).
@@ -427,6 +452,28 @@ static int hash_get_device_data(struct hash_ctx *ctx,
 	return 0;
 }
 
+/**
+ * hash_get_device_data - Checks for an available hash device and return it.
+ * @hash_ctx:		Structure for the hash context.
+ * @device_data:	Structure for the hash device.
+ *
+ * This function check for an available hash device and return it to
+ * the caller.
+ * Note! Caller need to release the device, calling up().
+ */
+static int hash_get_device_data(struct hash_ctx *ctx,
+				struct hash_device_data **device_data)
+{
+	int			ret;
+
+	/* Wait until a device is available */
+	ret = down_interruptible(&driver_data.device_allocation);
+	if (ret)
+		return ret;  /* Interrupted */
+
+	return hash_select_device(ctx, device_data);
+}
+
 /**
  * hash_hw_write_key - Writes the key to the hardware registries.
  *
@@ -576,6 +623,13 @@ static int hash_init(struct ahash_request *req)
 
 	memset(&ctx->state, 0, sizeof(struct hash_state));
 	ctx->updated = 0;
+
+	/* The stand-in takes any final as a queued request */
+	if (IS_ENABLED(CONFIG_CRYPTO_DEV_UX500_STANDIN)) {
+		ctx->dma_mode = true;
+		goto out;
+	}
+
 	if (hash_mode == HASH_MODE_DMA) {
 		if ((ctx->config.oper_mode == HASH_OPER_MODE_HMAC) &&
 				cpu_is_u5500()) {
@@ -918,22 +972,21 @@ out:
 }
 
 /**
- * hash_dma_final - The hash dma final function for SHA1/SHA256.
- * @req:	The hash request for the job.
+ * hash_dma_start - Program a device and start the DMA for a queued request.
+ * @req:		The hash request for the job.
+ * @device_data:	The device allocated for the request.
+ *
+ * Called from the queue tasklet. On success the request is completed from
+ * the DMA callback, see hash_dma_complete().
  */
-static int hash_dma_final(struct ahash_request *req)
+static int hash_dma_start(struct ahash_request *req,
+		struct hash_device_data *device_data)
 {
 	int ret = 0;
 	struct crypto_ahash *tfm = crypto_ahash_reqtfm(req);
 	struct hash_ctx *ctx = crypto_ahash_ctx(tfm);
-	struct hash_device_data *device_data;
-	u8 digest[SHA256_DIGEST_SIZE];
 	int bytes_written = 0;
 
-	ret = hash_get_device_data(ctx, &device_data);
-	if (ret)
-		return ret;
-
 	dev_dbg(device_data->dev, "[%s] (ctx=0x%x)!", __func__, (u32) ctx);
 
 	/* Enable device power (and clock) */
@@ -941,7 +994,7 @@ static int hash_dma_final(struct ahash_request *req)
 	if (ret) {
 		dev_err(device_data->dev, "[%s]: "
 				"hash_enable_power() failed!", __func__);
-		goto out;
+		return ret;
 	}
 
 	if (ctx->updated) {
@@ -990,6 +1043,7 @@ static int hash_dma_final(struct ahash_request *req)
 	if (!ctx->device->dma.nents) {
 		dev_err(device_data->dev, "[%s] "
 				"ctx->device->dma.nents = 0", __func__);
+		ret = -EINVAL;
 		goto out_power;
 	}
 
@@ -997,10 +1051,72 @@ static int hash_dma_final(struct ahash_request *req)
 	if (bytes_written != req->nbytes) {
 		dev_err(device_data->dev, "[%s] "
 				"hash_dma_write() failed!", __func__);
+		ret = -EFAULT;
 		goto out_power;
 	}
 
-	wait_for_completion(&ctx->device->dma.complete);
+	return 0;
+
+out_power:
+	/* Disable power (and clock) */
+	if (hash_disable_power(device_data, false))
+		dev_err(device_data->dev, "[%s] hash_disable_power() failed!",
+				__func__);
+
+	return ret;
+}
+
+/**
+ * hash_dma_finish - Release the resources of a finished DMA final.
+ * @req:		The hash request for the job.
+ * @device_data:	The device that ran it.
+ */
+static void hash_dma_finish(struct ahash_request *req,
+		struct hash_device_data *device_data)
+{
+	struct crypto_ahash *tfm = crypto_ahash_reqtfm(req);
+	struct hash_ctx *ctx = crypto_ahash_ctx(tfm);
+
+	release_hash_device(device_data);
+
+	/**
+	 * Allocated in setkey, and only used in HMAC.
+	 */
+	kfree(ctx->key);
+	ctx->key = NULL;
+}
+
+/**
+ * hash_finish - Release a device and complete the request it worked on.
+ * @device_data:	The device.
+ * @err:		Result to report to the owner of the request.
+ *
+ * The device is released and the next queued request is started before
+ * the owner is told, so the engine stays busy while the owner processes
+ * the result.
+ */
+static void hash_finish(struct hash_device_data *device_data, int err)
+{
+	struct ahash_request *req = device_data->current_req;
+
+	hash_dma_finish(req, device_data);
+	tasklet_schedule(&driver_data.queue_tasklet);
+
+	req->base.complete(&req->base, err);
+}
+
+/**
+ * hash_dma_complete - Collect the digest of the request a device runs.
+ * @device_data:	The device.
+ *
+ * Runs in the DMA tasklet.
+ */
+static void hash_dma_complete(struct hash_device_data *device_data)
+{
+	struct ahash_request *req = device_data->current_req;
+	struct hash_ctx *ctx = device_data->current_ctx;
+	u8 digest[SHA256_DIGEST_SIZE];
+
 	hash_dma_done(ctx);
 
 	while (device_data->base->str & HASH_STR_DCAL_MASK)
@@ -1018,19 +1134,240 @@ static int hash_dma_final(struct ahash_request *req)
 	hash_get_digest(device_data, digest, ctx->config.algorithm);
 	memcpy(req->result, digest, ctx->digestsize);
 
-out_power:
 	/* Disable power (and clock) */
 	if (hash_disable_power(device_data, false))
 		dev_err(device_data->dev, "[%s] hash_disable_power() failed!",
 				__func__);
 
-out:
-	release_hash_device(device_data);
+	hash_finish(device_data, 0);
+}
+
+#ifdef CONFIG_CRYPTO_DEV_UX500_STANDIN
+/*
+ * Stand-in for the engine. hash_standin_devices devices without registers,
+ * clock or regulator take the place of the platform devices. The queue
+ * tasklet hands them requests like it does to the engine; each digests its
+ * request with the software fallback from a workqueue and then completes
+ * it like the DMA callback would. The throughput of the stand-in engines
+ * over the time they were busy is in the standin_stats attribute.
+ */
+static int hash_standin_devices = 2;
+module_param(hash_standin_devices, int, 0);
+MODULE_PARM_DESC(hash_standin_devices, "Number of stand-in engines "
+		"(default 2)");
+
+/**
+ * struct hash_standin - A stand-in engine
+ * @device_data:	The device the queue tasklet allocates.
+ * @work:		Runs the request of the device.
+ */
+struct hash_standin {
+	struct hash_device_data	device_data;
+	struct work_struct	work;
+};
+
+static struct platform_device	*hash_standin_pdev;
+static struct hash_standin	*hash_standin;
+static atomic64_t		hash_standin_requests;
+static atomic64_t		hash_standin_bytes;
+static atomic64_t		hash_standin_ns;
+
+static void hash_standin_work(struct work_struct *work)
+{
+	struct hash_standin *standin =
+		container_of(work, struct hash_standin, work);
+	struct ahash_request *req = standin->device_data.current_req;
+	struct crypto_ahash *tfm = crypto_ahash_reqtfm(req);
+	struct hash_ctx *ctx = crypto_ahash_ctx(tfm);
+	struct shash_desc *desc = ahash_request_ctx(req);
+	ktime_t start = ktime_get();
+	int ret;
+
+	desc->tfm = ctx->fallback;
+	desc->flags = req->base.flags & CRYPTO_TFM_REQ_MAY_SLEEP;
+	ret = shash_ahash_digest(req, desc);
+
+	atomic64_add(ktime_to_ns(ktime_sub(ktime_get(), start)),
+			&hash_standin_ns);
+	atomic64_add(req->nbytes, &hash_standin_bytes);
+	atomic64_inc(&hash_standin_requests);
+
+	/* Complete in softirq context, like the DMA callback */
+	local_bh_disable();
+	hash_finish(&standin->device_data, ret);
+	local_bh_enable();
+}
+
+/**
+ * hash_standin_start - Start a queued request on a stand-in engine.
+ * @req:		The hash request for the job.
+ * @device_data:	The device allocated for the request.
+ */
+static int hash_standin_start(struct ahash_request *req,
+		struct hash_device_data *device_data)
+{
+	struct crypto_ahash *tfm = crypto_ahash_reqtfm(req);
+	struct hash_ctx *ctx = crypto_ahash_ctx(tfm);
+	struct hash_standin *standin =
+		container_of(device_data, struct hash_standin, device_data);
+
+	if (!ctx->fallback)
+		return -ENODEV;
+
+	queue_work(system_unbound_wq, &standin->work);
+
+	return 0;
+}
+
+static ssize_t hash_standin_show_stats(struct device *dev,
+		struct device_attribute *attr, char *buf)
+{
+	u64 requests = atomic64_read(&hash_standin_requests);
+	u64 bytes = atomic64_read(&hash_standin_bytes);
+	u64 ns = atomic64_read(&hash_standin_ns);
+
+	return sprintf(buf, "%llu requests %llu bytes %llu MB/s\n",
+			requests, bytes, ns ? div64_u64(bytes * 1000, ns) : 0);
+}
+
+static DEVICE_ATTR(standin_stats, 0444, hash_standin_show_stats, NULL);
+#else
+static inline int hash_standin_start(struct ahash_request *req,
+		struct hash_device_data *device_data)
+{
+	return -ENODEV;
+}
+#endif
+
+/**
+ * hash_queue_tasklet - Hand queued requests to free devices.
+ * @data:	Unused.
+ *
+ * Only one instance runs at a time, which is what keeps two requests for
+ * the same transform from being programmed into two devices at once.
+ */
+static void hash_queue_tasklet(unsigned long data)
+{
+	struct crypto_async_request *async_req;
+	struct crypto_async_request *backlog;
+	struct ahash_request *req;
+	struct hash_device_data *device_data;
+	struct hash_ctx *ctx;
+	int ret;
+
+	for (;;) {
+		if (down_trylock(&driver_data.device_allocation))
+			return; /* All busy, hash_dma_complete reschedules */
+
+		spin_lock_bh(&driver_data.queue_lock);
+		if (!driver_data.queue.qlen)
+			goto out_idle;
+
+		/* The transform context can only be on one device at a time */
+		async_req = list_first_entry(&driver_data.queue.list,
+					     struct crypto_async_request, list);
+		ctx = crypto_tfm_ctx(async_req->tfm);
+		if (ctx->device)
+			goto out_idle;
+
+		backlog = crypto_get_backlog(&driver_data.queue);
+		async_req = crypto_dequeue_request(&driver_data.queue);
+		spin_unlock_bh(&driver_data.queue_lock);
+
+		if (backlog)
+			backlog->complete(backlog, -EINPROGRESS);
+
+		req = ahash_request_cast(async_req);
+
+		ret = hash_select_device(ctx, &device_data);
+		if (ret) {
+			req->base.complete(&req->base, ret);
+			continue;
+		}
+
+		device_data->current_req = req;
+		if (IS_ENABLED(CONFIG_CRYPTO_DEV_UX500_STANDIN))
+			ret = hash_standin_start(req, device_data);
+		else
+			ret = hash_dma_start(req, device_data);
+		if (ret) {
+			hash_dma_finish(req, device_data);
+			req->base.complete(&req->base, ret);
+		}
+	}
+
+out_idle:
+	spin_unlock_bh(&driver_data.queue_lock);
+	up(&driver_data.device_allocation);
+}
+
+/**
+ * hash_fallback_final - Calculate the digest in software.
+ * @req:	The hash request for the job.
+ *
+ * Like the DMA path, all data is hashed in one go from req->src.
+ */
+static int hash_fallback_final(struct ahash_request *req)
+{
+	struct crypto_ahash *tfm = crypto_ahash_reqtfm(req);
+	struct hash_ctx *ctx = crypto_ahash_ctx(tfm);
+	struct shash_desc *desc = ahash_request_ctx(req);
+	int ret;
+
+	desc->tfm = ctx->fallback;
+	desc->flags = req->base.flags & CRYPTO_TFM_REQ_MAY_SLEEP;
+
+	ret = shash_ahash_digest(req, desc);
 
 	/**
 	 * Allocated in setkey, and only used in HMAC.
 	 */
 	kfree(ctx->key);
+	ctx->key = NULL;
+
+	return ret;
+}
+
+/**
+ * hash_use_software - Check if a digest is too short for the engine.
+ * @req:	The hash request, already initialized.
+ */
+static bool hash_use_software(struct ahash_request *req)
+{
+	struct crypto_ahash *tfm = crypto_ahash_reqtfm(req);
+	struct hash_ctx *ctx = crypto_ahash_ctx(tfm);
+
+	return ctx->fallback &&
+		req->nbytes < hash_sw_threshold[ctx->config.algorithm];
+}
+
+/**
+ * hash_dma_final - The hash dma final function for SHA1/SHA256.
+ * @req:	The hash request for the job.
+ *
+ * Queues the request for the engine and returns -EINPROGRESS (or -EBUSY
+ * when backlogged); the digest is delivered through the request callback.
+ * If the engine already has hash_fallback_qlen requests waiting, the digest
+ * is instead calculated synchronously in software.
+ */
+static int hash_dma_final(struct ahash_request *req)
+{
+	struct crypto_ahash *tfm = crypto_ahash_reqtfm(req);
+	struct hash_ctx *ctx = crypto_ahash_ctx(tfm);
+	bool congested;
+	int ret;
+
+	spin_lock_bh(&driver_data.queue_lock);
+	congested = ctx->fallback && hash_fallback_qlen > 0 &&
+		driver_data.queue.qlen >= hash_fallback_qlen;
+	if (!congested)
+		ret = ahash_enqueue_request(&driver_data.queue, req);
+	spin_unlock_bh(&driver_data.queue_lock);
+
+	if (congested)
+		return hash_fallback_final(req);
+
+	tasklet_schedule(&driver_data.queue_tasklet);
 
 	return ret;
 }
@@ -1459,7 +1796,7 @@ static int ahash_final(struct ahash_request *req)
 	else
 		ret = hash_hw_final(req);
 
-	if (ret) {
+	if (ret && ret != -EINPROGRESS && ret != -EBUSY) {
 		pr_err(DEV_DBG_NAME " [%s] hash_hw/dma_final() failed",
 				__func__);
 	}
@@ -1486,6 +1823,9 @@ static int hash_setkey(struct crypto_ahash *tfm,
 	memcpy(ctx->key, key, keylen);
 	ctx->keylen = keylen;
 
+	if (ctx->fallback)
+		ret = crypto_shash_setkey(ctx->fallback, key, keylen);
+
 	return ret;
  }
 
@@ -1523,6 +1863,9 @@ static int ahash_sha1_digest(struct ahash_request *req)
 	if (ret1)
 		goto out;
 
+	if (hash_use_software(req))
+		return hash_fallback_final(req);
+
 	ret1 = ahash_update(req);
 	ret2 = ahash_final(req);
 
@@ -1538,6 +1881,9 @@ static int ahash_sha256_digest(struct ahash_request *req)
 	if (ret1)
 		goto out;
 
+	if (hash_use_software(req))
+		return hash_fallback_final(req);
+
 	ret1 = ahash_update(req);
 	ret2 = ahash_final(req);
 
@@ -1579,6 +1925,9 @@ static int hmac_sha1_digest(struct ahash_request *req)
 	if (ret1)
 		goto out;
 
+	if (hash_use_software(req))
+		return hash_fallback_final(req);
+
 	ret1 = ahash_update(req);
 	ret2 = ahash_final(req);
 
@@ -1594,6 +1943,9 @@ static int hmac_sha256_digest(struct ahash_request *req)
 	if (ret1)
 		goto out;
 
+	if (hash_use_software(req))
+		return hash_fallback_final(req);
+
 	ret1 = ahash_update(req);
 	ret2 = ahash_final(req);
 
@@ -1613,6 +1965,42 @@ static int hmac_sha256_setkey(struct crypto_ahash *tfm,
 	return hash_setkey(tfm, key, keylen, HASH_ALGO_SHA256);
 }
 
+/**
+ * hash_cra_init - Set up the request context and the software fallback.
+ * @tfm:	The transform being created.
+ *
+ * A transform without a fallback still works, its requests are then always
+ * queued for the engine.
+ */
+static int hash_cra_init(struct crypto_tfm *tfm)
+{
+	struct hash_ctx *ctx = crypto_tfm_ctx(tfm);
+	const char *name = tfm->__crt_alg->cra_name;
+
+	ctx->fallback = crypto_alloc_shash(name, 0, CRYPTO_ALG_NEED_FALLBACK);
+	if (IS_ERR(ctx->fallback)) {
+		pr_debug(DEV_DBG_NAME " [%s] no fallback for %s", __func__,
+				name);
+		ctx->fallback = NULL;
+		return 0;
+	}
+
+	crypto_ahash_set_reqsize(__crypto_ahash_cast(tfm),
+			sizeof(struct shash_desc) +
+			crypto_shash_descsize(ctx->fallback));
+
+	return 0;
+}
+
+static void hash_cra_exit(struct crypto_tfm *tfm)
+{
+	struct hash_ctx *ctx = crypto_tfm_ctx(tfm);
+
+	if (ctx->fallback)
+		crypto_free_shash(ctx->fallback);
+	ctx->fallback = NULL;
+}
+
 static struct ahash_alg ahash_sha1_alg = {
 	.init			 = ahash_sha1_init,
 	.update			 = ahash_update,
@@ -1623,9 +2011,12 @@ static struct ahash_alg ahash_sha1_alg = {
 	.halg.base = {
 		.cra_name	 = "sha1",
 		.cra_driver_name = "sha1-ux500",
-		.cra_flags	 = CRYPTO_ALG_TYPE_AHASH | CRYPTO_ALG_ASYNC,
+		.cra_flags	 = CRYPTO_ALG_TYPE_AHASH | CRYPTO_ALG_ASYNC |
+				   CRYPTO_ALG_NEED_FALLBACK,
 		.cra_blocksize	 = SHA1_BLOCK_SIZE,
 		.cra_ctxsize	 = sizeof(struct hash_ctx),
+		.cra_init	 = hash_cra_init,
+		.cra_exit	 = hash_cra_exit,
 		.cra_module	 = THIS_MODULE,
 	}
 };
@@ -1640,10 +2031,13 @@ static struct ahash_alg ahash_sha256_alg = {
 	.halg.base = {
 		.cra_name        = "sha256",
 		.cra_driver_name = "sha256-ux500",
-		.cra_flags       = CRYPTO_ALG_TYPE_AHASH | CRYPTO_ALG_ASYNC,
+		.cra_flags       = CRYPTO_ALG_TYPE_AHASH | CRYPTO_ALG_ASYNC |
+				   CRYPTO_ALG_NEED_FALLBACK,
 		.cra_blocksize   = SHA256_BLOCK_SIZE,
 		.cra_ctxsize	 = sizeof(struct hash_ctx),
 		.cra_type	 = &crypto_ahash_type,
+		.cra_init	 = hash_cra_init,
+		.cra_exit	 = hash_cra_exit,
 		.cra_module      = THIS_MODULE,
 	}
 };
@@ -1659,10 +2053,13 @@ static struct ahash_alg hmac_sha1_alg = {
 	.halg.base = {
 		.cra_name        = "hmac(sha1)",
 		.cra_driver_name = "hmac-sha1-ux500",
-		.cra_flags       = CRYPTO_ALG_TYPE_AHASH | CRYPTO_ALG_ASYNC,
+		.cra_flags       = CRYPTO_ALG_TYPE_AHASH | CRYPTO_ALG_ASYNC |
+				   CRYPTO_ALG_NEED_FALLBACK,
 		.cra_blocksize   = SHA1_BLOCK_SIZE,
 		.cra_ctxsize	 = sizeof(struct hash_ctx),
 		.cra_type	 = &crypto_ahash_type,
+		.cra_init	 = hash_cra_init,
+		.cra_exit	 = hash_cra_exit,
 		.cra_module      = THIS_MODULE,
 	}
 };
@@ -1678,10 +2075,13 @@ static struct ahash_alg hmac_sha256_alg = {
 	.halg.base = {
 		.cra_name        = "hmac(sha256)",
 		.cra_driver_name = "hmac-sha256-ux500",
-		.cra_flags       = CRYPTO_ALG_TYPE_AHASH | CRYPTO_ALG_ASYNC,
+		.cra_flags       = CRYPTO_ALG_TYPE_AHASH | CRYPTO_ALG_ASYNC |
+				   CRYPTO_ALG_NEED_FALLBACK,
 		.cra_blocksize   = SHA256_BLOCK_SIZE,
 		.cra_ctxsize	 = sizeof(struct hash_ctx),
 		.cra_type	 = &crypto_ahash_type,
+		.cra_init	 = hash_cra_init,
+		.cra_exit	 = hash_cra_exit,
 		.cra_module      = THIS_MODULE,
 	}
 };
@@ -1733,6 +2133,174 @@ static void ahash_algs_unregister_all(struct hash_device_data *device_data)
 		crypto_unregister_ahash(ux500_ahash_algs[i]);
 }
 
+#define HASH_CALIBRATE_MIN	16
+#define HASH_CALIBRATE_MAX	4096
+#define HASH_CALIBRATE_LOOPS	64
+
+static const struct {
+	struct ahash_alg *alg;
+	enum hash_algo algorithm;
+} hash_calibrate_algs[] = {
+	{ &ahash_sha1_alg, HASH_ALGO_SHA1 },
+	{ &ahash_sha256_alg, HASH_ALGO_SHA256 },
+};
+
+struct hash_calibrate_result {
+	struct completion completion;
+	int err;
+};
+
+static void hash_calibrate_done(struct crypto_async_request *req, int err)
+{
+	struct hash_calibrate_result *res = req->data;
+
+	if (err == -EINPROGRESS)
+		return;
+
+	res->err = err;
+	complete(&res->completion);
+}
+
+/**
+ * hash_calibrate_time - Time HASH_CALIBRATE_LOOPS digests of one size.
+ * @tfm:	The transform to time.
+ * @buf:	Message buffer.
+ * @len:	Message size.
+ *
+ * Returns the elapsed time in ns, or a negative error code.
+ */
+static s64 hash_calibrate_time(struct crypto_ahash *tfm, u8 *buf,
+		unsigned int len)
+{
+	struct ahash_request *req;
+	struct hash_calibrate_result res;
+	struct scatterlist sg;
+	u8 digest[SHA256_DIGEST_SIZE];
+	ktime_t start;
+	s64 elapsed;
+	int ret = 0;
+	int i;
+
+	req = ahash_request_alloc(tfm, GFP_KERNEL);
+	if (!req)
+		return -ENOMEM;
+
+	init_completion(&res.completion);
+	ahash_request_set_callback(req, CRYPTO_TFM_REQ_MAY_BACKLOG,
+			hash_calibrate_done, &res);
+	sg_init_one(&sg, buf, len);
+	ahash_request_set_crypt(req, &sg, digest, len);
+
+	start = ktime_get();
+	for (i = 0; i < HASH_CALIBRATE_LOOPS && !ret; i++) {
+		ret = crypto_ahash_digest(req);
+		if (ret == -EINPROGRESS || ret == -EBUSY) {
+			wait_for_completion(&res.completion);
+			INIT_COMPLETION(res.completion);
+			ret = res.err;
+		}
+	}
+	elapsed = ktime_to_ns(ktime_sub(ktime_get(), start));
+
+	ahash_request_free(req);
+
+	return ret ? ret : elapsed;
+}
+
+/**
+ * hash_calibrate_algo - Find where the engine starts to beat software.
+ * @alg:	Engine implementation of the hash.
+ * @algorithm:	The hash algorithm.
+ * @buf:	Scratch buffer of HASH_CALIBRATE_MAX bytes.
+ *
+ * The threshold is the smallest measured size from which the engine is
+ * faster for all larger measured sizes.
+ */
+static void hash_calibrate_algo(struct ahash_alg *alg,
+		enum hash_algo algorithm, u8 *buf)
+{
+	struct crypto_alg *base = &alg->halg.base;
+	struct crypto_ahash *hw;
+	struct crypto_ahash *sw;
+	int threshold = HASH_CALIBRATE_MAX * 2;
+	unsigned int len;
+	s64 hw_ns, sw_ns;
+
+	hw = crypto_alloc_ahash(base->cra_driver_name, 0, 0);
+	if (IS_ERR(hw))
+		return;
+
+	sw = crypto_alloc_ahash(base->cra_name, 0,
+			CRYPTO_ALG_ASYNC | CRYPTO_ALG_NEED_FALLBACK);
+	if (IS_ERR(sw))
+		goto out_hw;
+
+	/* Time the engine itself, not the dispatcher */
+	hash_sw_threshold[algorithm] = 0;
+
+	for (len = HASH_CALIBRATE_MIN; len <= HASH_CALIBRATE_MAX; len *= 2) {
+		hw_ns = hash_calibrate_time(hw, buf, len);
+		sw_ns = hash_calibrate_time(sw, buf, len);
+		if (hw_ns < 0 || sw_ns < 0) {
+			threshold = 0;
+			break;
+		}
+
+		pr_debug(DEV_DBG_NAME " [%s] %s %u bytes: hw %lld ns, "
+				"sw %lld ns", __func__, base->cra_name, len,
+				hw_ns, sw_ns);
+
+		if (hw_ns > sw_ns)
+			threshold = HASH_CALIBRATE_MAX * 2;
+		else if (threshold > HASH_CALIBRATE_MAX)
+			threshold = len;
+	}
+
+	if (threshold == HASH_CALIBRATE_MIN)
+		threshold = 0;
+
+	hash_sw_threshold[algorithm] = threshold;
+	pr_info("ux500_hash: %s: software below %d bytes\n", base->cra_name,
+			threshold);
+
+	crypto_free_ahash(sw);
+out_hw:
+	crypto_free_ahash(hw);
+}
+
+static void hash_calibrate_all(struct work_struct *work)
+{
+	u8 *buf;
+	int i;
+
+	buf = kzalloc(HASH_CALIBRATE_MAX, GFP_KERNEL);
+	if (!buf)
+		return;
+
+	for (i = 0; i < ARRAY_SIZE(hash_calibrate_algs); i++)
+		hash_calibrate_algo(hash_calibrate_algs[i].alg,
+				hash_calibrate_algs[i].algorithm, buf);
+
+	kfree(buf);
+}
+
+static DECLARE_WORK(hash_calibrate_work, hash_calibrate_all);
+
+static DEVICE_INT_ATTR(sw_threshold_sha1, 0644,
+		       hash_sw_threshold[HASH_ALGO_SHA1]);
+static DEVICE_INT_ATTR(sw_threshold_sha256, 0644,
+		       hash_sw_threshold[HASH_ALGO_SHA256]);
+
+static struct attribute *hash_attrs[] = {
+	&dev_attr_sw_threshold_sha1.attr.attr,
+	&dev_attr_sw_threshold_sha256.attr.attr,
+	NULL
+};
+
+static const struct attribute_group hash_attr_group = {
+	.attrs = hash_attrs,
+};
+
 /**
  * ux500_hash_probe - Function that probes the hash hardware.
  * @pdev: The platform device.
@@ -1825,9 +2393,15 @@ static int ux500_hash_probe(struct platform_device *pdev)
 		goto out_power;
 	}
 
+	if (sysfs_create_group(&dev->kobj, &hash_attr_group))
+		dev_warn(dev, "[%s] sysfs_create_group() failed!", __func__);
+
 	if (hash_disable_power(device_data, false))
 		dev_err(dev, "[%s]: hash_disable_power() failed!", __func__);
 
+	if (hash_calibrate)
+		schedule_work(&hash_calibrate_work);
+
 	dev_info(dev, "[%s] successfully probed\n", __func__);
 	return 0;
 
@@ -1869,22 +2443,24 @@ static int ux500_hash_remove(struct platform_device *pdev)
 		return -ENOMEM;
 	}
 
+	cancel_work_sync(&hash_calibrate_work);
+
 	/* Try to decrease the number of available devices. */
 	if (down_trylock(&driver_data.device_allocation))
 		return -EBUSY;
 
 	/* Check that the device is free */
-	spin_lock(&device_data->ctx_lock);
+	spin_lock_bh(&device_data->ctx_lock);
 	/* current_ctx allocates a device, NULL = unallocated */
 	if (device_data->current_ctx) {
 		/* The device is busy */
-		spin_unlock(&device_data->ctx_lock);
+		spin_unlock_bh(&device_data->ctx_lock);
 		/* Return the device to the pool. */
 		up(&driver_data.device_allocation);
 		return -EBUSY;
 	}
 
-	spin_unlock(&device_data->ctx_lock);
+	spin_unlock_bh(&device_data->ctx_lock);
 
 	/* Remove the device from the list */
 	if (klist_node_attached(&device_data->list_node))
@@ -1894,6 +2470,8 @@ static int ux500_hash_remove(struct platform_device *pdev)
 	if (list_empty(&driver_data.device_list.k_list))
 		ahash_algs_unregister_all(device_data);
 
+	sysfs_remove_group(&dev->kobj, &hash_attr_group);
+
 	if (hash_disable_power(device_data, false))
 		dev_err(dev, "[%s]: hash_disable_power() failed",
 			__func__);
@@ -1929,7 +2507,7 @@ static void ux500_hash_shutdown(struct platform_device *pdev)
 	}
 
 	/* Check that the device is free */
-	spin_lock(&device_data->ctx_lock);
+	spin_lock_bh(&device_data->ctx_lock);
 	/* current_ctx allocates a device, NULL = unallocated */
 	if (!device_data->current_ctx) {
 		if (down_trylock(&driver_data.device_allocation))
@@ -1942,7 +2520,7 @@ static void ux500_hash_shutdown(struct platform_device *pdev)
 		 */
 		device_data->current_ctx++;
 	}
-	spin_unlock(&device_data->ctx_lock);
+	spin_unlock_bh(&device_data->ctx_lock);
 
 	/* Remove the device from the list */
 	if (klist_node_attached(&device_data->list_node))
@@ -1981,10 +2559,10 @@ static int ux500_hash_suspend(struct platform_device *pdev, pm_message_t state)
 		return -ENOMEM;
 	}
 
-	spin_lock(&device_data->ctx_lock);
+	spin_lock_bh(&device_data->ctx_lock);
 	if (!device_data->current_ctx)
 		device_data->current_ctx++;
-	spin_unlock(&device_data->ctx_lock);
+	spin_unlock_bh(&device_data->ctx_lock);
 
 	if (device_data->current_ctx == ++temp_ctx) {
 		if (down_interruptible(&driver_data.device_allocation))
@@ -2018,14 +2596,16 @@ static int ux500_hash_resume(struct platform_device *pdev)
 		return -ENOMEM;
 	}
 
-	spin_lock(&device_data->ctx_lock);
+	spin_lock_bh(&device_data->ctx_lock);
 	if (device_data->current_ctx == ++temp_ctx)
 		device_data->current_ctx = NULL;
-	spin_unlock(&device_data->ctx_lock);
+	spin_unlock_bh(&device_data->ctx_lock);
 
-	if (!device_data->current_ctx)
+	if (!device_data->current_ctx) {
 		up(&driver_data.device_allocation);
-	else
+		/* Restart requests queued while suspended */
+		tasklet_schedule(&driver_data.queue_tasklet);
+	} else
 		ret = hash_enable_power(device_data, true);
 
 	if (ret)
@@ -2047,6 +2627,103 @@ static struct platform_driver hash_driver = {
 	}
 };
 
+#ifdef CONFIG_CRYPTO_DEV_UX500_STANDIN
+static void hash_standin_remove(void)
+{
+	struct device *dev = &hash_standin_pdev->dev;
+	int i;
+
+	ahash_algs_unregister_all(&hash_standin[0].device_data);
+	sysfs_remove_group(&dev->kobj, &hash_attr_group);
+	device_remove_file(dev, &dev_attr_standin_stats);
+
+	for (i = 0; i < hash_standin_devices; i++) {
+		cancel_work_sync(&hash_standin[i].work);
+		klist_remove(&hash_standin[i].device_data.list_node);
+	}
+
+	kfree(hash_standin);
+	platform_device_unregister(hash_standin_pdev);
+}
+
+/**
+ * hash_standin_probe - Set up the stand-in engines in place of the devices.
+ *
+ * Calibration is skipped, it would find the stand-in slower than software
+ * at every size and leave it nothing to do.
+ */
+static int hash_standin_probe(void)
+{
+	struct hash_device_data *device_data;
+	struct device *dev;
+	int ret;
+	int i;
+
+	if (hash_standin_devices < 1)
+		return -EINVAL;
+
+	hash_standin_pdev = platform_device_register_simple("hash1-standin",
+			-1, NULL, 0);
+	if (IS_ERR(hash_standin_pdev))
+		return PTR_ERR(hash_standin_pdev);
+	dev = &hash_standin_pdev->dev;
+
+	hash_standin = kcalloc(hash_standin_devices, sizeof(*hash_standin),
+			GFP_KERNEL);
+	if (!hash_standin) {
+		ret = -ENOMEM;
+		goto out_pdev;
+	}
+
+	/* The stand-in only models the DMA driven engine */
+	hash_mode = HASH_MODE_DMA;
+
+	for (i = 0; i < hash_standin_devices; i++) {
+		device_data = &hash_standin[i].device_data;
+		device_data->dev = dev;
+		spin_lock_init(&device_data->ctx_lock);
+		spin_lock_init(&device_data->power_state_lock);
+		INIT_WORK(&hash_standin[i].work, hash_standin_work);
+
+		klist_add_tail(&device_data->list_node,
+				&driver_data.device_list);
+		up(&driver_data.device_allocation);
+	}
+
+	ret = ahash_algs_register_all(&hash_standin[0].device_data);
+	if (ret) {
+		dev_err(dev, "[%s] ahash_algs_register_all() "
+				"failed!", __func__);
+		goto out_list;
+	}
+
+	if (sysfs_create_group(&dev->kobj, &hash_attr_group) ||
+			device_create_file(dev, &dev_attr_standin_stats))
+		dev_warn(dev, "[%s] sysfs attributes failed!", __func__);
+
+	dev_info(dev, "%d stand-in engines\n", hash_standin_devices);
+
+	return 0;
+
+out_list:
+	for (i = 0; i < hash_standin_devices; i++)
+		klist_remove(&hash_standin[i].device_data.list_node);
+	kfree(hash_standin);
+out_pdev:
+	platform_device_unregister(hash_standin_pdev);
+	return ret;
+}
+#else
+static inline int hash_standin_probe(void)
+{
+	return -ENODEV;
+}
+
+static inline void hash_standin_remove(void)
+{
+}
+#endif
+
 /**
  * ux500_hash_mod_init - The kernel module init function.
  */
@@ -2055,6 +2732,12 @@ static int __init ux500_hash_mod_init(void)
 	klist_init(&driver_data.device_list, NULL, NULL);
 	/* Initialize the semaphore to 0 devices (locked state) */
 	sema_init(&driver_data.device_allocation, 0);
+	crypto_init_queue(&driver_data.queue, HASH_QUEUE_LENGTH);
+	spin_lock_init(&driver_data.queue_lock);
+	tasklet_init(&driver_data.queue_tasklet, hash_queue_tasklet, 0);
+
+	if (IS_ENABLED(CONFIG_CRYPTO_DEV_UX500_STANDIN))
+		return hash_standin_probe();
 
 	return platform_driver_register(&hash_driver);
 }
@@ -2064,7 +2747,11 @@ static int __init ux500_hash_mod_init(void)
  */
 static void __exit ux500_hash_mod_fini(void)
 {
-	platform_driver_unregister(&hash_driver);
+	if (IS_ENABLED(CONFIG_CRYPTO_DEV_UX500_STANDIN))
+		hash_standin_remove();
+	else
+		platform_driver_unregister(&hash_driver);
+	tasklet_kill(&driver_data.queue_tasklet);
 	return;
 }
 
@@ -13,6 +13,7 @@
 #include <linux/freezer.h>
 #include <linux/init.h>
 #include <linux/kthread.h>
+#include <linux/ktime.h>
 #include <linux/module.h>
 #include <linux/moduleparam.h>
 #include <linux/random.h>
@@ -253,6 +254,9 @@ static int dmatest_func(void *data)
 	unsigned int		error_count;
 	unsigned int		failed_tests = 0;
 	unsigned int		total_tests = 0;
+	unsigned int		submitted = 0;
+	u64			submit_ns = 0;
+	ktime_t			start;
 	dma_cookie_t		cookie;
 	enum dma_status		status;
 	enum dma_ctrl_flags 	flags;
@@ -361,6 +365,8 @@ static int dmatest_func(void *data)
 						     DMA_BIDIRECTIONAL);
 		}
 
+		/* Time descriptor preparation and submission */
+		start = ktime_get();
 
 		if (thread->type == DMA_MEMCPY)
 			tx = dev->device_prep_dma_memcpy(chan,
@@ -403,6 +409,7 @@ static int dmatest_func(void *data)
 		tx->callback = dmatest_callback;
 		tx->callback_param = &done;
 		cookie = tx->tx_submit(tx);
+		submit_ns += ktime_to_ns(ktime_sub(ktime_get(), start));
 
 		if (dma_submit_error(cookie)) {
 			pr_warning("%s: #%u: submit error %d with src_off=0x%x "
@@ -413,6 +420,7 @@ static int dmatest_func(void *data)
 			failed_tests++;
 			continue;
 		}
+		submitted++;
 		dma_async_issue_pending(chan);
 
 		wait_event_freezable_timeout(done_wait, done.done,
@@ -497,6 +505,11 @@ err_srcbuf:
 err_srcs:
 	pr_notice("%s: terminating after %u tests, %u failures (status %d)\n",
 			thread_name, total_tests, failed_tests, ret);
+	if (submitted) {
+		do_div(submit_ns, submitted);
+		pr_notice("%s: average prep+submit time %llu ns\n",
+				thread_name, (unsigned long long)submit_ns);
+	}
 
 	/* terminate all transfers on specified channels */
 	chan->device->device_control(chan, DMA_TERMINATE_ALL, 0);
@@ -44,6 +44,9 @@
 #define D40_LCLA_LINK_PER_EVENT_GRP 128
 #define D40_LCLA_END D40_LCLA_LINK_PER_EVENT_GRP
 
+/* Max number of recycled descriptors kept per channel */
+#define D40_DESC_CACHE_MAX 32
+
 /* Attempts before giving up to trying to get pages that are aligned */
 #define MAX_LCLA_ALLOC_ATTEMPTS 256
 
@@ -120,17 +123,27 @@ static u32 d40_backup_regs_chan[] = {
  * struct d40_lli_pool - Structure for keeping LLIs in memory
  *
  * @base: Pointer to memory area when the pre_alloc_lli's are not large
- * enough, IE bigger than the most common case, 1 dst and 1 src. NULL if
+ * enough, IE bigger than the most common case, 1 dst and 1 src. Kept
+ * while the descriptor is recycled, so it may be set even when
  * pre_alloc_lli is used.
+ * @alloc_size: The number of LLI bytes that fit at base.
  * @dma_addr: DMA address, if mapped
- * @size: The size in bytes of the memory at base or the size of pre_alloc_lli.
+ * @dma_base: The virtual address mapped at dma_addr.
+ * @dma_len: The number of bytes mapped at dma_addr.
+ * @size: The size in bytes of the LLIs in use, at base or in pre_alloc_lli.
  * @pre_alloc_lli: Pre allocated area for the most common case of transfers,
  * one buffer to one buffer.
+ *
+ * The mapping of a physical channel's LLIs is kept across recycling too,
+ * and only redone when the LLIs move or outgrow it.
  */
 struct d40_lli_pool {
 	void	*base;
+	int	 alloc_size;
 	int	 size;
 	dma_addr_t	dma_addr;
+	void	*dma_base;
+	int	 dma_len;
 	/* Space for dst and src, plus an extra for padding */
 	u8	 pre_alloc_lli[3 * sizeof(struct d40_phy_lli)];
 };
@@ -231,6 +244,11 @@ struct d40_base;
  * @tasklet: Tasklet that gets scheduled from interrupt context to complete a
  * transfer and call client callback.
  * @client: Cliented owned descriptor list.
+ * @free: Recycled descriptors, with their LLI memory still allocated.
+ * @free_count: Number of descriptors in @free.
+ * @desc_used: Number of descriptors currently handed out by d40_desc_get().
+ * @desc_peak: Highest @desc_used seen since the channel was allocated,
+ * which is how many descriptors @free keeps around.
  * @pending_queue: Submitted jobs, to be issued by issue_pending()
  * @active: Active descriptor.
  * @queue: Queued jobs.
@@ -258,6 +276,10 @@ struct d40_chan {
 	struct dma_chan			 chan;
 	struct tasklet_struct		 tasklet;
 	struct list_head		 client;
+	struct list_head		 free;
+	int				 free_count;
+	int				 desc_used;
+	int				 desc_peak;
 	struct list_head		 pending_queue;
 	struct list_head		 active;
 	struct list_head		 queue;
@@ -409,12 +431,24 @@ static void __iomem *chan_base(struct d40_chan *chan)
 #define chan_err(d40c, format, arg...)		\
 	d40_err(chan2dev(d40c), format, ## arg)
 
+static void d40_pool_lli_unmap(struct d40_chan *d40c, struct d40_desc *d40d)
+{
+	if (d40d->lli_pool.dma_addr)
+		dma_unmap_single(d40c->base->dev, d40d->lli_pool.dma_addr,
+				 d40d->lli_pool.dma_len, DMA_TO_DEVICE);
+
+	d40d->lli_pool.dma_addr = 0;
+	d40d->lli_pool.dma_base = NULL;
+	d40d->lli_pool.dma_len = 0;
+}
+
 static int d40_pool_lli_alloc(struct d40_chan *d40c, struct d40_desc *d40d,
 			      int lli_len)
 {
 	bool is_log = chan_is_logical(d40c);
 	u32 align;
 	void *base;
+	int map_len;
 
 	if (is_log)
 		align = sizeof(struct d40_log_lli);
@@ -424,38 +458,56 @@ static int d40_pool_lli_alloc(struct d40_chan *d40c, struct d40_desc *d40d,
 	if (lli_len == 1) {
 		base = d40d->lli_pool.pre_alloc_lli;
 		d40d->lli_pool.size = sizeof(d40d->lli_pool.pre_alloc_lli);
-		d40d->lli_pool.base = NULL;
+		map_len = d40d->lli_pool.size;
 	} else {
 		d40d->lli_pool.size = lli_len * 2 * align;
 
-		base = kmalloc(d40d->lli_pool.size + align, GFP_NOWAIT);
-		d40d->lli_pool.base = base;
+		/* Reuse the memory of a recycled descriptor if it fits */
+		if (d40d->lli_pool.size > d40d->lli_pool.alloc_size) {
+			if (d40d->lli_pool.dma_base != d40d->lli_pool.pre_alloc_lli)
+				d40_pool_lli_unmap(d40c, d40d);
+			kfree(d40d->lli_pool.base);
+			d40d->lli_pool.alloc_size = 0;
 
-		if (d40d->lli_pool.base == NULL)
-			return -ENOMEM;
+			d40d->lli_pool.base = kmalloc(d40d->lli_pool.size +
+						      align, GFP_NOWAIT);
+			if (d40d->lli_pool.base == NULL)
+				return -ENOMEM;
+
+			d40d->lli_pool.alloc_size = d40d->lli_pool.size;
+		}
+
+		base = d40d->lli_pool.base;
+		map_len = d40d->lli_pool.alloc_size;
 	}
 
 	if (is_log) {
 		d40d->lli_log.src = PTR_ALIGN(base, align);
 		d40d->lli_log.dst = d40d->lli_log.src + lli_len;
-
-		d40d->lli_pool.dma_addr = 0;
 	} else {
 		d40d->lli_phy.src = PTR_ALIGN(base, align);
 		d40d->lli_phy.dst = d40d->lli_phy.src + lli_len;
 
+		if (d40d->lli_pool.dma_addr &&
+		    d40d->lli_pool.dma_base == d40d->lli_phy.src &&
+		    d40d->lli_pool.dma_len >= d40d->lli_pool.size)
+			return 0;
+
+		d40_pool_lli_unmap(d40c, d40d);
+
 		d40d->lli_pool.dma_addr = dma_map_single(d40c->base->dev,
 							 d40d->lli_phy.src,
-							 d40d->lli_pool.size,
+							 map_len,
 							 DMA_TO_DEVICE);
 
 		if (dma_mapping_error(d40c->base->dev,
 				      d40d->lli_pool.dma_addr)) {
-			kfree(d40d->lli_pool.base);
-			d40d->lli_pool.base = NULL;
 			d40d->lli_pool.dma_addr = 0;
 			return -ENOMEM;
 		}
+
+		d40d->lli_pool.dma_base = d40d->lli_phy.src;
+		d40d->lli_pool.dma_len = map_len;
 	}
 
 	return 0;
@@ -463,12 +515,11 @@ static int d40_pool_lli_alloc(struct d40_chan *d40c, struct d40_desc *d40d,
 
 static void d40_pool_lli_free(struct d40_chan *d40c, struct d40_desc *d40d)
 {
-	if (d40d->lli_pool.dma_addr)
-		dma_unmap_single(d40c->base->dev, d40d->lli_pool.dma_addr,
-				 d40d->lli_pool.size, DMA_TO_DEVICE);
+	d40_pool_lli_unmap(d40c, d40d);
 
 	kfree(d40d->lli_pool.base);
 	d40d->lli_pool.base = NULL;
+	d40d->lli_pool.alloc_size = 0;
 	d40d->lli_pool.size = 0;
 	d40d->lli_log.src = NULL;
 	d40d->lli_log.dst = NULL;
@@ -476,34 +527,48 @@ static void d40_pool_lli_free(struct d40_chan *d40c, struct d40_desc *d40d)
 	d40d->lli_phy.dst = NULL;
 }
 
-static int d40_lcla_alloc_one(struct d40_chan *d40c,
-			      struct d40_desc *d40d)
+/**
+ * d40_lcla_alloc - Allocate LCLA entries for a descriptor.
+ * @d40c: The logical channel.
+ * @d40d: The descriptor the entries are for.
+ * @lcla: Filled in with the allocated entries, in allocation order.
+ * @count: Number of entries wanted.
+ *
+ * All entries are taken under one hold of the pool lock. Returns the number
+ * of entries actually allocated, which is less than @count if the physical
+ * channel ran out.
+ */
+static int d40_lcla_alloc(struct d40_chan *d40c, struct d40_desc *d40d,
+			  s8 *lcla, int count)
 {
+	struct d40_desc **map;
 	unsigned long flags;
+	int got = 0;
 	int i;
-	int ret = -EINVAL;
-	int p;
+
+	if (count <= 0)
+		return 0;
 
 	spin_lock_irqsave(&d40c->base->lcla_pool.lock, flags);
 
-	p = d40c->phy_chan->num * D40_LCLA_LINK_PER_EVENT_GRP;
+	map = &d40c->base->lcla_pool.alloc_map[d40c->phy_chan->num *
+					       D40_LCLA_LINK_PER_EVENT_GRP];
 
 	/*
 	 * Allocate both src and dst at the same time, therefore the half
 	 * start on 1 since 0 can't be used since zero is used as end marker.
 	 */
-	for (i = 1 ; i < D40_LCLA_LINK_PER_EVENT_GRP / 2; i++) {
-		if (!d40c->base->lcla_pool.alloc_map[p + i]) {
-			d40c->base->lcla_pool.alloc_map[p + i] = d40d;
-			d40d->lcla_alloc++;
-			ret = i;
-			break;
+	for (i = 1 ; i < D40_LCLA_LINK_PER_EVENT_GRP / 2 && got < count; i++) {
+		if (!map[i]) {
+			map[i] = d40d;
+			lcla[got++] = i;
 		}
 	}
+	d40d->lcla_alloc += got;
 
 	spin_unlock_irqrestore(&d40c->base->lcla_pool.lock, flags);
 
-	return ret;
+	return got;
 }
 
 static int d40_lcla_free_all(struct d40_chan *d40c,
@@ -542,11 +607,25 @@ static void d40_desc_remove(struct d40_desc *d40d)
 	list_del(&d40d->node);
 }
 
+/* Clear a descriptor for reuse, keeping its LLI memory */
+static void d40_desc_reset(struct d40_desc *d40d)
+{
+	struct d40_lli_pool lli_pool = d40d->lli_pool;
+
+	memset(d40d, 0, sizeof(*d40d));
+	d40d->lli_pool = lli_pool;
+}
+
 static struct d40_desc *d40_desc_get(struct d40_chan *d40c)
 {
 	struct d40_desc *desc = NULL;
 
-	if (!list_empty(&d40c->client)) {
+	if (!list_empty(&d40c->free)) {
+		desc = list_first_entry(&d40c->free, struct d40_desc, node);
+		d40_desc_remove(desc);
+		d40c->free_count--;
+		d40_desc_reset(desc);
+	} else if (!list_empty(&d40c->client)) {
 		struct d40_desc *d;
 		struct d40_desc *_d;
 
@@ -554,7 +633,9 @@ static struct d40_desc *d40_desc_get(struct d40_chan *d40c)
 			if (async_tx_test_ack(&d->txd)) {
 				d40_desc_remove(d);
 				desc = d;
-				memset(desc, 0, sizeof(*desc));
+				d40_desc_reset(desc);
+				/* Still counted in desc_used */
+				d40c->desc_used--;
 				break;
 			}
 		}
@@ -563,8 +644,11 @@ static struct d40_desc *d40_desc_get(struct d40_chan *d40c)
 	if (!desc)
 		desc = kmem_cache_zalloc(d40c->base->desc_slab, GFP_NOWAIT);
 
-	if (desc)
+	if (desc) {
 		INIT_LIST_HEAD(&desc->node);
+		if (++d40c->desc_used > d40c->desc_peak)
+			d40c->desc_peak = d40c->desc_used;
+	}
 
 	return desc;
 }
@@ -577,6 +661,41 @@ static void d40_desc_free(struct d40_chan *d40c, struct d40_desc *d40d)
 	kmem_cache_free(d40c->base->desc_slab, d40d);
 }
 
+/*
+ * Give back a descriptor from d40_desc_get(). It is kept for reuse as long
+ * as the channel has fewer spare descriptors than it has had in flight at
+ * most, so a steady stream of transfers stops allocating altogether.
+ */
+static void d40_desc_put(struct d40_chan *d40c, struct d40_desc *d40d)
+{
+	d40c->desc_used--;
+
+	if (d40c->free_count >= min(d40c->desc_peak, D40_DESC_CACHE_MAX)) {
+		d40_desc_free(d40c, d40d);
+		return;
+	}
+
+	d40_lcla_free_all(d40c, d40d);
+	list_add(&d40d->node, &d40c->free);
+	d40c->free_count++;
+}
+
+/* Release all recycled descriptors, for when the channel is given back */
+static void d40_desc_cache_drain(struct d40_chan *d40c)
+{
+	struct d40_desc *d40d;
+	struct d40_desc *_d;
+
+	list_for_each_entry_safe(d40d, _d, &d40c->free, node) {
+		d40_desc_remove(d40d);
+		d40_desc_free(d40c, d40d);
+	}
+
+	d40c->free_count = 0;
+	d40c->desc_used = 0;
+	d40c->desc_peak = 0;
+}
+
 static void d40_desc_submit(struct d40_chan *d40c, struct d40_desc *desc)
 {
 	list_add_tail(&desc->node, &d40c->active);
@@ -610,6 +729,9 @@ static void d40_log_lli_to_lcxa(struct d40_chan *chan, struct d40_desc *desc)
 	int first_lcla = 0;
 	bool use_esram_lcla = chan->base->plat_data->use_esram_lcla;
 	bool linkback;
+	s8 lcla_ids[D40_LCLA_LINK_PER_EVENT_GRP / 2];
+	int lcla_count;
+	int lcla_next = 0;
 
 	/*
 	 * We may have partially running cyclic transfers, in case we did't get
@@ -618,11 +740,17 @@ static void d40_log_lli_to_lcxa(struct d40_chan *chan, struct d40_desc *desc)
 	linkback = cyclic && lli_current == 0;
 
 	/*
-	 * For linkback, we need one LCLA even with only one link, because we
-	 * can't link back to the one in LCPA space
+	 * Every link except the one in LCPA needs an LCLA entry. For
+	 * linkback, the first link goes in both, since we can't link back to
+	 * the one in LCPA space. Allocate them all up front.
 	 */
-	if (linkback || (lli_len - lli_current > 1)) {
-		curr_lcla = d40_lcla_alloc_one(chan, desc);
+	lcla_count = linkback ? lli_len : lli_len - lli_current - 1;
+	lcla_count = d40_lcla_alloc(chan, desc, lcla_ids,
+				    min_t(int, lcla_count,
+					  ARRAY_SIZE(lcla_ids)));
+
+	if (lcla_count) {
+		curr_lcla = lcla_ids[lcla_next++];
 		first_lcla = curr_lcla;
 	}
 
@@ -657,7 +785,8 @@ static void d40_log_lli_to_lcxa(struct d40_chan *chan, struct d40_desc *desc)
 		int next_lcla;
 
 		if (lli_current + 1 < lli_len)
-			next_lcla = d40_lcla_alloc_one(chan, desc);
+			next_lcla = lcla_next < lcla_count ?
+				lcla_ids[lcla_next++] : -EINVAL;
 		else
 			next_lcla = linkback ? first_lcla : -EINVAL;
 
@@ -946,26 +1075,26 @@ static void d40_term_all(struct d40_chan *d40c)
 	/* Release active descriptors */
 	while ((d40d = d40_first_active_get(d40c))) {
 		d40_desc_remove(d40d);
-		d40_desc_free(d40c, d40d);
+		d40_desc_put(d40c, d40d);
 	}
 
 	/* Release queued descriptors waiting for transfer */
 	while ((d40d = d40_first_queued(d40c))) {
 		d40_desc_remove(d40d);
-		d40_desc_free(d40c, d40d);
+		d40_desc_put(d40c, d40d);
 	}
 
 	/* Release pending descriptors */
 	while ((d40d = d40_first_pending(d40c))) {
 		d40_desc_remove(d40d);
-		d40_desc_free(d40c, d40d);
+		d40_desc_put(d40c, d40d);
 	}
 
 	/* Release client owned descriptors */
 	if (!list_empty(&d40c->client))
 		list_for_each_entry_safe(d40d, _d, &d40c->client, node) {
 			d40_desc_remove(d40d);
-			d40_desc_free(d40c, d40d);
+			d40_desc_put(d40c, d40d);
 		}
 
 	/* Release descriptors in prepare queue */
@@ -973,7 +1102,7 @@ static void d40_term_all(struct d40_chan *d40c)
 		list_for_each_entry_safe(d40d, _d,
 					 &d40c->prepare_queue, node) {
 			d40_desc_remove(d40d);
-			d40_desc_free(d40c, d40d);
+			d40_desc_put(d40c, d40d);
 		}
 
 	d40c->pending_tx = 0;
@@ -1376,7 +1505,7 @@ static void dma_tasklet(unsigned long data)
 	if (!d40d->cyclic) {
 		if (async_tx_test_ack(&d40d->txd)) {
 			d40_desc_remove(d40d);
-			d40_desc_free(d40c, d40d);
+			d40_desc_put(d40c, d40d);
 		} else {
 			if (!d40d->is_in_client_list) {
 				d40_desc_remove(d40d);
@@ -1792,6 +1921,7 @@ static int d40_free_dma(struct d40_chan *d40c)
 
 	/* Terminate all queued and active transfers */
 	d40_term_all(d40c);
+	d40_desc_cache_drain(d40c);
 
 	if (phy == NULL) {
 		chan_err(d40c, "phy == null\n");
@@ -2032,7 +2162,7 @@ d40_prep_desc(struct d40_chan *chan, struct scatterlist *sg,
 	return desc;
 
 err:
-	d40_desc_free(chan, desc);
+	d40_desc_put(chan, desc);
 	return NULL;
 }
 
@@ -2115,7 +2245,7 @@ d40_prep_sg(struct dma_chan *dchan, struct scatterlist *sg_src,
 
 err:
 	if (desc)
-		d40_desc_free(chan, desc);
+		d40_desc_put(chan, desc);
 	spin_unlock_irqrestore(&chan->lock, flags);
 	return NULL;
 }
@@ -2665,6 +2795,7 @@ static void __init d40_chan_init(struct d40_base *base, struct dma_device *dma,
 		INIT_LIST_HEAD(&d40c->queue);
 		INIT_LIST_HEAD(&d40c->pending_queue);
 		INIT_LIST_HEAD(&d40c->client);
+		INIT_LIST_HEAD(&d40c->free);
 		INIT_LIST_HEAD(&d40c->prepare_queue);
 
 		tasklet_init(&d40c->tasklet, dma_tasklet,
@@ -13,6 +13,7 @@
 #include <linux/fs.h>
 #include <linux/mm.h>
 #include <linux/list.h>
+#include <linux/ioctl.h>
 
 #define GATOR_PERF_SUPPORT		LINUX_VERSION_CODE >= KERNEL_VERSION(3, 0, 0)
 #define GATOR_PERF_PMU_SUPPORT  GATOR_PERF_SUPPORT && defined(CONFIG_PERF_EVENTS) && defined(CONFIG_HW_PERF_EVENTS)
@@ -51,6 +52,27 @@ int gatorfs_create_ro_ulong(struct super_block *sb, struct dentry *root,
 
 void gator_op_create_files(struct super_block *sb, struct dentry *root);
 
+/*
+ * Zero-copy export of the capture buffers. After mmap()ing buffer_mmap_size
+ * bytes of the buffer file, GATOR_IOC_COMMIT_WAIT blocks like read() and
+ * describes where the next committed frame lives in the mapping; length2 is
+ * non-zero when the frame wraps around the end of its ring. The frame is
+ * handed back with GATOR_IOC_COMMIT_RELEASE or the next GATOR_IOC_COMMIT_WAIT.
+ * A return value of 0 means profiling has stopped.
+ */
+struct gator_buffer_segment {
+	__u32 cpu;
+	__u32 buftype;
+	__u32 offset1;
+	__u32 length1;
+	__u32 offset2;
+	__u32 length2;
+};
+
+#define GATOR_IOC_MAGIC			'G'
+#define GATOR_IOC_COMMIT_WAIT		_IOR(GATOR_IOC_MAGIC, 1, struct gator_buffer_segment)
+#define GATOR_IOC_COMMIT_RELEASE	_IO(GATOR_IOC_MAGIC, 2)
+
 /******************************************************************************
  * Tracepoints
  ******************************************************************************/
@@ -134,6 +134,13 @@ static DEFINE_PER_CPU(int[NUM_GATOR_BUFS], gator_buffer_write);
 static DEFINE_PER_CPU(int[NUM_GATOR_BUFS], gator_buffer_commit);
 static DEFINE_PER_CPU(int[NUM_GATOR_BUFS], buffer_space_available);
 static DEFINE_PER_CPU(char *[NUM_GATOR_BUFS], gator_buffer);
+static DEFINE_PER_CPU(unsigned long[NUM_GATOR_BUFS], gator_buffer_mmap_offset);
+
+// zero-copy interface, see userspace_buffer_mmap() and userspace_buffer_ioctl()
+static unsigned long gator_buffer_mmap_size;
+static int gator_mmap_pending_cpu = -1;
+static int gator_mmap_pending_buftype = -1;
+static int gator_mmap_pending_commit;
 
 /******************************************************************************
  * Application Includes
@@ -730,6 +737,9 @@ static int gator_op_setup(void)
 	gator_buffer_size[WFI_BUF] = WFI_BUFFER_SIZE;
 	gator_buffer_mask[WFI_BUF] = WFI_BUFFER_SIZE - 1;
 
+	gator_buffer_mmap_size = 0;
+	gator_mmap_pending_cpu = gator_mmap_pending_buftype = -1;
+
 	// Initialize percpu per buffer variables
 	for (i = 0; i < NUM_GATOR_BUFS; i++) {
 		// Verify buffers are a power of 2
@@ -750,11 +760,16 @@ static int gator_op_setup(void)
 				continue;
 			}
 
-			per_cpu(gator_buffer, cpu)[i] = vmalloc(gator_buffer_size[i]);
+			// vmalloc_user so the buffer can be exported via mmap
+			per_cpu(gator_buffer, cpu)[i] = vmalloc_user(gator_buffer_size[i]);
 			if (!per_cpu(gator_buffer, cpu)[i]) {
 				err = -ENOMEM;
 				goto setup_error;
 			}
+
+			// userspace_buffer_mmap() maps each buffer at this offset
+			per_cpu(gator_buffer_mmap_offset, cpu)[i] = gator_buffer_mmap_size;
+			gator_buffer_mmap_size += PAGE_ALIGN(gator_buffer_size[i]);
 		}
 	}
 
@@ -902,13 +917,46 @@ static int userspace_buffer_release(struct inode *inode, struct file *file)
 	return 0;
 }
 
+/*
+ * Determine the two halves of the committed data and post-populate the frame
+ * length. Must be called with gator_buffer_mutex held.
+ */
+static int gator_buffer_segment(int cpu, int buftype, int *read, int *commit, int *length1, int *length2)
+{
+	int length, byte, type_length;
+
+	*read = per_cpu(gator_buffer_read, cpu)[buftype];
+	*commit = per_cpu(gator_buffer_commit, cpu)[buftype];
+
+	/* May happen if the buffer is freed during pending reads. */
+	if (!per_cpu(gator_buffer, cpu)[buftype])
+		return -EFAULT;
+
+	/* determine the size of two halves */
+	*length1 = *commit - *read;
+	*length2 = 0;
+	if (*length1 < 0) {
+		*length1 = gator_buffer_size[buftype] - *read;
+		*length2 = *commit;
+	}
+
+	// post-populate the length, which does not include the response type length nor the length itself, i.e. only the length of the payload
+	type_length = gator_response_type ? 1 : 0;
+	length = *length1 + *length2 - type_length - sizeof(int);
+	for (byte = 0; byte < sizeof(int); byte++) {
+		per_cpu(gator_buffer, cpu)[buftype][(*read + type_length + byte) & gator_buffer_mask[buftype]] = (length >> byte * 8) & 0xFF;
+	}
+
+	return 0;
+}
+
 static ssize_t userspace_buffer_read(struct file *file, char __user *buf,
 				 size_t count, loff_t *offset)
 {
 	int retval = -EINVAL;
-	int commit = 0, length, length1, length2, read, byte, type_length;
+	int commit, length1, length2, read;
 	char *buffer1;
-	char *buffer2 = NULL;
+	char *buffer2;
 	int cpu, buftype;
 
 	/* do not handle partial reads */
@@ -923,7 +971,6 @@ static ssize_t userspace_buffer_read(struct file *file, char __user *buf,
 	if (signal_pending(current))
 		return -EINTR;
 
-	length2 = 0;
 	retval = -EFAULT;
 
 	mutex_lock(&gator_buffer_mutex);
@@ -933,30 +980,13 @@ static ssize_t userspace_buffer_read(struct file *file, char __user *buf,
 		goto out;
 	}
 
-	read = per_cpu(gator_buffer_read, cpu)[buftype];
-	commit = per_cpu(gator_buffer_commit, cpu)[buftype];
-
-	/* May happen if the buffer is freed during pending reads. */
-	if (!per_cpu(gator_buffer, cpu)[buftype]) {
-		retval = -EFAULT;
+	retval = gator_buffer_segment(cpu, buftype, &read, &commit, &length1, &length2);
+	if (retval)
 		goto out;
-	}
 
-	/* determine the size of two halves */
-	length1 = commit - read;
+	retval = -EFAULT;
 	buffer1 = &(per_cpu(gator_buffer, cpu)[buftype][read]);
 	buffer2 = &(per_cpu(gator_buffer, cpu)[buftype][0]);
-	if (length1 < 0) {
-		length1 = gator_buffer_size[buftype] - read;
-		length2 = commit;
-	}
-
-	// post-populate the length, which does not include the response type length nor the length itself, i.e. only the length of the payload
-	type_length = gator_response_type ? 1 : 0;
-	length = length1 + length2 - type_length - sizeof(int);
-	for (byte = 0; byte < sizeof(int); byte++) {
-		per_cpu(gator_buffer, cpu)[buftype][(read + type_length + byte) & gator_buffer_mask[buftype]] = (length >> byte * 8) & 0xFF;
-	}
 
 	/* start, middle or end */
 	if (length1 > 0) {
@@ -983,10 +1013,138 @@ out:
 	return retval;
 }
 
+/*
+ * Zero-copy interface: the daemon maps all per-cpu buffers read-only with
+ * mmap() on the buffer file (buffer_mmap_size bytes at offset 0) and then
+ * uses GATOR_IOC_COMMIT_WAIT to obtain the location of the next committed
+ * frame instead of read()ing a copy of it. The frame stays owned by the
+ * daemon until GATOR_IOC_COMMIT_RELEASE or the next GATOR_IOC_COMMIT_WAIT,
+ * so the producer cannot overwrite it while it is being shipped.
+ */
+static void gator_mmap_release_pending(void)
+{
+	int cpu = gator_mmap_pending_cpu;
+	int buftype = gator_mmap_pending_buftype;
+
+	if (cpu == -1 || buftype == -1)
+		return;
+
+	if (per_cpu(gator_buffer, cpu)[buftype])
+		per_cpu(gator_buffer_read, cpu)[buftype] = gator_mmap_pending_commit;
+	gator_mmap_pending_cpu = gator_mmap_pending_buftype = -1;
+
+	/* kick just in case we've lost an SMP event */
+	wake_up(&gator_buffer_wait);
+}
+
+static long userspace_buffer_commit_wait(struct gator_buffer_segment __user *arg)
+{
+	struct gator_buffer_segment seg;
+	int read, commit, length1, length2;
+	int cpu, buftype;
+	long retval;
+
+	mutex_lock(&gator_buffer_mutex);
+	gator_mmap_release_pending();
+	mutex_unlock(&gator_buffer_mutex);
+
+	buftype = cpu = -1;
+	wait_event_interruptible(gator_buffer_wait, buffer_commit_ready(&cpu, &buftype) || !gator_started);
+
+	if (signal_pending(current))
+		return -EINTR;
+
+	memset(&seg, 0, sizeof(seg));
+
+	mutex_lock(&gator_buffer_mutex);
+
+	if (buftype == -1 || cpu == -1) {
+		// profiling stopped, nothing more to ship
+		retval = 0;
+		goto copy;
+	}
+
+	retval = gator_buffer_segment(cpu, buftype, &read, &commit, &length1, &length2);
+	if (retval)
+		goto out;
+
+	seg.cpu = cpu;
+	seg.buftype = buftype;
+	seg.offset1 = per_cpu(gator_buffer_mmap_offset, cpu)[buftype] + read;
+	seg.length1 = length1;
+	seg.offset2 = per_cpu(gator_buffer_mmap_offset, cpu)[buftype];
+	seg.length2 = length2;
+
+	gator_mmap_pending_cpu = cpu;
+	gator_mmap_pending_buftype = buftype;
+	gator_mmap_pending_commit = commit;
+	retval = length1 + length2;
+
+copy:
+	if (copy_to_user(arg, &seg, sizeof(seg)))
+		retval = -EFAULT;
+out:
+	mutex_unlock(&gator_buffer_mutex);
+	return retval;
+}
+
+static long userspace_buffer_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+{
+	switch (cmd) {
+	case GATOR_IOC_COMMIT_WAIT:
+		return userspace_buffer_commit_wait((struct gator_buffer_segment __user *)arg);
+	case GATOR_IOC_COMMIT_RELEASE:
+		mutex_lock(&gator_buffer_mutex);
+		gator_mmap_release_pending();
+		mutex_unlock(&gator_buffer_mutex);
+		return 0;
+	default:
+		return -ENOTTY;
+	}
+}
+
+static int userspace_buffer_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	unsigned long size = vma->vm_end - vma->vm_start;
+	unsigned long addr, offset;
+	int cpu, i, err = 0;
+	char *buffer;
+
+	/* the buffers are only ever written by the kernel */
+	if (vma->vm_pgoff || size > PAGE_ALIGN(gator_buffer_mmap_size) || (vma->vm_flags & VM_WRITE))
+		return -EINVAL;
+	vma->vm_flags &= ~VM_MAYWRITE;
+
+	mutex_lock(&gator_buffer_mutex);
+
+	for_each_present_cpu(cpu) {
+		for (i = 0; i < NUM_GATOR_BUFS; i++) {
+			buffer = per_cpu(gator_buffer, cpu)[i];
+			if (!buffer)
+				continue;
+
+			/* at the offset COMMIT_WAIT reports, whatever the loop order */
+			addr = vma->vm_start + per_cpu(gator_buffer_mmap_offset, cpu)[i];
+			for (offset = 0; offset < gator_buffer_size[i] && addr < vma->vm_end; offset += PAGE_SIZE) {
+				err = vm_insert_page(vma, addr, vmalloc_to_page(buffer + offset));
+				if (err)
+					goto out;
+				addr += PAGE_SIZE;
+			}
+		}
+	}
+
+out:
+	mutex_unlock(&gator_buffer_mutex);
+	return err;
+}
+
 const struct file_operations gator_event_buffer_fops = {
 	.open		= userspace_buffer_open,
 	.release	= userspace_buffer_release,
 	.read		= userspace_buffer_read,
+	.unlocked_ioctl	= userspace_buffer_ioctl,
+	.mmap		= userspace_buffer_mmap,
 };
 
 static ssize_t depth_read(struct file *file, char __user *buf, size_t count, loff_t *offset)
@@ -1038,6 +1196,7 @@ void gator_op_create_files(struct super_block *sb, struct dentry *root)
 	gatorfs_create_file(sb, root, "backtrace_depth", &depth_fops);
 	gatorfs_create_ulong(sb, root, "cpu_cores", &gator_cpu_cores);
 	gatorfs_create_ulong(sb, root, "buffer_size", &userspace_buffer_size);
+	gatorfs_create_ro_ulong(sb, root, "buffer_mmap_size", &gator_buffer_mmap_size);
 	gatorfs_create_ulong(sb, root, "tick", &gator_timer_count);
 	gatorfs_create_ulong(sb, root, "response_type", &gator_response_type);
 	gatorfs_create_ro_ulong(sb, root, "version", &gator_protocol_version);
@@ -59,6 +59,24 @@
 #define MBOX_ENABLE_IRQ  0x0
 #define MBOX_LATCH 1
 
+/* Messages read from the FIFO before handing them to the client */
+#define MBOX_RX_BATCH 8
+
+#if defined(CONFIG_DEBUG_FS)
+#define mbox_stat_add(mbox, stat, n) ((mbox)->stat += (n))
+#else
+#define mbox_stat_add(mbox, stat, n) do { } while (0)
+#endif
+
+/*
+ * Messages delivered per interrupt. The interrupt stays raised while there
+ * are messages left in the FIFO, so the rest are handled on the next run
+ * of the interrupt thread.
+ */
+static int rx_budget = 64;
+module_param(rx_budget, int, 0644);
+MODULE_PARM_DESC(rx_budget, "Max messages received per interrupt");
+
 struct mbox_device_info {
 	struct mbox *mbox;
 	struct workqueue_struct *mbox_modem_rel_wq;
@@ -121,9 +139,44 @@ static struct mbox *get_mbox_with_id(u8 id)
 	return (struct mbox *) list_entry(pos, struct mbox, list);
 }
 
-int mbox_send(struct mbox *mbox, u32 mbox_msg, bool block)
+/*
+ * Write buffered messages into the peer FIFO while it has space.
+ * Called with the mailbox lock held.
+ */
+static void mbox_flush_tx(struct mbox *mbox)
+{
+	int nbr_free;
+
+	/* Check by reading FREE for LOCAL since that indicates OCCUP for PEER */
+	nbr_free = (readl(mbox->virtbase_local + MBOX_FIFO_STATUS) >> 4) & 0x7;
+	dev_dbg(&(mbox->pdev->dev),
+		"Status indicates %d empty spaces in the FIFO!\n", nbr_free);
+
+	while ((nbr_free > 0) && (mbox->read_index != mbox->write_index)) {
+		if (atomic_read(&mb->mod_reset)) {
+			dev_err(&mbox->pdev->dev, "modem in reset state\n");
+			return;
+		}
+		/* Write the message and latch it into the FIFO */
+		writel(mbox->buffer[mbox->read_index],
+		       (mbox->virtbase_peer + MBOX_FIFO_DATA));
+		writel(MBOX_LATCH, (mbox->virtbase_peer + MBOX_FIFO_ADD));
+		dev_dbg(&(mbox->pdev->dev),
+			"Wrote message 0x%X to addr 0x%X\n",
+			mbox->buffer[mbox->read_index],
+			(u32) (mbox->virtbase_peer + MBOX_FIFO_DATA));
+
+		nbr_free--;
+		mbox->read_index = (mbox->read_index + 1) % MBOX_BUF_SIZE;
+		mbox_stat_add(mbox, stat_tx_words, 1);
+	}
+}
+
+int mbox_send_batch(struct mbox *mbox, const u32 *mbox_msgs, int count,
+		    bool block)
 {
 	int res = 0;
+	int sent = 0;
 	unsigned long flag;
 
 	if (atomic_read(&mb->mod_reset)) {
@@ -132,9 +185,9 @@ int mbox_send(struct mbox *mbox, u32 mbox_msg, bool block)
 		return -EINVAL;
 	}
 	dev_dbg(&(mbox->pdev->dev),
-		"About to buffer 0x%X to mailbox 0x%X."
+		"About to buffer %d messages to mailbox 0x%X."
 		" ri = %d, wi = %d\n",
-		mbox_msg, (u32)mbox, mbox->read_index,
+		count, (u32)mbox, mbox->read_index,
 		mbox->write_index);
 
 	/* Request for modem */
@@ -142,44 +195,78 @@ int mbox_send(struct mbox *mbox, u32 mbox_msg, bool block)
 		mbox_modem_req();
 
 	spin_lock_irqsave(&mbox->lock, flag);
-	/* Check if write buffer is full */
-	while (((mbox->write_index + 1) % MBOX_BUF_SIZE) == mbox->read_index) {
+	while (sent < count) {
+		/* Check if write buffer is full */
+		if (((mbox->write_index + 1) % MBOX_BUF_SIZE) !=
+				mbox->read_index) {
+			mbox->buffer[mbox->write_index] = mbox_msgs[sent++];
+			mbox->write_index =
+				(mbox->write_index + 1) % MBOX_BUF_SIZE;
+			continue;
+		}
+
+		mbox_stat_add(mbox, stat_fifo_full, 1);
 		if (!block) {
 			dev_dbg(&(mbox->pdev->dev),
 			"Buffer full in non-blocking call! "
-			"Returning -ENOMEM!\n");
-			res = -ENOMEM;
+			"Returning after %d messages!\n", sent);
+			break;
+		}
+		if (atomic_read(&mb->mod_reset)) {
+			res = -EINVAL;
 			goto exit;
 		}
+		/* Make room by sending the buffered messages */
+		mbox_flush_tx(mbox);
+		writel(MBOX_ENABLE_IRQ,
+		       mbox->virtbase_peer + MBOX_FIFO_THRES_FREE);
+		if (((mbox->write_index + 1) % MBOX_BUF_SIZE) !=
+				mbox->read_index)
+			continue;
+
+		mbox->client_blocked = 1;
 		spin_unlock_irqrestore(&mbox->lock, flag);
 		dev_dbg(&(mbox->pdev->dev),
 			"Buffer full in blocking call! Sleeping...\n");
-		mbox->client_blocked = 1;
 		wait_for_completion(&mbox->buffer_available);
 		dev_dbg(&(mbox->pdev->dev),
 			"Blocking send was woken up! Trying again...\n");
 		spin_lock_irqsave(&mbox->lock, flag);
 	}
 
-	mbox->buffer[mbox->write_index] = mbox_msg;
-	mbox->write_index = (mbox->write_index + 1) % MBOX_BUF_SIZE;
-
-	/*
-	 * Indicate that we want an IRQ as soon as there is a slot
-	 * in the FIFO
-	 */
 	if (atomic_read(&mb->mod_reset)) {
 		dev_err(&mbox->pdev->dev,
 				"modem is in reset state, cannot proceed\n");
 		res  = -EINVAL;
 		goto exit;
 	}
-	writel(MBOX_ENABLE_IRQ, mbox->virtbase_peer + MBOX_FIFO_THRES_FREE);
+
+	/*
+	 * Send what fits in the FIFO right away, and indicate that we want
+	 * an IRQ as soon as there is a slot in the FIFO for the rest
+	 */
+	mbox_flush_tx(mbox);
+	if (mbox->read_index != mbox->write_index)
+		writel(MBOX_ENABLE_IRQ,
+		       mbox->virtbase_peer + MBOX_FIFO_THRES_FREE);
+	res = sent;
 
 exit:
 	spin_unlock_irqrestore(&mbox->lock, flag);
 	return res;
 }
+EXPORT_SYMBOL(mbox_send_batch);
+
+int mbox_send(struct mbox *mbox, u32 mbox_msg, bool block)
+{
+	int res;
+
+	res = mbox_send_batch(mbox, &mbox_msg, 1, block);
+	if (res == 0)
+		return -ENOMEM;
+
+	return res < 0 ? res : 0;
+}
 EXPORT_SYMBOL(mbox_send);
 
 #if defined(CONFIG_DEBUG_FS)
@@ -250,6 +337,8 @@ static int mbox_show(struct seq_file *s, void *data)
 {
 	struct list_head *pos;
 	u8 mbox_index = 0;
+	ktime_t now;
+	s64 ms;
 
 	list_for_each(pos, &mboxs) {
 		struct mbox *m =
@@ -261,17 +350,17 @@ static int mbox_show(struct seq_file *s, void *data)
 			continue;
 		}
 
-		spin_lock(&m->lock);
+		spin_lock_irq(&m->lock);
 		if ((m->virtbase_peer == NULL) || (m->virtbase_local == NULL)) {
 			seq_printf(s, "MAILBOX %d not setup or corrupt\n",
 				   mbox_index);
-			spin_unlock(&m->lock);
+			spin_unlock_irq(&m->lock);
 			continue;
 		}
 
 		if (atomic_read(&mb->mod_reset)) {
 			dev_err(&m->pdev->dev, "modem crashed, returning\n");
-			spin_unlock(&m->lock);
+			spin_unlock_irq(&m->lock);
 			return 0;
 		}
 		seq_printf(s,
@@ -297,8 +386,7 @@ static int mbox_show(struct seq_file *s, void *data)
 		"===========================\n"
 		"write_index: %d\n"
 		"read_index : %d\n"
-		"===========================\n"
-		"\n",
+		"===========================\n",
 		mbox_index,
 		readl(m->virtbase_peer + MBOX_FIFO_DATA),
 		readl(m->virtbase_peer + MBOX_FIFO_DATA),
@@ -325,8 +413,36 @@ static int mbox_show(struct seq_file *s, void *data)
 		(readl(m->virtbase_local + MBOX_FIFO_STATUS) >> 0) & 0x7,
 		(readl(m->virtbase_local + MBOX_FIFO_STATUS) >> 3) & 0x1,
 		m->write_index, m->read_index);
+
+		/* Rates are since the previous read of this file */
+		now = ktime_get();
+		ms = ktime_to_ms(ktime_sub(now, m->stat_snap_time));
+		if (ms <= 0)
+			ms = 1;
+		seq_printf(s,
+		" STATISTICS\n"
+		"---------------------------\n"
+		"TX words:             %u (%lld/s)\n"
+		"RX words:             %u (%lld/s)\n"
+		"IRQs:                 %u (%lld/s)\n"
+		"Buffer full events:   %u\n"
+		"RX budget exhausted:  %u\n"
+		"===========================\n"
+		"\n",
+		m->stat_tx_words,
+		(s64)(m->stat_tx_words - m->stat_snap[0]) * 1000 / ms,
+		m->stat_rx_words,
+		(s64)(m->stat_rx_words - m->stat_snap[1]) * 1000 / ms,
+		m->stat_irqs,
+		(s64)(m->stat_irqs - m->stat_snap[2]) * 1000 / ms,
+		m->stat_fifo_full, m->stat_rx_budget);
+		m->stat_snap[0] = m->stat_tx_words;
+		m->stat_snap[1] = m->stat_rx_words;
+		m->stat_snap[2] = m->stat_irqs;
+		m->stat_snap_time = now;
+
 		mbox_index++;
-		spin_unlock(&m->lock);
+		spin_unlock_irq(&m->lock);
 	}
 
 	return 0;
@@ -346,18 +462,35 @@ static const struct file_operations mbox_operations = {
 };
 #endif
 
+static void mbox_deliver(struct mbox *mbox, const u32 *msgs, int count)
+{
+	int i;
+
+	dev_dbg(&(mbox->pdev->dev), "Calling callback for %d messages!\n",
+		count);
+	if (mbox->batch_cb != NULL) {
+		mbox->batch_cb(msgs, count, mbox->client_data);
+		return;
+	}
+	for (i = 0; i < count; i++)
+		mbox->cb(msgs[i], mbox->client_data);
+}
+
 static irqreturn_t mbox_irq(int irq, void *arg)
 {
-	u32 mbox_value;
+	u32 msgs[MBOX_RX_BATCH];
+	unsigned long flag;
+	int budget = max(rx_budget, 1);
 	int nbr_occup;
-	int nbr_free;
+	int count;
 	struct mbox *mbox = (struct mbox *) arg;
 
 	if (atomic_read(&mb->mod_reset)) {
 		dev_err(&mbox->pdev->dev, "modem in reset state\n");
 		return IRQ_HANDLED;
 	}
-	spin_lock(&mbox->lock);
+	spin_lock_irqsave(&mbox->lock, flag);
+	mbox_stat_add(mbox, stat_irqs, 1);
 
 	dev_dbg(&(mbox->pdev->dev),
 		"mbox IRQ [%d] received. ri = %d, wi = %d\n",
@@ -368,40 +501,11 @@ static irqreturn_t mbox_irq(int irq, void *arg)
 	 * them in the FIFO.
 	 */
 	if (mbox->read_index != mbox->write_index) {
-		/*
-		 * Check by reading FREE for LOCAL since that indicates
-		 * OCCUP for PEER
-		 */
-		nbr_free = (readl(mbox->virtbase_local + MBOX_FIFO_STATUS)
-			    >> 4) & 0x7;
-		dev_dbg(&(mbox->pdev->dev),
-			"Status indicates %d empty spaces in the FIFO!\n",
-			nbr_free);
-
-		while ((nbr_free > 0) &&
-		       (mbox->read_index != mbox->write_index)) {
-			if (atomic_read(&mb->mod_reset)) {
-				dev_err(&mbox->pdev->dev,
-						"modem in reset state\n");
-				goto exit;
-			}
-			/* Write the message and latch it into the FIFO */
-			writel(mbox->buffer[mbox->read_index],
-			       (mbox->virtbase_peer + MBOX_FIFO_DATA));
-			writel(MBOX_LATCH,
-			       (mbox->virtbase_peer + MBOX_FIFO_ADD));
-			dev_dbg(&(mbox->pdev->dev),
-				"Wrote message 0x%X to addr 0x%X\n",
-				mbox->buffer[mbox->read_index],
-				(u32) (mbox->virtbase_peer + MBOX_FIFO_DATA));
-
-			nbr_free--;
-			mbox->read_index =
-				(mbox->read_index + 1) % MBOX_BUF_SIZE;
-		}
+		mbox_flush_tx(mbox);
 
 		if (atomic_read(&mb->mod_reset)) {
 			dev_err(&mbox->pdev->dev, "modem in reset state\n");
+			spin_unlock_irqrestore(&mbox->lock, flag);
 			goto exit;
 		}
 		/*
@@ -435,6 +539,7 @@ static irqreturn_t mbox_irq(int irq, void *arg)
 			mbox->client_blocked = 0;
 		}
 	}
+	spin_unlock_irqrestore(&mbox->lock, flag);
 
 	/* Start timer and on timer expiry call modem_rel */
 	hrtimer_start(&ape_timer, ktime_set(0, 10*NSEC_PER_MSEC),
@@ -449,31 +554,45 @@ static irqreturn_t mbox_irq(int irq, void *arg)
 	if (nbr_occup == 0)
 		goto exit;
 
-redo:
-	if (mbox->cb == NULL) {
+	if ((mbox->cb == NULL) && (mbox->batch_cb == NULL)) {
 		dev_dbg(&(mbox->pdev->dev), "No receive callback registered, "
 			"leaving %d incoming messages in fifo!\n", nbr_occup);
 		goto exit;
 	}
 	atomic_set(&mb->ape_state, 1);
 
-	if (atomic_read(&mb->mod_reset)) {
-		dev_err(&mbox->pdev->dev, "modem in reset state\n");
-		goto exit;
-	}
-	/* Read and acknowledge the message */
-	mbox_value = readl(mbox->virtbase_local + MBOX_FIFO_DATA);
-	writel(MBOX_LATCH, (mbox->virtbase_local + MBOX_FIFO_REMOVE));
-
-	/* Notify consumer of new mailbox message */
-	dev_dbg(&(mbox->pdev->dev), "Calling callback for message 0x%X!\n",
-		mbox_value);
-	mbox->cb(mbox_value, mbox->client_data);
+	/*
+	 * Only this thread reads the local FIFO, so the messages are read
+	 * and handed to the client without holding the mailbox lock, which
+	 * also lets the client send from its callback.
+	 */
+	while ((nbr_occup > 0) && (budget > 0)) {
+		count = 0;
+		while ((nbr_occup > 0) && (count < MBOX_RX_BATCH) &&
+		       (count < budget)) {
+			if (atomic_read(&mb->mod_reset)) {
+				dev_err(&mbox->pdev->dev,
+						"modem in reset state\n");
+				goto exit;
+			}
+			/* Read and acknowledge the message */
+			msgs[count++] = readl(mbox->virtbase_local +
+					      MBOX_FIFO_DATA);
+			writel(MBOX_LATCH,
+			       (mbox->virtbase_local + MBOX_FIFO_REMOVE));
 
-	nbr_occup = readl(mbox->virtbase_local + MBOX_FIFO_STATUS) & 0x7;
+			if (--nbr_occup == 0)
+				nbr_occup = readl(mbox->virtbase_local +
+						  MBOX_FIFO_STATUS) & 0x7;
+		}
+		budget -= count;
+		mbox_stat_add(mbox, stat_rx_words, count);
 
+		/* Notify consumer of new mailbox messages */
+		mbox_deliver(mbox, msgs, count);
+	}
 	if (nbr_occup > 0)
-		goto redo;
+		mbox_stat_add(mbox, stat_rx_budget, 1);
 
 	/* Start a timer and timer expiry will be the criteria for sleep */
 	hrtimer_start(&modem_timer, ktime_set(0, 100*MSEC_PER_SEC),
@@ -481,7 +600,6 @@ redo:
 exit:
 	dev_dbg(&(mbox->pdev->dev), "Exit mbox IRQ. ri = %d, wi = %d\n",
 		mbox->read_index, mbox->write_index);
-	spin_unlock(&mbox->lock);
 
 	return IRQ_HANDLED;
 }
@@ -506,6 +624,7 @@ static void mbox_shutdown(struct mbox *mbox)
 	iounmap(mbox->virtbase_local);
 	iounmap(mbox->virtbase_peer);
 	mbox->cb = NULL;
+	mbox->batch_cb = NULL;
 	mbox->client_data = NULL;
 	mbox->allocated = false;
 }
@@ -545,7 +664,8 @@ void mbox_state_reset(void)
 
 
 /* Setup is executed once for each mbox pair */
-struct mbox *mbox_setup(u8 mbox_id, mbox_recv_cb_t *mbox_cb, void *priv)
+static struct mbox *__mbox_setup(u8 mbox_id, mbox_recv_cb_t *mbox_cb,
+				 mbox_recv_batch_cb_t *batch_cb, void *priv)
 {
 	struct resource *resource;
 	int res;
@@ -582,6 +702,7 @@ struct mbox *mbox_setup(u8 mbox_id, mbox_recv_cb_t *mbox_cb, void *priv)
 
 	mbox->client_data = priv;
 	mbox->cb = mbox_cb;
+	mbox->batch_cb = batch_cb;
 
 	/* Get addr for peer mailbox and ioremap it */
 	resource = platform_get_resource_byname(mbox->pdev,
@@ -631,6 +752,15 @@ struct mbox *mbox_setup(u8 mbox_id, mbox_recv_cb_t *mbox_cb, void *priv)
 
 	init_completion(&mbox->buffer_available);
 	mbox->client_blocked = 0;
+#if defined(CONFIG_DEBUG_FS)
+	mbox->stat_tx_words = 0;
+	mbox->stat_rx_words = 0;
+	mbox->stat_irqs = 0;
+	mbox->stat_fifo_full = 0;
+	mbox->stat_rx_budget = 0;
+	memset(mbox->stat_snap, 0, sizeof(mbox->stat_snap));
+	mbox->stat_snap_time = ktime_get();
+#endif
 
 	/* Get IRQ for mailbox and allocate it */
 	mbox->irq = platform_get_irq_byname(mbox->pdev, "mbox_irq");
@@ -667,7 +797,7 @@ struct mbox *mbox_setup(u8 mbox_id, mbox_recv_cb_t *mbox_cb, void *priv)
 	 * a callback set. If not, do not raise IRQ, but keep message
 	 * in FIFO for manual retrieval
 	 */
-	if (mbox_cb != NULL)
+	if ((mbox_cb != NULL) || (batch_cb != NULL))
 		writel(MBOX_ENABLE_IRQ,
 		       mbox->virtbase_local + MBOX_FIFO_THRES_OCCUP);
 	else
@@ -696,11 +826,24 @@ free_map:
 free_mbox:
 	mbox->client_data = NULL;
 	mbox->cb = NULL;
+	mbox->batch_cb = NULL;
 exit:
 	return mbox;
 }
+
+struct mbox *mbox_setup(u8 mbox_id, mbox_recv_cb_t *mbox_cb, void *priv)
+{
+	return __mbox_setup(mbox_id, mbox_cb, NULL, priv);
+}
 EXPORT_SYMBOL(mbox_setup);
 
+struct mbox *mbox_setup_batch(u8 mbox_id, mbox_recv_batch_cb_t *mbox_cb,
+			      void *priv)
+{
+	return __mbox_setup(mbox_id, NULL, mbox_cb, priv);
+}
+EXPORT_SYMBOL(mbox_setup_batch);
+
 static irqreturn_t mbox_prcmu_mod_req_ack_handler(int irq, void *data)
 {
 	complete(&mb->mod_req_ack_work);
@@ -31,6 +31,7 @@
 #include <linux/dma-mapping.h>
 #include <linux/amba/mmci.h>
 #include <linux/pm_runtime.h>
+#include <linux/ktime.h>
 
 #include <asm/div64.h>
 #include <asm/io.h>
@@ -285,6 +286,195 @@ static void mmci_init_sg(struct mmci_host *host, struct mmc_data *data)
  * no custom DMA interfaces are supported.
  */
 #ifdef CONFIG_DMA_ENGINE
+static int mmci_xfer_bucket(unsigned int size)
+{
+	int bucket = ilog2(size) - MMCI_XFER_MIN_SHIFT;
+
+	if (bucket < 0 || bucket >= MMCI_XFER_BUCKETS)
+		return -1;
+
+	return bucket;
+}
+
+/*
+ * Decide between PIO and DMA for a transfer. With dma_threshold_auto set,
+ * one in MMCI_XFER_PROBE transfers of each measured size goes the other
+ * way, so that both modes keep being timed and the threshold can move.
+ * This runs from pre_req without host->lock and may run again for the
+ * same request from mmci_request, so it only reads the count of started
+ * transfers, which mmci_xfer_start() advances under the lock.
+ */
+static bool mmci_use_pio(struct mmci_host *host, unsigned int size)
+{
+	bool pio = size <= host->dma_threshold;
+	int bucket;
+
+	if (size <= host->variant->fifosize)
+		return true;
+
+	if (!host->dma_threshold_auto)
+		return pio;
+
+	bucket = mmci_xfer_bucket(size);
+	if (bucket >= 0 &&
+	    (ACCESS_ONCE(host->xfer_stats[bucket].count) + 1) %
+	    MMCI_XFER_PROBE == 0)
+		pio = !pio;
+
+	return pio;
+}
+
+/* Called with host->lock held, once per data transfer */
+static inline void mmci_xfer_start(struct mmci_host *host,
+				   struct mmc_data *data, bool dma)
+{
+	int bucket = mmci_xfer_bucket(data->blksz * data->blocks);
+
+	if (bucket >= 0)
+		host->xfer_stats[bucket].count++;
+
+	host->xfer_start = ktime_get();
+	host->xfer_dma = dma;
+}
+
+/*
+ * Account a completed transfer and, in auto mode, move the threshold to
+ * the smallest bucket from which DMA was measured to be at least as fast
+ * as PIO for every larger bucket. Called with host->lock held.
+ */
+static void mmci_xfer_account(struct mmci_host *host, struct mmc_data *data)
+{
+	unsigned int size = data->blksz * data->blocks;
+	struct mmci_xfer_stats *st;
+	int bucket = mmci_xfer_bucket(size);
+	int mode = host->xfer_dma;
+	u32 avg;
+	int i;
+
+	if (bucket < 0)
+		return;
+
+	st = &host->xfer_stats[bucket];
+	avg = div_u64((u64)ktime_to_ns(ktime_sub(ktime_get(), host->xfer_start))
+		      << 10, size);
+
+	if (st->samples[mode]++)
+		avg = st->avg[mode] - (st->avg[mode] >> 3) + (avg >> 3);
+	st->avg[mode] = avg;
+
+	if (!host->dma_threshold_auto)
+		return;
+
+	for (i = MMCI_XFER_BUCKETS - 1; i >= 0; i--) {
+		st = &host->xfer_stats[i];
+		if (st->samples[0] && st->samples[1] && st->avg[1] > st->avg[0])
+			break;
+	}
+
+	if (++i == 0)
+		host->dma_threshold = host->variant->fifosize;
+	else
+		host->dma_threshold = (1 << (i + MMCI_XFER_MIN_SHIFT)) - 1;
+}
+
+static ssize_t mmci_show_dma_threshold(struct device *dev,
+				       struct device_attribute *attr,
+				       char *buf)
+{
+	struct mmc_host *mmc = dev_get_drvdata(dev);
+	struct mmci_host *host = mmc_priv(mmc);
+
+	return sprintf(buf, "%u\n", host->dma_threshold);
+}
+
+/* Writing a threshold turns off automatic adjustment */
+static ssize_t mmci_store_dma_threshold(struct device *dev,
+					struct device_attribute *attr,
+					const char *buf, size_t count)
+{
+	struct mmc_host *mmc = dev_get_drvdata(dev);
+	struct mmci_host *host = mmc_priv(mmc);
+	unsigned long val;
+	unsigned long flags;
+
+	if (strict_strtoul(buf, 0, &val))
+		return -EINVAL;
+
+	spin_lock_irqsave(&host->lock, flags);
+	host->dma_threshold_auto = false;
+	host->dma_threshold = val;
+	spin_unlock_irqrestore(&host->lock, flags);
+
+	return count;
+}
+
+static ssize_t mmci_show_dma_threshold_auto(struct device *dev,
+					    struct device_attribute *attr,
+					    char *buf)
+{
+	struct mmc_host *mmc = dev_get_drvdata(dev);
+	struct mmci_host *host = mmc_priv(mmc);
+
+	return sprintf(buf, "%d\n", host->dma_threshold_auto);
+}
+
+static ssize_t mmci_store_dma_threshold_auto(struct device *dev,
+					     struct device_attribute *attr,
+					     const char *buf, size_t count)
+{
+	struct mmc_host *mmc = dev_get_drvdata(dev);
+	struct mmci_host *host = mmc_priv(mmc);
+	unsigned long val;
+
+	if (strict_strtoul(buf, 0, &val))
+		return -EINVAL;
+
+	host->dma_threshold_auto = !!val;
+
+	return count;
+}
+
+static ssize_t mmci_show_xfer_stats(struct device *dev,
+				    struct device_attribute *attr,
+				    char *buf)
+{
+	struct mmc_host *mmc = dev_get_drvdata(dev);
+	struct mmci_host *host = mmc_priv(mmc);
+	struct mmci_xfer_stats *st;
+	ssize_t len;
+	int i;
+
+	len = sprintf(buf, "%-8s %10s %10s %10s %10s\n", "size",
+		      "pio ns/KiB", "pio n", "dma ns/KiB", "dma n");
+
+	for (i = 0; i < MMCI_XFER_BUCKETS; i++) {
+		st = &host->xfer_stats[i];
+		len += sprintf(buf + len, "%-8u %10u %10u %10u %10u\n",
+			       1 << (i + MMCI_XFER_MIN_SHIFT),
+			       st->avg[0], st->samples[0],
+			       st->avg[1], st->samples[1]);
+	}
+
+	return len;
+}
+
+static DEVICE_ATTR(dma_threshold, S_IRUGO | S_IWUSR,
+		   mmci_show_dma_threshold, mmci_store_dma_threshold);
+static DEVICE_ATTR(dma_threshold_auto, S_IRUGO | S_IWUSR,
+		   mmci_show_dma_threshold_auto, mmci_store_dma_threshold_auto);
+static DEVICE_ATTR(xfer_stats, S_IRUGO, mmci_show_xfer_stats, NULL);
+
+static struct attribute *mmci_dma_attrs[] = {
+	&dev_attr_dma_threshold.attr,
+	&dev_attr_dma_threshold_auto.attr,
+	&dev_attr_xfer_stats.attr,
+	NULL,
+};
+
+static const struct attribute_group mmci_dma_attr_group = {
+	.attrs = mmci_dma_attrs,
+};
+
 static void __devinit mmci_dma_setup(struct mmci_host *host)
 {
 	struct mmci_platform_data *plat = host->plat;
@@ -358,6 +548,22 @@ static void __devinit mmci_dma_setup(struct mmci_host *host)
 		if (max_seg_size < host->mmc->max_seg_size)
 			host->mmc->max_seg_size = max_seg_size;
 	}
+
+	if (!host->dma_rx_channel && !host->dma_tx_channel)
+		return;
+
+	/* Start out like the fixed threshold did, then measure */
+	host->dma_threshold = host->variant->fifosize;
+	host->dma_threshold_auto = true;
+
+	if (sysfs_create_group(&mmc_dev(host->mmc)->kobj,
+			       &mmci_dma_attr_group))
+		dev_warn(mmc_dev(host->mmc), "failed to create sysfs files\n");
+}
+
+static void __devexit mmci_dma_remove_attrs(struct mmci_host *host)
+{
+	sysfs_remove_group(&mmc_dev(host->mmc)->kobj, &mmci_dma_attr_group);
 }
 
 /*
@@ -475,10 +681,10 @@ static int __mmci_dma_prep_data(struct mmci_host *host, struct mmc_data *data,
 		return -EINVAL;
 
 	/*
-	 * If less than or equal to the fifo size, don't bother with DMA
+	 * Small transfers are faster in PIO, see mmci_use_pio().
 	 * SDIO transfers may not be 4 bytes aligned, fall back to PIO
 	 */
-	if (data->blksz * data->blocks <= variant->fifosize ||
+	if (mmci_use_pio(host, data->blksz * data->blocks) ||
 	    (data->blksz * data->blocks) & 3)
 		return -EINVAL;
 
@@ -592,11 +798,11 @@ static void mmci_pre_request(struct mmc_host *mmc, struct mmc_request *mrq,
 		return;
 
 	/*
-	 * Don't prepare DMA if there is no previous request,
-	 * is_first_req is set. Instead, prepare DMA while
-	 * start command is being issued.
+	 * Prepare DMA here even for the first request, so that the
+	 * buffer is unmapped in post_req while the next request runs
+	 * instead of from the interrupt handler.
 	 */
-	if (!is_first_req && !mmci_dma_prep_next(host, data))
+	if (!mmci_dma_prep_next(host, data))
 		data->host_cookie = ++nd->cookie < 0 ? 1 : nd->cookie;
 }
 
@@ -634,6 +840,20 @@ static inline void mmci_dma_setup(struct mmci_host *host)
 {
 }
 
+static inline void mmci_dma_remove_attrs(struct mmci_host *host)
+{
+}
+
+static inline void mmci_xfer_start(struct mmci_host *host,
+				   struct mmc_data *data, bool dma)
+{
+}
+
+static inline void mmci_xfer_account(struct mmci_host *host,
+				     struct mmc_data *data)
+{
+}
+
 static inline void mmci_dma_release(struct mmci_host *host)
 {
 }
@@ -736,8 +956,12 @@ static void mmci_start_data(struct mmci_host *host, struct mmc_data *data)
 	 * Attempt to use DMA operation mode, if this
 	 * should fail, fall back to PIO mode
 	 */
-	if (!mmci_dma_start_data(host))
+	if (!mmci_dma_start_data(host)) {
+		mmci_xfer_start(host, data, true);
 		return;
+	}
+
+	mmci_xfer_start(host, data, false);
 
 	/* IRQ mode, map the SG list for CPU reading/writing */
 	mmci_init_sg(host, data);
@@ -851,6 +1075,8 @@ mmci_data_irq(struct mmci_host *host, struct mmc_data *data,
 		dev_err(mmc_dev(host->mmc), "stray MCI_DATABLOCKEND interrupt\n");
 
 	if (status & MCI_DATAEND || data->error) {
+		if (!data->error)
+			mmci_xfer_account(host, data);
 		if (dma_inprogress(host))
 			mmci_dma_finalize(host, data);
 		mmci_stop_data(host);
@@ -1590,6 +1816,7 @@ static int __devexit mmci_remove(struct amba_device *dev)
 		pm_runtime_get_sync(&dev->dev);
 
 		mmc_remove_host(mmc);
+		mmci_dma_remove_attrs(host);
 
 		writel(0, host->base + MMCIMASK0);
 		writel(0, host->base + MMCIMASK1);
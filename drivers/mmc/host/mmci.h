@@ -169,6 +169,24 @@ struct mmci_host_next {
 	s32				cookie;
 };
 
+/*
+ * Transfer sizes for which the PIO/DMA crossover is measured, in power of
+ * two buckets from 1 << MMCI_XFER_MIN_SHIFT bytes. Larger transfers always
+ * use DMA unless told otherwise through dma_threshold.
+ */
+#define MMCI_XFER_MIN_SHIFT	7
+#define MMCI_XFER_BUCKETS	7
+
+/* Try the other mode for one in this many transfers of a bucket */
+#define MMCI_XFER_PROBE		32
+
+struct mmci_xfer_stats {
+	/* Average ns per KiB, for PIO [0] and DMA [1] */
+	u32				avg[2];
+	u32				samples[2];
+	u32				count;
+};
+
 struct mmci_host {
 	phys_addr_t		phybase;
 	void __iomem		*base;
@@ -212,6 +230,13 @@ struct mmci_host {
 	struct dma_async_tx_descriptor	*dma_desc_current;
 	struct mmci_host_next	next_data;
 
+	/* Transfers up to this size use PIO */
+	unsigned int		dma_threshold;
+	bool			dma_threshold_auto;
+	ktime_t			xfer_start;
+	bool			xfer_dma;
+	struct mmci_xfer_stats	xfer_stats[MMCI_XFER_BUCKETS];
+
 #define dma_inprogress(host)	((host)->dma_current)
 #else
 #define dma_inprogress(host)	(0)
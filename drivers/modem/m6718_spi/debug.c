@@ -14,6 +14,7 @@
 #include "modem_private.h"
 #include "modem_util.h"
 #include "modem_queue.h"
+#include "modem_standin.h"
 
 /* name of each state - must match enum ipc_sm_state_id */
 static const char * const sm_state_id_str[] = {
@@ -137,12 +138,17 @@ char *ipc_dbg_link_state_str(struct ipc_link_context *context)
 	if (context == NULL)
 		return NULL;
 
-	statestr = kmalloc(500, GFP_ATOMIC);
+	statestr = kmalloc(640, GFP_ATOMIC);
 	if (statestr == NULL)
 		return NULL;
 
+#ifdef CONFIG_MODEM_M6718_SPI_STANDIN
+	ss_pin = ipc_standin_get_ss(context);
+	int_pin = ipc_standin_get_int(context);
+#else
 	ss_pin = gpio_get_value(context->link->gpio.ss_pin);
 	int_pin = gpio_get_value(context->link->gpio.int_pin);
+#endif
 	min_free_pc = context->tx_q_min > 0 ?
 		(context->tx_q_min * 100) / IPC_TX_QUEUE_MAX_SIZE :
 		0;
@@ -155,7 +161,9 @@ char *ipc_dbg_link_state_str(struct ipc_link_context *context)
 		"lastignored=%s in %s (ignoredinthis=%d)\n"
 		"tx_q_min=%d(%d%%)\n"
 		"tx_q_count=%d\n"
-		"lastcmd=0x%08x (type %d count %d len %d)\n",
+		"lastcmd=0x%08x (type %d count %d len %d)\n"
+		"tx=%u frames %u msgs %llu bytes\n"
+		"rx=%u frames %u msgs %llu bytes\n",
 		sm_state_id_str[context->state->id],
 		(jiffies - context->statesince) / HZ,
 		ss_pin == ipc_util_ss_level_active(context) ?
@@ -174,7 +182,13 @@ char *ipc_dbg_link_state_str(struct ipc_link_context *context)
 		context->cmd,
 		ipc_util_get_l1_cmd(context->cmd),
 		ipc_util_get_l1_counter(context->cmd),
-		ipc_util_get_l1_length(context->cmd));
+		ipc_util_get_l1_length(context->cmd),
+		context->stat_tx_frames,
+		context->stat_tx_msgs,
+		context->stat_tx_bytes,
+		context->stat_rx_frames,
+		context->stat_rx_msgs,
+		context->stat_rx_bytes);
 	return statestr;
 }
 
@@ -349,6 +363,12 @@ void ipc_dbg_debugfs_link_init(struct ipc_link_context *context)
 	context->lastignored_inthis = false;
 	context->tx_q_min = IPC_TX_QUEUE_MAX_SIZE;
 	context->statesince = 0;
+	context->stat_tx_frames = 0;
+	context->stat_tx_msgs = 0;
+	context->stat_tx_bytes = 0;
+	context->stat_rx_frames = 0;
+	context->stat_rx_msgs = 0;
+	context->stat_rx_bytes = 0;
 
 	if (l1_context.debugfsdir != NULL) {
 		context->debugfsfile =
@@ -387,6 +407,31 @@ void ipc_dbg_entering_state(struct ipc_link_context *context)
 #endif
 }
 
+/*
+ * Link counters: frames and bytes are what was transferred over SPI,
+ * msgs the L2 PDUs carried, more than one per frame when aggregating.
+ */
+void ipc_dbg_count_tx_frame(struct ipc_link_context *context,
+	struct ipc_tx_queue *frame)
+{
+#ifdef CONFIG_DEBUG_FS
+	context->stat_tx_frames++;
+	if (frame->actual_len != 0)
+		context->stat_tx_msgs += frame->msgs;
+	context->stat_tx_bytes += frame->len;
+#endif
+}
+
+void ipc_dbg_count_rx_frame(struct ipc_link_context *context,
+	struct ipc_tx_queue *frame, int msgs)
+{
+#ifdef CONFIG_DEBUG_FS
+	context->stat_rx_frames++;
+	context->stat_rx_msgs += msgs;
+	context->stat_rx_bytes += frame->len;
+#endif
+}
+
 void ipc_dbg_enter_idle(struct ipc_link_context *context)
 {
 #ifdef CONFIG_MODEM_M6718_SPI_ENABLE_FEATURE_THROUGHPUT_MEASUREMENT
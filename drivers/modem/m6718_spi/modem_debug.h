@@ -27,6 +27,10 @@ void ipc_dbg_debugfs_link_init(struct ipc_link_context *context);
 void ipc_dbg_ignoring_event(struct ipc_link_context *context, u8 event);
 void ipc_dbg_handling_event(struct ipc_link_context *context, u8 event);
 void ipc_dbg_entering_state(struct ipc_link_context *context);
+void ipc_dbg_count_tx_frame(struct ipc_link_context *context,
+	struct ipc_tx_queue *frame);
+void ipc_dbg_count_rx_frame(struct ipc_link_context *context,
+	struct ipc_tx_queue *frame, int msgs);
 void ipc_dbg_enter_idle(struct ipc_link_context *context);
 void ipc_dbg_exit_idle(struct ipc_link_context *context);
 void ipc_dbg_measure_throughput(unsigned long unused);
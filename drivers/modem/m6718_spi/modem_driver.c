@@ -16,6 +16,7 @@
 #include <linux/modem/m6718_spi/modem_net.h>
 #include <linux/modem/m6718_spi/modem_char.h>
 #include "modem_protocol.h"
+#include "modem_standin.h"
 
 #ifdef CONFIG_PHONET
 static void phonet_rcv_tasklet_func(unsigned long);
@@ -274,15 +275,25 @@ static struct spi_driver spi_driver = {
 
 static int __init m6718_spi_driver_init(void)
 {
+	int err;
+
 	pr_info("M6718 modem driver initialising\n");
 	modem_protocol_init();
-	return spi_register_driver(&spi_driver);
+	err = spi_register_driver(&spi_driver);
+	if (err)
+		return err;
+
+	err = ipc_standin_init();
+	if (err)
+		spi_unregister_driver(&spi_driver);
+	return err;
 }
 module_init(m6718_spi_driver_init);
 
 static void __exit m6718_spi_driver_exit(void)
 {
 	pr_debug("M6718 modem SPI IPC driver exit\n");
+	ipc_standin_exit();
 	spi_unregister_driver(&spi_driver);
 }
 module_exit(m6718_spi_driver_exit);
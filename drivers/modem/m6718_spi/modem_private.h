@@ -36,13 +36,23 @@
 #define IPC_L1_HDR_SIZE (4)
 #define IPC_L2_HDR_SIZE (4)
 
-/* tx queue item (frame) */
+/* L1 commands */
+#define CMD_BOOTREQ  (1)
+#define CMD_BOOTRESP (2)
+#define CMD_WRITE    (3)
+#define CMD_READ     (4)
+
+/* L1 frames, and L2 PDUs within aggregated frames, are padded to this */
+#define IPC_FRAME_LENGTH_ALIGN (4)
+
+/* tx queue item (frame), may hold several aggregated L2 PDUs (msgs) */
 struct ipc_tx_queue {
 	struct list_head node;
 	int actual_len;
 	int len;
 	void *data;
 	int counter;
+	int msgs;
 };
 
 /* context structure for an spi link */
@@ -83,6 +93,12 @@ struct ipc_link_context {
 	bool lastignored_inthis;
 	int tx_q_min;
 	unsigned long statesince;
+	u32 stat_tx_frames;
+	u32 stat_tx_msgs;
+	u64 stat_tx_bytes;
+	u32 stat_rx_frames;
+	u32 stat_rx_msgs;
+	u64 stat_rx_bytes;
 #endif
 };
 
@@ -18,6 +18,7 @@ struct ipc_tx_queue *ipc_queue_new_frame(struct ipc_link_context *link_context,
 bool ipc_queue_is_empty(struct ipc_link_context *context);
 int ipc_queue_push_frame(struct ipc_link_context *link_context, u8 l2_header,
 	u32 l2_length, void *l2_data);
+void ipc_queue_aggregate(struct ipc_link_context *context);
 struct ipc_tx_queue *ipc_queue_get_frame(struct ipc_link_context *context);
 void ipc_queue_reset(struct ipc_link_context *context);
 
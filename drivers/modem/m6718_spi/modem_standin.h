@@ -0,0 +1,28 @@
+/*
+ * Copyright (C) ST-Ericsson SA 2012
+ *
+ * License terms: GNU General Public License (GPL) version 2
+ *
+ * Modem IPC driver protocol interface header:
+ *   stand-in for the modem side of the SPI links.
+ */
+#ifndef _MODEM_STANDIN_H_
+#define _MODEM_STANDIN_H_
+
+#include "modem_private.h"
+
+#ifdef CONFIG_MODEM_M6718_SPI_STANDIN
+int ipc_standin_init(void);
+void ipc_standin_exit(void);
+
+void ipc_standin_set_irq(struct ipc_link_context *context,
+	irqreturn_t (*irqhnd)(int, void*));
+void ipc_standin_set_ss(struct ipc_link_context *context, int level);
+int ipc_standin_get_ss(struct ipc_link_context *context);
+int ipc_standin_get_int(struct ipc_link_context *context);
+#else
+static inline int ipc_standin_init(void) { return 0; }
+static inline void ipc_standin_exit(void) { }
+#endif
+
+#endif /* _MODEM_STANDIN_H_ */
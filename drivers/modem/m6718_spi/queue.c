@@ -11,7 +11,6 @@
 #include <linux/modem/m6718_spi/modem_driver.h>
 #include "modem_util.h"
 
-#define FRAME_LENGTH_ALIGN (4)
 #define MAX_FRAME_COUNTER (256)
 
 /* fixed L1 frame size for audio link: 4 byte L2 header + 664 byte L2 payload */
@@ -51,9 +50,9 @@ struct ipc_tx_queue *ipc_queue_new_frame(struct ipc_link_context *link_context,
 		padded_len = FRAME_SIZE_AUDIO;
 	} else {
 		/* frame length padded to alignment boundary */
-		if (padded_len % FRAME_LENGTH_ALIGN)
-			padded_len += (FRAME_LENGTH_ALIGN -
-					(padded_len % FRAME_LENGTH_ALIGN));
+		if (padded_len % IPC_FRAME_LENGTH_ALIGN)
+			padded_len += (IPC_FRAME_LENGTH_ALIGN -
+					(padded_len % IPC_FRAME_LENGTH_ALIGN));
 	}
 
 	dev_dbg(&link_context->sdev->dev,
@@ -71,6 +70,7 @@ struct ipc_tx_queue *ipc_queue_new_frame(struct ipc_link_context *link_context,
 	frame->actual_len = l2_length;
 	frame->len = padded_len;
 	frame->data = frame + 1;
+	frame->msgs = 1;
 	return frame;
 }
 
@@ -92,7 +92,6 @@ int ipc_queue_push_frame(struct ipc_link_context *context, u8 channel,
 	u32 l2_hdr;
 	unsigned long flags;
 	struct ipc_tx_queue *frame;
-	int *tx_frame_counter = &context->tx_frame_counter;
 	int qcount;
 
 	/*
@@ -120,8 +119,6 @@ int ipc_queue_push_frame(struct ipc_link_context *context, u8 channel,
 	memcpy(frame->data + IPC_L2_HDR_SIZE, data, length);
 
 	spin_lock_irqsave(&context->tx_q_update_lock, flags);
-	frame->counter = *tx_frame_counter;
-	*tx_frame_counter = (*tx_frame_counter + 1) % MAX_FRAME_COUNTER;
 	list_add_tail(&frame->node, &context->tx_q);
 	qcount = atomic_add_return(1, &context->tx_q_count);
 	/* tx_q_free could go negative here */
@@ -132,10 +129,9 @@ int ipc_queue_push_frame(struct ipc_link_context *context, u8 channel,
 	spin_unlock_irqrestore(&context->tx_q_update_lock, flags);
 
 	dev_dbg(&context->sdev->dev,
-		"link %d: push tx frame %d: %08x (ch %d len %d), "
+		"link %d: push tx frame: %08x (ch %d len %d), "
 		"new count %d, new free %d\n",
 		context->link->id,
-		frame->counter,
 		l2_hdr,
 		ipc_util_get_l2_channel(l2_hdr),
 		ipc_util_get_l2_length(l2_hdr),
@@ -144,15 +140,102 @@ int ipc_queue_push_frame(struct ipc_link_context *context, u8 channel,
 	return 0;
 }
 
+#ifdef CONFIG_MODEM_M6718_SPI_ENABLE_FEATURE_FRAME_AGGREGATION
+static bool frame_can_aggregate(struct ipc_tx_queue *frame, int len)
+{
+	if (len + frame->len > CONFIG_MODEM_M6718_SPI_SET_AGGREGATION_MAX_LEN)
+		return false;
+#ifdef CONFIG_MODEM_M6718_SPI_ENABLE_FEATURE_VERIFY_FRAMES
+	/* loopback frames are verified one at a time */
+	if (ipc_util_channel_is_loopback(
+			ipc_util_get_l2_channel(*(u32 *)frame->data)))
+		return false;
+#endif
+	return true;
+}
+#endif
+
+/*
+ * Replace the frames at the head of the tx queue with a single frame
+ * holding all their L2 PDUs, each still padded to the alignment boundary.
+ * Only the state machine removes frames from the queue, so the frames
+ * counted here are still at its head when they are replaced.
+ */
+void ipc_queue_aggregate(struct ipc_link_context *context)
+{
+#ifdef CONFIG_MODEM_M6718_SPI_ENABLE_FEATURE_FRAME_AGGREGATION
+	unsigned long flags;
+	struct ipc_tx_queue *frame;
+	struct ipc_tx_queue *next;
+	struct ipc_tx_queue *last = NULL;
+	struct ipc_tx_queue *aggr;
+	LIST_HEAD(batch);
+	int count = 0;
+	int len = 0;
+	int actual_len = 0;
+	int msgs = 0;
+	u8 *wr;
+
+	if (context->link->id != IPC_LINK_COMMON)
+		return;
+
+	spin_lock_irqsave(&context->tx_q_update_lock, flags);
+	list_for_each_entry(frame, &context->tx_q, node) {
+		if (!frame_can_aggregate(frame, len))
+			break;
+		actual_len = len + frame->actual_len;
+		len += frame->len;
+		msgs += frame->msgs;
+		last = frame;
+		count++;
+	}
+	spin_unlock_irqrestore(&context->tx_q_update_lock, flags);
+
+	if (count < 2)
+		return;
+
+	/* if this fails the frames are simply sent one by one */
+	aggr = ipc_queue_new_frame(context, len);
+	if (aggr == NULL)
+		return;
+	aggr->actual_len = actual_len;
+	aggr->msgs = msgs;
+
+	spin_lock_irqsave(&context->tx_q_update_lock, flags);
+	list_cut_position(&batch, &context->tx_q, &last->node);
+	list_add(&aggr->node, &context->tx_q);
+	atomic_sub(count - 1, &context->tx_q_count);
+	spin_unlock_irqrestore(&context->tx_q_update_lock, flags);
+
+	wr = aggr->data;
+	list_for_each_entry_safe(frame, next, &batch, node) {
+		memcpy(wr, frame->data, frame->len);
+		wr += frame->len;
+		list_del(&frame->node);
+		ipc_queue_delete_frame(frame);
+	}
+
+	dev_dbg(&context->sdev->dev,
+		"link %d: aggregated %d frames (%d msgs), length %d\n",
+		context->link->id, count, msgs, len);
+#endif
+}
+
 struct ipc_tx_queue *ipc_queue_get_frame(struct ipc_link_context *context)
 {
 	unsigned long flags;
 	struct ipc_tx_queue *frame;
+	int *tx_frame_counter = &context->tx_frame_counter;
 	int qcount;
 
+	ipc_queue_aggregate(context);
+
 	spin_lock_irqsave(&context->tx_q_update_lock, flags);
 	frame = list_first_entry(&context->tx_q, struct ipc_tx_queue, node);
 	list_del(&frame->node);
+	/* counters follow the frames actually sent */
+	frame->counter = *tx_frame_counter;
+	*tx_frame_counter = (*tx_frame_counter + 1) % MAX_FRAME_COUNTER;
 	qcount = atomic_sub_return(1, &context->tx_q_count);
 	context->tx_q_free += frame->len;
 	spin_unlock_irqrestore(&context->tx_q_update_lock, flags);
@@ -0,0 +1,519 @@
+/*
+ * Copyright (C) ST-Ericsson SA 2012
+ *
+ * License terms: GNU General Public License (GPL) version 2
+ *
+ * U9500 <-> M6718 IPC protocol implementation using SPI:
+ *   stand-in for the modem, for boards without one.
+ *
+ * Registers an SPI master with a device for each link, whose transfers are
+ * answered by a software slave that runs the modem side of the protocol.
+ * The SS and INT lines are flags shared with the driver instead of GPIOs:
+ * the slave raises INT, and calls the driver's interrupt handler, when the
+ * master activates SS and after every transfer the master expects to be
+ * followed by one. Every frame written by the driver is sent back to it,
+ * on the channels it was written to, so the loopback channels (and the
+ * char and net devices) can be exercised without a modem.
+ */
+#include <linux/module.h>
+#include <linux/platform_device.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
+#include <linux/modem/modem.h>
+#include <linux/modem/m6718_spi/modem_driver.h>
+#include "modem_util.h"
+#include "modem_standin.h"
+
+#define STANDIN_NAME "m6718-spi-standin"
+
+/* frames written by the driver that have not been sent back yet */
+#define STANDIN_MAX_FRAMES (64)
+
+/* what the slave expects from the next transfer on the common link */
+enum standin_state {
+	STANDIN_CMD,		/* a command from the master */
+	STANDIN_WR_DAT,		/* the data of a master write */
+	STANDIN_BOOTRESP,	/* its boot response */
+	STANDIN_RD_CMD,		/* its write command, or none */
+	STANDIN_RD_DAT,		/* the data of its write */
+};
+
+struct standin_frame {
+	struct list_head node;
+	u32 len;
+	u8 data[0];
+};
+
+struct standin_link {
+	struct ipc_link_context *context;
+	irqreturn_t (*irqhnd)(int, void*);
+	spinlock_t lock;
+	int ss_level;
+	bool int_active;
+	bool raise_int;
+	struct spi_message *msg;
+	struct work_struct work;
+	enum standin_state state;
+	u32 wr_len;
+	u8 counter;
+	struct list_head frames;
+	int nbr_frames;
+};
+
+static struct standin_link standin_links[IPC_NBR_SUPPORTED_SPI_LINKS];
+static struct workqueue_struct *standin_wq;
+static struct platform_device *standin_pdev;
+static struct spi_master *standin_master;
+static struct spi_device *standin_sdev[IPC_NBR_SUPPORTED_SPI_LINKS];
+static struct modem_dev *standin_mdev;
+
+static struct modem_m6718_spi_link_platform_data standin_link_data[] = {
+	{
+		.id = IPC_LINK_COMMON,
+		.gpio = {
+			.ss_pin = 0,
+			.ss_active = 1,
+			.int_pin = 1,
+			.int_active = 1,
+		},
+#ifdef CONFIG_DEBUG_FS
+		.name = "common",
+#endif
+	},
+	{
+		.id = IPC_LINK_AUDIO,
+		.gpio = {
+			.ss_pin = 2,
+			.ss_active = 1,
+			.int_pin = 3,
+			.int_active = 1,
+		},
+#ifdef CONFIG_DEBUG_FS
+		.name = "audio",
+#endif
+	},
+};
+
+static struct standin_link *standin_link(struct ipc_link_context *context)
+{
+	return &standin_links[context->link->id];
+}
+
+static void standin_queue_frame(struct standin_link *sl, const void *data,
+	u32 len)
+{
+	struct standin_frame *frame;
+	unsigned long flags;
+
+	spin_lock_irqsave(&sl->lock, flags);
+	if (sl->nbr_frames == STANDIN_MAX_FRAMES) {
+		spin_unlock_irqrestore(&sl->lock, flags);
+		dev_warn(&sl->context->sdev->dev,
+			"link %d: stand-in queue full, frame dropped\n",
+			sl->context->link->id);
+		return;
+	}
+	sl->nbr_frames++;
+	spin_unlock_irqrestore(&sl->lock, flags);
+
+	frame = kmalloc(sizeof(*frame) + len, GFP_KERNEL);
+	if (frame == NULL) {
+		spin_lock_irqsave(&sl->lock, flags);
+		sl->nbr_frames--;
+		spin_unlock_irqrestore(&sl->lock, flags);
+		return;
+	}
+	frame->len = len;
+	memcpy(frame->data, data, len);
+
+	spin_lock_irqsave(&sl->lock, flags);
+	list_add_tail(&frame->node, &sl->frames);
+	spin_unlock_irqrestore(&sl->lock, flags);
+}
+
+static struct standin_frame *standin_peek_frame(struct standin_link *sl)
+{
+	struct standin_frame *frame = NULL;
+	unsigned long flags;
+
+	spin_lock_irqsave(&sl->lock, flags);
+	if (!list_empty(&sl->frames))
+		frame = list_first_entry(&sl->frames, struct standin_frame,
+			node);
+	spin_unlock_irqrestore(&sl->lock, flags);
+	return frame;
+}
+
+static struct standin_frame *standin_dequeue_frame(struct standin_link *sl)
+{
+	struct standin_frame *frame;
+	unsigned long flags;
+
+	spin_lock_irqsave(&sl->lock, flags);
+	frame = list_first_entry(&sl->frames, struct standin_frame, node);
+	list_del(&frame->node);
+	sl->nbr_frames--;
+	spin_unlock_irqrestore(&sl->lock, flags);
+	return frame;
+}
+
+/* the driver sends frames on the slave loopback channels back itself */
+static bool standin_echo_frame(const void *data)
+{
+	u32 hdr;
+	u8 channel;
+
+	memcpy(&hdr, data, sizeof(hdr));
+	channel = ipc_util_get_l2_channel(hdr);
+	return channel != MODEM_M6718_SPI_CHN_SLAVE_LOOPBACK0 &&
+		channel != MODEM_M6718_SPI_CHN_SLAVE_LOOPBACK1;
+}
+
+static void standin_rx_copy(struct spi_transfer *tfr, const void *data,
+	u32 len)
+{
+	len = min(len, tfr->len);
+	memcpy(tfr->rx_buf, data, len);
+	memset(tfr->rx_buf + len, 0, tfr->len - len);
+}
+
+/*
+ * Audio link: every transaction is a frame from the master followed by one
+ * from the slave. A frame with a zero L2 header is a dummy.
+ */
+static bool standin_xfer_audio(struct standin_link *sl,
+	struct spi_transfer *tfr)
+{
+	struct standin_frame *frame;
+	u32 hdr;
+
+	if (tfr->tx_buf != NULL) {
+		memcpy(&hdr, tfr->tx_buf, sizeof(hdr));
+		if (hdr != 0)
+			standin_queue_frame(sl, tfr->tx_buf, tfr->len);
+		return true;
+	}
+
+	if (standin_peek_frame(sl) != NULL) {
+		frame = standin_dequeue_frame(sl);
+		standin_rx_copy(tfr, frame->data, frame->len);
+		kfree(frame);
+	} else {
+		memset(tfr->rx_buf, 0, tfr->len);
+	}
+	return false;
+}
+
+/* returns true if the master waits for INT before its next transfer */
+static bool standin_xfer(struct standin_link *sl, struct spi_transfer *tfr)
+{
+	struct ipc_link_context *context = sl->context;
+	struct standin_frame *frame;
+	u32 hdr;
+
+	if (context->link->id == IPC_LINK_AUDIO)
+		return standin_xfer_audio(sl, tfr);
+
+	switch (sl->state) {
+	case STANDIN_CMD:
+		memcpy(&hdr, tfr->tx_buf, sizeof(hdr));
+		switch (ipc_util_get_l1_cmd(hdr)) {
+		case CMD_BOOTREQ:
+			sl->state = STANDIN_BOOTRESP;
+			break;
+		case CMD_WRITE:
+			sl->wr_len = ipc_util_get_l1_length(hdr);
+			sl->state = STANDIN_WR_DAT;
+			break;
+		case CMD_READ:
+			sl->state = STANDIN_RD_CMD;
+			break;
+		default:
+			dev_err(&context->sdev->dev,
+				"link %d: stand-in got unknown command 0x%08x\n",
+				context->link->id, hdr);
+			return false;
+		}
+		return true;
+
+	case STANDIN_WR_DAT:
+		if (standin_echo_frame(tfr->tx_buf))
+			standin_queue_frame(sl, tfr->tx_buf,
+				min(sl->wr_len, tfr->len));
+		sl->state = STANDIN_CMD;
+		return true;
+
+	case STANDIN_BOOTRESP:
+		hdr = ipc_util_make_l1_header(CMD_BOOTRESP, 0,
+			IPC_DRIVER_VERSION);
+		standin_rx_copy(tfr, &hdr, sizeof(hdr));
+		sl->state = STANDIN_CMD;
+		return false;
+
+	case STANDIN_RD_CMD:
+		frame = standin_peek_frame(sl);
+		if (frame != NULL) {
+			hdr = ipc_util_make_l1_header(CMD_WRITE,
+				sl->counter++, frame->len);
+			sl->state = STANDIN_RD_DAT;
+		} else {
+			hdr = 0;
+			sl->state = STANDIN_CMD;
+		}
+		standin_rx_copy(tfr, &hdr, sizeof(hdr));
+		return false;
+
+	case STANDIN_RD_DAT:
+		frame = standin_dequeue_frame(sl);
+		standin_rx_copy(tfr, frame->data, frame->len);
+		kfree(frame);
+		sl->state = STANDIN_CMD;
+		return true;
+	}
+	return false;
+}
+
+static void standin_work(struct work_struct *work)
+{
+	struct standin_link *sl =
+		container_of(work, struct standin_link, work);
+	struct ipc_link_context *context = sl->context;
+	struct spi_transfer *tfr;
+	struct spi_message *msg;
+	unsigned long flags;
+	bool raise = false;
+
+	spin_lock_irqsave(&sl->lock, flags);
+	msg = sl->msg;
+	spin_unlock_irqrestore(&sl->lock, flags);
+
+	if (msg != NULL) {
+		list_for_each_entry(tfr, &msg->transfers, transfer_list) {
+			raise = standin_xfer(sl, tfr);
+			msg->actual_length += tfr->len;
+		}
+		msg->status = 0;
+
+		spin_lock_irqsave(&sl->lock, flags);
+		sl->msg = NULL;
+		sl->raise_int = raise;
+		spin_unlock_irqrestore(&sl->lock, flags);
+
+		/* spi_tfr_complete() expects to run in interrupt context */
+		local_irq_save(flags);
+		msg->complete(msg->context);
+		local_irq_restore(flags);
+	}
+
+	/* only signal a master that is still waiting */
+	spin_lock_irqsave(&sl->lock, flags);
+	raise = sl->raise_int && sl->msg == NULL && !sl->int_active &&
+		sl->ss_level == ipc_util_ss_level_active(context);
+	sl->raise_int = false;
+	if (raise)
+		sl->int_active = true;
+	spin_unlock_irqrestore(&sl->lock, flags);
+
+	if (raise) {
+		local_irq_save(flags);
+		sl->irqhnd(GPIO_TO_IRQ(context->link->gpio.int_pin), context);
+		local_irq_restore(flags);
+	}
+}
+
+void ipc_standin_set_irq(struct ipc_link_context *context,
+	irqreturn_t (*irqhnd)(int, void*))
+{
+	struct standin_link *sl = standin_link(context);
+
+	sl->context = context;
+	sl->irqhnd = irqhnd;
+	sl->ss_level = ipc_util_ss_level_inactive(context);
+	sl->int_active = false;
+	sl->state = STANDIN_CMD;
+}
+
+/* called with the link's state machine locked, so the INT goes to work */
+void ipc_standin_set_ss(struct ipc_link_context *context, int level)
+{
+	struct standin_link *sl = standin_link(context);
+	int active = ipc_util_ss_level_active(context);
+	unsigned long flags;
+
+	spin_lock_irqsave(&sl->lock, flags);
+	if (level == active && sl->ss_level != active) {
+		sl->raise_int = true;
+		queue_work(standin_wq, &sl->work);
+	}
+	sl->ss_level = level;
+	spin_unlock_irqrestore(&sl->lock, flags);
+}
+
+int ipc_standin_get_ss(struct ipc_link_context *context)
+{
+	return standin_link(context)->ss_level;
+}
+
+int ipc_standin_get_int(struct ipc_link_context *context)
+{
+	return standin_link(context)->int_active ?
+		ipc_util_int_level_active(context) :
+		ipc_util_int_level_inactive(context);
+}
+
+static int standin_setup(struct spi_device *sdev)
+{
+	return 0;
+}
+
+static int standin_transfer(struct spi_device *sdev, struct spi_message *msg)
+{
+	struct standin_link *sl = &standin_links[sdev->chip_select];
+	unsigned long flags;
+
+	spin_lock_irqsave(&sl->lock, flags);
+	if (sl->msg != NULL) {
+		spin_unlock_irqrestore(&sl->lock, flags);
+		return -EBUSY;
+	}
+	msg->actual_length = 0;
+	msg->status = -EINPROGRESS;
+	sl->msg = msg;
+	/* the slave is busy until it signals the next transfer */
+	sl->int_active = false;
+	sl->raise_int = false;
+	spin_unlock_irqrestore(&sl->lock, flags);
+
+	queue_work(standin_wq, &sl->work);
+	return 0;
+}
+
+static void standin_flush_frames(struct standin_link *sl)
+{
+	struct standin_frame *frame, *tmp;
+
+	list_for_each_entry_safe(frame, tmp, &sl->frames, node) {
+		list_del(&frame->node);
+		kfree(frame);
+	}
+	sl->nbr_frames = 0;
+}
+
+/* The modem is always on, so there is nothing to request */
+static void standin_modem_request(struct modem_dev *mdev)
+{
+}
+
+static void standin_modem_release(struct modem_dev *mdev)
+{
+}
+
+static int standin_modem_is_requested(struct modem_dev *mdev)
+{
+	return 1;
+}
+
+static struct modem_ops standin_modem_ops = {
+	.request = standin_modem_request,
+	.release = standin_modem_release,
+	.is_requested = standin_modem_is_requested,
+};
+
+/* no owner: the driver holds the modem and must stay unloadable */
+static struct modem_desc standin_modem_desc = {
+	.name = "m6718",
+	.ops = &standin_modem_ops,
+};
+
+/**
+ * ipc_standin_init() - register the stand-in SPI master and link devices
+ *
+ * Called once the SPI driver is registered, so the links are probed, and
+ * the common link starts its boot handshake, before this returns.
+ */
+int ipc_standin_init(void)
+{
+	struct spi_board_info info;
+	int err;
+	int i;
+
+	for (i = 0; i < IPC_NBR_SUPPORTED_SPI_LINKS; i++) {
+		spin_lock_init(&standin_links[i].lock);
+		INIT_WORK(&standin_links[i].work, standin_work);
+		INIT_LIST_HEAD(&standin_links[i].frames);
+	}
+
+	standin_wq = create_singlethread_workqueue("m6718_standin");
+	if (standin_wq == NULL)
+		return -ENOMEM;
+
+	standin_pdev = platform_device_register_simple(STANDIN_NAME, -1,
+		NULL, 0);
+	if (IS_ERR(standin_pdev)) {
+		err = PTR_ERR(standin_pdev);
+		goto destroy_wq;
+	}
+
+	standin_mdev = modem_register(&standin_modem_desc, &standin_pdev->dev,
+		NULL);
+	if (IS_ERR(standin_mdev)) {
+		err = PTR_ERR(standin_mdev);
+		goto unregister_pdev;
+	}
+
+	standin_master = spi_alloc_master(&standin_pdev->dev, 0);
+	if (standin_master == NULL) {
+		err = -ENOMEM;
+		goto unregister_modem;
+	}
+	standin_master->bus_num = -1;
+	standin_master->num_chipselect = IPC_NBR_SUPPORTED_SPI_LINKS;
+	standin_master->mode_bits = SPI_CPOL | SPI_CPHA;
+	standin_master->setup = standin_setup;
+	standin_master->transfer = standin_transfer;
+
+	err = spi_register_master(standin_master);
+	if (err) {
+		spi_master_put(standin_master);
+		goto unregister_modem;
+	}
+
+	for (i = 0; i < IPC_NBR_SUPPORTED_SPI_LINKS; i++) {
+		memset(&info, 0, sizeof(info));
+		strlcpy(info.modalias, "spimodem", sizeof(info.modalias));
+		info.platform_data = &standin_link_data[i];
+		info.chip_select = i;
+		info.max_speed_hz = 12000000;
+		standin_sdev[i] = spi_new_device(standin_master, &info);
+		if (standin_sdev[i] == NULL) {
+			err = -ENODEV;
+			goto unregister_master;
+		}
+	}
+
+	pr_info("M6718 modem stand-in registered\n");
+	return 0;
+
+unregister_master:
+	spi_unregister_master(standin_master);
+unregister_modem:
+	modem_unregister(standin_mdev);
+unregister_pdev:
+	platform_device_unregister(standin_pdev);
+destroy_wq:
+	destroy_workqueue(standin_wq);
+	return err;
+}
+
+void ipc_standin_exit(void)
+{
+	int i;
+
+	/* unregisters the link devices, which stops the state machines */
+	spi_unregister_master(standin_master);
+	destroy_workqueue(standin_wq);
+	for (i = 0; i < IPC_NBR_SUPPORTED_SPI_LINKS; i++)
+		standin_flush_frames(&standin_links[i]);
+	modem_unregister(standin_mdev);
+	platform_device_unregister(standin_pdev);
+}
@@ -20,11 +20,6 @@
 #include "modem_state.h"
 #endif
 
-#define CMD_BOOTREQ  (1)
-#define CMD_BOOTRESP (2)
-#define CMD_WRITE    (3)
-#define CMD_READ     (4)
-
 static u8 sm_init_enter(u8 event, struct ipc_link_context *context)
 {
 #ifdef CONFIG_MODEM_M6718_SPI_ENABLE_FEATURE_MODEM_STATE
@@ -401,6 +396,9 @@ static u8 sm_act_tx_wr_dat_enter(u8 event, struct ipc_link_context *context)
 			context->link->id, err);
 		return IPC_SM_RUN_ABORT;
 	}
+
+	/* build the next frame while this one is being transferred */
+	ipc_queue_aggregate(context);
 	return IPC_SM_RUN_NONE;
 }
 
@@ -414,6 +412,7 @@ static const struct ipc_sm_state *sm_act_tx_wr_dat_exit(u8 event,
 	/* frame is sent, increment link tx counter */
 	context->tx_bytes += context->frame->actual_len;
 #endif
+	ipc_dbg_count_tx_frame(context, context->frame);
 #ifdef CONFIG_MODEM_M6718_SPI_ENABLE_FEATURE_VERIFY_FRAMES
 	{
 		u8 channel;
@@ -444,6 +443,7 @@ static const struct ipc_sm_state *sm_act_tx_wr_dat_aud_exit(u8 event,
 	/* frame is sent, increment link tx counter */
 	context->tx_bytes += context->frame->actual_len;
 #endif
+	ipc_dbg_count_tx_frame(context, context->frame);
 #ifdef CONFIG_MODEM_M6718_SPI_ENABLE_FEATURE_VERIFY_FRAMES
 	{
 		u8 channel;
@@ -695,6 +695,62 @@ static u8 sm_act_rx_wr_dat_aud_enter(u8 event, struct ipc_link_context *context)
 	return IPC_SM_RUN_NONE;
 }
 
+#ifdef CONFIG_MODEM_M6718_SPI_ENABLE_FEATURE_FRAME_AGGREGATION
+/*
+ * Pass up any L2 PDUs following the first one in a received frame, each
+ * starting at the next alignment boundary. A zero L2 header marks the end
+ * of the frame. Returns the number of PDUs found.
+ */
+static int rx_aggregated_msgs(struct ipc_link_context *context, u32 offset)
+{
+	u8            *data = context->frame->data;
+	u32           frame_hdr;
+	unsigned char l2_header;
+	unsigned int  l2_length;
+	int           msgs = 0;
+
+	while (offset + IPC_L2_HDR_SIZE <= context->frame->len) {
+		frame_hdr = *(u32 *)(data + offset);
+		if (frame_hdr == 0)
+			break;
+
+		l2_header = ipc_util_get_l2_channel(frame_hdr);
+		l2_length = ipc_util_get_l2_length(frame_hdr);
+		offset += IPC_L2_HDR_SIZE;
+		if (l2_length > context->frame->len - offset) {
+			dev_err(&context->sdev->dev,
+				"link %d: suspicious aggregated frame: "
+				"L1 len %d L2 len %d at %d\n",
+				context->link->id, context->frame->len,
+				l2_length, offset);
+			break;
+		}
+
+		dev_dbg(&context->sdev->dev,
+			"link %d: L2 PDU decode: header 0x%08x channel %d "
+			"length %d (aggregated)\n",
+			context->link->id, frame_hdr, l2_header, l2_length);
+
+		if (!modem_protocol_channel_is_open(l2_header)) {
+			dev_err(&context->sdev->dev,
+				"link %d error: received frame on invalid "
+				"channel %d, frame discarded\n",
+				context->link->id, l2_header);
+		} else {
+#ifdef CONFIG_MODEM_M6718_SPI_ENABLE_FEATURE_THROUGHPUT_MEASUREMENT
+			if (!ipc_util_channel_is_loopback(l2_header))
+#endif
+				modem_m6718_spi_receive(context->sdev,
+					l2_header, l2_length, data + offset);
+		}
+
+		offset = ALIGN(offset + l2_length, IPC_FRAME_LENGTH_ALIGN);
+		msgs++;
+	}
+	return msgs;
+}
+#endif
+
 static const struct ipc_sm_state *sm_act_rx_wr_dat_exit(u8 event,
 	struct ipc_link_context *context)
 {
@@ -702,6 +758,7 @@ static const struct ipc_sm_state *sm_act_rx_wr_dat_exit(u8 event,
 	unsigned char l2_header;
 	unsigned int  l2_length;
 	u8            *l2_data;
+	int           msgs = 1;
 
 	if (event == IPC_SM_RUN_RESET)
 		return ipc_sm_state(IPC_SM_RESET);
@@ -758,6 +815,14 @@ static const struct ipc_sm_state *sm_act_rx_wr_dat_exit(u8 event,
 				l2_header, l2_length, l2_data);
 	}
 
+#ifdef CONFIG_MODEM_M6718_SPI_ENABLE_FEATURE_FRAME_AGGREGATION
+	if (l2_length <= context->frame->len - IPC_L2_HDR_SIZE)
+		msgs += rx_aggregated_msgs(context,
+			ALIGN(IPC_L2_HDR_SIZE + l2_length,
+				IPC_FRAME_LENGTH_ALIGN));
+#endif
+	ipc_dbg_count_rx_frame(context, context->frame, msgs);
+
 	/* data is copied by L2mux so free the frame here */
 	ipc_queue_delete_frame(context->frame);
 	context->frame = NULL;
@@ -845,6 +910,7 @@ static const struct ipc_sm_state *sm_act_rx_wr_dat_aud_exit(u8 event,
 			"link %d: received dummy frame, discarding\n",
 			context->link->id);
 	}
+	ipc_dbg_count_rx_frame(context, context->frame, frame_hdr != 0);
 
 	/* data is copied by L2mux so free the frame here */
 	ipc_queue_delete_frame(context->frame);
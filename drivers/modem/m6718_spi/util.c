@@ -11,6 +11,7 @@
 #include <linux/gpio.h>
 #include <linux/modem/m6718_spi/modem_driver.h>
 #include "modem_util.h"
+#include "modem_standin.h"
 
 #define MODEM_COMMS_TMO_MS  (5000) /* 0 == no timeout */
 #define SLAVE_STABLE_TMO_MS (1000)
@@ -86,10 +87,18 @@ int ipc_util_int_level_inactive(struct ipc_link_context *context)
 	return !ipc_util_int_level_active(context);
 }
 
+static void ipc_util_set_ss(struct ipc_link_context *context, int level)
+{
+#ifdef CONFIG_MODEM_M6718_SPI_STANDIN
+	ipc_standin_set_ss(context, level);
+#else
+	gpio_set_value(context->link->gpio.ss_pin, level);
+#endif
+}
+
 void ipc_util_deactivate_ss(struct ipc_link_context *context)
 {
-	gpio_set_value(context->link->gpio.ss_pin,
-		ipc_util_ss_level_inactive(context));
+	ipc_util_set_ss(context, ipc_util_ss_level_inactive(context));
 
 	dev_dbg(&context->sdev->dev,
 		"link %d: deactivated SS\n", context->link->id);
@@ -97,8 +106,7 @@ void ipc_util_deactivate_ss(struct ipc_link_context *context)
 
 void ipc_util_activate_ss(struct ipc_link_context *context)
 {
-	gpio_set_value(context->link->gpio.ss_pin,
-		ipc_util_ss_level_active(context));
+	ipc_util_set_ss(context, ipc_util_ss_level_active(context));
 
 	dev_dbg(&context->sdev->dev,
 		"link %d: activated SS\n", context->link->id);
@@ -106,8 +114,7 @@ void ipc_util_activate_ss(struct ipc_link_context *context)
 
 void ipc_util_activate_ss_with_tmo(struct ipc_link_context *context)
 {
-	gpio_set_value(context->link->gpio.ss_pin,
-		ipc_util_ss_level_active(context));
+	ipc_util_set_ss(context, ipc_util_ss_level_active(context));
 
 #if MODEM_COMMS_TMO_MS == 0
 	dev_dbg(&context->sdev->dev,
@@ -123,9 +130,18 @@ void ipc_util_activate_ss_with_tmo(struct ipc_link_context *context)
 #endif
 }
 
+static int ipc_util_get_int(struct ipc_link_context *context)
+{
+#ifdef CONFIG_MODEM_M6718_SPI_STANDIN
+	return ipc_standin_get_int(context);
+#else
+	return gpio_get_value(context->link->gpio.int_pin);
+#endif
+}
+
 bool ipc_util_int_is_active(struct ipc_link_context *context)
 {
-	return gpio_get_value(context->link->gpio.int_pin) ==
+	return ipc_util_get_int(context) ==
 		ipc_util_int_level_active(context);
 }
 
@@ -182,6 +198,15 @@ void ipc_util_spi_message_init(struct ipc_link_context *link_context,
 	spi_message_add_tail(tfr, msg);
 }
 
+#ifdef CONFIG_MODEM_M6718_SPI_STANDIN
+bool ipc_util_link_gpio_request(struct ipc_link_context *context,
+	irqreturn_t (*irqhnd)(int, void*))
+{
+	/* no pins to reserve, the stand-in calls irqhnd itself */
+	ipc_standin_set_irq(context, irqhnd);
+	return true;
+}
+#else
 bool ipc_util_link_gpio_request(struct ipc_link_context *context,
 	irqreturn_t (*irqhnd)(int, void*))
 {
@@ -221,6 +246,7 @@ bool ipc_util_link_gpio_request(struct ipc_link_context *context,
 	}
 	return true;
 }
+#endif
 
 bool ipc_util_link_gpio_config(struct ipc_link_context *context)
 {
@@ -233,6 +259,7 @@ bool ipc_util_link_gpio_config(struct ipc_link_context *context)
 	dev_dbg(&sdev->dev, "link %d: configuring GPIO\n", link->id);
 
 	ipc_util_deactivate_ss(context);
+#ifndef CONFIG_MODEM_M6718_SPI_STANDIN
 	gpio_direction_input(link->gpio.int_pin);
 	if (enable_irq_wake(GPIO_TO_IRQ(link->gpio.int_pin)) < 0) {
 		dev_err(&sdev->dev,
@@ -240,8 +267,9 @@ bool ipc_util_link_gpio_config(struct ipc_link_context *context)
 			link->id);
 		return false;
 	}
+#endif
 
-	atomic_set(&context->state_int, gpio_get_value(link->gpio.int_pin));
+	atomic_set(&context->state_int, ipc_util_get_int(context));
 	atomic_set(&context->gpio_configured, 1);
 	return true;
 }
@@ -257,11 +285,13 @@ bool ipc_util_link_gpio_unconfig(struct ipc_link_context *context)
 	dev_dbg(&sdev->dev, "link %d: un-configuring GPIO\n", link->id);
 
 	/* SS: output anyway, just make sure it is low */
-	gpio_set_value(link->gpio.ss_pin, 0);
+	ipc_util_set_ss(context, 0);
 
+#ifndef CONFIG_MODEM_M6718_SPI_STANDIN
 	/* INT: disable system-wake, reconfigure as output-low */
 	disable_irq_wake(GPIO_TO_IRQ(link->gpio.int_pin));
 	gpio_direction_output(link->gpio.int_pin, 0);
+#endif
 	atomic_set(&context->gpio_configured, 0);
 	return true;
 }
@@ -58,10 +58,8 @@ struct tasklet_struct phonet_rcv_tasklet;
 static int audio_receive(struct shrm_dev *shrm, void *data,
 					u32 n_bytes, u8 l2_header)
 {
-	u32 size = 0;
 	int ret = 0;
 	int idx;
-	u8 *psrc;
 	struct message_queue *q;
 	struct isadev_context *audiodev;
 
@@ -73,21 +71,8 @@ static int audio_receive(struct shrm_dev *shrm, void *data,
 	}
 	audiodev = &shrm->isa_context->isadev[idx];
 	q = &audiodev->dl_queue;
-	spin_lock(&q->update_lock);
-	/* Memcopy RX data first */
-	if ((q->writeptr+n_bytes) >= q->size) {
-		psrc = (u8 *)data;
-		size = (q->size-q->writeptr);
-		/* Copy First Part of msg */
-		memcpy((q->fifo_base+q->writeptr), psrc, size);
-		psrc += size;
-		/* Copy Second Part of msg at the top of fifo */
-		memcpy(q->fifo_base, psrc, (n_bytes-size));
-	} else {
-		memcpy((q->fifo_base+q->writeptr), data, n_bytes);
-	}
-	ret = add_msg_to_queue(q, n_bytes);
-	spin_unlock(&q->update_lock);
+	/* Copy RX data to the queue */
+	ret = add_msg_to_queue(q, data, n_bytes);
 	if (ret < 0)
 		dev_err(shrm->dev, "Adding a msg to message queue failed");
 	dev_dbg(shrm->dev, "%s OUT\n", __func__);
@@ -108,10 +93,8 @@ static int audio_receive(struct shrm_dev *shrm, void *data,
 static int common_receive(struct shrm_dev *shrm, void *data,
 					u32 n_bytes, u8 l2_header)
 {
-	u32 size = 0;
 	int ret = 0;
 	int idx;
-	u8 *psrc;
 	struct message_queue *q;
 	struct isadev_context *isa_dev;
 
@@ -123,22 +106,8 @@ static int common_receive(struct shrm_dev *shrm, void *data,
 	}
 	isa_dev = &shrm->isa_context->isadev[idx];
 	q = &isa_dev->dl_queue;
-	spin_lock(&q->update_lock);
-	/* Memcopy RX data first */
-	if ((q->writeptr+n_bytes) >= q->size) {
-		dev_dbg(shrm->dev, "Inside Loop Back\n");
-		psrc = (u8 *)data;
-		size = (q->size-q->writeptr);
-		/* Copy First Part of msg */
-		memcpy((q->fifo_base+q->writeptr), psrc, size);
-		psrc += size;
-		/* Copy Second Part of msg at the top of fifo */
-		memcpy(q->fifo_base, psrc, (n_bytes-size));
-	} else {
-		memcpy((q->fifo_base+q->writeptr), data, n_bytes);
-	}
-	ret = add_msg_to_queue(q, n_bytes);
-	spin_unlock(&q->update_lock);
+	/* Copy RX data to the queue */
+	ret = add_msg_to_queue(q, data, n_bytes);
 	if (ret < 0) {
 		dev_err(shrm->dev, "Adding a msg to message queue failed");
 		return ret;
@@ -218,6 +187,10 @@ static int __init shm_initialise_irq(struct shrm_dev *shrm)
 		return err;
 	}
 
+	/* The stand-in calls the handlers itself */
+	if (IS_ENABLED(CONFIG_U8500_SHRM_STANDIN))
+		return 0;
+
 	err = request_irq(shrm->ca_wake_irq,
 			ca_wake_irq_handler, IRQF_TRIGGER_RISING,
 				 "ca_wake-up", shrm);
@@ -281,6 +254,9 @@ irq_err1:
 
 static void free_shm_irq(struct shrm_dev *shrm)
 {
+	if (IS_ENABLED(CONFIG_U8500_SHRM_STANDIN))
+		return;
+
 	free_irq(shrm->ca_wake_irq, shrm);
 	free_irq(shrm->ac_read_notif_0_irq, shrm);
 	free_irq(shrm->ac_read_notif_1_irq, shrm);
@@ -317,34 +293,27 @@ void do_phonet_rcv_tasklet(unsigned long unused)
 	dev_dbg(shrm->dev, "%s OUT\n", __func__);
 }
 
-static int shrm_probe(struct platform_device *pdev)
+#ifdef CONFIG_U8500_SHRM_STANDIN
+static int shrm_map(struct platform_device *pdev, struct shrm_dev *shrm)
 {
-	int err = 0;
-	struct resource *res;
-	struct shrm_dev *shrm = NULL;
-
-	shrm = kzalloc(sizeof(struct shrm_dev), GFP_KERNEL);
-	if (shrm == NULL) {
-		dev_err(&pdev->dev,
-			"Could not allocate memory for struct shm_dev\n");
-		return -ENOMEM;
-	}
+	return shrm_standin_map(shrm);
+}
 
-	shrm->dev = &pdev->dev;
-	shrm->modem = modem_get(shrm->dev, "u8500-shrm-modem");
-	if (shrm->modem == NULL) {
-		dev_err(shrm->dev, " Could not retrieve the modem.\n");
-		err = -ENODEV;
-		goto rollback_intr;
-	}
+static void shrm_unmap(struct shrm_dev *shrm)
+{
+	shrm_standin_unmap(shrm);
+}
+#else
+static int shrm_map(struct platform_device *pdev, struct shrm_dev *shrm)
+{
+	struct resource *res;
+	int err;
 
-	/* initialise the SHM */
 	res = platform_get_resource(pdev, IORESOURCE_IRQ, 0);
 	if (!res) {
 		dev_err(shrm->dev,
 				"Unable to map Ca Wake up interrupt\n");
-		err = -EBUSY;
-		goto rollback_intr;
+		return -EBUSY;
 	}
 	shrm->ca_wake_irq = res->start;
 	res = platform_get_resource(pdev, IORESOURCE_IRQ, 1);
@@ -352,8 +321,7 @@ static int shrm_probe(struct platform_device *pdev)
 	if (!res) {
 		dev_err(shrm->dev,
 			"Unable to map APE_Read_notif_common IRQ base\n");
-		err = -EBUSY;
-		goto rollback_intr;
+		return -EBUSY;
 	}
 	shrm->ac_read_notif_0_irq = res->start;
 	res = platform_get_resource(pdev, IORESOURCE_IRQ, 2);
@@ -361,8 +329,7 @@ static int shrm_probe(struct platform_device *pdev)
 	if (!res) {
 		dev_err(shrm->dev,
 			"Unable to map APE_Read_notif_audio IRQ base\n");
-		err = -EBUSY;
-		goto rollback_intr;
+		return -EBUSY;
 	}
 	shrm->ac_read_notif_1_irq = res->start;
 	res = platform_get_resource(pdev, IORESOURCE_IRQ, 3);
@@ -370,8 +337,7 @@ static int shrm_probe(struct platform_device *pdev)
 	if (!res) {
 		dev_err(shrm->dev,
 			"Unable to map Cmt_msg_pending_notif_common IRQbase\n");
-		err = -EBUSY;
-		goto rollback_intr;
+		return -EBUSY;
 	}
 	shrm->ca_msg_pending_notif_0_irq = res->start;
 	res = platform_get_resource(pdev, IORESOURCE_IRQ, 4);
@@ -379,8 +345,7 @@ static int shrm_probe(struct platform_device *pdev)
 	if (!res) {
 		dev_err(shrm->dev,
 			"Unable to map Cmt_msg_pending_notif_audio IRQ base\n");
-		err = -EBUSY;
-		goto rollback_intr;
+		return -EBUSY;
 	}
 	shrm->ca_msg_pending_notif_1_irq = res->start;
 	res = platform_get_resource(pdev, IORESOURCE_MEM, 0);
@@ -388,15 +353,13 @@ static int shrm_probe(struct platform_device *pdev)
 	if (!res) {
 		dev_err(shrm->dev,
 				"Could not get SHM IO memory information\n");
-		err = -ENODEV;
-		goto rollback_intr;
+		return -ENODEV;
 	}
 	shrm->intr_base = (void __iomem *)ioremap_nocache(res->start,
 					res->end - res->start + 1);
 	if (!(shrm->intr_base)) {
 		dev_err(shrm->dev, "Unable to map register base\n");
-		err = -EBUSY;
-		goto rollback_intr;
+		return -EBUSY;
 	}
 	shrm->ape_common_fifo_base_phy =
 			(u32 *)U8500_SHM_FIFO_APE_COMMON_BASE;
@@ -512,33 +475,9 @@ static int shrm_probe(struct platform_device *pdev)
 		goto rollback_map;
 	}
 
-	if (isa_init(shrm) != 0) {
-		dev_err(shrm->dev, "Driver Initialization Error\n");
-		err = -EBUSY;
-	}
-	/* install handlers and tasklets */
-	if (shm_initialise_irq(shrm)) {
-		dev_err(shrm->dev,
-				"shm error in interrupt registration\n");
-		goto rollback_irq;
-	}
-#ifdef CONFIG_HIGH_RES_TIMERS
-	hrtimer_init(&timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
-	timer.function = callback;
-	hrtimer_start(&timer, ktime_set(0, 2*NSEC_PER_MSEC), HRTIMER_MODE_REL);
-#endif
-	err = shrm_register_netdev(shrm);
-	if (err < 0)
-		goto rollback_irq;
-
-	tasklet_init(&phonet_rcv_tasklet, do_phonet_rcv_tasklet, 0);
-	phonet_rcv_tasklet.data = (unsigned long)shrm;
 
-	platform_set_drvdata(pdev, shrm);
+	return 0;
 
-	return err;
-rollback_irq:
-	free_shm_irq(shrm);
 rollback_map:
 	iounmap(shrm->ac_common_shared_wptr);
 	iounmap(shrm->ac_common_shared_rptr);
@@ -558,16 +497,11 @@ rollback_cmt_common_fifo_base:
 	iounmap(shrm->ape_common_fifo_base);
 rollback_ape_common_fifo_base:
 	iounmap(shrm->intr_base);
-rollback_intr:
-	kfree(shrm);
 	return err;
 }
 
-static int __exit shrm_remove(struct platform_device *pdev)
+static void shrm_unmap(struct shrm_dev *shrm)
 {
-	struct shrm_dev *shrm = platform_get_drvdata(pdev);
-
-	free_shm_irq(shrm);
 	iounmap(shrm->intr_base);
 	iounmap(shrm->ape_common_fifo_base);
 	iounmap(shrm->cmt_common_fifo_base);
@@ -581,6 +515,76 @@ static int __exit shrm_remove(struct platform_device *pdev)
 	iounmap(shrm->ac_audio_shared_rptr);
 	iounmap(shrm->ca_audio_shared_wptr);
 	iounmap(shrm->ca_audio_shared_rptr);
+}
+#endif
+
+static int shrm_probe(struct platform_device *pdev)
+{
+	int err = 0;
+	struct shrm_dev *shrm = NULL;
+
+	shrm = kzalloc(sizeof(struct shrm_dev), GFP_KERNEL);
+	if (shrm == NULL) {
+		dev_err(&pdev->dev,
+			"Could not allocate memory for struct shm_dev\n");
+		return -ENOMEM;
+	}
+
+	shrm->dev = &pdev->dev;
+
+	err = shrm_map(pdev, shrm);
+	if (err)
+		goto rollback_intr;
+
+	shrm->modem = modem_get(shrm->dev, "u8500-shrm-modem");
+	if (shrm->modem == NULL) {
+		dev_err(shrm->dev, " Could not retrieve the modem.\n");
+		err = -ENODEV;
+		goto rollback_map;
+	}
+
+	if (isa_init(shrm) != 0) {
+		dev_err(shrm->dev, "Driver Initialization Error\n");
+		err = -EBUSY;
+	}
+	/* install handlers and tasklets */
+	if (shm_initialise_irq(shrm)) {
+		dev_err(shrm->dev,
+				"shm error in interrupt registration\n");
+		goto rollback_irq;
+	}
+#ifdef CONFIG_HIGH_RES_TIMERS
+	hrtimer_init(&timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	timer.function = callback;
+	hrtimer_start(&timer, ktime_set(0, 2*NSEC_PER_MSEC), HRTIMER_MODE_REL);
+#endif
+	err = shrm_register_netdev(shrm);
+	if (err < 0)
+		goto rollback_irq;
+
+	tasklet_init(&phonet_rcv_tasklet, do_phonet_rcv_tasklet, 0);
+	phonet_rcv_tasklet.data = (unsigned long)shrm;
+
+	platform_set_drvdata(pdev, shrm);
+
+	shrm_standin_start(shrm);
+
+	return err;
+rollback_irq:
+	free_shm_irq(shrm);
+rollback_map:
+	shrm_unmap(shrm);
+rollback_intr:
+	kfree(shrm);
+	return err;
+}
+
+static int __exit shrm_remove(struct platform_device *pdev)
+{
+	struct shrm_dev *shrm = platform_get_drvdata(pdev);
+
+	free_shm_irq(shrm);
+	shrm_unmap(shrm);
 	shrm_unregister_netdev(shrm);
 	isa_exit(shrm);
 	kfree(shrm);
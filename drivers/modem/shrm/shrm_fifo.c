@@ -12,6 +12,7 @@
 #include <linux/modem/shrm/shrm_private.h>
 #include <linux/modem/shrm/shrm_net.h>
 #include <linux/mfd/dbx500-prcmu.h>
+#include <linux/skbuff.h>
 
 #define L1_BOOT_INFO_REQ	1
 #define L1_BOOT_INFO_RESP	2
@@ -155,30 +156,40 @@ void write_boot_info_resp(struct shrm_dev *shrm, u32 config,
 	spin_unlock_bh(&fifo->fifo_update_lock);
 }
 
+typedef void (*shm_fifo_copy_fn)(void *dst, const void *src, u32 offset,
+				 u32 len);
+
+static void shm_fifo_copy_buf(void *dst, const void *src, u32 offset, u32 len)
+{
+	memcpy(dst, (const u8 *)src + offset, len);
+}
+
+static void shm_fifo_copy_skb(void *dst, const void *src, u32 offset, u32 len)
+{
+	skb_copy_bits(src, offset, dst, len);
+}
+
 /**
- * shm_write_msg_to_fifo() - write message to FIFO
+ * __shm_write_msg_to_fifo() - write one L2 message to FIFO
  * @shrm:	pointer to shrm device information structure
  * @channel:	audio or common channel
  * @l2header:	L2 header or device ID
- * @addr:	pointer to write buffer address
- * @length:	length of mst to write
+ * @src:	message source, passed to @copy
+ * @length:	length of msg to write
+ * @copy:	copies a byte range of @src into the FIFO
  *
- * Function Which Writes the data into Fifo in IPC zone
- * It is called from shm_write_msg. This function will copy the msg
- * from the kernel buffer to FIFO. There are 4 kernel buffers from where
- * the data is to copied to FIFO one for each of the messages ISI, RPC,
- * AUDIO and SECURITY. ISI, RPC and SECURITY messages are pushed to FIFO
- * in commmon channel and AUDIO message is pushed onto audio channel FIFO.
+ * Builds the L1 and L2 headers in place and copies the payload straight
+ * from @src into the FIFO, in two pieces if it wraps around the end.
  */
-int shm_write_msg_to_fifo(struct shrm_dev *shrm, u8 channel,
-				u8 l2header, void *addr, u32 length)
+static int __shm_write_msg_to_fifo(struct shrm_dev *shrm, u8 channel,
+				u8 l2header, const void *src, u32 length,
+				shm_fifo_copy_fn copy)
 {
 	struct fifo_write_params *fifo = NULL;
 	u32 l1_header = 0, l2_header = 0;
 	u32 requiredsize;
-	u32 size = 0;
-	u32 *msg;
-	u8 *src;
+	u32 wptr, size;
+	u32 *base;
 
 	if (channel == COMMON_CHANNEL)
 		fifo = &ape_shm_fifo_0;
@@ -246,135 +257,89 @@ int shm_write_msg_to_fifo(struct shrm_dev *shrm, u8 channel,
 	l2_header = ((l2header << L2_HEADER_OFFSET) |
 					((length) & MASK_0_39_BIT));
 	spin_lock_bh(&fifo->fifo_update_lock);
-	/* Check Local Rptr is less than or equal to Local WPtr */
-	if (fifo->writer_local_rptr <= fifo->writer_local_wptr) {
-		msg = (u32 *)
-			(fifo->fifo_virtual_addr+fifo->writer_local_wptr);
-
-		/* check enough place bewteen writer_local_wptr & end of FIFO */
-		if ((fifo->end_addr_fifo-fifo->writer_local_wptr) >=
-							requiredsize) {
-			/* Add L1 header and L2 header */
-			*msg = l1_header;
-			msg++;
-			*msg = l2_header;
-			msg++;
+	base = fifo->fifo_virtual_addr;
+	wptr = fifo->writer_local_wptr;
 
-			/* copy the l2 message in 1 memcpy */
-			memcpy((void *)msg, addr, length);
-			/* UpdateWptr */
-			fifo->writer_local_wptr += requiredsize;
-			fifo->availablesize -= requiredsize;
-			fifo->writer_local_wptr %= fifo->end_addr_fifo;
-		} else {
-			/*
-			 * message is split between and of FIFO and beg of FIFO
-			 * copy first part from writer_local_wptr to end of FIFO
-			 */
-			size = fifo->end_addr_fifo-fifo->writer_local_wptr;
-
-			if (size == 1) {
-				/* Add L1 header */
-				*msg = l1_header;
-				msg++;
-				/* UpdateWptr */
-				fifo->writer_local_wptr = 0;
-				fifo->availablesize -= size;
-				/*
-				 * copy second part from beg of FIFO
-				 * with remaining part of msg
-				 */
-				msg =	(u32 *)
-						fifo->fifo_virtual_addr;
-				*msg = l2_header;
-				msg++;
-
-				/* copy the l3 message in 1 memcpy */
-				memcpy((void *)msg, addr, length);
-				/* UpdateWptr */
-				fifo->writer_local_wptr +=
-							requiredsize-size;
-				fifo->availablesize -=
-							(requiredsize-size);
-			} else if (size == 2) {
-				/* Add L1 header and L2 header */
-				*msg = l1_header;
-				msg++;
-				*msg = l2_header;
-				msg++;
-
-				/* UpdateWptr */
-				fifo->writer_local_wptr = 0;
-				fifo->availablesize -= size;
-
-				/*
-				 * copy second part from beg of FIFO
-				 * with remaining part of msg
-				 */
-				msg =	(u32 *)
-						fifo->fifo_virtual_addr;
-				/* copy the l3 message in 1 memcpy */
-				memcpy((void *)msg, addr, length);
-
-				/* UpdateWptr */
-				fifo->writer_local_wptr +=
-							requiredsize-size;
-				fifo->availablesize -=
-							(requiredsize-size);
-			} else {
-				/* Add L1 header and L2 header */
-				*msg = l1_header;
-				msg++;
-				*msg = l2_header;
-				msg++;
-
-				/* copy the l2 message in 1 memcpy */
-				memcpy((void *)msg, addr, (size-2)*4);
-
-
-				/* UpdateWptr */
-				fifo->writer_local_wptr = 0;
-				fifo->availablesize -= size;
-
-				/*
-				 * copy second part from beg of FIFO
-				 * with remaining part of msg
-				 */
-				msg = (u32 *)fifo->fifo_virtual_addr;
-				src = (u8 *)addr+((size - 2) * 4);
-				memcpy((void *)msg, src,
-						(length-((size - 2) * 4)));
+	/* Add L1 header and L2 header, either may wrap to the beginning */
+	base[wptr] = l1_header;
+	wptr = (wptr + 1) % fifo->end_addr_fifo;
+	base[wptr] = l2_header;
+	wptr = (wptr + 1) % fifo->end_addr_fifo;
 
-				/* UpdateWptr */
-				fifo->writer_local_wptr +=
-							requiredsize-size;
-				fifo->availablesize -=
-							(requiredsize-size);
-			}
+	/*
+	 * copy the l2 message, split between end and beginning of FIFO
+	 * if it does not fit before the end
+	 */
+	size = min((fifo->end_addr_fifo - wptr) * 4, length);
+	copy(base + wptr, src, 0, size);
+	if (size < length)
+		copy(base, src, size, length - size);
+
+	/* UpdateWptr */
+	fifo->writer_local_wptr = (fifo->writer_local_wptr + requiredsize) %
+							fifo->end_addr_fifo;
+	fifo->availablesize -= requiredsize;
+	spin_unlock_bh(&fifo->fifo_update_lock);
+	return length;
+}
 
-		}
-	} else {
-		/* writer_local_rptr > writer_local_wptr */
-		msg = (u32 *)
-			(fifo->fifo_virtual_addr+fifo->writer_local_wptr);
-		/* Add L1 header and L2 header */
-		*msg = l1_header;
-		msg++;
-		*msg = l2_header;
-		msg++;
-		/*
-		 * copy message possbile between writer_local_wptr up
-		 * to writer_local_rptr copy the l3 message in 1 memcpy
-		 */
-		memcpy((void *)msg, addr, length);
+/**
+ * shm_write_msg_to_fifo() - write message to FIFO
+ * @shrm:	pointer to shrm device information structure
+ * @channel:	audio or common channel
+ * @l2header:	L2 header or device ID
+ * @addr:	pointer to write buffer address
+ * @length:	length of mst to write
+ *
+ * Function Which Writes the data into Fifo in IPC zone
+ * It is called from shm_write_msg. This function will copy the msg
+ * from the kernel buffer to FIFO. There are 4 kernel buffers from where
+ * the data is to copied to FIFO one for each of the messages ISI, RPC,
+ * AUDIO and SECURITY. ISI, RPC and SECURITY messages are pushed to FIFO
+ * in commmon channel and AUDIO message is pushed onto audio channel FIFO.
+ */
+int shm_write_msg_to_fifo(struct shrm_dev *shrm, u8 channel,
+				u8 l2header, void *addr, u32 length)
+{
+	return __shm_write_msg_to_fifo(shrm, channel, l2header, addr, length,
+				       shm_fifo_copy_buf);
+}
+
+/**
+ * shm_write_skb_to_fifo() - write a socket buffer to FIFO
+ * @shrm:	pointer to shrm device information structure
+ * @channel:	audio or common channel
+ * @l2header:	L2 header or device ID
+ * @skb:	the message, may be non-linear
+ *
+ * Like shm_write_msg_to_fifo(), but gathers the message from the skb
+ * fragments directly into the FIFO instead of needing a linear copy.
+ */
+int shm_write_skb_to_fifo(struct shrm_dev *shrm, u8 channel,
+				u8 l2header, struct sk_buff *skb)
+{
+	return __shm_write_msg_to_fifo(shrm, channel, l2header, skb,
+				       skb->len, shm_fifo_copy_skb);
+}
+
+/**
+ * peek_l2msg_common() - look at the next message on the common channel
+ * @len:	message length
+ *
+ * Returns the l2 header type of the message read_one_l2msg_common() will
+ * return next, without consuming it. Only valid while
+ * read_remaining_messages_common() is true.
+ */
+u8 peek_l2msg_common(u32 *len)
+{
+	struct fifo_read_params *fifo = &cmt_shm_fifo_0;
+	u32 l2_header;
 
-		/* UpdateWptr */
-		fifo->writer_local_wptr += requiredsize;
-		fifo->availablesize -= requiredsize;
+	l2_header = fifo->fifo_virtual_addr[(fifo->reader_local_rptr + 1) %
+					    fifo->end_addr_fifo];
+	*len = l2_header & MASK_0_39_BIT;
 
-	}
-	spin_unlock_bh(&fifo->fifo_update_lock);
-	return length;
+	return (l2_header >> L2_HEADER_OFFSET) & MASK_0_15_BIT;
 }
 
 /**
@@ -11,6 +11,8 @@
 #include <linux/delay.h>
 #include <linux/netlink.h>
 #include <linux/kthread.h>
+#include <linux/moduleparam.h>
+#include <linux/netdevice.h>
 #include <linux/modem/shrm/shrm.h>
 #include <linux/modem/shrm/shrm_driver.h>
 #include <linux/modem/shrm/shrm_private.h>
@@ -40,8 +42,18 @@ static u8 recieve_audio_msg[8*1024];
 static received_msg_handler rx_common_handler;
 static received_msg_handler rx_audio_handler;
 static struct hrtimer timer;
+static struct hrtimer doorbell_timer;
 struct sock *shrm_nl_sk;
 
+/*
+ * Common channel messages written within this many microseconds of the
+ * first unread one share its message pending notification.
+ */
+static unsigned int doorbell_delay_us;
+module_param(doorbell_delay_us, uint, 0644);
+MODULE_PARM_DESC(doorbell_delay_us, "Max delay for coalescing common "
+		 "channel message pending notifications, 0 = none (default)");
+
 static char shrm_common_tx_state = SHRM_SLEEP_STATE;
 static char shrm_common_rx_state = SHRM_SLEEP_STATE;
 static char shrm_audio_tx_state = SHRM_SLEEP_STATE;
@@ -92,10 +104,31 @@ static void shm_ac_wake_req_work(struct kthread_work *work)
 	mutex_unlock(&ac_state_mutex);
 }
 
+/* Raise a GOP output towards the CMT */
+static inline void shrm_gop_set(struct shrm_dev *shrm, u32 bit)
+{
+#ifdef CONFIG_U8500_SHRM_STANDIN
+	shrm_standin_gop_set(shrm, bit);
+#else
+	writel(1 << bit, shrm->intr_base + GOP_SET_REGISTER_BASE);
+#endif
+}
+
+/* Acknowledge a GOP input from the CMT */
+static inline void shrm_gop_clear(struct shrm_dev *shrm, u32 bit)
+{
+#ifndef CONFIG_U8500_SHRM_STANDIN
+	writel(1 << bit, shrm->intr_base + GOP_CLEAR_REGISTER_BASE);
+#endif
+}
+
 static u32 get_host_accessport_val(void)
 {
 	u32 prcm_hostaccess;
 
+	if (IS_ENABLED(CONFIG_U8500_SHRM_STANDIN))
+		return 1;
+
 	prcm_hostaccess = prcmu_read(PRCM_HOSTACCESS_REQ);
 	wmb();
 	prcm_hostaccess = prcm_hostaccess & 0x01;
@@ -459,8 +492,7 @@ void shm_ca_sleep_req_work(struct kthread_work *work)
 		return;
 	}
 
-	writel((1<<GOP_CA_WAKE_ACK_BIT),
-		shm_dev->intr_base + GOP_SET_REGISTER_BASE);
+	shrm_gop_set(shm_dev, GOP_CA_WAKE_ACK_BIT);
 
 	hrtimer_start(&timer, ktime_set(0, 10*NSEC_PER_MSEC),
 			HRTIMER_MODE_REL);
@@ -494,8 +526,7 @@ void shm_ca_wake_req_work(struct kthread_work *work)
 		return;
 	}
 
-	writel((1<<GOP_CA_WAKE_ACK_BIT),
-			shm_dev->intr_base + GOP_SET_REGISTER_BASE);
+	shrm_gop_set(shm_dev, GOP_CA_WAKE_ACK_BIT);
 }
 #ifdef CONFIG_U8500_SHRM_MODEM_SILENT_RESET
 static int shrm_modem_reset_sequence(void)
@@ -516,8 +547,12 @@ static int shrm_modem_reset_sequence(void)
 	queue_kthread_work(&shm_dev->shm_ac_wake_kw,
 			&shm_dev->shm_ac_wake_req);
 
-	/* reset char device queues */
+	/* reset char device queues, with their receive handlers stopped */
+	tasklet_disable(&shm_ca_0_tasklet);
+	tasklet_disable(&shm_ca_1_tasklet);
 	shrm_char_reset_queues(shm_dev);
+	tasklet_enable(&shm_ca_1_tasklet);
+	tasklet_enable(&shm_ca_0_tasklet);
 
 	/* reset protocol states */
 	shrm_common_tx_state = SHRM_SLEEP_STATE;
@@ -649,8 +684,7 @@ static void send_ac_msg_pend_notify_0_work(struct kthread_work *work)
 	}
 
 	/* Trigger AcMsgPendingNotification to CMU */
-	writel((1<<GOP_COMMON_AC_MSG_PENDING_NOTIFICATION_BIT),
-			shrm->intr_base + GOP_SET_REGISTER_BASE);
+	shrm_gop_set(shrm, GOP_COMMON_AC_MSG_PENDING_NOTIFICATION_BIT);
 
 	if (shrm_common_tx_state == SHRM_PTR_FREE)
 		shrm_common_tx_state = SHRM_PTR_BUSY;
@@ -688,8 +722,7 @@ static void send_ac_msg_pend_notify_1_work(struct kthread_work *work)
 	}
 
 	/* Trigger AcMsgPendingNotification to CMU */
-	writel((1<<GOP_AUDIO_AC_MSG_PENDING_NOTIFICATION_BIT),
-			shrm->intr_base + GOP_SET_REGISTER_BASE);
+	shrm_gop_set(shrm, GOP_AUDIO_AC_MSG_PENDING_NOTIFICATION_BIT);
 
 	if (shrm_audio_tx_state == SHRM_PTR_FREE)
 		shrm_audio_tx_state = SHRM_PTR_BUSY;
@@ -697,6 +730,14 @@ static void send_ac_msg_pend_notify_1_work(struct kthread_work *work)
 	dev_dbg(shrm->dev, "%s OUT\n", __func__);
 }
 
+static enum hrtimer_restart doorbell_callback(struct hrtimer *timer)
+{
+	queue_kthread_work(&shm_dev->shm_common_ch_wr_kw,
+			&shm_dev->send_ac_msg_pend_notify_0);
+
+	return HRTIMER_NORESTART;
+}
+
 void shm_nl_receive(struct sk_buff *skb)
 {
 	struct nlmsghdr *nlh = NULL;
@@ -740,6 +781,8 @@ int shrm_protocol_init(struct shrm_dev *shrm,
 
 	hrtimer_init(&timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
 	timer.function = callback;
+	hrtimer_init(&doorbell_timer, CLOCK_MONOTONIC, HRTIMER_MODE_REL);
+	doorbell_timer.function = doorbell_callback;
 
 	init_kthread_worker(&shrm->shm_common_ch_wr_kw);
 	shrm->shm_common_ch_wr_kw_task = kthread_run(kthread_worker_fn,
@@ -867,6 +910,7 @@ free_kw1:
 
 void shrm_protocol_deinit(struct shrm_dev *shrm)
 {
+	hrtimer_cancel(&doorbell_timer);
 	free_irq(IRQ_PRCMU_CA_SLEEP, NULL);
 	free_irq(IRQ_PRCMU_CA_WAKE, NULL);
 	free_irq(IRQ_PRCMU_MODEM_SW_RESET_REQ, NULL);
@@ -901,12 +945,10 @@ irqreturn_t ca_wake_irq_handler(int irq, void *ctrlr)
 	dev_dbg(shrm->dev, "Inside ca_wake_irq_handler\n");
 
 	/* Clear the interrupt */
-	writel((1 << GOP_CA_WAKE_REQ_BIT),
-				shrm->intr_base + GOP_CLEAR_REGISTER_BASE);
+	shrm_gop_clear(shrm, GOP_CA_WAKE_REQ_BIT);
 
 	/* send ca_wake_ack_interrupt to CMU */
-	writel((1 << GOP_CA_WAKE_ACK_BIT),
-		shrm->intr_base + GOP_SET_REGISTER_BASE);
+	shrm_gop_set(shrm, GOP_CA_WAKE_ACK_BIT);
 
 
 	dev_dbg(shrm->dev, "%s OUT\n", __func__);
@@ -936,8 +978,7 @@ irqreturn_t ac_read_notif_0_irq_handler(int irq, void *ctrlr)
 	}
 
 	/* Clear the interrupt */
-	writel((1 << GOP_COMMON_AC_READ_NOTIFICATION_BIT),
-			shrm->intr_base + GOP_CLEAR_REGISTER_BASE);
+	shrm_gop_clear(shrm, GOP_COMMON_AC_READ_NOTIFICATION_BIT);
 
 	dev_dbg(shrm->dev, "%s OUT\n", __func__);
 	return IRQ_HANDLED;
@@ -965,8 +1006,7 @@ irqreturn_t ac_read_notif_1_irq_handler(int irq, void *ctrlr)
 	}
 
 	/* Clear the interrupt */
-	writel((1 << GOP_AUDIO_AC_READ_NOTIFICATION_BIT),
-			shrm->intr_base + GOP_CLEAR_REGISTER_BASE);
+	shrm_gop_clear(shrm, GOP_AUDIO_AC_READ_NOTIFICATION_BIT);
 
 	dev_dbg(shrm->dev, "%s OUT\n", __func__);
 	return IRQ_HANDLED;
@@ -993,8 +1033,7 @@ irqreturn_t ca_msg_pending_notif_0_irq_handler(int irq, void *ctrlr)
 	}
 
 	/* Clear the interrupt */
-	writel((1 << GOP_COMMON_CA_MSG_PENDING_NOTIFICATION_BIT),
-			shrm->intr_base + GOP_CLEAR_REGISTER_BASE);
+	shrm_gop_clear(shrm, GOP_COMMON_CA_MSG_PENDING_NOTIFICATION_BIT);
 
 	dev_dbg(shrm->dev, "%s OUT\n", __func__);
 	return IRQ_HANDLED;
@@ -1021,8 +1060,7 @@ irqreturn_t ca_msg_pending_notif_1_irq_handler(int irq, void *ctrlr)
 	}
 
 	/* Clear the interrupt */
-	writel((1<<GOP_AUDIO_CA_MSG_PENDING_NOTIFICATION_BIT),
-			shrm->intr_base+GOP_CLEAR_REGISTER_BASE);
+	shrm_gop_clear(shrm, GOP_AUDIO_CA_MSG_PENDING_NOTIFICATION_BIT);
 
 	dev_dbg(shrm->dev, "%s OUT\n", __func__);
 	return IRQ_HANDLED;
@@ -1030,32 +1068,20 @@ irqreturn_t ca_msg_pending_notif_1_irq_handler(int irq, void *ctrlr)
 }
 
 /**
- * shm_write_msg() - write message to shared memory
+ * shm_write_msg_channel() - find the channel for an L2 header
  * @shrm:	pointer to the shrm device information structure
  * @l2_header:	L2 header
- * @addr:	pointer to the message
- * @length:	length of the message to be written
  *
- * This function is called from net or char interface driver write operation.
- * Prior to calling this function the message is copied from the user space
- * buffer to the kernel buffer. This function based on the l2 header routes
- * the message to the respective channel and FIFO. Then makes a call to the
- * fifo write function where the message is written to the physical device.
+ * Returns the FIFO channel the message goes to, and marks the channel as
+ * having data to send.
  */
-int shm_write_msg(struct shrm_dev *shrm, u8 l2_header,
-					void *addr, u32 length)
+static int shm_write_msg_channel(struct shrm_dev *shrm, u8 l2_header)
 {
-	u8 channel = 0;
-	int ret;
-
-	dev_dbg(shrm->dev, "%s IN\n", __func__);
-
 	if (boot_state != BOOT_DONE) {
 		dev_err(shrm->dev,
 			"error:after boot done  call this fn, L2Header = %d\n",
 			l2_header);
-		ret = -ENODEV;
-		goto out;
+		return -ENODEV;
 	}
 
 	if ((l2_header == L2_HEADER_ISI) ||
@@ -1065,12 +1091,12 @@ int shm_write_msg(struct shrm_dev *shrm, u8 l2_header,
 			(l2_header == L2_HEADER_COMMON_ADVANCED_LOOPBACK) ||
 			(l2_header == L2_HEADER_CIQ) ||
 			(l2_header == L2_HEADER_RTC_CALIBRATION)) {
-		channel = 0;
 		if (shrm_common_tx_state == SHRM_SLEEP_STATE)
 			shrm_common_tx_state = SHRM_PTR_FREE;
 		else if (shrm_common_tx_state == SHRM_IDLE)
 			shrm_common_tx_state = SHRM_PTR_FREE;
 
+		return COMMON_CHANNEL;
 	} else if ((l2_header == L2_HEADER_AUDIO) ||
 			(l2_header == L2_HEADER_AUDIO_SIMPLE_LOOPBACK) ||
 			(l2_header == L2_HEADER_AUDIO_ADVANCED_LOOPBACK)) {
@@ -1079,37 +1105,106 @@ int shm_write_msg(struct shrm_dev *shrm, u8 l2_header,
 		else if (shrm_audio_tx_state == SHRM_IDLE)
 			shrm_audio_tx_state = SHRM_PTR_FREE;
 
-		channel = 1;
-	} else {
-		ret = -ENODEV;
-		goto out;
-	}
-	ret = shm_write_msg_to_fifo(shrm, channel, l2_header, addr, length);
-	if (ret < 0) {
-		dev_err(shrm->dev, "write message to fifo failed\n");
-		return ret;
+		return AUDIO_CHANNEL;
 	}
+
+	return -ENODEV;
+}
+
+/**
+ * shm_write_msg_notify() - tell the CMT about a message written to FIFO
+ * @shrm:	pointer to the shrm device information structure
+ * @channel:	the channel written to
+ * @length:	length of the message written
+ */
+static void shm_write_msg_notify(struct shrm_dev *shrm, u8 channel,
+				u32 length)
+{
 	/*
 	 * notify only if new msg copied is the only unread one
 	 * otherwise it means that reading process is ongoing
 	 */
-	if (is_the_only_one_unread_message(shrm, channel, length)) {
+	if (!is_the_only_one_unread_message(shrm, channel, length))
+		return;
 
-		/* Send Message Pending Noitication to CMT */
-		if (channel == 0)
-			queue_kthread_work(&shrm->shm_common_ch_wr_kw,
-					&shrm->send_ac_msg_pend_notify_0);
-		else
-			queue_kthread_work(&shrm->shm_audio_ch_wr_kw,
-					&shrm->send_ac_msg_pend_notify_1);
+	/* Send Message Pending Noitication to CMT */
+	if (channel == AUDIO_CHANNEL)
+		queue_kthread_work(&shrm->shm_audio_ch_wr_kw,
+				&shrm->send_ac_msg_pend_notify_1);
+	else if (!doorbell_delay_us)
+		queue_kthread_work(&shrm->shm_common_ch_wr_kw,
+				&shrm->send_ac_msg_pend_notify_0);
+	else if (!hrtimer_is_queued(&doorbell_timer))
+		/* Let messages that follow share this notification */
+		hrtimer_start(&doorbell_timer,
+				ktime_set(0, doorbell_delay_us * NSEC_PER_USEC),
+				HRTIMER_MODE_REL);
+}
 
+/**
+ * shm_write_msg() - write message to shared memory
+ * @shrm:	pointer to the shrm device information structure
+ * @l2_header:	L2 header
+ * @addr:	pointer to the message
+ * @length:	length of the message to be written
+ *
+ * This function is called from net or char interface driver write operation.
+ * Prior to calling this function the message is copied from the user space
+ * buffer to the kernel buffer. This function based on the l2 header routes
+ * the message to the respective channel and FIFO. Then makes a call to the
+ * fifo write function where the message is written to the physical device.
+ */
+int shm_write_msg(struct shrm_dev *shrm, u8 l2_header,
+					void *addr, u32 length)
+{
+	int channel;
+	int ret;
+
+	dev_dbg(shrm->dev, "%s IN\n", __func__);
+
+	channel = shm_write_msg_channel(shrm, l2_header);
+	if (channel < 0)
+		return channel;
+
+	ret = shm_write_msg_to_fifo(shrm, channel, l2_header, addr, length);
+	if (ret < 0) {
+		dev_err(shrm->dev, "write message to fifo failed\n");
+		return ret;
 	}
 
+	shm_write_msg_notify(shrm, channel, length);
+
 	dev_dbg(shrm->dev, "%s OUT\n", __func__);
 	return 0;
+}
 
-out:
-	return ret;
+/**
+ * shm_write_skb() - write a socket buffer to shared memory
+ * @shrm:	pointer to the shrm device information structure
+ * @l2_header:	L2 header
+ * @skb:	the message
+ *
+ * Same as shm_write_msg(), but the message is gathered from the skb
+ * directly into the FIFO, so non-linear skbs need no intermediate copy.
+ */
+int shm_write_skb(struct shrm_dev *shrm, u8 l2_header, struct sk_buff *skb)
+{
+	int channel;
+	int ret;
+
+	channel = shm_write_msg_channel(shrm, l2_header);
+	if (channel < 0)
+		return channel;
+
+	ret = shm_write_skb_to_fifo(shrm, channel, l2_header, skb);
+	if (ret < 0) {
+		dev_err(shrm->dev, "write message to fifo failed\n");
+		return ret;
+	}
+
+	shm_write_msg_notify(shrm, channel, skb->len);
+
+	return 0;
 }
 
 void ca_msg_read_notification_0(struct shrm_dev *shrm)
@@ -1126,8 +1221,7 @@ void ca_msg_read_notification_0(struct shrm_dev *shrm)
 		}
 
 		/* Trigger CaMsgReadNotification to CMU */
-		writel((1 << GOP_COMMON_CA_READ_NOTIFICATION_BIT),
-			shrm->intr_base + GOP_SET_REGISTER_BASE);
+		shrm_gop_set(shrm, GOP_COMMON_CA_READ_NOTIFICATION_BIT);
 		set_ca_msg_0_read_notif_send(1);
 		shrm_common_rx_state = SHRM_PTR_BUSY;
 	}
@@ -1149,14 +1243,43 @@ void ca_msg_read_notification_1(struct shrm_dev *shrm)
 		}
 
 		/* Trigger CaMsgReadNotification to CMU */
-		writel((1<<GOP_AUDIO_CA_READ_NOTIFICATION_BIT),
-			shrm->intr_base+GOP_SET_REGISTER_BASE);
+		shrm_gop_set(shrm, GOP_AUDIO_CA_READ_NOTIFICATION_BIT);
 		set_ca_msg_1_read_notif_send(1);
 		shrm_audio_rx_state = SHRM_PTR_BUSY;
 	}
 	dev_dbg(shrm->dev, "%s OUT\n", __func__);
 }
 
+/**
+ * receive_one_common - receive one message from the common channel
+ * @shrm:	pointer to shrm device information structure
+ *
+ * ISI messages for the network interface are read straight from the FIFO
+ * into an skb, saving the copies through the receive buffer and the ISI
+ * queue. Everything else goes to the common channel receive handler.
+ */
+static void receive_one_common(struct shrm_dev *shrm)
+{
+	struct sk_buff *skb;
+	u8 l2_header;
+	u32 len;
+
+	l2_header = peek_l2msg_common(&len);
+	if (l2_header == ISI_MESSAGING && len <= sizeof(recieve_common_msg) &&
+			shrm_net_rx_direct(shrm)) {
+		skb = netdev_alloc_skb(shrm->ndev, len);
+		if (skb) {
+			read_one_l2msg_common(shrm, skb_put(skb, len), &len);
+			shrm_net_receive_skb(shrm->ndev, skb);
+			return;
+		}
+	}
+
+	l2_header = read_one_l2msg_common(shrm, recieve_common_msg, &len);
+	/* Send Recieve_Call_back to Upper Layer */
+	(*rx_common_handler)(l2_header, &recieve_common_msg, len, shrm);
+}
+
 /**
  * receive_messages_common - receive common channnel msg from
  * CMT(Cellular Mobile Terminal)
@@ -1180,14 +1303,11 @@ void receive_messages_common(struct shrm_dev *shrm)
 		return;
 	}
 
-	l2_header = read_one_l2msg_common(shrm, recieve_common_msg, &len);
-	/* Send Recieve_Call_back to Upper Layer */
 	if (!rx_common_handler) {
 		dev_err(shrm->dev, "common_rx_handler is Null\n");
 		BUG();
 	}
-	(*rx_common_handler)(l2_header, &recieve_common_msg, len,
-					shrm);
+	receive_one_common(shrm);
 	/* SendReadNotification */
 	ca_msg_read_notification_0(shrm);
 
@@ -1198,12 +1318,7 @@ void receive_messages_common(struct shrm_dev *shrm)
 			return;
 		}
 
-		l2_header = read_one_l2msg_common(shrm, recieve_common_msg,
-								&len);
-		/* Send Recieve_Call_back to Upper Layer */
-		(*rx_common_handler)(l2_header,
-					&recieve_common_msg, len,
-					shrm);
+		receive_one_common(shrm);
 	}
 }
 
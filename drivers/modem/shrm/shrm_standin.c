@@ -0,0 +1,322 @@
+/*
+ * Copyright (C) ST-Ericsson SA 2012
+ * License terms: GNU General Public License (GPL) version 2
+ *
+ * Stand-in for the CMT side of the shared memory link.
+ *
+ * The FIFOs and shared pointers are plain kernel memory and the GOP
+ * outputs of the APE are routed here instead of to the modem. The
+ * stand-in boots the link like the CMT does and then loops every message
+ * written to an APE to CMT FIFO back into the CMT to APE FIFO of the same
+ * channel, calling the interrupt handlers the modem would trigger. A
+ * message sent on /dev/rpc or the shrm0 interface is thus received again,
+ * so the driver's throughput, latency and CPU cost can be measured on a
+ * board without a modem.
+ */
+
+#include <linux/kernel.h>
+#include <linux/bitops.h>
+#include <linux/err.h>
+#include <linux/interrupt.h>
+#include <linux/vmalloc.h>
+#include <linux/workqueue.h>
+#include <linux/modem/modem.h>
+#include <linux/modem/shrm/shrm_driver.h>
+#include <linux/modem/shrm/shrm_private.h>
+#include <linux/modem/shrm/shrm_config.h>
+
+/* L1 message types, as in shrm_fifo.c */
+#define L1_BOOT_INFO_REQ	1
+#define L1_BOOT_INFO_RESP	2
+
+/* write_boot_info_resp() sends three words for version 1 and up */
+#define BOOT_INFO_RESP_LEN	3
+#define BOOT_INFO_VERSION	2
+
+struct shrm_standin_mem {
+	u32 ac_common_fifo[SHM_FIFO_0_SIZE / 4];
+	u32 ca_common_fifo[SHM_FIFO_0_SIZE / 4];
+	u32 ac_audio_fifo[SHM_FIFO_1_SIZE / 4];
+	u32 ca_audio_fifo[SHM_FIFO_1_SIZE / 4];
+	u32 ac_common_wptr;
+	u32 ac_common_rptr;
+	u32 ca_common_wptr;
+	u32 ca_common_rptr;
+	u32 ac_audio_wptr;
+	u32 ac_audio_rptr;
+	u32 ca_audio_wptr;
+	u32 ca_audio_rptr;
+};
+
+/**
+ * struct shrm_standin_chan - one direction pair of the common or audio channel
+ * @ac_fifo:		APE to CMT FIFO
+ * @ca_fifo:		CMT to APE FIFO
+ * @size:		size of either FIFO in words
+ * @ac_wptr:		shared write pointer of @ac_fifo
+ * @ac_rptr:		shared read pointer of @ac_fifo
+ * @ca_wptr:		shared write pointer of @ca_fifo
+ * @ca_rptr:		shared read pointer of @ca_fifo
+ * @msg_pending_bit:	GOP output telling the CMT about new messages
+ * @read_bit:		GOP output telling the CMT that @ca_fifo was read
+ * @read_notif:		handler of the CMT's read notification
+ * @msg_pending:	handler of the CMT's message pending notification
+ * @ac_pending:		a message pending notification is not answered yet
+ */
+struct shrm_standin_chan {
+	u32 *ac_fifo;
+	u32 *ca_fifo;
+	u32 size;
+	u32 *ac_wptr;
+	u32 *ac_rptr;
+	u32 *ca_wptr;
+	u32 *ca_rptr;
+	unsigned int msg_pending_bit;
+	unsigned int read_bit;
+	irq_handler_t read_notif;
+	irq_handler_t msg_pending;
+	bool ac_pending;
+};
+
+static struct shrm_dev *standin_shrm;
+static struct shrm_standin_mem *standin_mem;
+static struct modem_dev *standin_mdev;
+static struct workqueue_struct *standin_wq;
+static unsigned long standin_gop;
+
+static struct shrm_standin_chan standin_chan[] = {
+	{
+		.size = SHM_FIFO_0_SIZE / 4,
+		.msg_pending_bit = GOP_COMMON_AC_MSG_PENDING_NOTIFICATION_BIT,
+		.read_bit = GOP_COMMON_CA_READ_NOTIFICATION_BIT,
+		.read_notif = ac_read_notif_0_irq_handler,
+		.msg_pending = ca_msg_pending_notif_0_irq_handler,
+	}, {
+		.size = SHM_FIFO_1_SIZE / 4,
+		.msg_pending_bit = GOP_AUDIO_AC_MSG_PENDING_NOTIFICATION_BIT,
+		.read_bit = GOP_AUDIO_CA_READ_NOTIFICATION_BIT,
+		.read_notif = ac_read_notif_1_irq_handler,
+		.msg_pending = ca_msg_pending_notif_1_irq_handler,
+	},
+};
+
+/* Raise a CMT interrupt, in hard interrupt context like the real one */
+static void shrm_standin_irq(irq_handler_t handler)
+{
+	unsigned long flags;
+
+	local_irq_save(flags);
+	handler(0, standin_shrm);
+	local_irq_restore(flags);
+}
+
+/*
+ * Copy the messages the APE has published to the CMT to APE FIFO, as far
+ * as they fit. The read notification goes out once all of them are
+ * copied, so there is one for every message pending notification.
+ */
+static void shrm_standin_loop(struct shrm_standin_chan *ch)
+{
+	u32 ac_rptr = *ch->ac_rptr;
+	u32 ac_wptr = ACCESS_ONCE(*ch->ac_wptr);
+	u32 ca_wptr = *ch->ca_wptr;
+	u32 ca_rptr = ACCESS_ONCE(*ch->ca_rptr);
+	u32 l1_header, length, words, room, i;
+	bool written = false;
+
+	/* the pointers are published after the data they cover */
+	smp_rmb();
+
+	while (ac_rptr != ac_wptr) {
+		l1_header = ch->ac_fifo[ac_rptr];
+		if (l1_header >> L1_MSG_MAPID_OFFSET == L1_BOOT_INFO_RESP) {
+			ac_rptr = (ac_rptr + BOOT_INFO_RESP_LEN) % ch->size;
+			continue;
+		}
+
+		length = ch->ac_fifo[(ac_rptr + 1) % ch->size] & 0xFFFFF;
+		words = DIV_ROUND_UP(length, 4) + 2;
+
+		/* keep a word free, equal pointers mean an empty FIFO */
+		room = (ca_rptr + ch->size - ca_wptr - 1) % ch->size;
+		if (words > room)
+			break;
+
+		for (i = 0; i < words; i++)
+			ch->ca_fifo[(ca_wptr + i) % ch->size] =
+				ch->ac_fifo[(ac_rptr + i) % ch->size];
+
+		ac_rptr = (ac_rptr + words) % ch->size;
+		ca_wptr = (ca_wptr + words) % ch->size;
+		written = true;
+	}
+
+	smp_wmb();
+	*ch->ac_rptr = ac_rptr;
+	if (ac_rptr == ac_wptr) {
+		ch->ac_pending = false;
+		shrm_standin_irq(ch->read_notif);
+	}
+
+	if (written) {
+		*ch->ca_wptr = ca_wptr;
+		shrm_standin_irq(ch->msg_pending);
+	}
+}
+
+static void shrm_standin_work_func(struct work_struct *work)
+{
+	struct shrm_standin_chan *ch;
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(standin_chan); i++) {
+		ch = &standin_chan[i];
+
+		if (test_and_clear_bit(ch->msg_pending_bit, &standin_gop))
+			ch->ac_pending = true;
+		/* reading frees room for messages that did not fit */
+		clear_bit(ch->read_bit, &standin_gop);
+
+		if (ch->ac_pending)
+			shrm_standin_loop(ch);
+	}
+}
+
+static DECLARE_WORK(standin_work, shrm_standin_work_func);
+
+void shrm_standin_gop_set(struct shrm_dev *shrm, u32 bit)
+{
+	/* wake requests and acknowledges need no answer */
+	if (bit == GOP_CA_WAKE_ACK_BIT)
+		return;
+
+	set_bit(bit, &standin_gop);
+	queue_work(standin_wq, &standin_work);
+}
+
+/* The link is always up, so there is nothing to request */
+static void shrm_standin_modem_request(struct modem_dev *mdev)
+{
+}
+
+static void shrm_standin_modem_release(struct modem_dev *mdev)
+{
+}
+
+static int shrm_standin_modem_is_requested(struct modem_dev *mdev)
+{
+	return 1;
+}
+
+static struct modem_ops shrm_standin_modem_ops = {
+	.request = shrm_standin_modem_request,
+	.release = shrm_standin_modem_release,
+	.is_requested = shrm_standin_modem_is_requested,
+};
+
+static struct modem_desc shrm_standin_modem_desc = {
+	.name = "u8500-shrm-modem",
+	.ops = &shrm_standin_modem_ops,
+	.owner = THIS_MODULE,
+};
+
+/**
+ * shrm_standin_map() - set up the shared memory in place of the modem's
+ * @shrm:	pointer to the shrm device information structure
+ *
+ * Also registers the modem the driver gets with modem_get().
+ */
+int shrm_standin_map(struct shrm_dev *shrm)
+{
+	struct shrm_standin_mem *mem;
+	int err;
+
+	mem = vzalloc(sizeof(*mem));
+	if (!mem)
+		return -ENOMEM;
+
+	standin_wq = create_singlethread_workqueue("shrm_standin");
+	if (!standin_wq) {
+		err = -ENOMEM;
+		goto free_mem;
+	}
+
+	standin_mdev = modem_register(&shrm_standin_modem_desc, shrm->dev,
+				      NULL);
+	if (IS_ERR(standin_mdev)) {
+		err = PTR_ERR(standin_mdev);
+		goto free_wq;
+	}
+
+	shrm->ape_common_fifo_base = (void __iomem *)mem->ac_common_fifo;
+	shrm->cmt_common_fifo_base = (void __iomem *)mem->ca_common_fifo;
+	shrm->ape_audio_fifo_base = (void __iomem *)mem->ac_audio_fifo;
+	shrm->cmt_audio_fifo_base = (void __iomem *)mem->ca_audio_fifo;
+	shrm->ape_common_fifo_size = SHM_FIFO_0_SIZE / 4;
+	shrm->cmt_common_fifo_size = SHM_FIFO_0_SIZE / 4;
+	shrm->ape_audio_fifo_size = SHM_FIFO_1_SIZE / 4;
+	shrm->cmt_audio_fifo_size = SHM_FIFO_1_SIZE / 4;
+
+	shrm->ac_common_shared_wptr = (void __iomem *)&mem->ac_common_wptr;
+	shrm->ac_common_shared_rptr = (void __iomem *)&mem->ac_common_rptr;
+	shrm->ca_common_shared_wptr = (void __iomem *)&mem->ca_common_wptr;
+	shrm->ca_common_shared_rptr = (void __iomem *)&mem->ca_common_rptr;
+	shrm->ac_audio_shared_wptr = (void __iomem *)&mem->ac_audio_wptr;
+	shrm->ac_audio_shared_rptr = (void __iomem *)&mem->ac_audio_rptr;
+	shrm->ca_audio_shared_wptr = (void __iomem *)&mem->ca_audio_wptr;
+	shrm->ca_audio_shared_rptr = (void __iomem *)&mem->ca_audio_rptr;
+
+	standin_chan[COMMON_CHANNEL].ac_fifo = mem->ac_common_fifo;
+	standin_chan[COMMON_CHANNEL].ca_fifo = mem->ca_common_fifo;
+	standin_chan[COMMON_CHANNEL].ac_wptr = &mem->ac_common_wptr;
+	standin_chan[COMMON_CHANNEL].ac_rptr = &mem->ac_common_rptr;
+	standin_chan[COMMON_CHANNEL].ca_wptr = &mem->ca_common_wptr;
+	standin_chan[COMMON_CHANNEL].ca_rptr = &mem->ca_common_rptr;
+	standin_chan[AUDIO_CHANNEL].ac_fifo = mem->ac_audio_fifo;
+	standin_chan[AUDIO_CHANNEL].ca_fifo = mem->ca_audio_fifo;
+	standin_chan[AUDIO_CHANNEL].ac_wptr = &mem->ac_audio_wptr;
+	standin_chan[AUDIO_CHANNEL].ac_rptr = &mem->ac_audio_rptr;
+	standin_chan[AUDIO_CHANNEL].ca_wptr = &mem->ca_audio_wptr;
+	standin_chan[AUDIO_CHANNEL].ca_rptr = &mem->ca_audio_rptr;
+
+	standin_shrm = shrm;
+	standin_mem = mem;
+	dev_info(shrm->dev, "modem stand-in, %zu bytes of shared memory\n",
+		 sizeof(*mem));
+
+	return 0;
+
+free_wq:
+	destroy_workqueue(standin_wq);
+free_mem:
+	vfree(mem);
+	return err;
+}
+
+void shrm_standin_unmap(struct shrm_dev *shrm)
+{
+	destroy_workqueue(standin_wq);
+	modem_unregister(standin_mdev);
+	vfree(standin_mem);
+}
+
+/**
+ * shrm_standin_start() - boot the link
+ * @shrm:	pointer to the shrm device information structure
+ *
+ * Wakes the APE and sends the boot info request. The driver answers with
+ * its boot info response, and the read notification for that response
+ * completes the boot.
+ */
+void shrm_standin_start(struct shrm_dev *shrm)
+{
+	struct shrm_standin_chan *ch = &standin_chan[COMMON_CHANNEL];
+
+	shrm_standin_irq(ca_wake_irq_handler);
+
+	ch->ca_fifo[*ch->ca_wptr] = L1_BOOT_INFO_REQ << L1_MSG_MAPID_OFFSET |
+		BOOT_INFO_VERSION;
+	smp_wmb();
+	*ch->ca_wptr = (*ch->ca_wptr + 1) % ch->size;
+	shrm_standin_irq(ch->msg_pending);
+}
@@ -0,0 +1,127 @@
+/*
+ * Copyright (C) ST-Ericsson AB 2012
+ * License terms: GNU General Public License (GPL) version 2
+ *
+ * Loopback stand-in for the remote side of the CAIF shared memory link.
+ *
+ * The shared memory is plain kernel memory and the core runs with
+ * shm_loopback set, so RX buffer n is the same memory as TX buffer n.
+ * The stand-in answers every mailbox message with the same message:
+ * a TX buffer marked full comes back as the full RX buffer with the same
+ * index, and once the host has emptied that RX buffer the TX buffer is
+ * released. Traffic sent on the cfshm interface is thus received again,
+ * and throughput and CPU cost per byte can be read from the interface
+ * statistics and /proc/stat while a sender runs.
+ */
+
+#define pr_fmt(fmt) KBUILD_MODNAME ":" fmt
+
+#include <linux/init.h>
+#include <linux/module.h>
+#include <linux/gfp.h>
+#include <linux/kfifo.h>
+#include <linux/netdevice.h>
+#include <linux/spinlock.h>
+#include <linux/workqueue.h>
+#include <net/caif/caif_shm.h>
+
+MODULE_LICENSE("GPL");
+MODULE_DESCRIPTION("CAIF Shared Memory loopback driver");
+
+/* Mailbox messages in flight, at most one per buffer. */
+#define SHM_LOOP_MSGS		32
+
+static struct shmdev_layer shmdev_lyr;
+
+static unsigned int shm_size = 0x18000;
+module_param(shm_size, uint, 0440);
+MODULE_PARM_DESC(shm_size, "Size of the loopback shared memory");
+
+static int (*shm_loop_cb)(u32 mbx_msg, void *priv);
+static void *shm_loop_priv;
+
+static DEFINE_KFIFO(shm_loop_fifo, u32, SHM_LOOP_MSGS);
+static DEFINE_SPINLOCK(shm_loop_lock);
+static struct workqueue_struct *shm_loop_wq;
+
+/* Deliver the answers from process context, like the mailbox IRQ thread. */
+static void shm_loop_work_func(struct work_struct *work)
+{
+	u32 mbx_msg;
+
+	while (kfifo_out_spinlocked(&shm_loop_fifo, &mbx_msg, 1,
+				    &shm_loop_lock))
+		shm_loop_cb(mbx_msg, shm_loop_priv);
+}
+
+static DECLARE_WORK(shm_loop_work, shm_loop_work_func);
+
+static int shmdev_send_msg(u32 dev_id, u32 mbx_msg)
+{
+	if (!kfifo_in_spinlocked(&shm_loop_fifo, &mbx_msg, 1,
+				 &shm_loop_lock)) {
+		pr_warn("Loopback mailbox full, dropping msg:%x\n", mbx_msg);
+		return -ENOBUFS;
+	}
+
+	queue_work(shm_loop_wq, &shm_loop_work);
+	return 0;
+}
+
+static int shmdev_mbx_setup(void *pshmdrv_cb, struct shmdev_layer *pshm_dev,
+							 void *pshm_drv)
+{
+	shm_loop_cb = pshmdrv_cb;
+	shm_loop_priv = pshm_drv;
+	return 0;
+}
+
+static int __init caif_shmdev_init(void)
+{
+	void *shm;
+	int result;
+
+	shm_loop_wq = create_singlethread_workqueue("shm_loop");
+	if (!shm_loop_wq)
+		return -ENOMEM;
+
+	/* Not compound, so the core can take page references on RX. */
+	shm = alloc_pages_exact(shm_size, GFP_KERNEL | __GFP_ZERO);
+	if (!shm) {
+		result = -ENOMEM;
+		goto err_wq;
+	}
+
+	shmdev_lyr.shm_base_addr = (u32)shm;
+	shmdev_lyr.shm_total_sz = shm_size;
+	shmdev_lyr.shm_id = 0;
+	shmdev_lyr.shm_loopback = 1;
+	shmdev_lyr.pshmdev_mbxsend = shmdev_send_msg;
+	shmdev_lyr.pshmdev_mbxsetup = shmdev_mbx_setup;
+
+	pr_info("SHM LOOPBACK AREA AT %p, %u bytes\n", shm, shm_size);
+
+	result = caif_shmcore_probe(&shmdev_lyr);
+	if (result) {
+		pr_warn("ERROR[%d], Could not probe SHM core\n", result);
+		goto err_mem;
+	}
+
+	return 0;
+
+err_mem:
+	free_pages_exact(shm, shm_size);
+err_wq:
+	destroy_workqueue(shm_loop_wq);
+	return result;
+}
+
+static void __exit caif_shmdev_exit(void)
+{
+	caif_shmcore_remove(shmdev_lyr.pshm_netdev);
+	destroy_workqueue(shm_loop_wq);
+	free_pages_exact((void *)shmdev_lyr.shm_base_addr, shm_size);
+}
+
+module_init(caif_shmdev_init);
+module_exit(caif_shmdev_exit);
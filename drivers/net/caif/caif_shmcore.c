@@ -8,9 +8,11 @@
 
 #define pr_fmt(fmt) KBUILD_MODNAME ":" fmt
 
+#include <linux/module.h>
 #include <linux/spinlock.h>
 #include <linux/sched.h>
 #include <linux/list.h>
+#include <linux/mm.h>
 #include <linux/netdevice.h>
 #include <linux/if_arp.h>
 #include <linux/kthread.h>
@@ -55,6 +57,25 @@
 
 #define CAIF_MAX_MTU		4096
 
+/* Number of CAIF frames delivered per NAPI poll. */
+#define SHM_NAPI_WEIGHT		32
+
+/*
+ * Bytes of a zero-copy RX frame copied into the skb head, covering the
+ * CAIF headers the protocol layers pull.
+ */
+#define SHM_RX_PULL_LEN		CAIF_NEEDED_HEADROOM
+
+/*
+ * Frames of at least this size are received without copying when the
+ * shared memory is part of the kernel linear mapping. The skbs then keep
+ * their RX buffer from being handed back to the modem until they are
+ * freed, so small frames are still copied.
+ */
+static unsigned int rx_copybreak = 256;
+module_param(rx_copybreak, uint, 0644);
+MODULE_PARM_DESC(rx_copybreak, "Smallest RX frame received without copy");
+
 #define SHM_SET_FULL(x)	(((x+1) & 0x0F) << 0)
 #define SHM_GET_FULL(x)	(((x >> 0) & 0x0F) - 1)
 
@@ -73,6 +94,14 @@ struct shm_pck_desc {
 	u32 frm_len;
 };
 
+struct shmdrv_layer;
+
+/*
+ * For RX buffers, frames is the next descriptor to parse and rx_refs
+ * counts the zero-copy skbs still referencing the buffer, plus one while
+ * it is being parsed. The buffer is given back to the modem only once
+ * rx_refs drops to zero.
+ */
 struct buf_list {
 	unsigned char *desc_vptr;
 	u32 phy_addr;
@@ -81,6 +110,9 @@ struct buf_list {
 	u32 frames;
 	u32 frm_ofs;
 	struct list_head list;
+	atomic_t rx_refs;
+	struct shmdrv_layer *pshm_drv;
+	struct ubuf_info rx_ubuf[SHM_MAX_FRMS_PER_BUF];
 };
 
 struct shm_caif_frm {
@@ -106,29 +138,41 @@ struct shmdrv_layer {
 	struct list_head rx_full_list;
 
 	struct workqueue_struct *pshm_tx_workqueue;
-	struct workqueue_struct *pshm_rx_workqueue;
 
 	struct kthread_worker pshm_flow_ctrl_kw;
 	struct task_struct *pshm_flow_ctrl_kw_task;
 
 	struct work_struct shm_tx_work;
-	struct work_struct shm_rx_work;
 	struct kthread_work shm_flow_on_work;
 	struct kthread_work shm_flow_off_work;
 
+	struct napi_struct napi;
+	bool rx_zerocopy;
+
 	struct sk_buff_head sk_qhead;
 	struct shmdev_layer *pshm_dev;
 };
 
 static int shm_netdev_open(struct net_device *shm_netdev)
 {
+	struct shmdrv_layer *pshm_drv = netdev_priv(shm_netdev);
+
+	napi_enable(&pshm_drv->napi);
 	netif_wake_queue(shm_netdev);
+
+	/* Pick up buffers received while we were down. */
+	local_bh_disable();
+	napi_schedule(&pshm_drv->napi);
+	local_bh_enable();
 	return 0;
 }
 
 static int shm_netdev_close(struct net_device *shm_netdev)
 {
+	struct shmdrv_layer *pshm_drv = netdev_priv(shm_netdev);
+
 	netif_stop_queue(shm_netdev);
+	napi_disable(&pshm_drv->napi);
 	return 0;
 }
 
@@ -201,14 +245,19 @@ int caif_shmdrv_rx_cb(u32 mbx_msg, void *priv)
 		}
 
 		list_del_init(&pbuf->list);
+		pbuf->frames = 0;
+		atomic_set(&pbuf->rx_refs, 1);
 		list_add_tail(&pbuf->list, &pshm_drv->rx_full_list);
 
 		spin_unlock_irqrestore(&pshm_drv->lock, flags);
 
-		/* Schedule RX work queue. */
-		if (!work_pending(&pshm_drv->shm_rx_work))
-			queue_work(pshm_drv->pshm_rx_workqueue,
-						&pshm_drv->shm_rx_work);
+		/*
+		 * We are called from the mailbox IRQ thread, so make sure
+		 * the NET_RX softirq runs as soon as it is raised.
+		 */
+		local_bh_disable();
+		napi_schedule(&pshm_drv->napi);
+		local_bh_enable();
 	}
 
 	/* Check for emptied buffers. */
@@ -280,21 +329,163 @@ err_sync:
 	return -EIO;
 }
 
-static void shm_rx_work_func(struct work_struct *rx_work)
+/*
+ * Called when the last reference to the shared memory pages of a
+ * zero-copy skb is dropped, or when they have been copied away.
+ */
+static void shm_rx_zc_release(void *arg)
 {
-	struct shmdrv_layer *pshm_drv;
-	struct buf_list *pbuf;
-	unsigned long flags = 0;
+	struct ubuf_info *uarg = arg;
+	struct buf_list *pbuf = uarg->arg;
+	struct shmdrv_layer *pshm_drv = pbuf->pshm_drv;
+
+	/* Let the TX work hand the buffer back to the modem. */
+	if (atomic_dec_and_test(&pbuf->rx_refs))
+		queue_work(pshm_drv->pshm_tx_workqueue, &pshm_drv->shm_tx_work);
+}
+
+/*
+ * Build an skb for one received CAIF frame. Large frames from linearly
+ * mapped shared memory only get their headers copied; the payload is
+ * attached as page fragments referencing the RX buffer.
+ */
+static struct sk_buff *shm_rx_frame(struct shmdrv_layer *pshm_drv,
+		struct buf_list *pbuf, unsigned int ofs, unsigned int len)
+{
+	struct net_device *ndev = pshm_drv->pshm_dev->pshm_netdev;
+	unsigned char *src = pbuf->desc_vptr + ofs;
+	unsigned int hlen = len;
+	struct ubuf_info *uarg;
+	struct sk_buff *skb;
+	int i = 0;
+
+	if (pshm_drv->rx_zerocopy && len >= rx_copybreak)
+		hlen = min_t(unsigned int, len, SHM_RX_PULL_LEN);
+
+	skb = netdev_alloc_skb(ndev, hlen + 1);
+	if (skb == NULL)
+		return NULL;
+
+	memcpy(skb_put(skb, hlen), src, hlen);
+	if (hlen == len)
+		return skb;
+
+	src += hlen;
+	len -= hlen;
+	while (len) {
+		unsigned int pg_ofs = offset_in_page(src);
+		unsigned int pg_len = min_t(unsigned int, len,
+					    PAGE_SIZE - pg_ofs);
+		struct page *page = virt_to_page(src);
+
+		get_page(page);
+		skb_fill_page_desc(skb, i++, page, pg_ofs, pg_len);
+		skb->len += pg_len;
+		skb->data_len += pg_len;
+		skb->truesize += pg_len;
+		src += pg_len;
+		len -= pg_len;
+	}
+
+	uarg = &pbuf->rx_ubuf[pbuf->frames];
+	uarg->callback = shm_rx_zc_release;
+	uarg->arg = pbuf;
+	atomic_inc(&pbuf->rx_refs);
+	skb_shinfo(skb)->destructor_arg = uarg;
+	skb_shinfo(skb)->tx_flags |= SKBTX_DEV_ZEROCOPY;
+
+	return skb;
+}
+
+/*
+ * Deliver up to budget frames from an RX buffer, continuing from where
+ * the previous poll stopped. Returns true when the buffer is done.
+ */
+static bool shm_rx_buf(struct shmdrv_layer *pshm_drv, struct buf_list *pbuf,
+		int budget, int *work_done)
+{
+	struct net_device *ndev = pshm_drv->pshm_dev->pshm_netdev;
+	u32 buf_ofs = pbuf->phy_addr - pshm_drv->shm_base_addr;
+	struct shm_pck_desc *pck_desc;
 	struct sk_buff *skb;
-	char *p;
-	int ret;
 
-	pshm_drv = container_of(rx_work, struct shmdrv_layer, shm_rx_work);
+	/* Retrieve pointer to the next packet descriptor. */
+	pck_desc = (struct shm_pck_desc *) pbuf->desc_vptr;
+	pck_desc += pbuf->frames;
+
+	/*
+	 * Check whether descriptor contains a CAIF shared memory
+	 * frame.
+	 */
+	while (pck_desc->frm_ofs && pbuf->frames < SHM_MAX_FRMS_PER_BUF) {
+		unsigned int frm_buf_ofs;
+		unsigned int frm_pck_ofs;
+		unsigned int frm_pck_len;
+
+		if (*work_done >= budget)
+			return false;
 
-	while (1) {
+		/* Check whether offset is within buffer limits. */
+		if (pck_desc->frm_ofs < buf_ofs ||
+				pck_desc->frm_ofs > buf_ofs + pbuf->len)
+			break;
+
+		/* Calculate offset from start of buffer. */
+		frm_buf_ofs = pck_desc->frm_ofs - buf_ofs;
+
+		/*
+		 * Calculate offset and length of CAIF packet while
+		 * taking care of the shared memory header.
+		 */
+		frm_pck_ofs =
+			frm_buf_ofs + SHM_HDR_LEN +
+			(*(pbuf->desc_vptr + frm_buf_ofs));
+		frm_pck_len =
+			(pck_desc->frm_len - SHM_HDR_LEN -
+			(*(pbuf->desc_vptr + frm_buf_ofs)));
+
+		/* Check whether CAIF packet is within buffer limits */
+		if ((frm_pck_ofs + pck_desc->frm_len) > pbuf->len)
+			break;
+
+		skb = shm_rx_frame(pshm_drv, pbuf, frm_pck_ofs, frm_pck_len);
+		if (skb == NULL) {
+			pr_info("OOM: Dropping rest of RX buffer\n");
+			++ndev->stats.rx_dropped;
+			break;
+		}
 
-		struct shm_pck_desc *pck_desc;
+		skb->protocol = htons(ETH_P_CAIF);
+		skb_reset_mac_header(skb);
+		skb->dev = ndev;
 
+		/* Push received packet up the stack. */
+		if (netif_receive_skb(skb) == NET_RX_SUCCESS) {
+			ndev->stats.rx_packets++;
+			ndev->stats.rx_bytes += pck_desc->frm_len;
+		} else
+			++ndev->stats.rx_dropped;
+
+		/* Move to next packet descriptor. */
+		(*work_done)++;
+		pbuf->frames++;
+		pck_desc++;
+	}
+
+	return true;
+}
+
+static int shm_rx_poll(struct napi_struct *napi, int budget)
+{
+	struct shmdrv_layer *pshm_drv;
+	struct buf_list *pbuf;
+	unsigned long flags = 0;
+	bool released = false;
+	int work_done = 0;
+
+	pshm_drv = container_of(napi, struct shmdrv_layer, napi);
+
+	while (work_done < budget) {
 		spin_lock_irqsave(&pshm_drv->lock, flags);
 
 		/* Check for received buffers. */
@@ -303,113 +494,126 @@ static void shm_rx_work_func(struct work_struct *rx_work)
 			break;
 		}
 
-		pbuf =
-			list_entry(pshm_drv->rx_full_list.next, struct buf_list,
-					list);
-		list_del_init(&pbuf->list);
+		/*
+		 * The buffer stays at the head of the full list while we
+		 * parse it; the mailbox callback only adds to the tail.
+		 */
+		pbuf = list_entry(pshm_drv->rx_full_list.next,
+				struct buf_list, list);
 		spin_unlock_irqrestore(&pshm_drv->lock, flags);
 
-		/* Retrieve pointer to start of the packet descriptor area. */
-		pck_desc = (struct shm_pck_desc *) pbuf->desc_vptr;
+		if (!shm_rx_buf(pshm_drv, pbuf, budget, &work_done))
+			break;
 
 		/*
-		 * Check whether descriptor contains a CAIF shared memory
-		 * frame.
+		 * Buffers are returned to the modem in the order they were
+		 * received, so queue it as pending even if zero-copy skbs
+		 * still hold it.
 		 */
-		while (pck_desc->frm_ofs) {
-			unsigned int frm_buf_ofs;
-			unsigned int frm_pck_ofs;
-			unsigned int frm_pck_len;
-			/*
-			 * Check whether offset is within buffer limits
-			 * (lower).
-			 */
-			if (pck_desc->frm_ofs <
-				(pbuf->phy_addr - pshm_drv->shm_base_addr))
-				break;
-			/*
-			 * Check whether offset is within buffer limits
-			 * (higher).
-			 */
-			if (pck_desc->frm_ofs >
-				((pbuf->phy_addr - pshm_drv->shm_base_addr) +
-					pbuf->len))
-				break;
-
-			/* Calculate offset from start of buffer. */
-			frm_buf_ofs =
-				pck_desc->frm_ofs - (pbuf->phy_addr -
-						pshm_drv->shm_base_addr);
-
-			/*
-			 * Calculate offset and length of CAIF packet while
-			 * taking care of the shared memory header.
-			 */
-			frm_pck_ofs =
-				frm_buf_ofs + SHM_HDR_LEN +
-				(*(pbuf->desc_vptr + frm_buf_ofs));
-			frm_pck_len =
-				(pck_desc->frm_len - SHM_HDR_LEN -
-				(*(pbuf->desc_vptr + frm_buf_ofs)));
-
-			/* Check whether CAIF packet is within buffer limits */
-			if ((frm_pck_ofs + pck_desc->frm_len) > pbuf->len)
-				break;
-
-			/* Get a suitable CAIF packet and copy in data. */
-			skb = netdev_alloc_skb(pshm_drv->pshm_dev->pshm_netdev,
-							frm_pck_len + 1);
-
-			if (skb == NULL) {
-				pr_info("OOM: Try next frame in descriptor\n");
-				break;
-			}
-
-			p = skb_put(skb, frm_pck_len);
-			memcpy(p, pbuf->desc_vptr + frm_pck_ofs, frm_pck_len);
-
-			skb->protocol = htons(ETH_P_CAIF);
-			skb_reset_mac_header(skb);
-			skb->dev = pshm_drv->pshm_dev->pshm_netdev;
-
-			/* Push received packet up the stack. */
-			ret = netif_rx_ni(skb);
-
-			if (!ret) {
-				pshm_drv->pshm_dev->pshm_netdev->stats.
-								rx_packets++;
-				pshm_drv->pshm_dev->pshm_netdev->stats.
-						rx_bytes += pck_desc->frm_len;
-			} else
-				++pshm_drv->pshm_dev->pshm_netdev->stats.
-								rx_dropped;
-			/* Move to next packet descriptor. */
-			pck_desc++;
-		}
-
 		spin_lock_irqsave(&pshm_drv->lock, flags);
+		list_del_init(&pbuf->list);
 		list_add_tail(&pbuf->list, &pshm_drv->rx_pend_list);
-
 		spin_unlock_irqrestore(&pshm_drv->lock, flags);
 
+		if (atomic_dec_and_test(&pbuf->rx_refs))
+			released = true;
 	}
 
 	/* Schedule the work queue. if required */
-	if (!work_pending(&pshm_drv->shm_tx_work))
+	if (released && !work_pending(&pshm_drv->shm_tx_work))
 		queue_work(pshm_drv->pshm_tx_workqueue, &pshm_drv->shm_tx_work);
 
+	if (work_done < budget) {
+		napi_complete(napi);
+
+		/* Catch buffers that arrived while we were completing. */
+		spin_lock_irqsave(&pshm_drv->lock, flags);
+		if (!list_empty(&pshm_drv->rx_full_list))
+			napi_schedule(napi);
+		spin_unlock_irqrestore(&pshm_drv->lock, flags);
+	}
+
+	return work_done;
+}
+
+/*
+ * Gather queued skbs into a TX buffer owned by the caller. skb_copy_bits()
+ * walks page fragments and the frag list, so fragmented skbs go straight
+ * into shared memory without being linearized first.
+ */
+static void shm_tx_fill(struct shmdrv_layer *pshm_drv, struct buf_list *pbuf)
+{
+	struct net_device *ndev = pshm_drv->pshm_dev->pshm_netdev;
+	struct shm_pck_desc *pck_desc;
+	struct shm_caif_frm *frm;
+	struct sk_buff *skb;
+	unsigned int frmlen;
+
+	while (pbuf->frames < SHM_MAX_FRMS_PER_BUF &&
+			pbuf->frm_ofs < pbuf->len) {
+		/* Only this work dequeues, so the head is stable. */
+		skb = skb_peek(&pshm_drv->sk_qhead);
+		if (skb == NULL)
+			break;
+
+		frmlen = SHM_HDR_LEN + skb->len;
+
+		/* Add tail padding if needed. */
+		if (frmlen % SHM_FRM_PAD_LEN)
+			frmlen += SHM_FRM_PAD_LEN - (frmlen % SHM_FRM_PAD_LEN);
+
+		/*
+		 * Verify that packet, header and additional padding
+		 * can fit within the buffer frame area. A frame that does
+		 * not even fit an empty buffer would block the queue.
+		 */
+		if (frmlen >= (pbuf->len - pbuf->frm_ofs)) {
+			if (pbuf->frames)
+				break;
+			skb = skb_dequeue(&pshm_drv->sk_qhead);
+			ndev->stats.tx_dropped++;
+			dev_kfree_skb(skb);
+			continue;
+		}
+
+		skb = skb_dequeue(&pshm_drv->sk_qhead);
+
+		frm = (struct shm_caif_frm *) (pbuf->desc_vptr + pbuf->frm_ofs);
+		frm->hdr_ofs = 0;
+
+		/* Copy in CAIF frame. */
+		skb_copy_bits(skb, 0, pbuf->desc_vptr + pbuf->frm_ofs +
+				SHM_HDR_LEN + frm->hdr_ofs, skb->len);
+
+		ndev->stats.tx_packets++;
+		ndev->stats.tx_bytes += frmlen;
+		dev_kfree_skb(skb);
+
+		/* Fill in the shared memory packet descriptor area. */
+		pck_desc = (struct shm_pck_desc *) (pbuf->desc_vptr);
+		/* Forward to current frame. */
+		pck_desc += pbuf->frames;
+		pck_desc->frm_ofs = (pbuf->phy_addr -
+					pshm_drv->shm_base_addr) +
+							pbuf->frm_ofs;
+		pck_desc->frm_len = frmlen;
+		/* Terminate packet descriptor area. */
+		pck_desc++;
+		pck_desc->frm_ofs = 0;
+		/* Update buffer parameters. */
+		pbuf->frames++;
+		pbuf->frm_ofs += frmlen + (frmlen % 32);
+	}
 }
 
 static void shm_tx_work_func(struct work_struct *tx_work)
 {
 	u32 mbox_msg;
-	unsigned int frmlen, avail_emptybuff, append = 0;
+	unsigned int avail_emptybuff;
 	unsigned long flags = 0;
 	struct buf_list *pbuf = NULL;
 	struct shmdrv_layer *pshm_drv;
-	struct shm_caif_frm *frm;
 	struct sk_buff *skb;
-	struct shm_pck_desc *pck_desc;
 	struct list_head *pos;
 
 	pshm_drv = container_of(tx_work, struct shmdrv_layer, shm_tx_work);
@@ -421,19 +625,25 @@ static void shm_tx_work_func(struct work_struct *tx_work)
 
 		spin_lock_irqsave(&pshm_drv->lock, flags);
 
-		/* Check for pending receive buffers. */
+		/*
+		 * Check for pending receive buffers no longer referenced by
+		 * any skb.
+		 */
 		if (!list_empty(&pshm_drv->rx_pend_list)) {
 
 			pbuf = list_entry(pshm_drv->rx_pend_list.next,
 						struct buf_list, list);
 
-			list_del_init(&pbuf->list);
-			list_add_tail(&pbuf->list, &pshm_drv->rx_empty_list);
-			/*
-			 * Value index is never changed,
-			 * so read access should be safe.
-			 */
-			mbox_msg |= SHM_SET_EMPTY(pbuf->index);
+			if (!atomic_read(&pbuf->rx_refs)) {
+				list_del_init(&pbuf->list);
+				list_add_tail(&pbuf->list,
+						&pshm_drv->rx_empty_list);
+				/*
+				 * Value index is never changed,
+				 * so read access should be safe.
+				 */
+				mbox_msg |= SHM_SET_EMPTY(pbuf->index);
+			}
 		}
 
 		skb = skb_peek(&pshm_drv->sk_qhead);
@@ -460,75 +670,24 @@ static void shm_tx_work_func(struct work_struct *tx_work)
 		if (list_empty(&pshm_drv->tx_empty_list))
 			goto send_msg;
 
-		/* Get the first free Tx buffer. */
+		/*
+		 * Take the first free Tx buffer off the list and fill it
+		 * without holding the lock.
+		 */
 		pbuf = list_entry(pshm_drv->tx_empty_list.next,
 						struct buf_list, list);
-		do {
-			if (append) {
-				skb = skb_peek(&pshm_drv->sk_qhead);
-				if (skb == NULL)
-					break;
-			}
-
-			frm = (struct shm_caif_frm *)
-					(pbuf->desc_vptr + pbuf->frm_ofs);
-
-			frm->hdr_ofs = 0;
-			frmlen = 0;
-			frmlen += SHM_HDR_LEN + frm->hdr_ofs + skb->len;
+		list_del_init(&pbuf->list);
+		spin_unlock_irqrestore(&pshm_drv->lock, flags);
 
-			/* Add tail padding if needed. */
-			if (frmlen % SHM_FRM_PAD_LEN)
-				frmlen += SHM_FRM_PAD_LEN -
-						(frmlen % SHM_FRM_PAD_LEN);
+		shm_tx_fill(pshm_drv, pbuf);
 
-			/*
-			 * Verify that packet, header and additional padding
-			 * can fit within the buffer frame area.
-			 */
-			if (frmlen >= (pbuf->len - pbuf->frm_ofs))
-				break;
-
-			if (!append) {
-				list_del_init(&pbuf->list);
-				append = 1;
-			}
-
-			skb = skb_dequeue(&pshm_drv->sk_qhead);
-			if (skb == NULL)
-				break;
-			/* Copy in CAIF frame. */
-			skb_copy_bits(skb, 0, pbuf->desc_vptr +
-					pbuf->frm_ofs + SHM_HDR_LEN +
-						frm->hdr_ofs, skb->len);
-
-			pshm_drv->pshm_dev->pshm_netdev->stats.tx_packets++;
-			pshm_drv->pshm_dev->pshm_netdev->stats.tx_bytes +=
-									frmlen;
-			dev_kfree_skb_irq(skb);
-
-			/* Fill in the shared memory packet descriptor area. */
-			pck_desc = (struct shm_pck_desc *) (pbuf->desc_vptr);
-			/* Forward to current frame. */
-			pck_desc += pbuf->frames;
-			pck_desc->frm_ofs = (pbuf->phy_addr -
-						pshm_drv->shm_base_addr) +
-								pbuf->frm_ofs;
-			pck_desc->frm_len = frmlen;
-			/* Terminate packet descriptor area. */
-			pck_desc++;
-			pck_desc->frm_ofs = 0;
-			/* Update buffer parameters. */
-			pbuf->frames++;
-			pbuf->frm_ofs += frmlen + (frmlen % 32);
-
-		} while (pbuf->frames < SHM_MAX_FRMS_PER_BUF &&
-				pbuf->frm_ofs < pbuf->len);
-
-		/* Assign buffer as full. */
-		list_add_tail(&pbuf->list, &pshm_drv->tx_full_list);
-		append = 0;
-		mbox_msg |= SHM_SET_FULL(pbuf->index);
+		spin_lock_irqsave(&pshm_drv->lock, flags);
+		if (pbuf->frames) {
+			/* Assign buffer as full. */
+			list_add_tail(&pbuf->list, &pshm_drv->tx_full_list);
+			mbox_msg |= SHM_SET_FULL(pbuf->index);
+		} else
+			list_add(&pbuf->list, &pshm_drv->tx_empty_list);
 send_msg:
 		spin_unlock_irqrestore(&pshm_drv->lock, flags);
 
@@ -569,6 +728,12 @@ static void shm_netdev_setup(struct net_device *pshm_netdev)
 	pshm_netdev->hard_header_len = CAIF_NEEDED_HEADROOM;
 	pshm_netdev->tx_queue_len = 0;
 	pshm_netdev->destructor = free_netdev;
+	/*
+	 * TX gathers fragments into shared memory itself. CAIF frames carry
+	 * no checksum, but without a checksum feature the core clears SG.
+	 */
+	pshm_netdev->features = NETIF_F_SG | NETIF_F_FRAGLIST |
+				NETIF_F_HW_CSUM;
 
 	pshm_drv = netdev_priv(pshm_netdev);
 
@@ -641,15 +806,14 @@ int caif_shmcore_probe(struct shmdev_layer *pshm_dev)
 	INIT_LIST_HEAD(&pshm_drv->rx_full_list);
 
 	INIT_WORK(&pshm_drv->shm_tx_work, shm_tx_work_func);
-	INIT_WORK(&pshm_drv->shm_rx_work, shm_rx_work_func);
+	netif_napi_add(pshm_dev->pshm_netdev, &pshm_drv->napi, shm_rx_poll,
+			SHM_NAPI_WEIGHT);
 
 	init_kthread_work(&pshm_drv->shm_flow_on_work, shm_flow_on_work_func);
 	init_kthread_work(&pshm_drv->shm_flow_off_work, shm_flow_off_work_func);
 
 	pshm_drv->pshm_tx_workqueue =
 				create_singlethread_workqueue("shm_tx_work");
-	pshm_drv->pshm_rx_workqueue =
-				create_singlethread_workqueue("shm_rx_work");
 
 	init_kthread_worker(&pshm_drv->pshm_flow_ctrl_kw);
 	pshm_drv->pshm_flow_ctrl_kw_task = kthread_run(kthread_worker_fn,
@@ -673,6 +837,7 @@ int caif_shmcore_probe(struct shmdev_layer *pshm_dev)
 		tx_buf->len = TX_BUF_SZ;
 		tx_buf->frames = 0;
 		tx_buf->frm_ofs = SHM_CAIF_FRM_OFS;
+		tx_buf->pshm_drv = pshm_drv;
 
 		if (pshm_dev->shm_loopback)
 			tx_buf->desc_vptr = (unsigned char *)tx_buf->phy_addr;
@@ -683,6 +848,7 @@ int caif_shmcore_probe(struct shmdev_layer *pshm_dev)
 		list_add_tail(&tx_buf->list, &pshm_drv->tx_empty_list);
 	}
 
+	pshm_drv->rx_zerocopy = true;
 	for (j = 0; j < NR_RX_BUF; j++) {
 		struct buf_list *rx_buf =
 				kmalloc(sizeof(struct buf_list), GFP_KERNEL);
@@ -697,12 +863,23 @@ int caif_shmcore_probe(struct shmdev_layer *pshm_dev)
 		rx_buf->index = j;
 		rx_buf->phy_addr = pshm_drv->shm_rx_addr + (RX_BUF_SZ * j);
 		rx_buf->len = RX_BUF_SZ;
+		rx_buf->pshm_drv = pshm_drv;
+		atomic_set(&rx_buf->rx_refs, 0);
 
 		if (pshm_dev->shm_loopback)
 			rx_buf->desc_vptr = (unsigned char *)rx_buf->phy_addr;
 		else
 			rx_buf->desc_vptr =
 					ioremap(rx_buf->phy_addr, RX_BUF_SZ);
+
+		/*
+		 * Received frames can only be lent to the stack as page
+		 * fragments when the buffer is in the kernel linear mapping.
+		 */
+		if (!virt_addr_valid(rx_buf->desc_vptr) ||
+		    !virt_addr_valid(rx_buf->desc_vptr + RX_BUF_SZ - 1))
+			pshm_drv->rx_zerocopy = false;
+
 		list_add_tail(&rx_buf->list, &pshm_drv->rx_empty_list);
 	}
 
@@ -773,7 +950,7 @@ void caif_shmcore_remove(struct net_device *pshm_netdev)
 
 	/* Destroy work queues. */
 	destroy_workqueue(pshm_drv->pshm_tx_workqueue);
-	destroy_workqueue(pshm_drv->pshm_rx_workqueue);
+	netif_napi_del(&pshm_drv->napi);
 	flush_kthread_worker(&pshm_drv->pshm_flow_ctrl_kw);
 	kthread_stop(pshm_drv->pshm_flow_ctrl_kw_task);
 
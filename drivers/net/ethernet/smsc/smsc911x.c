@@ -35,6 +35,8 @@
 #include <linux/crc32.h>
 #include <linux/clk.h>
 #include <linux/delay.h>
+#include <linux/dmaengine.h>
+#include <linux/dma-mapping.h>
 #include <linux/errno.h>
 #include <linux/etherdevice.h>
 #include <linux/ethtool.h>
@@ -46,6 +48,7 @@
 #include <linux/netdevice.h>
 #include <linux/platform_device.h>
 #include <linux/regulator/consumer.h>
+#include <linux/scatterlist.h>
 #include <linux/sched.h>
 #include <linux/timer.h>
 #include <linux/bug.h>
@@ -79,6 +82,13 @@ static int debug = 3;
 module_param(debug, int, 0);
 MODULE_PARM_DESC(debug, "Debug level (0=none,...,16=all)");
 
+#ifdef CONFIG_SMSC911X_DMA
+static unsigned int dma_threshold = 512;
+module_param(dma_threshold, uint, 0);
+MODULE_PARM_DESC(dma_threshold,
+		 "Smallest packet in bytes moved through the FIFOs by DMA");
+#endif
+
 struct smsc911x_data;
 
 struct smsc911x_ops {
@@ -92,6 +102,20 @@ struct smsc911x_ops {
 
 #define SMSC911X_NUM_SUPPLIES 2
 
+/* CPU time spent moving packets through the data FIFOs, reported through
+ * ethtool -S.  For DMA only setting the transfer up and, on RX, handing the
+ * packet over counts, not the transfer itself. */
+struct smsc911x_fifo_stats {
+	u64 rx_pio_packets;
+	u64 rx_pio_ns;
+	u64 rx_dma_packets;
+	u64 rx_dma_ns;
+	u64 tx_pio_packets;
+	u64 tx_pio_ns;
+	u64 tx_dma_packets;
+	u64 tx_dma_ns;
+};
+
 struct smsc911x_data {
 	void __iomem *ioaddr;
 
@@ -148,6 +172,27 @@ struct smsc911x_data {
 
 	/* clock */
 	struct clk *fsmc_clk;
+
+	struct smsc911x_fifo_stats fifo_stats;
+
+#ifdef CONFIG_SMSC911X_DMA
+	/* DMA engine channel for FIFO transfers, NULL when using PIO only */
+	struct dma_chan *dma_chan;
+	dma_addr_t fifo_phys;
+	unsigned int dma_threshold;
+	struct scatterlist *dma_sg;
+
+	/* RX transfer in flight, owned by the NAPI poll */
+	struct sk_buff *rx_dma_skb;
+	dma_addr_t rx_dma_addr;
+	unsigned int rx_dma_len;
+	int rx_dma_done;
+
+	/* TX transfer in flight, the queue is stopped meanwhile */
+	struct sk_buff *tx_dma_skb;
+	dma_addr_t tx_dma_addr;
+	unsigned int tx_dma_len;
+#endif
 };
 
 /* Easy access to information */
@@ -240,6 +285,42 @@ static inline void smsc911x_reg_write(struct smsc911x_data *pdata, u32 reg,
 	spin_unlock_irqrestore(&pdata->dev_lock, flags);
 }
 
+/* In 16-bit mode each FIFO word takes two bus accesses, low half-word
+ * first.  The relaxed accessors keep the I/O barrier of every access out of
+ * the loop, a single one after the burst orders it against what follows. */
+#ifdef readw_relaxed
+#define smsc911x_readw_fifo(addr)	readw_relaxed(addr)
+#define smsc911x_writew_fifo(val, addr)	writew_relaxed(val, addr)
+#else
+#define smsc911x_readw_fifo(addr)	readw(addr)
+#define smsc911x_writew_fifo(val, addr)	writew(val, addr)
+#endif
+
+static inline void
+smsc911x_writefifo16(void __iomem *lo, void __iomem *hi, unsigned int *buf,
+		     unsigned int wordcount)
+{
+	while (wordcount--) {
+		u32 val = *buf++;
+
+		smsc911x_writew_fifo(val & 0xFFFF, lo);
+		smsc911x_writew_fifo(val >> 16, hi);
+	}
+	wmb();
+}
+
+static inline void
+smsc911x_readfifo16(void __iomem *lo, void __iomem *hi, unsigned int *buf,
+		    unsigned int wordcount)
+{
+	while (wordcount--) {
+		u32 val = smsc911x_readw_fifo(lo);
+
+		*buf++ = val | (smsc911x_readw_fifo(hi) << 16);
+	}
+	rmb();
+}
+
 /* Writes a packet to the TX_DATA_FIFO */
 static inline void
 smsc911x_tx_writefifo(struct smsc911x_data *pdata, unsigned int *buf,
@@ -262,8 +343,9 @@ smsc911x_tx_writefifo(struct smsc911x_data *pdata, unsigned int *buf,
 	}
 
 	if (pdata->config.flags & SMSC911X_USE_16BIT) {
-		while (wordcount--)
-			__smsc911x_reg_write(pdata, TX_DATA_FIFO, *buf++);
+		smsc911x_writefifo16(pdata->ioaddr + TX_DATA_FIFO,
+				     pdata->ioaddr + TX_DATA_FIFO + 2,
+				     buf, wordcount);
 		goto out;
 	}
 
@@ -295,9 +377,11 @@ smsc911x_tx_writefifo_shift(struct smsc911x_data *pdata, unsigned int *buf,
 	}
 
 	if (pdata->config.flags & SMSC911X_USE_16BIT) {
-		while (wordcount--)
-			__smsc911x_reg_write_shift(pdata,
-						 TX_DATA_FIFO, *buf++);
+		smsc911x_writefifo16(pdata->ioaddr +
+					__smsc_shift(pdata, TX_DATA_FIFO),
+				     pdata->ioaddr +
+					__smsc_shift(pdata, TX_DATA_FIFO + 2),
+				     buf, wordcount);
 		goto out;
 	}
 
@@ -328,8 +412,9 @@ smsc911x_rx_readfifo(struct smsc911x_data *pdata, unsigned int *buf,
 	}
 
 	if (pdata->config.flags & SMSC911X_USE_16BIT) {
-		while (wordcount--)
-			*buf++ = __smsc911x_reg_read(pdata, RX_DATA_FIFO);
+		smsc911x_readfifo16(pdata->ioaddr + RX_DATA_FIFO,
+				    pdata->ioaddr + RX_DATA_FIFO + 2,
+				    buf, wordcount);
 		goto out;
 	}
 
@@ -361,9 +446,11 @@ smsc911x_rx_readfifo_shift(struct smsc911x_data *pdata, unsigned int *buf,
 	}
 
 	if (pdata->config.flags & SMSC911X_USE_16BIT) {
-		while (wordcount--)
-			*buf++ = __smsc911x_reg_read_shift(pdata,
-								RX_DATA_FIFO);
+		smsc911x_readfifo16(pdata->ioaddr +
+					__smsc_shift(pdata, RX_DATA_FIFO),
+				    pdata->ioaddr +
+					__smsc_shift(pdata, RX_DATA_FIFO + 2),
+				    buf, wordcount);
 		goto out;
 	}
 
@@ -1217,6 +1304,390 @@ smsc911x_rx_fastforward(struct smsc911x_data *pdata, unsigned int pktbytes)
 	}
 }
 
+/* Hands a received packet to the stack */
+static void smsc911x_rx_deliver(struct net_device *dev, struct sk_buff *skb)
+{
+	unsigned int len = skb->len;
+
+	skb->protocol = eth_type_trans(skb, dev);
+	skb_checksum_none_assert(skb);
+	netif_receive_skb(skb);
+
+	/* Update counters */
+	dev->stats.rx_packets++;
+	dev->stats.rx_bytes += len;
+}
+
+#ifdef CONFIG_SMSC911X_DMA
+/* The data FIFO ports are aliased over 32 bytes each, so a memory to memory
+ * transfer is split into windows which all start at the port address */
+#define SMSC911X_FIFO_WINDOW	32
+#define SMSC911X_DMA_MAX_SG	(2048 / SMSC911X_FIFO_WINDOW)
+
+/* Prepares a transfer of len bytes between buf and the FIFO port at fifo.
+ * sg holds 2 * SMSC911X_DMA_MAX_SG entries, the DMA engine has built its
+ * descriptors from them once this returns */
+static struct dma_async_tx_descriptor *
+smsc911x_dma_prep(struct smsc911x_data *pdata, struct scatterlist *sg,
+		  u32 fifo, dma_addr_t buf, unsigned int len, bool to_fifo)
+{
+	struct dma_chan *chan = pdata->dma_chan;
+	struct scatterlist *sg_fifo = sg;
+	struct scatterlist *sg_buf = sg + SMSC911X_DMA_MAX_SG;
+	unsigned int nents = DIV_ROUND_UP(len, SMSC911X_FIFO_WINDOW);
+	unsigned long flags = DMA_PREP_INTERRUPT | DMA_CTRL_ACK |
+		DMA_COMPL_SKIP_SRC_UNMAP | DMA_COMPL_SKIP_DEST_UNMAP;
+	unsigned int i;
+
+	if (nents > SMSC911X_DMA_MAX_SG)
+		return NULL;
+
+	sg_init_table(sg_fifo, nents);
+	sg_init_table(sg_buf, nents);
+	for (i = 0; i < nents; i++) {
+		unsigned int chunk = min_t(unsigned int, len,
+					   SMSC911X_FIFO_WINDOW);
+
+		sg_dma_address(&sg_fifo[i]) = pdata->fifo_phys + fifo;
+		sg_dma_len(&sg_fifo[i]) = chunk;
+		sg_dma_address(&sg_buf[i]) = buf;
+		sg_dma_len(&sg_buf[i]) = chunk;
+		buf += chunk;
+		len -= chunk;
+	}
+
+	if (to_fifo)
+		return chan->device->device_prep_dma_sg(chan, sg_fifo, nents,
+							sg_buf, nents, flags);
+	return chan->device->device_prep_dma_sg(chan, sg_buf, nents,
+						sg_fifo, nents, flags);
+}
+
+static inline bool
+smsc911x_use_dma(struct smsc911x_data *pdata, unsigned int len)
+{
+	return pdata->dma_chan && len >= pdata->dma_threshold;
+}
+
+static void smsc911x_rx_dma_complete(void *param)
+{
+	struct smsc911x_data *pdata = param;
+
+	pdata->rx_dma_done = 1;
+	smp_wmb();
+	napi_schedule(&pdata->napi);
+}
+
+/* Starts moving pktwords from the RX data FIFO into skb. Until the
+ * completion callback reschedules NAPI the FIFO belongs to the DMA channel,
+ * which keeps packets in order without waiting for the transfer */
+static int smsc911x_rx_dma_start(struct smsc911x_data *pdata,
+				 struct sk_buff *skb, unsigned int pktwords)
+{
+	struct device *dmadev = pdata->dma_chan->device->dev;
+	struct dma_async_tx_descriptor *desc;
+	unsigned int len = pktwords << 2;
+	dma_addr_t addr;
+
+	addr = dma_map_single(dmadev, skb->head, len, DMA_FROM_DEVICE);
+	if (dma_mapping_error(dmadev, addr))
+		return -ENOMEM;
+
+	desc = smsc911x_dma_prep(pdata, pdata->dma_sg, RX_DATA_FIFO,
+				 addr, len, false);
+	if (!desc) {
+		dma_unmap_single(dmadev, addr, len, DMA_FROM_DEVICE);
+		return -EBUSY;
+	}
+
+	desc->callback = smsc911x_rx_dma_complete;
+	desc->callback_param = pdata;
+
+	pdata->rx_dma_skb = skb;
+	pdata->rx_dma_addr = addr;
+	pdata->rx_dma_len = len;
+	pdata->rx_dma_done = 0;
+
+	dmaengine_submit(desc);
+	dma_async_issue_pending(pdata->dma_chan);
+	return 0;
+}
+
+static inline bool smsc911x_rx_dma_pending(struct smsc911x_data *pdata)
+{
+	return pdata->rx_dma_skb != NULL;
+}
+
+static inline bool smsc911x_rx_dma_done(struct smsc911x_data *pdata)
+{
+	return pdata->rx_dma_done;
+}
+
+/* Delivers the packet of a finished RX transfer, returns false if the
+ * transfer is still running */
+static bool smsc911x_rx_dma_finish(struct smsc911x_data *pdata)
+{
+	struct sk_buff *skb = pdata->rx_dma_skb;
+
+	if (!smsc911x_rx_dma_done(pdata))
+		return false;
+	smp_rmb();
+
+	dma_unmap_single(pdata->dma_chan->device->dev, pdata->rx_dma_addr,
+			 pdata->rx_dma_len, DMA_FROM_DEVICE);
+	pdata->rx_dma_skb = NULL;
+	smsc911x_rx_deliver(pdata->dev, skb);
+	return true;
+}
+
+static void smsc911x_tx_dma_complete(void *param)
+{
+	struct smsc911x_data *pdata = param;
+	struct sk_buff *skb = xchg(&pdata->tx_dma_skb, NULL);
+	unsigned int freespace;
+	unsigned int temp;
+
+	/* already reclaimed by smsc911x_dma_stop() */
+	if (!skb)
+		return;
+
+	dma_unmap_single(pdata->dma_chan->device->dev, pdata->tx_dma_addr,
+			 pdata->tx_dma_len, DMA_TO_DEVICE);
+	dev_kfree_skb_any(skb);
+
+	freespace = smsc911x_reg_read(pdata, TX_FIFO_INF) & TX_FIFO_INF_TDFREE_;
+	if (freespace >= TX_FIFO_LOW_THRESHOLD) {
+		netif_wake_queue(pdata->dev);
+		return;
+	}
+
+	/* The FIFO is still low and a TDFA interrupt taken while the
+	 * transfer was pending has already disabled itself, so re-arm it
+	 * to wake the queue once space frees up */
+	temp = smsc911x_reg_read(pdata, FIFO_INT);
+	temp &= 0x00FFFFFF;
+	temp |= 0x32000000;
+	smsc911x_reg_write(pdata, FIFO_INT, temp);
+}
+
+/* Starts moving wordcount words from buf into the TX data FIFO, the skb is
+ * freed and the queue woken once the transfer completes */
+static int smsc911x_tx_dma_start(struct smsc911x_data *pdata,
+				 struct sk_buff *skb, unsigned int *buf,
+				 unsigned int wordcount)
+{
+	struct device *dmadev = pdata->dma_chan->device->dev;
+	struct dma_async_tx_descriptor *desc;
+	unsigned int len = wordcount << 2;
+	dma_addr_t addr;
+
+	addr = dma_map_single(dmadev, buf, len, DMA_TO_DEVICE);
+	if (dma_mapping_error(dmadev, addr))
+		return -ENOMEM;
+
+	desc = smsc911x_dma_prep(pdata, pdata->dma_sg + 2 * SMSC911X_DMA_MAX_SG,
+				 TX_DATA_FIFO, addr, len, true);
+	if (!desc) {
+		dma_unmap_single(dmadev, addr, len, DMA_TO_DEVICE);
+		return -EBUSY;
+	}
+
+	desc->callback = smsc911x_tx_dma_complete;
+	desc->callback_param = pdata;
+
+	/* Nothing else may touch the TX data FIFO until the transfer ends */
+	netif_stop_queue(pdata->dev);
+	pdata->tx_dma_addr = addr;
+	pdata->tx_dma_len = len;
+	pdata->tx_dma_skb = skb;
+
+	dmaengine_submit(desc);
+	dma_async_issue_pending(pdata->dma_chan);
+	return 0;
+}
+
+static inline bool smsc911x_tx_dma_pending(struct smsc911x_data *pdata)
+{
+	return pdata->tx_dma_skb != NULL;
+}
+
+/* Aborts transfers in flight, called with NAPI and the queue stopped */
+static void smsc911x_dma_stop(struct smsc911x_data *pdata)
+{
+	struct device *dmadev;
+	struct sk_buff *skb;
+
+	if (!pdata->dma_chan)
+		return;
+
+	dmadev = pdata->dma_chan->device->dev;
+	dmaengine_terminate_all(pdata->dma_chan);
+
+	if (pdata->rx_dma_skb) {
+		dma_unmap_single(dmadev, pdata->rx_dma_addr,
+				 pdata->rx_dma_len, DMA_FROM_DEVICE);
+		dev_kfree_skb(pdata->rx_dma_skb);
+		pdata->rx_dma_skb = NULL;
+	}
+
+	skb = xchg(&pdata->tx_dma_skb, NULL);
+	if (skb) {
+		dma_unmap_single(dmadev, pdata->tx_dma_addr,
+				 pdata->tx_dma_len, DMA_TO_DEVICE);
+		dev_kfree_skb(skb);
+	}
+}
+
+static ssize_t smsc911x_show_dma_threshold(struct device *dev,
+					   struct device_attribute *attr,
+					   char *buf)
+{
+	struct net_device *ndev = dev_get_drvdata(dev);
+	struct smsc911x_data *pdata;
+
+	if (!ndev)
+		return -ENODEV;
+	pdata = netdev_priv(ndev);
+
+	return sprintf(buf, "%u\n", pdata->dma_threshold);
+}
+
+static ssize_t smsc911x_store_dma_threshold(struct device *dev,
+					    struct device_attribute *attr,
+					    const char *buf, size_t count)
+{
+	struct net_device *ndev = dev_get_drvdata(dev);
+	struct smsc911x_data *pdata;
+	unsigned int val;
+	int ret;
+
+	if (!ndev)
+		return -ENODEV;
+	pdata = netdev_priv(ndev);
+
+	ret = kstrtouint(buf, 0, &val);
+	if (ret)
+		return ret;
+
+	pdata->dma_threshold = val;
+	return count;
+}
+
+static DEVICE_ATTR(dma_threshold, S_IRUGO | S_IWUSR,
+		   smsc911x_show_dma_threshold, smsc911x_store_dma_threshold);
+
+static void __devinit smsc911x_dma_init(struct platform_device *pdev,
+					struct smsc911x_data *pdata,
+					resource_size_t phys)
+{
+	dma_cap_mask_t mask;
+
+	pdata->dma_threshold = dma_threshold;
+
+	/* The DMA engine moves each word with a single access to the next
+	 * port address, which reaches the FIFO only on an unshifted 32-bit
+	 * bus without byte swapping */
+	if (!(pdata->config.flags & SMSC911X_USE_32BIT) ||
+	    (pdata->config.flags & SMSC911X_SWAP_FIFO) ||
+	    pdata->config.shift) {
+		dev_info(&pdev->dev, "FIFO DMA needs an unshifted 32-bit bus, "
+			 "using PIO\n");
+		return;
+	}
+
+	pdata->dma_sg = kcalloc(4 * SMSC911X_DMA_MAX_SG,
+				sizeof(struct scatterlist), GFP_KERNEL);
+	if (!pdata->dma_sg)
+		return;
+
+	dma_cap_zero(mask);
+	dma_cap_set(DMA_SG, mask);
+	pdata->dma_chan = dma_request_channel(mask, pdata->config.dma_filter,
+					      pdata->config.dma_param);
+	if (!pdata->dma_chan) {
+		dev_info(&pdev->dev, "no DMA channel, using PIO\n");
+		kfree(pdata->dma_sg);
+		pdata->dma_sg = NULL;
+		return;
+	}
+
+	pdata->fifo_phys = phys;
+	if (device_create_file(&pdev->dev, &dev_attr_dma_threshold))
+		dev_warn(&pdev->dev, "failed to create dma_threshold\n");
+
+	dev_info(&pdev->dev, "FIFO DMA on %s for packets from %u bytes\n",
+		 dma_chan_name(pdata->dma_chan), pdata->dma_threshold);
+}
+
+static void smsc911x_dma_release(struct platform_device *pdev,
+				 struct smsc911x_data *pdata)
+{
+	if (!pdata->dma_chan)
+		return;
+
+	device_remove_file(&pdev->dev, &dev_attr_dma_threshold);
+	dma_release_channel(pdata->dma_chan);
+	pdata->dma_chan = NULL;
+	kfree(pdata->dma_sg);
+	pdata->dma_sg = NULL;
+}
+#else
+static inline bool
+smsc911x_use_dma(struct smsc911x_data *pdata, unsigned int len)
+{
+	return false;
+}
+
+static inline int smsc911x_rx_dma_start(struct smsc911x_data *pdata,
+					struct sk_buff *skb,
+					unsigned int pktwords)
+{
+	return -ENODEV;
+}
+
+static inline bool smsc911x_rx_dma_pending(struct smsc911x_data *pdata)
+{
+	return false;
+}
+
+static inline bool smsc911x_rx_dma_done(struct smsc911x_data *pdata)
+{
+	return false;
+}
+
+static inline bool smsc911x_rx_dma_finish(struct smsc911x_data *pdata)
+{
+	return true;
+}
+
+static inline int smsc911x_tx_dma_start(struct smsc911x_data *pdata,
+					struct sk_buff *skb, unsigned int *buf,
+					unsigned int wordcount)
+{
+	return -ENODEV;
+}
+
+static inline bool smsc911x_tx_dma_pending(struct smsc911x_data *pdata)
+{
+	return false;
+}
+
+static inline void smsc911x_dma_stop(struct smsc911x_data *pdata)
+{
+}
+
+static inline void smsc911x_dma_init(struct platform_device *pdev,
+				     struct smsc911x_data *pdata,
+				     resource_size_t phys)
+{
+}
+
+static inline void smsc911x_dma_release(struct platform_device *pdev,
+					struct smsc911x_data *pdata)
+{
+}
+#endif /* CONFIG_SMSC911X_DMA */
+
 /* NAPI poll function */
 static int smsc911x_poll(struct napi_struct *napi, int budget)
 {
@@ -1224,6 +1695,15 @@ static int smsc911x_poll(struct napi_struct *napi, int budget)
 		container_of(napi, struct smsc911x_data, napi);
 	struct net_device *dev = pdata->dev;
 	int npackets = 0;
+	u64 start;
+
+	if (smsc911x_rx_dma_pending(pdata)) {
+		start = local_clock();
+		if (!smsc911x_rx_dma_finish(pdata))
+			goto wait_dma;
+		/* already counted against the budget when it was started */
+		pdata->fifo_stats.rx_dma_ns += local_clock() - start;
+	}
 
 	while (npackets < budget) {
 		unsigned int pktlength;
@@ -1277,19 +1757,35 @@ static int smsc911x_poll(struct napi_struct *napi, int budget)
 		/* Align IP on 16B boundary */
 		skb_reserve(skb, NET_IP_ALIGN);
 		skb_put(skb, pktlength - 4);
+
+		start = local_clock();
+		if (smsc911x_use_dma(pdata, pktlength) &&
+		    !smsc911x_rx_dma_start(pdata, skb, pktwords)) {
+			pdata->fifo_stats.rx_dma_packets++;
+			pdata->fifo_stats.rx_dma_ns += local_clock() - start;
+			/* Out of budget, the next poll picks the packet up */
+			if (npackets == budget)
+				break;
+			goto wait_dma;
+		}
+
 		pdata->ops->rx_readfifo(pdata,
 				 (unsigned int *)skb->head, pktwords);
-		skb->protocol = eth_type_trans(skb, dev);
-		skb_checksum_none_assert(skb);
-		netif_receive_skb(skb);
-
-		/* Update counters */
-		dev->stats.rx_packets++;
-		dev->stats.rx_bytes += (pktlength - 4);
+		pdata->fifo_stats.rx_pio_packets++;
+		pdata->fifo_stats.rx_pio_ns += local_clock() - start;
+		smsc911x_rx_deliver(dev, skb);
 	}
 
 	/* Return total received packets */
 	return npackets;
+
+wait_dma:
+	/* Sleep until the RX transfer completes, the interrupt stays off */
+	napi_complete(napi);
+	smp_mb();
+	if (smsc911x_rx_dma_done(pdata))
+		napi_reschedule(napi);
+	return npackets;
 }
 
 /* Returns hash bit number for given MAC address
@@ -1628,6 +2124,7 @@ static int smsc911x_stop(struct net_device *dev)
 	/* Stop Tx and Rx polling */
 	netif_stop_queue(dev);
 	napi_disable(&pdata->napi);
+	smsc911x_dma_stop(pdata);
 
 	/* At this point all Rx and Tx activity is stopped */
 	dev->stats.rx_dropped += smsc911x_reg_read(pdata, RX_DROP);
@@ -1651,6 +2148,7 @@ static int smsc911x_hard_start_xmit(struct sk_buff *skb, struct net_device *dev)
 	unsigned int temp;
 	u32 wrsz;
 	ulong bufp;
+	u64 start;
 
 	freespace = smsc911x_reg_read(pdata, TX_FIFO_INF) & TX_FIFO_INF_TDFREE_;
 
@@ -1674,10 +2172,20 @@ static int smsc911x_hard_start_xmit(struct sk_buff *skb, struct net_device *dev)
 	wrsz += (u32)((ulong)skb->data & 0x3);
 	wrsz >>= 2;
 
-	pdata->ops->tx_writefifo(pdata, (unsigned int *)bufp, wrsz);
 	freespace -= (skb->len + 32);
 	skb_tx_timestamp(skb);
-	dev_kfree_skb(skb);
+
+	start = local_clock();
+	if (smsc911x_use_dma(pdata, skb->len) &&
+	    !smsc911x_tx_dma_start(pdata, skb, (unsigned int *)bufp, wrsz)) {
+		pdata->fifo_stats.tx_dma_packets++;
+		pdata->fifo_stats.tx_dma_ns += local_clock() - start;
+	} else {
+		pdata->ops->tx_writefifo(pdata, (unsigned int *)bufp, wrsz);
+		dev_kfree_skb(skb);
+		pdata->fifo_stats.tx_pio_packets++;
+		pdata->fifo_stats.tx_pio_ns += local_clock() - start;
+	}
 
 	if (unlikely(smsc911x_tx_get_txstatcount(pdata) >= 30))
 		smsc911x_tx_update_txcounters(dev);
@@ -1811,7 +2319,9 @@ static irqreturn_t smsc911x_irqhandler(int irq, void *dev_id)
 		temp |= FIFO_INT_TX_AVAIL_LEVEL_;
 		smsc911x_reg_write(pdata, FIFO_INT, temp);
 		smsc911x_reg_write(pdata, INT_STS, INT_STS_TDFA_);
-		netif_wake_queue(dev);
+		/* a TX DMA completion wakes the queue itself */
+		if (!smsc911x_tx_dma_pending(pdata))
+			netif_wake_queue(dev);
 		serviced = IRQ_HANDLED;
 	}
 
@@ -2084,6 +2594,40 @@ static int smsc911x_ethtool_set_eeprom(struct net_device *dev,
 	return ret;
 }
 
+static const char smsc911x_gstrings_fifo_stats[][ETH_GSTRING_LEN] = {
+	"rx_pio_packets", "rx_pio_ns", "rx_dma_packets", "rx_dma_ns",
+	"tx_pio_packets", "tx_pio_ns", "tx_dma_packets", "tx_dma_ns",
+};
+
+static int smsc911x_ethtool_get_sset_count(struct net_device *dev, int sset)
+{
+	switch (sset) {
+	case ETH_SS_STATS:
+		return ARRAY_SIZE(smsc911x_gstrings_fifo_stats);
+	default:
+		return -EOPNOTSUPP;
+	}
+}
+
+static void smsc911x_ethtool_get_strings(struct net_device *dev,
+					 u32 stringset, u8 *data)
+{
+	if (stringset == ETH_SS_STATS)
+		memcpy(data, smsc911x_gstrings_fifo_stats,
+		       sizeof(smsc911x_gstrings_fifo_stats));
+}
+
+static void smsc911x_ethtool_get_ethtool_stats(struct net_device *dev,
+					       struct ethtool_stats *stats,
+					       u64 *data)
+{
+	struct smsc911x_data *pdata = netdev_priv(dev);
+
+	BUILD_BUG_ON(sizeof(pdata->fifo_stats) !=
+		     ARRAY_SIZE(smsc911x_gstrings_fifo_stats) * sizeof(u64));
+	memcpy(data, &pdata->fifo_stats, sizeof(pdata->fifo_stats));
+}
+
 static const struct ethtool_ops smsc911x_ethtool_ops = {
 	.get_settings = smsc911x_ethtool_getsettings,
 	.set_settings = smsc911x_ethtool_setsettings,
@@ -2097,6 +2641,9 @@ static const struct ethtool_ops smsc911x_ethtool_ops = {
 	.get_eeprom_len = smsc911x_ethtool_get_eeprom_len,
 	.get_eeprom = smsc911x_ethtool_get_eeprom,
 	.set_eeprom = smsc911x_ethtool_set_eeprom,
+	.get_sset_count = smsc911x_ethtool_get_sset_count,
+	.get_strings = smsc911x_ethtool_get_strings,
+	.get_ethtool_stats = smsc911x_ethtool_get_ethtool_stats,
 };
 
 static const struct net_device_ops smsc911x_netdev_ops = {
@@ -2280,6 +2827,7 @@ static int __devexit smsc911x_drv_remove(struct platform_device *pdev)
 	platform_set_drvdata(pdev, NULL);
 	unregister_netdev(dev);
 	free_irq(dev->irq, dev);
+	smsc911x_dma_release(pdev, pdata);
 	res = platform_get_resource_byname(pdev, IORESOURCE_MEM,
 					   "smsc911x-memory");
 	if (!res)
@@ -2469,6 +3017,8 @@ static int __devinit smsc911x_drv_probe(struct platform_device *pdev)
 	if (retval < 0)
 		goto out_disable_resources;
 
+	smsc911x_dma_init(pdev, pdata, res->start);
+
 	/* configure irq polarity and type before connecting isr */
 	if (pdata->config.irq_polarity == SMSC911X_IRQ_POLARITY_ACTIVE_HIGH)
 		intcfg |= INT_CFG_IRQ_POL_;
@@ -2545,6 +3095,7 @@ out_unregister_netdev_5:
 out_free_irq:
 	free_irq(dev->irq, dev);
 out_disable_resources:
+	smsc911x_dma_release(pdev, pdata);
 	(void)smsc911x_disable_resources(pdev);
 out_return_resources:
 	smsc911x_free_resources(pdev);
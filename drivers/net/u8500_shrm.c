@@ -42,17 +42,11 @@ int shrm_net_receive(struct net_device *dev)
 	isadev = &shrm->isa_context->isadev[ISI_MESSAGING];
 	q = &isadev->dl_queue;
 
-	spin_lock_bh(&q->update_lock);
-	if (list_empty(&q->msg_list)) {
-		spin_unlock_bh(&q->update_lock);
-		dev_dbg(shrm->dev, "Empty Shrm queue\n");
-		return 0;
-	}
-	spin_unlock_bh(&q->update_lock);
-
 	msgsize = get_size_of_new_msg(q);
-	if (msgsize <= 0)
+	if (msgsize <= 0) {
+		dev_dbg(shrm->dev, "Empty Shrm queue\n");
 		return msgsize;
+	}
 
 	/*
 	 * The packet has been retrieved from the transmission
@@ -85,14 +79,28 @@ int shrm_net_receive(struct net_device *dev)
 		skb_put(skb, msgsize);
 	}
 
-	spin_lock_bh(&q->update_lock);
 	remove_msg_from_queue(q);
-	spin_unlock_bh(&q->update_lock);
+
+	return shrm_net_receive_skb(dev, skb);
+out:
+	return -ENOMEM;
+}
+
+/**
+ * shrm_net_receive_skb() - pass a received message to the phonet stack
+ * @dev:	pointer to the network device structure
+ * @skb:	the message, including the phonet link header
+ *
+ * Returns the length of the message.
+ */
+int shrm_net_receive_skb(struct net_device *dev, struct sk_buff *skb)
+{
+	u32 msgsize = skb->len;
 
 	skb_reset_mac_header(skb);
 	__skb_pull(skb, dev->hard_header_len);
 	/*Write metadata, and then pass to the receive level*/
-	skb->dev = dev;/*kmalloc(sizeof(struct net_device), GFP_ATOMIC);*/
+	skb->dev = dev;
 	skb->protocol = htons(ETH_P_PHONET);
 	skb->priority = 0;
 	skb->ip_summed = CHECKSUM_UNNECESSARY; /* don't check it */
@@ -103,8 +111,30 @@ int shrm_net_receive(struct net_device *dev)
 		dev->stats.rx_dropped++;
 
 	return msgsize;
-out:
-	return -ENOMEM;
+}
+
+/**
+ * shrm_net_rx_direct() - check if ISI messages may bypass the ISI queue
+ * @shrm:	pointer to the shrm device information structure
+ *
+ * Messages can go straight from the FIFO to the network interface when it
+ * is up and no earlier message is still waiting to be delivered by the
+ * phonet receive tasklet, so that ordering is kept.
+ */
+bool shrm_net_rx_direct(struct shrm_dev *shrm)
+{
+	if (!shrm->netdev_flag_up)
+		return false;
+
+	/*
+	 * The tasklet takes a message off the ISI queue before passing it
+	 * up, so the queue is only known to be drained once the tasklet is
+	 * neither scheduled nor running.
+	 */
+	if (ACCESS_ONCE(phonet_rcv_tasklet.state))
+		return false;
+
+	return msg_queue_empty(&shrm->isa_context->isadev[ISI_MESSAGING].dl_queue);
 }
 
 static int netdev_isa_open(struct net_device *dev)
@@ -154,8 +184,8 @@ static struct net_device_stats *netdev_isa_stats(struct net_device *dev)
  * @skb:	pointer to the socket buffer
  * @dev:	pointer to the network device structure
  *
- * Copies data(ISI message) from the user buffer to the kernel buffer and
- * schedule transfer thread to transmit the message to the modem via FIFO.
+ * Gathers the ISI message from the socket buffer straight into the FIFO and
+ * schedules the transfer thread to notify the modem.
  */
 static netdev_tx_t netdev_isa_write(struct sk_buff *skb, struct net_device *dev)
 {
@@ -165,6 +195,13 @@ static netdev_tx_t netdev_isa_write(struct sk_buff *skb, struct net_device *dev)
 			(struct shrm_net_iface_priv *)netdev_priv(dev);
 	struct shrm_dev *shrm = net_iface_priv->shrm_device;
 
+	/* The header fixup below needs the phonet header in the linear part */
+	if (!pskb_may_pull(skb, PIPE_HDL_INDEX + 1)) {
+		dev->stats.tx_dropped++;
+		dev_kfree_skb(skb);
+		return NETDEV_TX_OK;
+	}
+
 	/*
 	 * FIXME:
 	 * U8500 modem requires that Pipe created/enabled Indication should
@@ -192,8 +229,7 @@ static netdev_tx_t netdev_isa_write(struct sk_buff *skb, struct net_device *dev)
 	}
 
 	spin_lock_bh(&shrm->isa_context->common_tx);
-	err = shm_write_msg(shrm, ISI_MESSAGING, skb->data,
-			skb->len);
+	err = shm_write_skb(shrm, ISI_MESSAGING, skb);
 	if (!err) {
 		dev->stats.tx_packets++;
 		dev->stats.tx_bytes += skb->len;
@@ -230,6 +266,8 @@ static void shm_net_init(struct net_device *dev)
 	dev->tx_queue_len = PN_TX_QUEUE_LEN;
 	dev->destructor = free_netdev;
 	dev->dev_addr[0] = PN_LINK_ADDR;
+	/* no checksum on Phonet, HW_CSUM keeps SG enabled */
+	dev->features = NETIF_F_SG | NETIF_F_FRAGLIST | NETIF_F_HW_CSUM;
 	net_iface_priv = netdev_priv(dev);
 	memset(net_iface_priv, 0 , sizeof(struct shrm_net_iface_priv));
 }
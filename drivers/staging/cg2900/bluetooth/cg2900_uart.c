@@ -34,6 +34,7 @@
 #include <linux/tty_ldisc.h>
 #include <linux/types.h>
 #include <linux/workqueue.h>
+#include <asm/unaligned.h>
 #include <net/bluetooth/bluetooth.h>
 #include <net/bluetooth/hci.h>
 
@@ -67,6 +68,12 @@
 #define RX_SKB_RESERVE		8
 /* Max size of received packet (not including reserved bytes) */
 #define RX_SKB_MAX_SIZE		1024
+/* Number of RX_SKB_MAX_SIZE sk_buffers kept for reuse */
+#define RX_SKB_POOL_SIZE	8
+/* Max size of one UART write built from coalesced ACL packets */
+#define TX_COALESCE_MAX_SIZE	RX_SKB_MAX_SIZE
+/* ACL packets up to this size are coalesced by default */
+#define TX_COALESCE_DEFAULT	256
 
 /* Size of the header in the different packets */
 #define HCI_BT_EVT_HDR_SIZE	2
@@ -273,6 +280,8 @@ struct uart_delayed_work_struct {
  * @rx_skb:		SK_buffer to store the received data into.
  * @tx_queue:		TX queue for sending data to chip.
  * @rx_skb_lock	Spin lock to protect rx_skb.
+ * @rx_pool:		Free sk_buffers for received packets, refilled with sent
+ *			ones.
  * @hu:			Hci uart structure.
  * @wq:			UART work queue.
  * @baud_rate_state:	UART baud rate change state.
@@ -301,6 +310,7 @@ struct uart_info {
 	struct sk_buff			*rx_skb;
 	struct sk_buff_head		tx_queue;
 	spinlock_t			rx_skb_lock;
+	struct sk_buff_head		rx_pool;
 
 	struct hci_uart			*hu;
 
@@ -330,6 +340,7 @@ struct uart_info {
 static int uart_default_baud = DEFAULT_BAUD_RATE;
 static int uart_high_baud = HIGH_BAUD_RATE;
 static int uart_debug;
+static int uart_tx_coalesce = TX_COALESCE_DEFAULT;
 
 static DECLARE_WAIT_QUEUE_HEAD(uart_wait_queue);
 
@@ -969,14 +980,60 @@ static struct sk_buff *alloc_rx_skb(unsigned int size, gfp_t priority)
 {
 	struct sk_buff *skb;
 
-	/* Allocate the SKB and reserve space for the header */
-	skb = alloc_skb(size + RX_SKB_RESERVE, priority);
+	/*
+	 * Allocate the SKB and reserve space for the header. Data starts
+	 * where it does in a recycled sk_buffer, see recycle_skb().
+	 */
+	skb = alloc_skb(size + NET_SKB_PAD + RX_SKB_RESERVE, priority);
 	if (skb)
-		skb_reserve(skb, RX_SKB_RESERVE);
+		skb_reserve(skb, NET_SKB_PAD + RX_SKB_RESERVE);
+
+	return skb;
+}
+
+/**
+ * get_rx_skb() - Get an sk_buff structure for receiving data from controller.
+ * @uart_info:	Main UART info structure.
+ * @size:	Size in number of octets.
+ *
+ * Takes an sk_buffer from the pool of recycled ones if possible and
+ * allocates a new one otherwise.
+ *
+ * Returns:
+ *   Pointer to sk_buff structure, NULL if allocation failed.
+ */
+static struct sk_buff *get_rx_skb(struct uart_info *uart_info,
+				  unsigned int size)
+{
+	struct sk_buff *skb = NULL;
 
+	if (size <= RX_SKB_MAX_SIZE)
+		skb = skb_dequeue(&uart_info->rx_pool);
+	if (!skb)
+		return alloc_rx_skb(size, GFP_ATOMIC);
+
+	skb_reserve(skb, RX_SKB_RESERVE);
 	return skb;
 }
 
+/**
+ * recycle_skb() - Free an sk_buff or keep it for receiving data.
+ * @uart_info:	Main UART info structure.
+ * @skb:	sk_buffer no longer used.
+ *
+ * Sent packets and packets consumed by the UART driver itself are put in
+ * the RX pool if they are large enough, so that the receive path does not
+ * have to allocate in atomic context.
+ */
+static void recycle_skb(struct uart_info *uart_info, struct sk_buff *skb)
+{
+	if (skb_queue_len(&uart_info->rx_pool) < RX_SKB_POOL_SIZE &&
+	    skb_recycle_check(skb, RX_SKB_MAX_SIZE + RX_SKB_RESERVE))
+		skb_queue_tail(&uart_info->rx_pool, skb);
+	else
+		kfree_skb(skb);
+}
+
 /**
  * finish_setting_baud_rate() - Handles sending the ste baud rate hci cmd.
  * @hu:	Pointer to associated Hci uart structure.
@@ -1546,7 +1603,7 @@ static void send_skb_to_core(struct uart_info *uart_info, struct sk_buff *skb)
 			uart_info->baud_rate_state = BAUD_FAIL;
 		}
 		wake_up_all(&uart_wait_queue);
-		kfree_skb(skb);
+		recycle_skb(uart_info, skb);
 	} else if (BAUD_SENDING_RESET == uart_info->baud_rate_state) {
 		/*
 		 * Should only really be one packet received now:
@@ -1587,7 +1644,7 @@ static void send_skb_to_core(struct uart_info *uart_info, struct sk_buff *skb)
 			uart_info->baud_rate_state = BAUD_FAIL;
 		}
 		wake_up_all(&uart_wait_queue);
-		kfree_skb(skb);
+		recycle_skb(uart_info, skb);
 	} else {
 		/* Just pass data to CG2900 Core */
 		uart_info->chip_dev.c_cb.data_from_chip
@@ -1658,13 +1715,53 @@ static void work_restart_sleep(struct work_struct *work)
 	spin_unlock_bh(&(uart_info->transmission_lock));
 }
 
+/**
+ * h4_packet_len() - Get length of an H:4 packet from its header.
+ * @data:	Received data starting with the H:4 packet type.
+ * @count:	Number of bytes available in @data.
+ *
+ * Returns:
+ *   Length of the packet including H:4 and packet headers,
+ *   0 if the packet header is not complete in @data,
+ *   -EINVAL if the packet type is unknown.
+ */
+static int h4_packet_len(const u8 *data, int count)
+{
+	switch (data[0]) {
+	case HCI_BT_EVT_H4_CHANNEL:
+		if (count < HCI_H4_SIZE + HCI_BT_EVT_HDR_SIZE)
+			return 0;
+		return HCI_H4_SIZE + HCI_BT_EVT_HDR_SIZE +
+			data[HCI_EVT_LEN_POS];
+	case HCI_BT_ACL_H4_CHANNEL:
+		if (count < HCI_H4_SIZE + HCI_BT_ACL_HDR_SIZE)
+			return 0;
+		return HCI_H4_SIZE + HCI_BT_ACL_HDR_SIZE +
+			get_unaligned_le16(&data[HCI_ACL_LEN_POS]);
+	case HCI_FM_RADIO_H4_CHANNEL:
+		if (count < HCI_H4_SIZE + HCI_FM_RADIO_HDR_SIZE)
+			return 0;
+		return HCI_H4_SIZE + HCI_FM_RADIO_HDR_SIZE +
+			data[FM_RADIO_LEN_POS];
+	case HCI_GNSS_H4_CHANNEL:
+		if (count < HCI_H4_SIZE + HCI_GNSS_HDR_SIZE)
+			return 0;
+		return HCI_H4_SIZE + HCI_GNSS_HDR_SIZE +
+			get_unaligned_le16(&data[GNSS_LEN_POS]);
+	default:
+		return -EINVAL;
+	}
+}
+
 /**
  * cg2900_hu_receive() - Handles received UART data.
  * @data:	Data received
  * @count:	Number of bytes received
  *
  * The cg2900_hu_receive() function handles received UART data and puts it
- * together to one complete packet.
+ * together to one complete packet. Packets that are complete in the tty
+ * buffer are copied out of it directly, so only packets split over several
+ * calls go through the byte-oriented state machine.
  *
  * Returns:
  *   Number of bytes not handled, i.e. 0 = no error.
@@ -1680,6 +1777,7 @@ static int cg2900_hu_receive(struct hci_uart *hu,
 	union fm_leg_evt_or_irq	*fm;
 	struct gnss_hci_hdr	*gnss;
 	struct uart_info *uart_info = dev_get_drvdata(hu->proto->dev);
+	struct sk_buff *skb;
 	u8 *tmp;
 
 	r_ptr = (const u8 *)data;
@@ -1768,6 +1866,19 @@ static int cg2900_hu_receive(struct hci_uart *hu,
 		}
 
 check_h4_header:
+		/* Whole packet in the buffer? Then take it in one go. */
+		len = h4_packet_len(r_ptr, count);
+		if (len > 0 && len <= count && len <= RX_SKB_MAX_SIZE) {
+			skb = get_rx_skb(uart_info, len);
+			if (skb) {
+				memcpy(skb_put(skb, len), r_ptr, len);
+				r_ptr += len;
+				count -= len;
+				send_skb_to_core(uart_info, skb);
+				continue;
+			}
+		}
+
 		/* Check which H:4 packet this is and update RX states */
 		if (*r_ptr == HCI_BT_EVT_H4_CHANNEL) {
 			uart_info->rx_state = W4_EVENT_HDR;
@@ -1793,7 +1904,7 @@ check_h4_header:
 		 * Allocate packet. We do not yet know the size and therefore
 		 * allocate max size.
 		 */
-		uart_info->rx_skb = alloc_rx_skb(RX_SKB_MAX_SIZE, GFP_ATOMIC);
+		uart_info->rx_skb = get_rx_skb(uart_info, RX_SKB_MAX_SIZE);
 		if (!uart_info->rx_skb) {
 			dev_err(MAIN_DEV,
 				"Can't allocate memory for new packet\n");
@@ -1880,6 +1991,7 @@ static int cg2900_hu_close(struct hci_uart *hu)
 
 	/* Purge any stored sk_buffers */
 	skb_queue_purge(&uart_info->tx_queue);
+	skb_queue_purge(&uart_info->rx_pool);
 
 	spin_lock_bh(&uart_info->rx_skb_lock);
 	if (uart_info->rx_skb) {
@@ -1899,6 +2011,79 @@ static int cg2900_hu_close(struct hci_uart *hu)
 	return 0;
 }
 
+/**
+ * is_small_acl() - Check if sk_buffer holds an ACL packet worth coalescing.
+ * @skb:	sk_buffer including H:4 header.
+ *
+ * Returns:
+ *   true - if ACL packet of at most uart_tx_coalesce bytes;
+ *   false - otherwise.
+ */
+static bool is_small_acl(const struct sk_buff *skb)
+{
+	return (int)skb->len <= uart_tx_coalesce &&
+		skb->data[0] == HCI_BT_ACL_H4_CHANNEL;
+}
+
+/**
+ * coalesce_tx_skb() - Merge queued small ACL packets into one UART write.
+ * @uart_info:	Main UART info structure.
+ * @skb:	Packet dequeued for sending.
+ *
+ * H:4 packets are just concatenated on the wire, so small ACL packets
+ * waiting in the TX queue behind @skb are copied after it into a single
+ * sk_buffer, saving a tty write per packet.
+ *
+ * Returns:
+ *   sk_buffer to send, @skb if nothing was merged.
+ */
+static struct sk_buff *coalesce_tx_skb(struct uart_info *uart_info,
+				       struct sk_buff *skb)
+{
+	struct sk_buff_head *queue = &uart_info->tx_queue;
+	struct sk_buff_head merge;
+	struct sk_buff *merged;
+	struct sk_buff *next;
+	unsigned int len = skb->len;
+	unsigned long flags;
+
+	if (!is_small_acl(skb))
+		return skb;
+
+	__skb_queue_head_init(&merge);
+
+	spin_lock_irqsave(&queue->lock, flags);
+	while ((next = skb_peek(queue)) && is_small_acl(next) &&
+	       len + next->len <= TX_COALESCE_MAX_SIZE) {
+		__skb_unlink(next, queue);
+		__skb_queue_tail(&merge, next);
+		len += next->len;
+	}
+	spin_unlock_irqrestore(&queue->lock, flags);
+
+	if (skb_queue_empty(&merge))
+		return skb;
+
+	merged = get_rx_skb(uart_info, TX_COALESCE_MAX_SIZE);
+	if (!merged) {
+		/* Send them one by one instead */
+		spin_lock_irqsave(&queue->lock, flags);
+		skb_queue_splice(&merge, queue);
+		spin_unlock_irqrestore(&queue->lock, flags);
+		return skb;
+	}
+
+	bt_cb(merged)->pkt_type = bt_cb(skb)->pkt_type;
+	memcpy(skb_put(merged, skb->len), skb->data, skb->len);
+	recycle_skb(uart_info, skb);
+	while ((next = __skb_dequeue(&merge))) {
+		memcpy(skb_put(merged, next->len), next->data, next->len);
+		recycle_skb(uart_info, next);
+	}
+
+	return merged;
+}
+
 /**
  * cg2900_hu_dequeue() - Get new skbuff.
  * @hu: Pointer to associated hci_uart structure.
@@ -1929,6 +2114,9 @@ static struct sk_buff *cg2900_hu_dequeue(struct hci_uart *hu)
 
 	spin_unlock_bh(&(uart_info->transmission_lock));
 
+	if (skb && BAUD_IDLE == uart_info->baud_rate_state)
+		skb = coalesce_tx_skb(uart_info, skb);
+
 	if (BAUD_SENDING == uart_info->baud_rate_state && !skb)
 		finish_setting_baud_rate(hu);
 	/*
@@ -1949,6 +2137,18 @@ static struct sk_buff *cg2900_hu_dequeue(struct hci_uart *hu)
 	return skb;
 }
 
+/**
+ * cg2900_hu_tx_done() - Handle sk_buffer written to the UART.
+ * @hu:		Pointer to associated hci_uart structure.
+ * @skb:	Sent sk_buffer.
+ */
+static void cg2900_hu_tx_done(struct hci_uart *hu, struct sk_buff *skb)
+{
+	struct uart_info *uart_info = dev_get_drvdata(hu->proto->dev);
+
+	recycle_skb(uart_info, skb);
+}
+
 /**
  * cg2900_hu_flush() - Flush buffers.
  * @hu: Pointer to associated hci_uart structure.
@@ -1995,6 +2195,7 @@ static int __devinit cg2900_uart_probe(struct platform_device *pdev)
 
 	spin_lock_init(&(uart_info->transmission_lock));
 	spin_lock_init(&(uart_info->rx_skb_lock));
+	skb_queue_head_init(&uart_info->rx_pool);
 
 	uart_info->chip_dev.t_cb.open = uart_open;
 	uart_info->chip_dev.t_cb.close = uart_close;
@@ -2062,6 +2263,7 @@ static int __devinit cg2900_uart_probe(struct platform_device *pdev)
 	p->recv		= &cg2900_hu_receive;
 	p->dequeue	= &cg2900_hu_dequeue;
 	p->flush	= &cg2900_hu_flush;
+	p->tx_done	= &cg2900_hu_tx_done;
 
 	dev_set_drvdata(uart_info->dev, (void *)uart_info);
 
@@ -2106,6 +2308,7 @@ static int __devexit cg2900_uart_remove(struct platform_device *pdev)
 
 	pm_qos_remove_request(&uart_info->pm_qos_latency);
 	destroy_workqueue(uart_info->wq);
+	skb_queue_purge(&uart_info->rx_pool);
 
 	dev_info(MAIN_DEV, "CG2900 UART removed\n");
 	kfree(uart_info);
@@ -2164,6 +2367,11 @@ MODULE_PARM_DESC(uart_high_baud,
 
 module_param(uart_debug, int, S_IRUGO | S_IWUSR | S_IWGRP);
 MODULE_PARM_DESC(uart_debug, "Enable/Disable debug. 0 means Debug disabled.");
+
+module_param(uart_tx_coalesce, int, S_IRUGO | S_IWUSR | S_IWGRP);
+MODULE_PARM_DESC(uart_tx_coalesce,
+		 "ACL packets up to this size in bytes are sent together in "
+		 "one UART write. 0 disables coalescing.");
 MODULE_AUTHOR("Par-Gunnar Hjalmdahl ST-Ericsson");
 MODULE_LICENSE("GPL v2");
 MODULE_DESCRIPTION("ST-Ericsson CG2900 UART Driver");
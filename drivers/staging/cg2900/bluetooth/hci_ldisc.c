@@ -145,7 +145,10 @@ restart:
 		}
 
 		hci_uart_tx_complete(hu, bt_cb(skb)->pkt_type);
-		kfree_skb(skb);
+		if (hu->proto->tx_done)
+			hu->proto->tx_done(hu, skb);
+		else
+			kfree_skb(skb);
 	}
 
 	if (test_bit(HCI_UART_TX_WAKEUP, &hu->tx_state))
@@ -57,6 +57,7 @@ struct hci_uart_proto {
 	int (*recv)(struct hci_uart *hu, void *data, int len);
 	int (*enqueue)(struct hci_uart *hu, struct sk_buff *skb);
 	struct sk_buff *(*dequeue)(struct hci_uart *hu);
+	void (*tx_done)(struct hci_uart *hu, struct sk_buff *skb);
 	bool register_hci_dev;
 	struct device *dev;
 };
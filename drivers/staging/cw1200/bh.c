@@ -15,6 +15,8 @@
  */
 
 #include <net/mac80211.h>
+#include <linux/module.h>
+#include <linux/slab.h>
 #include <linux/kthread.h>
 
 #include "cw1200.h"
@@ -40,6 +42,17 @@ static int cw1200_bh(void *arg);
 #define PIGGYBACK_CTRL_REG	(2)
 #define EFFECTIVE_BUF_SIZE	(MAX_SZ_RD_WR_BUFFERS - PIGGYBACK_CTRL_REG)
 
+#if defined(CONFIG_CW1200_TX_AGGREGATION)
+/* Upper limit of WSM messages packed into one input queue write */
+#define CW1200_TX_AGGR_MAX	8
+
+/* Fixed at load time: the firmware has to know the input queue format */
+static int tx_aggr_max = 4;
+module_param(tx_aggr_max, int, 0444);
+MODULE_PARM_DESC(tx_aggr_max, "Max WSM messages per SDIO TX transfer "
+		 "(1 disables aggregation)");
+#endif /* CONFIG_CW1200_TX_AGGREGATION */
+
 /* Suspend state privates */
 enum cw1200_bh_pm_state {
 	CW1200_BH_RESUMED = 0,
@@ -66,10 +79,21 @@ int cw1200_register_bh(struct cw1200_common *priv)
 	priv->buf_id_rx = 0;
 	init_waitqueue_head(&priv->bh_wq);
 	init_waitqueue_head(&priv->bh_evt_wq);
+#if defined(CONFIG_CW1200_TX_AGGREGATION)
+	/* Room for rounding the transfer up to the block size */
+	priv->tx_aggr_buf = kmalloc(EFFECTIVE_BUF_SIZE + SDIO_BLOCK_SIZE,
+				    GFP_KERNEL);
+	if (!priv->tx_aggr_buf)
+		return -ENOMEM;
+#endif /* CONFIG_CW1200_TX_AGGREGATION */
 	priv->bh_thread = kthread_create(&cw1200_bh, priv, "cw1200_bh");
 	if (IS_ERR(priv->bh_thread)) {
 		err = PTR_ERR(priv->bh_thread);
 		priv->bh_thread = NULL;
+#if defined(CONFIG_CW1200_TX_AGGREGATION)
+		kfree(priv->tx_aggr_buf);
+		priv->tx_aggr_buf = NULL;
+#endif /* CONFIG_CW1200_TX_AGGREGATION */
 	} else {
 		WARN_ON(sched_setscheduler(priv->bh_thread,
 			SCHED_FIFO, &param));
@@ -95,6 +119,10 @@ void cw1200_unregister_bh(struct cw1200_common *priv)
 #ifdef HAS_PUT_TASK_STRUCT
 	put_task_struct(thread);
 #endif
+#if defined(CONFIG_CW1200_TX_AGGREGATION)
+	kfree(priv->tx_aggr_buf);
+	priv->tx_aggr_buf = NULL;
+#endif /* CONFIG_CW1200_TX_AGGREGATION */
 }
 
 void cw1200_irq_handler(struct cw1200_common *priv)
@@ -239,6 +267,172 @@ static int cw1200_device_wakeup(struct cw1200_common *priv)
 	return 0;
 }
 
+static size_t cw1200_bh_align_tx(struct cw1200_common *priv, size_t tx_len)
+{
+#if defined(CONFIG_CW1200_NON_POWER_OF_TWO_BLOCKSIZES)
+	tx_len = priv->sbus_ops->align_size(priv->sbus_priv, tx_len);
+#else /* CONFIG_CW1200_NON_POWER_OF_TWO_BLOCKSIZES */
+	/* HACK!!! Platform limitation.
+	 * It is also supported by upper layer:
+	 * there is always enough space at the
+	 * end of the buffer. */
+	if (tx_len & (SDIO_BLOCK_SIZE - 1)) {
+		tx_len &= ~(SDIO_BLOCK_SIZE - 1);
+		tx_len += SDIO_BLOCK_SIZE;
+	}
+#endif /* CONFIG_CW1200_NON_POWER_OF_TWO_BLOCKSIZES */
+
+	/* Check if not exceeding CW1200 capabilities */
+	if (WARN_ON_ONCE(tx_len > EFFECTIVE_BUF_SIZE))
+		printk(KERN_DEBUG "Write aligned len: %d\n", tx_len);
+
+	return tx_len;
+}
+
+static void cw1200_bh_dump_tx(struct cw1200_common *priv, u8 *data)
+{
+#if defined(CONFIG_CW1200_WSM_DUMPS)
+	struct wsm_hdr *wsm = (struct wsm_hdr *)data;
+	size_t wsm_dump_max = -1;
+
+#if defined(CONFIG_CW1200_WSM_DUMPS_SHORT)
+	wsm_dump_max = priv->wsm_dump_max_size;
+#endif /* CONFIG_CW1200_WSM_DUMPS_SHORT */
+	if (unlikely(priv->wsm_enable_wsm_dumps))
+		print_hex_dump_bytes("--> ", DUMP_PREFIX_NONE, data,
+			min_t(size_t, __le16_to_cpu(wsm->len), wsm_dump_max));
+#endif /* CONFIG_CW1200_WSM_DUMPS */
+}
+
+static void cw1200_bh_set_tx_seq(struct cw1200_common *priv, u8 *data)
+{
+	struct wsm_hdr *wsm = (struct wsm_hdr *)data;
+
+	wsm->id &= __cpu_to_le32(~WSM_TX_SEQ(WSM_TX_SEQ_MAX));
+	wsm->id |= cpu_to_le32(WSM_TX_SEQ(priv->wsm_tx_seq));
+}
+
+/* Send one WSM message in its own input queue write. */
+static int cw1200_bh_tx_one(struct cw1200_common *priv, u8 *data,
+			    size_t tx_len)
+{
+	tx_len = cw1200_bh_align_tx(priv, tx_len);
+	cw1200_bh_set_tx_seq(priv, data);
+
+	if (WARN_ON(cw1200_data_write(priv, data, tx_len))) {
+		wsm_release_tx_buffer(priv, 1);
+		return -EIO;
+	}
+
+	cw1200_bh_dump_tx(priv, data);
+	wsm_txed(priv, data);
+	priv->wsm_tx_seq = (priv->wsm_tx_seq + 1) & WSM_TX_SEQ_MAX;
+	cw1200_debug_tx_frames(priv, 1);
+	return 1;
+}
+
+#if defined(CONFIG_CW1200_TX_AGGREGATION)
+/*
+ * Give up on a message fetched for packing that does not fit. A command
+ * stays pending and goes out in the next write; a frame is dropped from
+ * its queue like wsm_handle_tx_data() drops one.
+ */
+static void cw1200_bh_tx_drop(struct cw1200_common *priv, u8 *data)
+{
+	struct wsm_tx *wsm = (struct wsm_tx *)data;
+	u32 packet_id = __le32_to_cpu(wsm->packetID);
+	u8 queue_id = cw1200_queue_get_queue_id(packet_id);
+
+	wsm_release_tx_buffer(priv, 1);
+	if (data == priv->wsm_cmd.ptr ||
+			queue_id >= ARRAY_SIZE(priv->tx_queue))
+		return;
+	WARN_ON(cw1200_queue_remove(&priv->tx_queue[queue_id], packet_id));
+}
+
+/*
+ * Pack the message in data and further queued messages into one input
+ * queue write. Each message is padded to 4 bytes and keeps its own WSM
+ * header, sequence number and input buffer accounting; the firmware
+ * walks them using the WSM length. A message is only fetched while there
+ * is room left for the largest one the firmware accepts, so nothing
+ * ever has to be put back. A single message is sent in the same format
+ * so the firmware never has to guess which one it is looking at; only
+ * with tx_aggr_max at 1 are messages sent one by one, unpacked.
+ *
+ * Returns the number of messages sent or a negative error code.
+ */
+static int cw1200_bh_tx_aggr(struct cw1200_common *priv, u8 *data,
+			     size_t tx_len, int *tx_burst)
+{
+	u8 *msgs[CW1200_TX_AGGR_MAX];
+	u8 *buf = priv->tx_aggr_buf;
+	size_t max_len = priv->wsm_caps.sizeInpChBuf;
+	int max = min(tx_aggr_max, CW1200_TX_AGGR_MAX);
+	size_t len = 0;
+	int count = 0;
+	int ret;
+	int i;
+
+	for (;;) {
+		cw1200_bh_set_tx_seq(priv, data);
+		priv->wsm_tx_seq = (priv->wsm_tx_seq + 1) & WSM_TX_SEQ_MAX;
+		memcpy(&buf[len], data, tx_len);
+		len += ALIGN(tx_len, 4);
+		msgs[count++] = data;
+
+		if (count >= max || *tx_burst <= 1 ||
+				len + max_len + SDIO_BLOCK_SIZE >
+					EFFECTIVE_BUF_SIZE ||
+				priv->hw_bufs_used >=
+					priv->wsm_caps.numInpChBufs)
+			break;
+
+		wsm_alloc_tx_buffer(priv);
+		ret = wsm_get_tx(priv, &data, &tx_len, tx_burst);
+		if (ret <= 0) {
+			wsm_release_tx_buffer(priv, 1);
+			WARN_ON(ret < 0);
+			break;
+		}
+		if (WARN_ON_ONCE(tx_len > max_len)) {
+			cw1200_bh_tx_drop(priv, data);
+			break;
+		}
+	}
+
+	/* Terminate the message list for the firmware */
+	if (len < EFFECTIVE_BUF_SIZE) {
+		memset(&buf[len], 0, sizeof(struct wsm_hdr));
+		len += sizeof(struct wsm_hdr);
+	}
+
+	if (WARN_ON(cw1200_data_write(priv, buf,
+			cw1200_bh_align_tx(priv, len)))) {
+		wsm_release_tx_buffer(priv, count);
+		return -EIO;
+	}
+
+	for (i = 0; i < count; ++i) {
+		cw1200_bh_dump_tx(priv, msgs[i]);
+		wsm_txed(priv, msgs[i]);
+	}
+	cw1200_debug_tx_frames(priv, count);
+	return count;
+}
+#endif /* CONFIG_CW1200_TX_AGGREGATION */
+
+/* Whether input queue writes use the packed format of cw1200_bh_tx_aggr(). */
+bool cw1200_bh_tx_packed(void)
+{
+#if defined(CONFIG_CW1200_TX_AGGREGATION)
+	return tx_aggr_max > 1;
+#else
+	return false;
+#endif /* CONFIG_CW1200_TX_AGGREGATION */
+}
+EXPORT_SYMBOL_GPL(cw1200_bh_tx_packed);
+
 /* Must be called from BH thraed. */
 void cw1200_enable_powersave(struct cw1200_common *priv,
 			     bool enable)
@@ -264,6 +458,7 @@ static int cw1200_bh(void *arg)
 	int pending_tx = 0;
 	int tx_burst;
 	int rx_burst = 0;
+	int rx_frames = 0;
 	long status;
 #if defined(CONFIG_CW1200_WSM_DUMPS)
 	size_t wsm_dump_max = -1;
@@ -271,6 +466,12 @@ static int cw1200_bh(void *arg)
 	u32 dummy;
 
 	for (;;) {
+		/* Messages read since the last wakeup */
+		if (rx_frames) {
+			cw1200_debug_rx_frames(priv, rx_frames);
+			rx_frames = 0;
+		}
+
 		if (!priv->hw_bufs_used
 				&& priv->powersave_enabled
 				&& !priv->device_can_sleep)
@@ -479,6 +680,7 @@ rx:
 			}
 
 			read_len = 0;
+			++rx_frames;
 
 			if (rx_burst) {
 				cw1200_debug_rx_burst(priv);
@@ -528,52 +730,16 @@ tx:
 				atomic_add(1, &priv->bh_tx);
 #endif
 
-
-#if defined(CONFIG_CW1200_NON_POWER_OF_TWO_BLOCKSIZES)
-				tx_len = priv->sbus_ops->align_size(
-						priv->sbus_priv, tx_len);
-#else /* CONFIG_CW1200_NON_POWER_OF_TWO_BLOCKSIZES */
-				/* HACK!!! Platform limitation.
-				* It is also supported by upper layer:
-				* there is always enough space at the
-				* end of the buffer. */
-				if (tx_len & (SDIO_BLOCK_SIZE - 1)) {
-					tx_len &= ~(SDIO_BLOCK_SIZE - 1);
-					tx_len += SDIO_BLOCK_SIZE;
-				}
-#endif /* CONFIG_CW1200_NON_POWER_OF_TWO_BLOCKSIZES */
-
-				/* Check if not exceeding CW1200
-				    capabilities */
-				if (WARN_ON_ONCE(
-				    tx_len > EFFECTIVE_BUF_SIZE)) {
-					printk(KERN_DEBUG "Write aligned len:"
-					" %d\n", tx_len);
-				}
-
-				wsm->id &= __cpu_to_le32(
-						~WSM_TX_SEQ(WSM_TX_SEQ_MAX));
-				wsm->id |= cpu_to_le32(
-						WSM_TX_SEQ(priv->wsm_tx_seq));
-
-				if (WARN_ON(cw1200_data_write(priv,
-				    data, tx_len))) {
-					wsm_release_tx_buffer(priv, 1);
+#if defined(CONFIG_CW1200_TX_AGGREGATION)
+				if (cw1200_bh_tx_packed())
+					ret = cw1200_bh_tx_aggr(priv, data,
+							tx_len, &tx_burst);
+				else
+#endif /* CONFIG_CW1200_TX_AGGREGATION */
+					ret = cw1200_bh_tx_one(priv, data,
+							tx_len);
+				if (ret < 0)
 					break;
-				}
-
-#if defined(CONFIG_CW1200_WSM_DUMPS)
-				if (unlikely(priv->wsm_enable_wsm_dumps))
-					print_hex_dump_bytes("--> ",
-						DUMP_PREFIX_NONE,
-						data,
-						min(__le32_to_cpu(wsm->len),
-						 wsm_dump_max));
-#endif /* CONFIG_CW1200_WSM_DUMPS */
-
-				wsm_txed(priv, data);
-				priv->wsm_tx_seq = (priv->wsm_tx_seq + 1) &
-						WSM_TX_SEQ_MAX;
 
 				if (tx_burst > 1) {
 					cw1200_debug_tx_burst(priv);
@@ -26,5 +26,6 @@ int cw1200_bh_resume(struct cw1200_common *priv);
 void cw1200_enable_powersave(struct cw1200_common *priv,
 			     bool enable);
 int wsm_release_tx_buffer(struct cw1200_common *priv, int count);
+bool cw1200_bh_tx_packed(void);
 
 #endif /* CW1200_BH_H */
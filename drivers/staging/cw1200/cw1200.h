@@ -193,6 +193,9 @@ struct cw1200_common {
 	int				wsm_tx_seq;	/* byte */
 	int				hw_bufs_used;
 	struct sk_buff			*skb_cache;
+#if defined(CONFIG_CW1200_TX_AGGREGATION)
+	u8				*tx_aggr_buf;
+#endif /* CONFIG_CW1200_TX_AGGREGATION */
 	bool				powersave_enabled;
 	bool				device_can_sleep;
 
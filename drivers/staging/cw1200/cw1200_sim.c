@@ -0,0 +1,844 @@
+/*
+ * Simulated SBUS backend for ST-Ericsson CW1200 mac80211 drivers
+ *
+ * Copyright (c) 2012, ST-Ericsson
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/*
+ * The simulated device implements the host interface registers used by
+ * the core driver and a minimal WSM firmware model behind them, so that
+ * the TX queues, the BH thread and the TX/RX paths can be benchmarked and
+ * profiled on a machine without CW1200 hardware:
+ *
+ *  - the device reports itself as CW1200 cut 2.2 already running in
+ *    queue mode, so no firmware image is downloaded;
+ *  - every WSM request is confirmed successfully, start-scan and set-pm
+ *    requests are followed by their completion indications;
+ *  - TX requests are confirmed by a firmware thread, in multi-TX confirms
+ *    once the host has enabled them;
+ *  - the firmware thread generates broadcast data frames of rx_len bytes
+ *    at rx_pps frames per second.
+ *
+ * debugfs cw1200_sim/bench reports packets per second and CPU time and
+ * cycles per packet since the previous read. CPU time comes from the
+ * scheduler tick accounting of all CPUs, so read it over several seconds
+ * on an otherwise idle system. TX load can be generated by, for example,
+ * starting an AP with hostapd and flooding the interface with broadcast
+ * traffic.
+ */
+
+#include <linux/module.h>
+#include <linux/platform_device.h>
+#include <linux/kthread.h>
+#include <linux/slab.h>
+#include <linux/debugfs.h>
+#include <linux/seq_file.h>
+#include <linux/kernel_stat.h>
+#include <linux/cpufreq.h>
+#include <linux/etherdevice.h>
+#include <linux/ieee80211.h>
+#include <asm/unaligned.h>
+
+#include "cw1200.h"
+#include "sbus.h"
+#include "hwio.h"
+#include "bh.h"
+
+MODULE_DESCRIPTION("Simulated ST-Ericsson CW1200 device for benchmarking");
+MODULE_LICENSE("GPL");
+
+/* Silicon type 2 in CONFIG: CW1200 cut 2.x, not versatile */
+#define SIM_CONFIG_INIT		(2 << 24)
+/* Depth of the device to host queue above which RX frames are dropped */
+#define SIM_OUT_QUEUE_MAX	64
+/* Largest message generated, well within a single host read */
+#define SIM_MSG_MAX		(0x1000 - 4)
+/* Size of a receive indication without the frame body */
+#define SIM_RX_HDR_LEN		(sizeof(struct wsm_hdr) + 12 + \
+				 sizeof(struct ieee80211_hdr_3addr) + 8)
+/* Size of one confirm entry of a TX confirm */
+#define SIM_TX_CONF_LEN		20
+
+static unsigned int rx_pps;
+module_param(rx_pps, uint, 0644);
+MODULE_PARM_DESC(rx_pps, "Generated RX frames per second (0: no RX)");
+
+static unsigned int rx_len = 1500;
+module_param(rx_len, uint, 0644);
+MODULE_PARM_DESC(rx_len, "Payload length of generated RX frames");
+
+static unsigned int in_bufs = 16;
+module_param(in_bufs, uint, 0444);
+MODULE_PARM_DESC(in_bufs, "Number of input buffers of the firmware");
+
+static unsigned int in_buf_size = 1632;
+module_param(in_buf_size, uint, 0444);
+MODULE_PARM_DESC(in_buf_size, "Size of firmware input buffers");
+
+struct sim_msg {
+	struct list_head	link;
+	size_t			len;
+	u8			data[0];
+};
+
+struct sim_tx_conf {
+	u32			packet_id;
+	int			link_id;
+};
+
+struct sim_stats {
+	ktime_t			time;
+	u64			busy;
+	u64			tx;
+	u64			rx;
+	u64			rx_dropped;
+	u64			tx_xfers;
+};
+
+struct sbus_priv {
+	struct platform_device	*pdev;
+	struct cw1200_common	*core;
+	struct mutex		bus_lock;
+
+	/* Host interface registers */
+	u32			config;
+	u16			control;
+	u32			dpll;
+
+	/* Device to host messages, protected by lock */
+	spinlock_t		lock;
+	struct list_head	out_queue;
+	int			out_count;
+	u8			out_seq;
+	sbus_irq_handler	irq_handler;
+	void			*irq_priv;
+
+	/* Firmware model; tx_conf is protected by lock */
+	struct task_struct	*thread;
+	wait_queue_head_t	wq;
+	struct sim_tx_conf	*tx_conf;
+	struct sim_tx_conf	*tx_conf_batch;
+	int			tx_conf_count;
+	bool			multi_tx_conf;
+	u8			mac[ETH_ALEN];
+	u16			rx_seq_ctrl;
+	unsigned int		rx_rate;
+	ktime_t			rx_start;
+	u64			rx_generated;
+
+	/* Statistics */
+	struct sim_stats	stats;
+	struct sim_stats	last;
+	struct dentry		*debugfs;
+};
+
+static struct sbus_priv *sim;
+
+/* ******************************************************************** */
+/* Device to host queue							*/
+
+static struct sim_msg *sim_alloc_msg(size_t len, u16 id)
+{
+	struct sim_msg *msg;
+
+	if (WARN_ON(len > SIM_MSG_MAX))
+		return NULL;
+
+	msg = kzalloc(sizeof(*msg) + len, GFP_KERNEL);
+	if (!msg)
+		return NULL;
+
+	msg->len = len;
+	put_unaligned_le16(len, &msg->data[0]);
+	put_unaligned_le16(id, &msg->data[2]);
+	return msg;
+}
+
+/* Stamp the sequence number, queue the message and raise the IRQ. */
+static void sim_send(struct sbus_priv *self, struct sim_msg *msg)
+{
+	sbus_irq_handler handler;
+	void *priv;
+	u16 id;
+
+	spin_lock(&self->lock);
+	id = get_unaligned_le16(&msg->data[2]);
+	id |= WSM_TX_SEQ(self->out_seq);
+	put_unaligned_le16(id, &msg->data[2]);
+	self->out_seq = (self->out_seq + 1) & WSM_TX_SEQ_MAX;
+	list_add_tail(&msg->link, &self->out_queue);
+	++self->out_count;
+	handler = self->irq_handler;
+	priv = self->irq_priv;
+	spin_unlock(&self->lock);
+
+	if (handler)
+		handler(priv);
+}
+
+static void sim_send_empty(struct sbus_priv *self, u16 id, size_t len)
+{
+	struct sim_msg *msg = sim_alloc_msg(sizeof(struct wsm_hdr) + len, id);
+
+	if (msg)
+		sim_send(self, msg);
+}
+
+static void sim_purge(struct sbus_priv *self)
+{
+	struct sim_msg *msg, *tmp;
+
+	spin_lock(&self->lock);
+	list_for_each_entry_safe(msg, tmp, &self->out_queue, link) {
+		list_del(&msg->link);
+		kfree(msg);
+	}
+	self->out_count = 0;
+	self->out_seq = 0;
+	self->tx_conf_count = 0;
+	spin_unlock(&self->lock);
+}
+
+static u16 sim_control(struct sbus_priv *self)
+{
+	struct sim_msg *msg;
+	u16 ctrl = self->control & ~ST90TDS_CONT_NEXT_LEN_MASK;
+
+	if (ctrl & ST90TDS_CONT_WUP_BIT)
+		ctrl |= ST90TDS_CONT_RDY_BIT;
+
+	spin_lock(&self->lock);
+	if (!list_empty(&self->out_queue)) {
+		msg = list_first_entry(&self->out_queue, struct sim_msg, link);
+		ctrl |= DIV_ROUND_UP(msg->len, 2);
+	}
+	spin_unlock(&self->lock);
+	return ctrl;
+}
+
+static int sim_read_queue(struct sbus_priv *self, u8 *dst, int count)
+{
+	struct sim_msg *msg;
+
+	spin_lock(&self->lock);
+	if (list_empty(&self->out_queue)) {
+		spin_unlock(&self->lock);
+		return -EIO;
+	}
+	msg = list_first_entry(&self->out_queue, struct sim_msg, link);
+	list_del(&msg->link);
+	--self->out_count;
+	spin_unlock(&self->lock);
+
+	if (WARN_ON(msg->len + 2 > count)) {
+		kfree(msg);
+		return -EIO;
+	}
+
+	memcpy(dst, msg->data, msg->len);
+	memset(&dst[msg->len], 0, count - msg->len);
+	kfree(msg);
+
+	/* Piggyback the control register for the next message */
+	put_unaligned_le16(sim_control(self), &dst[(count & ~1) - 2]);
+	return 0;
+}
+
+/* ******************************************************************** */
+/* Firmware model							*/
+
+static void sim_send_startup(struct sbus_priv *self)
+{
+	struct sim_msg *msg = sim_alloc_msg(sizeof(struct wsm_hdr) +
+			10 * sizeof(u16) + 128, 0x0801);
+	u8 *p;
+
+	if (!msg)
+		return;
+
+	p = &msg->data[sizeof(struct wsm_hdr)];
+	put_unaligned_le16(in_bufs, &p[0]);
+	put_unaligned_le16(in_buf_size, &p[2]);
+	put_unaligned_le16(2, &p[4]);	/* hardware id */
+	put_unaligned_le16(2, &p[6]);	/* hardware sub id */
+	put_unaligned_le16(0, &p[8]);	/* status */
+	put_unaligned_le16(0, &p[10]);	/* capabilities */
+	put_unaligned_le16(1, &p[12]);	/* WFM firmware */
+	strlcpy((char *)&p[20], "CW1200 simulator", 128);
+	sim_send(self, msg);
+}
+
+static void sim_configuration(struct sbus_priv *self, const u8 *req,
+			      size_t len)
+{
+	struct sim_msg *msg;
+	u8 *p;
+	int i;
+
+	/* MSDU and RX lifetimes, RTS threshold, DPD header */
+	if (len >= sizeof(struct wsm_hdr) + 16 + ETH_ALEN)
+		memcpy(self->mac, &req[sizeof(struct wsm_hdr) + 16], ETH_ALEN);
+
+	msg = sim_alloc_msg(sizeof(struct wsm_hdr) + 4 + ETH_ALEN + 2 + 4 +
+			2 * 12, 0x0409);
+	if (!msg)
+		return;
+
+	p = &msg->data[sizeof(struct wsm_hdr) + 4];
+	memcpy(p, self->mac, ETH_ALEN);
+	p += ETH_ALEN;
+	*p = 1;				/* 2.4 GHz band only */
+	p += 2;
+	put_unaligned_le32(0x3FFF, p);	/* all 802.11bg rates */
+	p += 4;
+	for (i = 0; i < 2; ++i, p += 12) {
+		put_unaligned_le32(0, &p[0]);
+		put_unaligned_le32(200, &p[4]);
+		put_unaligned_le32(1, &p[8]);
+	}
+	sim_send(self, msg);
+}
+
+static void sim_read_mib(struct sbus_priv *self, const u8 *req)
+{
+	struct sim_msg *msg = sim_alloc_msg(sizeof(struct wsm_hdr) + 12,
+			0x0405);
+
+	if (!msg)
+		return;
+
+	/* Status, MIB id, 4 bytes of zeroes */
+	memcpy(&msg->data[8], &req[sizeof(struct wsm_hdr)], 2);
+	put_unaligned_le16(4, &msg->data[10]);
+	sim_send(self, msg);
+}
+
+static void sim_join(struct sbus_priv *self)
+{
+	struct sim_msg *msg = sim_alloc_msg(sizeof(struct wsm_hdr) + 12,
+			0x040B);
+
+	if (!msg)
+		return;
+	put_unaligned_le32(200, &msg->data[12]);
+	sim_send(self, msg);
+}
+
+static void sim_tx(struct sbus_priv *self, const u8 *req, int link_id)
+{
+	spin_lock(&self->lock);
+	if (!WARN_ON(self->tx_conf_count >= in_bufs)) {
+		struct sim_tx_conf *conf = &self->tx_conf[self->tx_conf_count++];
+
+		conf->packet_id = get_unaligned_le32(
+				&req[sizeof(struct wsm_hdr)]);
+		conf->link_id = link_id;
+	}
+	++self->stats.tx;
+	spin_unlock(&self->lock);
+	wake_up(&self->wq);
+}
+
+/* Handle one WSM request written by the host. */
+static void sim_request(struct sbus_priv *self, const u8 *req, size_t len)
+{
+	u16 id = get_unaligned_le16(&req[2]);
+	int link_id = (id >> 6) & WSM_TX_LINK_ID_MAX;
+	u16 cmd = id & 0x3F;
+	u16 conf = (cmd | 0x0400) | WSM_TX_LINK_ID(link_id);
+
+	switch (cmd) {
+	case 0x0004: /* tx */
+		sim_tx(self, req, link_id);
+		break;
+	case 0x0005: /* read_mib */
+		sim_read_mib(self, req);
+		break;
+	case 0x0006: /* write_mib */
+		if (get_unaligned_le16(&req[4]) == WSM_MIB_USE_MULTI_TX_CONF)
+			self->multi_tx_conf = !!get_unaligned_le32(&req[8]);
+		sim_send_empty(self, conf, 4);
+		break;
+	case 0x0007: /* start_scan */
+		sim_send_empty(self, conf, 4);
+		/* Status, PSM, number of channels scanned */
+		sim_send_empty(self, 0x0806, 6);
+		break;
+	case 0x0009: /* configuration */
+		sim_configuration(self, req, len);
+		break;
+	case 0x000B: /* join */
+		sim_join(self);
+		break;
+	case 0x0010: /* set_pm */
+		sim_send_empty(self, conf, 4);
+		sim_send_empty(self, 0x0809, 0);
+		break;
+	default:
+		/* Status only, zero is WSM_STATUS_SUCCESS */
+		sim_send_empty(self, conf, 4);
+		break;
+	}
+}
+
+static int sim_write_queue(struct sbus_priv *self, const u8 *src, int count)
+{
+	size_t len;
+
+	spin_lock(&self->lock);
+	++self->stats.tx_xfers;
+	spin_unlock(&self->lock);
+
+	if (!cw1200_bh_tx_packed()) {
+		len = get_unaligned_le16(src);
+		if (WARN_ON(len < sizeof(struct wsm_hdr) || len > count))
+			return -EIO;
+		sim_request(self, src, len);
+		return 0;
+	}
+
+	/* Messages padded to 4 bytes, terminated by an empty header */
+	while (count >= sizeof(struct wsm_hdr)) {
+		len = get_unaligned_le16(src);
+		if (!len)
+			break;
+		if (WARN_ON(len < sizeof(struct wsm_hdr) || len > count))
+			return -EIO;
+		sim_request(self, src, len);
+		src += ALIGN(len, 4);
+		count -= min_t(int, count, ALIGN(len, 4));
+	}
+	return 0;
+}
+
+static void sim_send_tx_confirms(struct sbus_priv *self)
+{
+	struct sim_tx_conf *conf = self->tx_conf_batch;
+	struct sim_msg *msg;
+	int count, i, j, n;
+	u8 *p;
+
+	spin_lock(&self->lock);
+	count = self->tx_conf_count;
+	memcpy(conf, self->tx_conf, count * sizeof(conf[0]));
+	self->tx_conf_count = 0;
+	spin_unlock(&self->lock);
+
+	for (i = 0; i < count; i += n) {
+		/* A multi-TX confirm carries a single link id */
+		for (n = 1; self->multi_tx_conf && i + n < count; ++n)
+			if (conf[i + n].link_id != conf[i].link_id)
+				break;
+
+		if (n > 1) {
+			msg = sim_alloc_msg(sizeof(struct wsm_hdr) + 4 +
+					n * SIM_TX_CONF_LEN, 0x041E |
+					WSM_TX_LINK_ID(conf[i].link_id));
+			if (!msg)
+				return;
+			put_unaligned_le32(n, &msg->data[4]);
+			p = &msg->data[8];
+		} else {
+			msg = sim_alloc_msg(sizeof(struct wsm_hdr) +
+					SIM_TX_CONF_LEN, 0x0404 |
+					WSM_TX_LINK_ID(conf[i].link_id));
+			if (!msg)
+				return;
+			p = &msg->data[4];
+		}
+
+		/* Everything but the packet id is zero: sent, first try */
+		for (j = 0; j < n; ++j, p += SIM_TX_CONF_LEN)
+			put_unaligned_le32(conf[i + j].packet_id, p);
+		sim_send(self, msg);
+	}
+}
+
+static void sim_send_rx(struct sbus_priv *self, size_t body_len)
+{
+	struct ieee80211_hdr_3addr *hdr;
+	struct sim_msg *msg;
+	u8 *p;
+
+	/* Confirms are always queued, received frames are dropped when
+	 * the host does not keep up. */
+	spin_lock(&self->lock);
+	if (self->out_count >= SIM_OUT_QUEUE_MAX) {
+		++self->stats.rx_dropped;
+		spin_unlock(&self->lock);
+		return;
+	}
+	++self->stats.rx;
+	spin_unlock(&self->lock);
+
+	msg = sim_alloc_msg(SIM_RX_HDR_LEN + body_len, 0x0804);
+	if (!msg)
+		return;
+
+	/* Status, channel, rate, RCPI/RSSI, flags */
+	p = &msg->data[sizeof(struct wsm_hdr)];
+	put_unaligned_le16(1, &p[4]);
+	p[6] = 11;			/* 54 Mbps */
+	p[7] = 200;
+	p += 12;
+
+	hdr = (struct ieee80211_hdr_3addr *)p;
+	hdr->frame_control = cpu_to_le16(IEEE80211_FTYPE_DATA |
+			IEEE80211_STYPE_DATA | IEEE80211_FCTL_FROMDS);
+	memset(hdr->addr1, 0xFF, ETH_ALEN);
+	memcpy(hdr->addr2, self->mac, ETH_ALEN);
+	hdr->addr2[0] ^= 0x02;
+	memcpy(hdr->addr3, hdr->addr2, ETH_ALEN);
+	hdr->addr3[ETH_ALEN - 1] ^= 0x01;
+	hdr->seq_ctrl = cpu_to_le16(self->rx_seq_ctrl);
+	self->rx_seq_ctrl += 0x10;
+
+	/* RFC 1042 header for IPv4, payload left zeroed */
+	p += sizeof(*hdr);
+	memcpy(p, "\xAA\xAA\x03\x00\x00\x00\x08\x00", 8);
+
+	sim_send(self, msg);
+}
+
+/* Generate the RX frames due since the rate was last changed. */
+static void sim_generate_rx(struct sbus_priv *self)
+{
+	unsigned int rate = ACCESS_ONCE(rx_pps);
+	size_t body_len = min_t(size_t, ACCESS_ONCE(rx_len),
+			SIM_MSG_MAX - SIM_RX_HDR_LEN);
+	ktime_t now = ktime_get();
+	u64 due;
+
+	if (rate != self->rx_rate) {
+		self->rx_rate = rate;
+		self->rx_start = now;
+		self->rx_generated = 0;
+	}
+	if (!rate || !self->irq_handler)
+		return;
+
+	due = div64_u64((u64)ktime_to_ns(ktime_sub(now, self->rx_start)) *
+			rate, NSEC_PER_SEC);
+	while (self->rx_generated < due) {
+		sim_send_rx(self, body_len);
+		++self->rx_generated;
+	}
+}
+
+static int sim_thread(void *arg)
+{
+	struct sbus_priv *self = arg;
+
+	while (!kthread_should_stop()) {
+		wait_event_interruptible_timeout(self->wq,
+				self->tx_conf_count || kthread_should_stop(),
+				rx_pps ? 1 : HZ);
+		sim_send_tx_confirms(self);
+		sim_generate_rx(self);
+	}
+	return 0;
+}
+
+/* ******************************************************************** */
+/* sbus_ops implementation						*/
+
+static int sim_memcpy_fromio(struct sbus_priv *self, unsigned int addr,
+			     void *dst, int count)
+{
+	int reg = (addr & 0x1F) >> 2;
+	u32 val = 0;
+
+	switch (reg) {
+	case ST90TDS_IN_OUT_QUEUE_REG_ID:
+		return sim_read_queue(self, dst, count);
+	case ST90TDS_CONFIG_REG_ID:
+		val = self->config;
+		break;
+	case ST90TDS_CONTROL_REG_ID:
+		val = sim_control(self);
+		break;
+	case ST90TDS_AHB_DPORT_REG_ID:
+	case ST90TDS_SRAM_DPORT_REG_ID:
+		/* The only memory the host reads is the cut 2.2 id */
+		memset(dst, 0, count);
+		if (count >= 12) {
+			put_unaligned_le32(CW1200_CUT_22_ID_STR1, dst);
+			put_unaligned_le32(CW1200_CUT_22_ID_STR2, dst + 4);
+			put_unaligned_le32(CW1200_CUT_22_ID_STR3, dst + 8);
+		}
+		return 0;
+	case ST90TDS_TSET_GEN_R_W_REG_ID:
+		val = self->dpll;
+		break;
+	}
+
+	memset(dst, 0, count);
+	memcpy(dst, &val, min_t(int, count, sizeof(val)));
+	return 0;
+}
+
+static int sim_memcpy_toio(struct sbus_priv *self, unsigned int addr,
+			   const void *src, int count)
+{
+	int reg = (addr & 0x1F) >> 2;
+	u32 val = 0;
+
+	if (reg == ST90TDS_IN_OUT_QUEUE_REG_ID)
+		return sim_write_queue(self, src, count);
+
+	memcpy(&val, src, min_t(int, count, sizeof(val)));
+
+	switch (reg) {
+	case ST90TDS_CONFIG_REG_ID:
+		/* Prefetches complete immediately */
+		self->config = val & ~(ST90TDS_CONFIG_PFETCH_BIT |
+				ST90TDS_CONFIG_AHB_PFETCH_BIT);
+		break;
+	case ST90TDS_CONTROL_REG_ID:
+		self->control = val & (ST90TDS_CONT_WUP_BIT |
+				ST90TDS_CONT_IRQ_RDY_ENABLE);
+		break;
+	case ST90TDS_TSET_GEN_R_W_REG_ID:
+		self->dpll = val;
+		break;
+	}
+	return 0;
+}
+
+static void sim_lock(struct sbus_priv *self)
+{
+	mutex_lock(&self->bus_lock);
+}
+
+static void sim_unlock(struct sbus_priv *self)
+{
+	mutex_unlock(&self->bus_lock);
+}
+
+static int sim_irq_subscribe(struct sbus_priv *self,
+			     sbus_irq_handler handler, void *priv)
+{
+	spin_lock(&self->lock);
+	self->irq_priv = priv;
+	self->irq_handler = handler;
+	spin_unlock(&self->lock);
+
+	/* The firmware is up as soon as the host is listening */
+	sim_send_startup(self);
+	return 0;
+}
+
+static int sim_irq_unsubscribe(struct sbus_priv *self)
+{
+	spin_lock(&self->lock);
+	self->irq_handler = NULL;
+	self->irq_priv = NULL;
+	spin_unlock(&self->lock);
+	return 0;
+}
+
+static int sim_reset(struct sbus_priv *self)
+{
+	sim_purge(self);
+	self->config = SIM_CONFIG_INIT;
+	self->control = 0;
+	self->multi_tx_conf = false;
+	return 0;
+}
+
+static size_t sim_align_size(struct sbus_priv *self, size_t size)
+{
+	return ALIGN(size, 4);
+}
+
+static int sim_power_mgmt(struct sbus_priv *self, bool suspend)
+{
+	return 0;
+}
+
+static int sim_set_block_size(struct sbus_priv *self, size_t size)
+{
+	return 0;
+}
+
+static struct sbus_ops sim_sbus_ops = {
+	.sbus_memcpy_fromio	= sim_memcpy_fromio,
+	.sbus_memcpy_toio	= sim_memcpy_toio,
+	.lock			= sim_lock,
+	.unlock			= sim_unlock,
+	.irq_subscribe		= sim_irq_subscribe,
+	.irq_unsubscribe	= sim_irq_unsubscribe,
+	.reset			= sim_reset,
+	.align_size		= sim_align_size,
+	.power_mgmt		= sim_power_mgmt,
+	.set_block_size		= sim_set_block_size,
+};
+
+/* ******************************************************************** */
+/* Benchmark report							*/
+
+/* CPU time spent outside idle on all CPUs, in nanoseconds */
+static u64 sim_cpu_busy(void)
+{
+	u64 busy = 0;
+	int cpu;
+
+	for_each_possible_cpu(cpu) {
+		u64 *stat = kcpustat_cpu(cpu).cpustat;
+
+		busy += cputime64_to_jiffies64(stat[CPUTIME_USER] +
+				stat[CPUTIME_NICE] + stat[CPUTIME_SYSTEM] +
+				stat[CPUTIME_IRQ] + stat[CPUTIME_SOFTIRQ]);
+	}
+	return busy * (NSEC_PER_SEC / HZ);
+}
+
+static u64 sim_rate(u64 count, u64 ns)
+{
+	return ns ? div64_u64(count * NSEC_PER_SEC, ns) : 0;
+}
+
+static int sim_bench_show(struct seq_file *seq, void *v)
+{
+	struct sbus_priv *self = seq->private;
+	struct sim_stats now, *last = &self->last;
+	unsigned int khz = cpufreq_quick_get(0);
+	u64 ns, busy, pkts;
+
+	spin_lock(&self->lock);
+	now = self->stats;
+	spin_unlock(&self->lock);
+	now.time = ktime_get();
+	now.busy = sim_cpu_busy();
+
+	ns = ktime_to_ns(ktime_sub(now.time, last->time));
+	busy = now.busy - last->busy;
+	pkts = (now.tx - last->tx) + (now.rx - last->rx);
+
+	seq_printf(seq, "Interval:     %llu ms\n", div64_u64(ns, NSEC_PER_MSEC));
+	seq_printf(seq, "TX:           %llu pkts, %llu pkts/s\n",
+		   now.tx - last->tx, sim_rate(now.tx - last->tx, ns));
+	seq_printf(seq, "TX transfers: %llu\n", now.tx_xfers - last->tx_xfers);
+	seq_printf(seq, "RX:           %llu pkts, %llu pkts/s, %llu dropped\n",
+		   now.rx - last->rx, sim_rate(now.rx - last->rx, ns),
+		   now.rx_dropped - last->rx_dropped);
+	seq_printf(seq, "CPU busy:     %llu ms\n",
+		   div64_u64(busy, NSEC_PER_MSEC));
+	if (pkts) {
+		seq_printf(seq, "CPU/pkt:      %llu ns\n",
+			   div64_u64(busy, pkts));
+		if (khz)
+			seq_printf(seq, "Cycles/pkt:   %llu (at %u kHz)\n",
+				   div64_u64(busy * khz, pkts * USEC_PER_SEC),
+				   khz);
+	}
+
+	*last = now;
+	return 0;
+}
+
+static int sim_bench_open(struct inode *inode, struct file *file)
+{
+	return single_open(file, &sim_bench_show, inode->i_private);
+}
+
+static const struct file_operations fops_bench = {
+	.open = sim_bench_open,
+	.read = seq_read,
+	.llseek = seq_lseek,
+	.release = single_release,
+	.owner = THIS_MODULE,
+};
+
+/* ******************************************************************** */
+/* Module								*/
+
+static int __init cw1200_sim_init(void)
+{
+	struct sbus_priv *self;
+	int ret;
+
+	if (!in_bufs || in_buf_size < sizeof(struct wsm_hdr) ||
+			in_buf_size > SIM_MSG_MAX)
+		return -EINVAL;
+
+	self = kzalloc(sizeof(*self), GFP_KERNEL);
+	if (!self)
+		return -ENOMEM;
+
+	self->tx_conf = kcalloc(in_bufs, sizeof(*self->tx_conf), GFP_KERNEL);
+	self->tx_conf_batch = kcalloc(in_bufs, sizeof(*self->tx_conf),
+			GFP_KERNEL);
+	if (!self->tx_conf || !self->tx_conf_batch) {
+		ret = -ENOMEM;
+		goto err_tx_conf;
+	}
+
+	mutex_init(&self->bus_lock);
+	spin_lock_init(&self->lock);
+	INIT_LIST_HEAD(&self->out_queue);
+	init_waitqueue_head(&self->wq);
+	self->config = SIM_CONFIG_INIT;
+	random_ether_addr(self->mac);
+	self->last.time = ktime_get();
+	self->last.busy = sim_cpu_busy();
+
+	self->pdev = platform_device_register_simple("cw1200_sim", -1,
+			NULL, 0);
+	if (IS_ERR(self->pdev)) {
+		ret = PTR_ERR(self->pdev);
+		goto err_pdev;
+	}
+
+	self->thread = kthread_run(sim_thread, self, "cw1200_sim");
+	if (IS_ERR(self->thread)) {
+		ret = PTR_ERR(self->thread);
+		goto err_thread;
+	}
+
+	ret = cw1200_core_probe(&sim_sbus_ops, self, &self->pdev->dev,
+			&self->core);
+	if (ret)
+		goto err_probe;
+
+	self->debugfs = debugfs_create_dir("cw1200_sim", NULL);
+	if (!IS_ERR_OR_NULL(self->debugfs))
+		debugfs_create_file("bench", S_IRUSR, self->debugfs, self,
+				&fops_bench);
+
+	sim = self;
+	return 0;
+
+err_probe:
+	kthread_stop(self->thread);
+err_thread:
+	platform_device_unregister(self->pdev);
+err_pdev:
+	sim_purge(self);
+err_tx_conf:
+	kfree(self->tx_conf_batch);
+	kfree(self->tx_conf);
+	kfree(self);
+	return ret;
+}
+
+static void __exit cw1200_sim_exit(void)
+{
+	struct sbus_priv *self = sim;
+
+	debugfs_remove_recursive(self->debugfs);
+	cw1200_core_release(self->core);
+	kthread_stop(self->thread);
+	platform_device_unregister(self->pdev);
+	sim_purge(self);
+	kfree(self->tx_conf_batch);
+	kfree(self->tx_conf);
+	kfree(self);
+}
+
+module_init(cw1200_sim_init);
+module_exit(cw1200_sim_exit);
@@ -99,6 +99,17 @@ static void cw1200_debug_print_map(struct seq_file *seq,
 	seq_printf(seq, "<-%d\n", priv->tx_queue_stats.map_capacity - 1);
 }
 
+static void cw1200_debug_print_hist(struct seq_file *seq,
+				    const char *label, const int *hist)
+{
+	int i;
+
+	seq_puts(seq, label);
+	for (i = 0; i < CW1200_DEBUG_HIST_SIZE - 1; ++i)
+		seq_printf(seq, " %d:%d", i + 1, hist[i]);
+	seq_printf(seq, " %d+:%d\n", i + 1, hist[i]);
+}
+
 static int cw1200_status_show(struct seq_file *seq, void *v)
 {
 	int i;
@@ -309,6 +320,10 @@ static int cw1200_status_show(struct seq_file *seq, void *v)
 		d->tx_burst);
 	seq_printf(seq, "RX burst:   %d\n",
 		d->rx_burst);
+	cw1200_debug_print_hist(seq, "TX frames/xfer:",
+		d->tx_frames_hist);
+	cw1200_debug_print_hist(seq, "RX frames/wakeup:",
+		d->rx_frames_hist);
 	seq_printf(seq, "TX TTL:     %d\n",
 		d->tx_ttl);
 	seq_printf(seq, "Scan:       %s\n",
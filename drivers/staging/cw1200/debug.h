@@ -18,6 +18,9 @@ struct cw200_common;
 
 #ifdef CONFIG_CW1200_DEBUGFS
 
+/* Frames per SDIO transfer are counted as 1, 2, ... and 8 or more */
+#define CW1200_DEBUG_HIST_SIZE	8
+
 struct cw1200_debug_priv {
 	struct dentry *debugfs_phy;
 	int tx;
@@ -33,6 +36,8 @@ struct cw1200_debug_priv {
 	int rx_burst;
 	int ba_cnt;
 	int ba_acc;
+	int tx_frames_hist[CW1200_DEBUG_HIST_SIZE];
+	int rx_frames_hist[CW1200_DEBUG_HIST_SIZE];
 #ifdef CONFIG_CW1200_ITP
 	struct cw1200_itp itp;
 #endif /* CONFIG_CW1200_ITP */
@@ -100,6 +105,25 @@ static inline void cw1200_debug_ba(struct cw1200_common *priv,
 	priv->debug->ba_acc = ba_acc;
 }
 
+static inline void cw1200_debug_hist(int *hist, int frames)
+{
+	++hist[min(frames, CW1200_DEBUG_HIST_SIZE) - 1];
+}
+
+/* WSM messages sent in one SDIO transfer */
+static inline void cw1200_debug_tx_frames(struct cw1200_common *priv,
+					  int frames)
+{
+	cw1200_debug_hist(priv->debug->tx_frames_hist, frames);
+}
+
+/* WSM messages read on one BH wakeup */
+static inline void cw1200_debug_rx_frames(struct cw1200_common *priv,
+					  int frames)
+{
+	cw1200_debug_hist(priv->debug->rx_frames_hist, frames);
+}
+
 int cw1200_print_fw_version(struct cw1200_common *priv, u8 *buf, size_t len);
 
 #else /* CONFIG_CW1200_DEBUGFS */
@@ -159,6 +183,16 @@ static inline void cw1200_debug_ba(struct cw1200_common *priv,
 {
 }
 
+static inline void cw1200_debug_tx_frames(struct cw1200_common *priv,
+					  int frames)
+{
+}
+
+static inline void cw1200_debug_rx_frames(struct cw1200_common *priv,
+					  int frames)
+{
+}
+
 int cw1200_print_fw_version(struct cw1200_common *priv, u8 *buf, size_t len)
 {
 }
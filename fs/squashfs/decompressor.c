@@ -25,6 +25,10 @@
 #include <linux/mutex.h>
 #include <linux/slab.h>
 #include <linux/buffer_head.h>
+#include <linux/percpu.h>
+#include <linux/sched.h>
+#include <linux/spinlock.h>
+#include <linux/wait.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -83,34 +87,310 @@ const struct squashfs_decompressor *squashfs_lookup_decompressor(int id)
 }
 
 
-void *squashfs_decompressor_init(struct super_block *sb, unsigned short flags)
+/*
+ * Decompressor streams.
+ *
+ * A stream holds the decompressor state and work buffers and can only be
+ * used by one reader at a time.  How streams are shared is selected per
+ * mount:
+ *
+ * SQUASHFS_DECOMP_SINGLE: one stream serialised by a mutex.  Least
+ * memory, but all decompression on the filesystem is serialised.
+ *
+ * SQUASHFS_DECOMP_MULTI: a pool of streams, created on demand up to
+ * msblk->decomp_max.  A reader that finds the pool exhausted waits for a
+ * stream to be returned.
+ *
+ * SQUASHFS_DECOMP_PERCPU: one stream per possible CPU, each behind its
+ * own mutex.  A reader takes the stream of the CPU it is running on and
+ * stays preemptible while decompressing; it only waits if another task
+ * on the same CPU is already using that stream.  Costs a stream per CPU
+ * whether used or not.
+ */
+struct squashfs_stream {
+	void			*stream;
+	struct list_head	list;
+	struct mutex		mutex;	/* SQUASHFS_DECOMP_PERCPU */
+};
+
+struct squashfs_streams {
+	/* Compressor options, kept to create further streams */
+	void			*comp_opts;
+	int			comp_opts_len;
+
+	/* SQUASHFS_DECOMP_SINGLE */
+	struct mutex		mutex;
+	void			*single;
+
+	/* SQUASHFS_DECOMP_MULTI */
+	spinlock_t		lock;
+	struct list_head	free;
+	int			count;
+	wait_queue_head_t	wait;
+
+	/* SQUASHFS_DECOMP_PERCPU */
+	struct squashfs_stream __percpu *percpu;
+};
+
+
+static void *squashfs_stream_init(struct squashfs_sb_info *msblk,
+	struct squashfs_streams *s)
+{
+	return msblk->decompressor->init(msblk, s->comp_opts, s->comp_opts_len);
+}
+
+
+static struct squashfs_stream *squashfs_stream_alloc(
+	struct squashfs_sb_info *msblk, struct squashfs_streams *s)
+{
+	struct squashfs_stream *stream;
+
+	stream = kmalloc(sizeof(*stream), GFP_KERNEL);
+	if (stream == NULL)
+		return ERR_PTR(-ENOMEM);
+
+	stream->stream = squashfs_stream_init(msblk, s);
+	if (IS_ERR(stream->stream)) {
+		void *err = stream->stream;
+
+		kfree(stream);
+		return err;
+	}
+
+	return stream;
+}
+
+
+/*
+ * Get a stream from the pool, allocating a new one if the pool is empty
+ * and below its limit, otherwise waiting for one to be returned.  The
+ * first stream is allocated at mount time, so there is always one to
+ * wait for.
+ */
+static struct squashfs_stream *squashfs_stream_get(
+	struct squashfs_sb_info *msblk, struct squashfs_streams *s)
+{
+	struct squashfs_stream *stream;
+
+	while (1) {
+		spin_lock(&s->lock);
+		if (!list_empty(&s->free)) {
+			stream = list_first_entry(&s->free,
+				struct squashfs_stream, list);
+			list_del(&stream->list);
+			spin_unlock(&s->lock);
+			return stream;
+		}
+
+		if (s->count < msblk->decomp_max) {
+			s->count++;
+			spin_unlock(&s->lock);
+
+			stream = squashfs_stream_alloc(msblk, s);
+			if (!IS_ERR(stream))
+				return stream;
+
+			spin_lock(&s->lock);
+			s->count--;
+		}
+		spin_unlock(&s->lock);
+
+		wait_event(s->wait, !list_empty(&s->free));
+	}
+}
+
+
+static void squashfs_stream_put(struct squashfs_streams *s,
+	struct squashfs_stream *stream)
+{
+	spin_lock(&s->lock);
+	list_add(&stream->list, &s->free);
+	spin_unlock(&s->lock);
+	wake_up(&s->wait);
+}
+
+
+int squashfs_max_decompressors(struct squashfs_sb_info *msblk)
+{
+	switch (msblk->decomp_mode) {
+	case SQUASHFS_DECOMP_MULTI:
+		return msblk->decomp_max;
+	case SQUASHFS_DECOMP_PERCPU:
+		return num_possible_cpus();
+	default:
+		return 1;
+	}
+}
+
+
+static void squashfs_streams_free(struct squashfs_sb_info *msblk,
+	struct squashfs_streams *s)
+{
+	struct squashfs_stream *stream, *next;
+	int cpu;
+
+	switch (msblk->decomp_mode) {
+	case SQUASHFS_DECOMP_SINGLE:
+		if (s->single)
+			msblk->decompressor->free(s->single);
+		break;
+	case SQUASHFS_DECOMP_MULTI:
+		list_for_each_entry_safe(stream, next, &s->free, list) {
+			msblk->decompressor->free(stream->stream);
+			kfree(stream);
+		}
+		break;
+	case SQUASHFS_DECOMP_PERCPU:
+		if (s->percpu == NULL)
+			break;
+		for_each_possible_cpu(cpu) {
+			stream = per_cpu_ptr(s->percpu, cpu);
+			if (stream->stream)
+				msblk->decompressor->free(stream->stream);
+		}
+		free_percpu(s->percpu);
+		break;
+	}
+
+	kfree(s->comp_opts);
+	kfree(s);
+}
+
+
+int squashfs_decompressor_setup(struct super_block *sb, unsigned short flags)
 {
 	struct squashfs_sb_info *msblk = sb->s_fs_info;
-	void *strm, *buffer = NULL;
-	int length = 0;
+	struct squashfs_streams *s;
+	struct squashfs_stream *stream;
+	void *buffer = NULL, *strm;
+	int length = 0, cpu, err;
+
+	s = kzalloc(sizeof(*s), GFP_KERNEL);
+	if (s == NULL)
+		return -ENOMEM;
 
 	/*
 	 * Read decompressor specific options from file system if present
 	 */
 	if (SQUASHFS_COMP_OPTS(flags)) {
 		buffer = kmalloc(PAGE_CACHE_SIZE, GFP_KERNEL);
-		if (buffer == NULL)
-			return ERR_PTR(-ENOMEM);
+		if (buffer == NULL) {
+			err = -ENOMEM;
+			goto failed;
+		}
 
 		length = squashfs_read_data(sb, &buffer,
 			sizeof(struct squashfs_super_block), 0, NULL,
 			PAGE_CACHE_SIZE, 1);
 
 		if (length < 0) {
-			strm = ERR_PTR(length);
-			goto finished;
+			err = length;
+			goto failed;
 		}
+
+		s->comp_opts = kmemdup(buffer, length, GFP_KERNEL);
+		if (s->comp_opts == NULL) {
+			err = -ENOMEM;
+			goto failed;
+		}
+		s->comp_opts_len = length;
 	}
 
-	strm = msblk->decompressor->init(msblk, buffer, length);
+	switch (msblk->decomp_mode) {
+	case SQUASHFS_DECOMP_SINGLE:
+		mutex_init(&s->mutex);
+		strm = squashfs_stream_init(msblk, s);
+		if (IS_ERR(strm)) {
+			err = PTR_ERR(strm);
+			goto failed;
+		}
+		s->single = strm;
+		break;
+
+	case SQUASHFS_DECOMP_MULTI:
+		spin_lock_init(&s->lock);
+		INIT_LIST_HEAD(&s->free);
+		init_waitqueue_head(&s->wait);
+		stream = squashfs_stream_alloc(msblk, s);
+		if (IS_ERR(stream)) {
+			err = PTR_ERR(stream);
+			goto failed;
+		}
+		list_add(&stream->list, &s->free);
+		s->count = 1;
+		break;
+
+	case SQUASHFS_DECOMP_PERCPU:
+		s->percpu = alloc_percpu(struct squashfs_stream);
+		if (s->percpu == NULL) {
+			err = -ENOMEM;
+			goto failed;
+		}
+		for_each_possible_cpu(cpu) {
+			strm = squashfs_stream_init(msblk, s);
+			if (IS_ERR(strm)) {
+				err = PTR_ERR(strm);
+				goto failed;
+			}
+			stream = per_cpu_ptr(s->percpu, cpu);
+			mutex_init(&stream->mutex);
+			stream->stream = strm;
+		}
+		break;
+	}
 
-finished:
 	kfree(buffer);
+	msblk->stream = s;
+	return 0;
+
+failed:
+	kfree(buffer);
+	squashfs_streams_free(msblk, s);
+	return err;
+}
+
+
+void squashfs_decompressor_destroy(struct squashfs_sb_info *msblk)
+{
+	if (msblk->stream) {
+		squashfs_streams_free(msblk, msblk->stream);
+		msblk->stream = NULL;
+	}
+}
+
+
+int squashfs_decompress(struct squashfs_sb_info *msblk, void **buffer,
+	struct buffer_head **bh, int b, int offset, int length, int srclength,
+	int pages)
+{
+	const struct squashfs_decompressor *decomp = msblk->decompressor;
+	struct squashfs_streams *s = msblk->stream;
+	struct squashfs_stream *stream;
+	int res;
+
+	switch (msblk->decomp_mode) {
+	case SQUASHFS_DECOMP_MULTI:
+		stream = squashfs_stream_get(msblk, s);
+		res = decomp->decompress(msblk, stream->stream, buffer, bh, b,
+			offset, length, srclength, pages);
+		squashfs_stream_put(s, stream);
+		break;
+
+	case SQUASHFS_DECOMP_PERCPU:
+		stream = per_cpu_ptr(s->percpu, raw_smp_processor_id());
+		mutex_lock(&stream->mutex);
+		res = decomp->decompress(msblk, stream->stream, buffer, bh, b,
+			offset, length, srclength, pages);
+		mutex_unlock(&stream->mutex);
+		break;
+
+	default:
+		mutex_lock(&s->mutex);
+		res = decomp->decompress(msblk, s->single, buffer, bh, b,
+			offset, length, srclength, pages);
+		mutex_unlock(&s->mutex);
+		break;
+	}
 
-	return strm;
+	return res;
 }
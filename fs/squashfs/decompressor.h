@@ -26,27 +26,29 @@
 struct squashfs_decompressor {
 	void	*(*init)(struct squashfs_sb_info *, void *, int);
 	void	(*free)(void *);
-	int	(*decompress)(struct squashfs_sb_info *, void **,
+	int	(*decompress)(struct squashfs_sb_info *, void *, void **,
 		struct buffer_head **, int, int, int, int, int);
 	int	id;
 	char	*name;
 	int	supported;
 };
 
-static inline void squashfs_decompressor_free(struct squashfs_sb_info *msblk,
-	void *s)
-{
-	if (msblk->decompressor)
-		msblk->decompressor->free(s);
-}
+/*
+ * How decompressor streams are shared between concurrent readers, see
+ * decompressor.c.  The default is chosen at build time and can be
+ * overridden per mount with the threads= option.
+ */
+#define SQUASHFS_DECOMP_SINGLE		0
+#define SQUASHFS_DECOMP_MULTI		1
+#define SQUASHFS_DECOMP_PERCPU		2
 
-static inline int squashfs_decompress(struct squashfs_sb_info *msblk,
-	void **buffer, struct buffer_head **bh, int b, int offset, int length,
-	int srclength, int pages)
-{
-	return msblk->decompressor->decompress(msblk, buffer, bh, b, offset,
-		length, srclength, pages);
-}
+#if defined(CONFIG_SQUASHFS_DECOMP_MULTI)
+#define SQUASHFS_DECOMP_DEFAULT		SQUASHFS_DECOMP_MULTI
+#elif defined(CONFIG_SQUASHFS_DECOMP_MULTI_PERCPU)
+#define SQUASHFS_DECOMP_DEFAULT		SQUASHFS_DECOMP_PERCPU
+#else
+#define SQUASHFS_DECOMP_DEFAULT		SQUASHFS_DECOMP_SINGLE
+#endif
 
 #ifdef CONFIG_SQUASHFS_XZ
 extern const struct squashfs_decompressor squashfs_xz_comp_ops;
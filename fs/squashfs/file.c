@@ -410,7 +410,27 @@ static int squashfs_readpage(struct file *file, struct page *page)
 			sparse = 1;
 		} else {
 			/*
-			 * Read and decompress datablock.
+			 * Decompress the datablock straight into the page
+			 * cache, if memory allows.
+			 */
+			struct page **push_pages;
+			int res = -ENOMEM;
+
+			push_pages = kcalloc(mask + 1, sizeof(*push_pages),
+				GFP_KERNEL);
+			if (push_pages) {
+				push_pages[page->index - start_index] = page;
+				res = squashfs_readpage_block(inode, index,
+					block, bsize, push_pages, page);
+				kfree(push_pages);
+			}
+			if (res == 0)
+				return 0;
+			if (res != -ENOMEM)
+				goto error_out;
+
+			/*
+			 * Read and decompress datablock through the cache.
 			 */
 			buffer = squashfs_get_datablock(inode->i_sb,
 								block, bsize);
@@ -496,6 +516,82 @@ out:
 }
 
 
+/*
+ * Readahead.  The generic code would add all the readahead pages to the
+ * page cache, locked, and call readpage on each in turn; readpage could
+ * then not grab the other pages of the datablock and every page would cost
+ * a datablock lookup and copy.  Instead the readahead pages are gathered
+ * per datablock and the datablock is decompressed into them in one go.
+ * Fragments and holes go through readpage.
+ */
+static int squashfs_readpages(struct file *file, struct address_space *mapping,
+	struct list_head *pages, unsigned nr_pages)
+{
+	struct inode *inode = mapping->host;
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	int shift = msblk->block_log - PAGE_CACHE_SHIFT;
+	int file_end = i_size_read(inode) >> msblk->block_log;
+	struct page **push_pages;
+	int i;
+
+	push_pages = kmalloc(sizeof(*push_pages) << shift, GFP_KERNEL);
+	if (push_pages == NULL)
+		return -ENOMEM;
+
+	while (!list_empty(pages)) {
+		struct page *page = list_entry(pages->prev, struct page, lru);
+		int index = page->index >> shift;
+		int start_index = index << shift;
+		int bsize, n = 0;
+		u64 block = 0;
+
+		memset(push_pages, 0, sizeof(*push_pages) << shift);
+
+		/* Readahead queues pages highest index first */
+		while (!list_empty(pages)) {
+			page = list_entry(pages->prev, struct page, lru);
+			if (page->index >> shift != index)
+				break;
+
+			list_del(&page->lru);
+			if (add_to_page_cache_lru(page, mapping, page->index,
+					GFP_KERNEL)) {
+				page_cache_release(page);
+				continue;
+			}
+			push_pages[page->index - start_index] = page;
+			n++;
+		}
+
+		if (n == 0)
+			continue;
+
+		if (index < file_end || squashfs_i(inode)->fragment_block ==
+						SQUASHFS_INVALID_BLK) {
+			bsize = read_blocklist(inode, index, &block);
+			if (bsize > 0) {
+				squashfs_readpage_block(inode, index, block,
+					bsize, push_pages, NULL);
+				continue;
+			}
+		}
+
+		/* Fragment, hole or error: one page at a time */
+		for (i = 0; i < 1 << shift; i++) {
+			if (push_pages[i] == NULL)
+				continue;
+
+			squashfs_readpage(file, push_pages[i]);
+			page_cache_release(push_pages[i]);
+		}
+	}
+
+	kfree(push_pages);
+	return 0;
+}
+
+
 const struct address_space_operations squashfs_aops = {
-	.readpage = squashfs_readpage
+	.readpage = squashfs_readpage,
+	.readpages = squashfs_readpages
 };
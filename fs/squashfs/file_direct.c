@@ -0,0 +1,201 @@
+/*
+ * Squashfs - a compressed read only filesystem for Linux
+ *
+ * Copyright (c) 2012 ST-Ericsson SA
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2,
+ * or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301, USA.
+ *
+ * file_direct.c
+ */
+
+/*
+ * Decompress datablocks directly into the page cache.
+ *
+ * The cached path in file.c decompresses a datablock into a "data" cache
+ * entry and then copies it page by page into the page cache.  Here the
+ * page cache pages covering the datablock are grabbed up front and handed
+ * to the decompressor as its output buffers, which saves a memcpy per page
+ * and keeps cold reads out of the read_page cache.
+ *
+ * Pages that cannot be grabbed (locked by someone else, or already up to
+ * date) are decompressed into a scratch page and thrown away.
+ */
+
+#include <linux/fs.h>
+#include <linux/vfs.h>
+#include <linux/kernel.h>
+#include <linux/slab.h>
+#include <linux/string.h>
+#include <linux/pagemap.h>
+#include <linux/highmem.h>
+#include <linux/vmalloc.h>
+
+#include "squashfs_fs.h"
+#include "squashfs_fs_sb.h"
+#include "squashfs_fs_i.h"
+#include "squashfs.h"
+
+/*
+ * Map the output pages.  Lowmem pages are used through their linear
+ * mapping; if any page is in highmem the whole block is vmapped instead of
+ * holding up to a block's worth of kmap slots at once.
+ */
+static void *squashfs_map_pages(struct page **page, struct page *scratch,
+	void **buffer, int pages)
+{
+	struct page **map;
+	void *addr;
+	int i;
+
+	for (i = 0; i < pages; i++)
+		if (PageHighMem(page[i] ? page[i] : scratch))
+			break;
+
+	if (i == pages) {
+		for (i = 0; i < pages; i++)
+			buffer[i] = page_address(page[i] ? page[i] : scratch);
+		return NULL;
+	}
+
+	map = kmalloc(pages * sizeof(*map), GFP_KERNEL);
+	if (map == NULL)
+		return ERR_PTR(-ENOMEM);
+
+	for (i = 0; i < pages; i++)
+		map[i] = page[i] ? page[i] : scratch;
+	addr = vmap(map, pages, VM_MAP, PAGE_KERNEL);
+	kfree(map);
+	if (addr == NULL)
+		return ERR_PTR(-ENOMEM);
+
+	for (i = 0; i < pages; i++)
+		buffer[i] = addr + (i << PAGE_CACHE_SHIFT);
+	return addr;
+}
+
+
+/*
+ * Read datablock index (at block, with on-disk size bsize) of inode
+ * straight into the page cache.  page[] has one slot per page in the
+ * datablock; slots may be filled in by the caller with locked page cache
+ * pages, empty slots are grabbed here if possible.
+ *
+ * All pages other than target are unlocked and released on return.  On
+ * success every page is uptodate and target is unlocked too.  On failure
+ * target is left locked for the caller; if the failure is -ENOMEM the
+ * other pages are left !uptodate, so that a later readpage can retry them,
+ * and the caller should read target through the cached path.  Otherwise
+ * they have PG_error set.
+ */
+int squashfs_readpage_block(struct inode *inode, int index, u64 block,
+	int bsize, struct page **page, struct page *target)
+{
+	struct squashfs_sb_info *msblk = inode->i_sb->s_fs_info;
+	int shift = msblk->block_log - PAGE_CACHE_SHIFT;
+	int start_index = index << shift;
+	int file_pages = (i_size_read(inode) + PAGE_CACHE_SIZE - 1) >>
+		PAGE_CACHE_SHIFT;
+	int pages = min(1 << shift, file_pages - start_index);
+	struct page *scratch = NULL;
+	void **buffer, *vaddr;
+	int i, res;
+
+	res = -ENOMEM;
+	buffer = kmalloc(pages * sizeof(*buffer), GFP_KERNEL);
+	if (buffer == NULL)
+		goto failed;
+
+	for (i = 0; i < pages; i++)
+		if (page[i] == NULL)
+			break;
+	if (i < pages) {
+		scratch = alloc_page(GFP_KERNEL);
+		if (scratch == NULL)
+			goto failed;
+	}
+
+	for (i = 0; i < pages; i++) {
+		if (page[i])
+			continue;
+
+		page[i] = grab_cache_page_nowait(inode->i_mapping,
+			start_index + i);
+		if (page[i] && PageUptodate(page[i])) {
+			unlock_page(page[i]);
+			page_cache_release(page[i]);
+			page[i] = NULL;
+		}
+	}
+
+	vaddr = squashfs_map_pages(page, scratch, buffer, pages);
+	if (IS_ERR(vaddr)) {
+		res = PTR_ERR(vaddr);
+		goto failed;
+	}
+
+	res = squashfs_read_data(inode->i_sb, buffer, block, bsize, NULL,
+		pages << PAGE_CACHE_SHIFT, pages);
+	if (res < 0)
+		goto unmap;
+
+	/* Zero whatever the datablock does not cover */
+	for (i = res >> PAGE_CACHE_SHIFT; i < pages; i++) {
+		int offset = (i == res >> PAGE_CACHE_SHIFT) ?
+			res & (PAGE_CACHE_SIZE - 1) : 0;
+
+		memset(buffer[i] + offset, 0, PAGE_CACHE_SIZE - offset);
+	}
+
+	if (vaddr)
+		vunmap(vaddr);
+
+	for (i = 0; i < pages; i++) {
+		if (page[i] == NULL)
+			continue;
+
+		flush_dcache_page(page[i]);
+		SetPageUptodate(page[i]);
+		unlock_page(page[i]);
+		if (page[i] != target)
+			page_cache_release(page[i]);
+	}
+
+	if (scratch)
+		__free_page(scratch);
+	kfree(buffer);
+	return 0;
+
+unmap:
+	ERROR("Unable to read page, block %llx, size %x\n", block, bsize);
+	if (vaddr)
+		vunmap(vaddr);
+	res = -EIO;
+
+failed:
+	for (i = 0; i < pages; i++) {
+		if (page[i] == NULL || page[i] == target)
+			continue;
+
+		if (res != -ENOMEM)
+			SetPageError(page[i]);
+		unlock_page(page[i]);
+		page_cache_release(page[i]);
+	}
+
+	if (scratch)
+		__free_page(scratch);
+	kfree(buffer);
+	return res;
+}
@@ -48,7 +48,11 @@ extern void *squashfs_read_table(struct super_block *, u64, int);
 
 /* decompressor.c */
 extern const struct squashfs_decompressor *squashfs_lookup_decompressor(int);
-extern void *squashfs_decompressor_init(struct super_block *, unsigned short);
+extern int squashfs_decompressor_setup(struct super_block *, unsigned short);
+extern void squashfs_decompressor_destroy(struct squashfs_sb_info *);
+extern int squashfs_decompress(struct squashfs_sb_info *, void **,
+				struct buffer_head **, int, int, int, int, int);
+extern int squashfs_max_decompressors(struct squashfs_sb_info *);
 
 /* export.c */
 extern __le64 *squashfs_read_inode_lookup_table(struct super_block *, u64, u64,
@@ -64,6 +68,10 @@ extern int squashfs_get_id(struct super_block *, unsigned int, unsigned int *);
 extern __le64 *squashfs_read_id_index_table(struct super_block *, u64, u64,
 				unsigned short);
 
+/* file_direct.c */
+extern int squashfs_readpage_block(struct inode *, int, u64, int,
+				struct page **, struct page *);
+
 /* inode.c */
 extern struct inode *squashfs_iget(struct super_block *, long long,
 				unsigned int);
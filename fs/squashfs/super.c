@@ -36,6 +36,8 @@
 #include <linux/module.h>
 #include <linux/magic.h>
 #include <linux/xattr.h>
+#include <linux/parser.h>
+#include <linux/seq_file.h>
 
 #include "squashfs_fs.h"
 #include "squashfs_fs_sb.h"
@@ -74,6 +76,73 @@ static const struct squashfs_decompressor *supported_squashfs_filesystem(short
 }
 
 
+enum {
+	Opt_threads, Opt_err
+};
+
+static const match_table_t squashfs_tokens = {
+	{Opt_threads, "threads=%s"},
+	{Opt_err, NULL}
+};
+
+/*
+ * Parse the mount options.  The only option is threads=, which selects how
+ * decompressor streams are shared between concurrent readers:
+ *
+ *	threads=single	one stream, decompression is serialised
+ *	threads=multi	a pool of up to twice the online CPUs streams
+ *	threads=percpu	one stream per CPU
+ *	threads=<n>	a pool of up to n streams, at most one per possible CPU
+ */
+static int squashfs_parse_options(struct squashfs_sb_info *msblk, char *data)
+{
+	substring_t args[MAX_OPT_ARGS];
+	char *p;
+	int n;
+
+	msblk->decomp_mode = SQUASHFS_DECOMP_DEFAULT;
+	msblk->decomp_max = num_online_cpus() * 2;
+
+	if (data == NULL)
+		return 0;
+
+	while ((p = strsep(&data, ",")) != NULL) {
+		if (!*p)
+			continue;
+
+		switch (match_token(p, squashfs_tokens, args)) {
+		case Opt_threads:
+			if (match_int(&args[0], &n) == 0) {
+				if (n < 1)
+					goto bad_option;
+				/* the data block cache holds n blocks */
+				n = min_t(int, n, num_possible_cpus());
+				msblk->decomp_mode = n == 1 ?
+					SQUASHFS_DECOMP_SINGLE :
+					SQUASHFS_DECOMP_MULTI;
+				msblk->decomp_max = n;
+			} else if (strcmp(args[0].from, "single") == 0)
+				msblk->decomp_mode = SQUASHFS_DECOMP_SINGLE;
+			else if (strcmp(args[0].from, "multi") == 0)
+				msblk->decomp_mode = SQUASHFS_DECOMP_MULTI;
+			else if (strcmp(args[0].from, "percpu") == 0)
+				msblk->decomp_mode = SQUASHFS_DECOMP_PERCPU;
+			else
+				goto bad_option;
+			break;
+		default:
+			goto bad_option;
+		}
+	}
+
+	return 0;
+
+bad_option:
+	ERROR("Unrecognised mount option \"%s\"\n", p);
+	return -EINVAL;
+}
+
+
 static int squashfs_fill_super(struct super_block *sb, void *data, int silent)
 {
 	struct squashfs_sb_info *msblk;
@@ -98,9 +167,12 @@ static int squashfs_fill_super(struct super_block *sb, void *data, int silent)
 	msblk->devblksize = sb_min_blocksize(sb, SQUASHFS_DEVBLK_SIZE);
 	msblk->devblksize_log2 = ffz(~msblk->devblksize);
 
-	mutex_init(&msblk->read_data_mutex);
 	mutex_init(&msblk->meta_index_mutex);
 
+	err = squashfs_parse_options(msblk, data);
+	if (err)
+		goto failed_mount;
+
 	/*
 	 * msblk->bytes_used is checked in squashfs_read_table to ensure reads
 	 * are not beyond filesystem end.  But as we're using
@@ -200,19 +272,20 @@ static int squashfs_fill_super(struct super_block *sb, void *data, int silent)
 	if (msblk->block_cache == NULL)
 		goto failed_mount;
 
-	/* Allocate read_page block */
-	msblk->read_page = squashfs_cache_init("data", 1, msblk->block_size);
+	/*
+	 * Allocate read_page blocks, one per decompressor stream so that
+	 * concurrent readers are not serialised on the cache entry
+	 */
+	msblk->read_page = squashfs_cache_init("data",
+		squashfs_max_decompressors(msblk), msblk->block_size);
 	if (msblk->read_page == NULL) {
 		ERROR("Failed to allocate read_page block\n");
 		goto failed_mount;
 	}
 
-	msblk->stream = squashfs_decompressor_init(sb, flags);
-	if (IS_ERR(msblk->stream)) {
-		err = PTR_ERR(msblk->stream);
-		msblk->stream = NULL;
+	err = squashfs_decompressor_setup(sb, flags);
+	if (err)
 		goto failed_mount;
-	}
 
 	/* Handle xattrs */
 	sb->s_xattr = squashfs_xattr_handlers;
@@ -332,7 +405,7 @@ failed_mount:
 	squashfs_cache_delete(msblk->block_cache);
 	squashfs_cache_delete(msblk->fragment_cache);
 	squashfs_cache_delete(msblk->read_page);
-	squashfs_decompressor_free(msblk, msblk->stream);
+	squashfs_decompressor_destroy(msblk);
 	kfree(msblk->inode_lookup_table);
 	kfree(msblk->fragment_index);
 	kfree(msblk->id_table);
@@ -365,6 +438,26 @@ static int squashfs_statfs(struct dentry *dentry, struct kstatfs *buf)
 }
 
 
+static int squashfs_show_options(struct seq_file *seq, struct dentry *root)
+{
+	struct squashfs_sb_info *msblk = root->d_sb->s_fs_info;
+
+	switch (msblk->decomp_mode) {
+	case SQUASHFS_DECOMP_MULTI:
+		seq_printf(seq, ",threads=%d", msblk->decomp_max);
+		break;
+	case SQUASHFS_DECOMP_PERCPU:
+		seq_puts(seq, ",threads=percpu");
+		break;
+	default:
+		seq_puts(seq, ",threads=single");
+		break;
+	}
+
+	return 0;
+}
+
+
 static int squashfs_remount(struct super_block *sb, int *flags, char *data)
 {
 	*flags |= MS_RDONLY;
@@ -379,7 +472,7 @@ static void squashfs_put_super(struct super_block *sb)
 		squashfs_cache_delete(sbi->block_cache);
 		squashfs_cache_delete(sbi->fragment_cache);
 		squashfs_cache_delete(sbi->read_page);
-		squashfs_decompressor_free(sbi, sbi->stream);
+		squashfs_decompressor_destroy(sbi);
 		kfree(sbi->id_table);
 		kfree(sbi->fragment_index);
 		kfree(sbi->meta_index);
@@ -486,6 +579,7 @@ static const struct super_operations squashfs_super_ops = {
 	.destroy_inode = squashfs_destroy_inode,
 	.statfs = squashfs_statfs,
 	.put_super = squashfs_put_super,
+	.show_options = squashfs_show_options,
 	.remount_fs = squashfs_remount
 };
 
@@ -27,6 +27,9 @@
 
 #define ISA_DEVICES 8
 
+/* Message descriptors per queue, must be a power of two */
+#define SHRM_QUEUE_ELEMS 256
+
 #define BOOT_INIT  (0)
 #define BOOT_INFO_SYNC  (1)
 #define BOOT_DONE  (2)
@@ -144,45 +147,54 @@ struct shrm_dev {
 };
 
 /**
- * struct queue_element - information to add an element to queue
- * @entry:	list entry
+ * struct queue_element - message descriptor in a queue
  * @offset:	message offset
  * @size:	message size
- * @no:		total number of messages
  */
 struct queue_element {
-	struct list_head entry;
 	u32 offset;
 	u32 size;
-	u32 no;
 };
 
 /**
  * struct message_queue - ISI, RPC, AUDIO, SECURITY message queue information
  * @fifo_base:		pointer to the respective fifo base
  * @size:		size of the data to be read
- * @readptr:		fifo read pointer
- * @writeptr:		fifo write pointer
- * @no:			total number of messages
- * @update_lock:	spinlock for protecting the queue read operation
- * @q_rp:		queue write pointer
+ * @readptr:		fifo read pointer, only changed by the reader
+ * @writeptr:		fifo write pointer, only changed by the receive handler
+ * @q_rp:		set while there are messages to read
+ * @flush:		set when the reader is to drop the messages before
+ *			@flush_tail
+ * @flush_tail:	head of the queue when it was last reset
  * @wq_readable:	wait queue head
- * @msg_list:		message list
+ * @elem:		ring of message descriptors
+ * @head:		next descriptor to fill, only changed by the receive handler
+ * @tail:		next descriptor to read, only changed by the reader
  * @shrm:		pointer to shrm device information structure
+ *
+ * The queue has a single producer, the receive handler, and a single
+ * consumer, so messages are added and removed without locking.
  */
 struct message_queue {
       u8 *fifo_base;
       u32 size;
       u32 readptr;
       u32 writeptr;
-      u32 no;
-      spinlock_t update_lock;
       atomic_t q_rp;
+      atomic_t flush;
+      u32 flush_tail;
       wait_queue_head_t wq_readable;
-      struct list_head msg_list;
+      struct queue_element elem[SHRM_QUEUE_ELEMS];
+      u32 head;
+      u32 tail;
       struct shrm_dev *shrm;
 };
 
+static inline bool msg_queue_empty(struct message_queue *q)
+{
+	return ACCESS_ONCE(q->head) == ACCESS_ONCE(q->tail);
+}
+
 /**
  * struct isadev_context - shrm char interface context
  * @dl_queue:	structre to store the queue related info
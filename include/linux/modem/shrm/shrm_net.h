@@ -32,8 +32,12 @@ struct shrm_net_iface_priv {
 	unsigned int iface_num;
 };
 
+extern struct tasklet_struct phonet_rcv_tasklet;
+
 int shrm_register_netdev(struct shrm_dev *shrm_dev_data);
 int shrm_net_receive(struct net_device *dev);
+int shrm_net_receive_skb(struct net_device *dev, struct sk_buff *skb);
+bool shrm_net_rx_direct(struct shrm_dev *shrm);
 int shrm_suspend_netdev(struct net_device *dev);
 int shrm_resume_netdev(struct net_device *dev);
 int shrm_stop_netdev(struct net_device *dev);
@@ -15,6 +15,8 @@
 #include <linux/interrupt.h>
 #include <linux/modem/shrm/shrm.h>
 
+struct sk_buff;
+
 #define GOP_OUTPUT_REGISTER_BASE (0x0)
 #define GOP_SET_REGISTER_BASE    (0x4)
 #define GOP_CLEAR_REGISTER_BASE  (0x8)
@@ -110,6 +112,9 @@ int shm_write_msg_to_fifo(struct shrm_dev *shrm, u8 channel,
 				u8 l2header, void *addr, u32 length);
 int shm_write_msg(struct shrm_dev *shrm,
 			u8 l2_header, void *addr, u32 length);
+int shm_write_skb_to_fifo(struct shrm_dev *shrm, u8 channel,
+				u8 l2header, struct sk_buff *skb);
+int shm_write_skb(struct shrm_dev *shrm, u8 l2_header, struct sk_buff *skb);
 
 u8 is_the_only_one_unread_message(struct shrm_dev *shrm,
 						u8 channel, u32 length);
@@ -119,6 +124,7 @@ u8 read_one_l2msg_audio(struct shrm_dev *shrm,
 			u8 *p_l2_msg, u32 *p_len);
 u8 read_one_l2msg_common(struct shrm_dev *shrm,
 				u8 *p_l2_msg, u32 *p_len);
+u8 peek_l2msg_common(u32 *p_len);
 void receive_messages_common(struct shrm_dev *shrm);
 void receive_messages_audio(struct shrm_dev *shrm);
 
@@ -171,7 +177,7 @@ int get_ca_wake_req_state(void);
 /* shrm character interface */
 int isa_init(struct shrm_dev *shrm);
 void isa_exit(struct shrm_dev *shrm);
-int add_msg_to_queue(struct message_queue *q, u32 size);
+int add_msg_to_queue(struct message_queue *q, const void *data, u32 size);
 ssize_t isa_read(struct file *filp, char __user *buf, size_t len,
 							loff_t *ppos);
 int get_size_of_new_msg(struct message_queue *q);
@@ -180,4 +186,16 @@ void shrm_char_reset_queues(struct shrm_dev *shrm);
 int shrm_get_cdev_index(u8 l2_header);
 int shrm_get_cdev_l2header(u8 idx);
 
+/* stand-in for the CMT, see shrm_standin.c */
+#ifdef CONFIG_U8500_SHRM_STANDIN
+int shrm_standin_map(struct shrm_dev *shrm);
+void shrm_standin_unmap(struct shrm_dev *shrm);
+void shrm_standin_start(struct shrm_dev *shrm);
+void shrm_standin_gop_set(struct shrm_dev *shrm, u32 bit);
+#else
+static inline void shrm_standin_start(struct shrm_dev *shrm)
+{
+}
+#endif
+
 #endif
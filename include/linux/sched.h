@@ -831,6 +831,28 @@ enum cpu_idle_type {
 #define SCHED_POWER_SHIFT	10
 #define SCHED_POWER_SCALE	(1L << SCHED_POWER_SHIFT)
 
+#ifdef CONFIG_SCHED_UTIL_TRACKING
+/*
+ * Decaying averages of the time a fair task spends queued and running,
+ * SCHED_UTIL_SCALE meaning all of the time; see kernel/sched/fair.c.
+ */
+#define SCHED_UTIL_SHIFT	10
+#define SCHED_UTIL_SCALE	(1UL << SCHED_UTIL_SHIFT)
+
+/*
+ * A hook registered for a cpu is called with the runqueue lock held and
+ * interrupts off whenever the summed utilization of the fair tasks queued
+ * on that cpu changes: at enqueue, dequeue and the tick.  It must not
+ * sleep nor wake up tasks; irq_work is the way out.
+ */
+struct sched_util_hook {
+	void (*func)(struct sched_util_hook *hook, int cpu, unsigned long util);
+};
+
+extern unsigned long sched_cpu_util(int cpu);
+extern void sched_set_util_hook(int cpu, struct sched_util_hook *hook);
+#endif
+
 /*
  * sched-domains (multiprocessor balancing) declarations:
  */
@@ -1183,6 +1205,20 @@ struct sched_statistics {
 };
 #endif
 
+#ifdef CONFIG_SCHED_UTIL_TRACKING
+struct sched_avg {
+	u64			last_update;
+	/* geometric series over 1024us periods, see kernel/sched/fair.c */
+	u32			runnable_avg_sum;
+	u32			running_avg_sum;
+	u32			avg_period;
+	u32			period_contrib;	/* into the current period */
+	/* the sums over avg_period, SCHED_UTIL_SCALE being always */
+	unsigned long		runnable;
+	unsigned long		util;
+};
+#endif
+
 struct sched_entity {
 	struct load_weight	load;		/* for load-balancing */
 	struct rb_node		run_node;
@@ -1200,6 +1236,10 @@ struct sched_entity {
 	struct sched_statistics statistics;
 #endif
 
+#ifdef CONFIG_SCHED_UTIL_TRACKING
+	struct sched_avg	avg;
+#endif
+
 #ifdef CONFIG_FAIR_GROUP_SCHED
 	struct sched_entity	*parent;
 	/* rq on which this entity is (to be) queued: */
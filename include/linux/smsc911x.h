@@ -23,6 +23,8 @@
 
 #include <linux/phy.h>
 
+struct dma_chan;
+
 /* platform_device configuration data, should be assigned to
  * the platform_device's dev.platform_data */
 struct smsc911x_platform_config {
@@ -32,6 +34,12 @@ struct smsc911x_platform_config {
 	unsigned int shift;
 	phy_interface_t phy_interface;
 	unsigned char mac[6];
+
+	/* Optional DMA engine channel for data FIFO transfers, used when
+	 * CONFIG_SMSC911X_DMA is set.  A NULL filter takes any channel
+	 * capable of DMA_SG. */
+	bool (*dma_filter)(struct dma_chan *chan, void *filter_param);
+	void *dma_param;
 };
 
 /* Constants for platform_device irq polarity configuration */
@@ -399,6 +399,40 @@ TRACE_EVENT(sched_pi_setprio,
 			__entry->oldprio, __entry->newprio)
 );
 
+/*
+ * Tracepoint for the utilization of a fair task and of its cpu, emitted
+ * each time the cpu's sum changes (see sched_util_hook):
+ */
+TRACE_EVENT(sched_util,
+
+	TP_PROTO(struct task_struct *tsk, int cpu, unsigned long runnable,
+		 unsigned long util, unsigned long cpu_util),
+
+	TP_ARGS(tsk, cpu, runnable, util, cpu_util),
+
+	TP_STRUCT__entry(
+		__array( char,	comm,	TASK_COMM_LEN	)
+		__field( pid_t,	pid			)
+		__field( int,	cpu			)
+		__field( unsigned long,	runnable		)
+		__field( unsigned long,	util			)
+		__field( unsigned long,	cpu_util		)
+	),
+
+	TP_fast_assign(
+		memcpy(__entry->comm, tsk->comm, TASK_COMM_LEN);
+		__entry->pid		= tsk->pid;
+		__entry->cpu		= cpu;
+		__entry->runnable	= runnable;
+		__entry->util		= util;
+		__entry->cpu_util	= cpu_util;
+	),
+
+	TP_printk("comm=%s pid=%d cpu=%d runnable=%lu util=%lu cpu_util=%lu",
+			__entry->comm, __entry->pid, __entry->cpu,
+			__entry->runnable, __entry->util, __entry->cpu_util)
+);
+
 #endif /* _TRACE_SCHED_H */
 
 /* This part must be outside protection */
@@ -8,6 +8,7 @@
 #include <linux/dirent.h>
 #include <linux/syscalls.h>
 #include <linux/utime.h>
+#include <linux/ktime.h>
 
 static __initdata char *message;
 static void __init error(char *x)
@@ -446,10 +447,17 @@ static char * __init unpack_to_rootfs(char *buf, unsigned len)
 		this_header = 0;
 		decompress = decompress_method(buf, len, &compress_name);
 		if (decompress) {
+			ktime_t start = ktime_get();
+
 			res = decompress(buf, len, NULL, flush_buffer, NULL,
 				   &my_inptr, error);
 			if (res)
 				error("decompressor failed");
+			else
+				pr_debug("initramfs: %s, %u bytes unpacked"
+					 " in %lld us\n", compress_name,
+					 my_inptr,
+					 ktime_us_delta(ktime_get(), start));
 		} else if (compress_name) {
 			if (!message) {
 				snprintf(msg_buf, sizeof msg_buf,
@@ -26,6 +26,7 @@
 #include <linux/slab.h>
 #include <linux/profile.h>
 #include <linux/interrupt.h>
+#include <linux/export.h>
 
 #include <trace/events/sched.h>
 
@@ -2125,6 +2126,256 @@ void unthrottle_offline_cfs_rqs(struct rq *rq) {}
 
 #endif /* CONFIG_CFS_BANDWIDTH */
 
+#ifdef CONFIG_SCHED_UTIL_TRACKING
+/*
+ * Per-task utilization tracking.
+ *
+ * Time is cut into periods of 1024us.  The time a task spends queued,
+ * and the part of it spent running, are summed over the periods, each
+ * period weighted by y^n where n is its age and y^32 = 1/2: what happened
+ * 32ms ago counts half as much as what happens now.  avg_period sums the
+ * elapsed time the same way, so the ratios of the sums to it are the
+ * recent fractions of time the task wanted the cpu and had it.
+ *
+ * rq->util is the sum of the running fractions of the fair tasks queued
+ * on a cpu.  cpufreq and hotplug code can read it through sched_cpu_util()
+ * or be handed it at enqueue, dequeue and the tick through a
+ * sched_util_hook instead of sampling the idle time.
+ */
+#define UTIL_AVG_PERIOD	32	/* y^UTIL_AVG_PERIOD = 1/2 */
+#define UTIL_AVG_MAX	46763	/* the sum over UTIL_AVG_MAX_N full periods */
+#define UTIL_AVG_MAX_N	524	/* after which it no longer grows */
+
+/* y^n * 2^32 */
+static const u32 util_avg_yN_inv[] = {
+	0xffffffff, 0xfa83b2db, 0xf5257d15, 0xefe4b99b,
+	0xeac0c6e7, 0xe5b906e7, 0xe0ccdeec, 0xdbfbb797,
+	0xd744fcca, 0xd2a81d91, 0xce248c15, 0xc9b9bd86,
+	0xc5672a11, 0xc12c4cca, 0xbd08a39f, 0xb8fbaf47,
+	0xb504f333, 0xb123f581, 0xad583eea, 0xa9a15ab4,
+	0xa5fed6a9, 0xa2704303, 0x9ef53260, 0x9b8d39b9,
+	0x9837f051, 0x94f4efa8, 0x91c3d373, 0x8ea4398b,
+	0x8b95c1e3, 0x88980e80, 0x85aac367, 0x82cd8698,
+};
+
+/* 1024 * (y^1 + ... + y^n) */
+static const u32 util_avg_yN_sum[] = {
+	    0,  1002,  1982,  2942,  3881,  4800,  5699,  6579,  7440,
+	 8282,  9107,  9914, 10704, 11476, 12232, 12972, 13696, 14405,
+	15098, 15777, 16441, 17091, 17726, 18349, 18957, 19553, 20136,
+	20707, 21265, 21812, 22346, 22870, 23382,
+};
+
+static DEFINE_PER_CPU(struct sched_util_hook __rcu *, sched_util_hooks);
+
+/* val * y^n */
+static __always_inline u64 decay_util(u64 val, u64 n)
+{
+	if (!n)
+		return val;
+	if (unlikely(n > UTIL_AVG_PERIOD * 63))
+		return 0;
+
+	if (n >= UTIL_AVG_PERIOD) {
+		val >>= n / UTIL_AVG_PERIOD;
+		n %= UTIL_AVG_PERIOD;
+	}
+
+	val *= util_avg_yN_inv[n];
+	return val >> 32;
+}
+
+/* What n full periods add to a sum once they are 1..n periods old */
+static u32 __compute_util_contrib(u64 n)
+{
+	u32 contrib = 0;
+
+	if (likely(n <= UTIL_AVG_PERIOD))
+		return util_avg_yN_sum[n];
+	else if (unlikely(n >= UTIL_AVG_MAX_N))
+		return UTIL_AVG_MAX;
+
+	do {
+		contrib /= 2;	/* y^UTIL_AVG_PERIOD */
+		contrib += util_avg_yN_sum[UTIL_AVG_PERIOD];
+		n -= UTIL_AVG_PERIOD;
+	} while (n > UTIL_AVG_PERIOD);
+
+	contrib = decay_util(contrib, n);
+	return contrib + util_avg_yN_sum[n];
+}
+
+/*
+ * Account the time since the last update to the sums, as queued and
+ * running or not.  Returns whether a period boundary was crossed, that
+ * is whether the averages need recomputing.
+ */
+static int __update_sched_avg(u64 now, struct sched_avg *sa,
+			      int runnable, int running)
+{
+	u64 delta, periods;
+	u32 delta_w, contrib;
+	int decayed = 0;
+
+	delta = now - sa->last_update;
+	/* A migrated task may come from a rq whose clock_task is ahead */
+	if ((s64)delta < 0) {
+		sa->last_update = now;
+		return 0;
+	}
+
+	/* Close enough to microseconds */
+	delta >>= 10;
+	if (!delta)
+		return 0;
+	sa->last_update = now;
+
+	/* Complete the current period first */
+	delta_w = sa->period_contrib;
+	if (delta + delta_w >= 1024) {
+		decayed = 1;
+
+		delta_w = 1024 - delta_w;
+		if (runnable)
+			sa->runnable_avg_sum += delta_w;
+		if (running)
+			sa->running_avg_sum += delta_w;
+		sa->avg_period += delta_w;
+		delta -= delta_w;
+
+		/* Age it and add the full periods since */
+		periods = delta / 1024;
+		delta %= 1024;
+
+		sa->runnable_avg_sum = decay_util(sa->runnable_avg_sum,
+						  periods + 1);
+		sa->running_avg_sum = decay_util(sa->running_avg_sum,
+						 periods + 1);
+		sa->avg_period = decay_util(sa->avg_period, periods + 1);
+
+		contrib = __compute_util_contrib(periods);
+		if (runnable)
+			sa->runnable_avg_sum += contrib;
+		if (running)
+			sa->running_avg_sum += contrib;
+		sa->avg_period += contrib;
+		sa->period_contrib = 0;
+	}
+
+	/* The remainder goes into the new current period */
+	if (runnable)
+		sa->runnable_avg_sum += delta;
+	if (running)
+		sa->running_avg_sum += delta;
+	sa->avg_period += delta;
+	sa->period_contrib += delta;
+
+	return decayed;
+}
+
+static void update_task_util(struct rq *rq, struct task_struct *p)
+{
+	struct sched_avg *sa = &p->se.avg;
+	unsigned long util;
+
+	if (!__update_sched_avg(rq->clock_task, sa, p->se.on_rq,
+				rq->curr == p))
+		return;
+
+	sa->runnable = (sa->runnable_avg_sum << SCHED_UTIL_SHIFT) /
+			(sa->avg_period + 1);
+	util = (sa->running_avg_sum << SCHED_UTIL_SHIFT) /
+			(sa->avg_period + 1);
+
+	if (p->se.on_rq)
+		rq->util += util - sa->util;
+	sa->util = util;
+}
+
+static void notify_util(struct rq *rq, struct task_struct *p)
+{
+	struct sched_util_hook *hook;
+	int cpu = cpu_of(rq);
+	unsigned long util = min(rq->util, SCHED_UTIL_SCALE);
+
+	trace_sched_util(p, cpu, p->se.avg.runnable, p->se.avg.util, util);
+
+	hook = rcu_dereference_sched(per_cpu(sched_util_hooks, cpu));
+	if (hook)
+		hook->func(hook, cpu, util);
+}
+
+/* Called before the task is put on the rq, and after */
+static void enqueue_task_util(struct rq *rq, struct task_struct *p, int queued)
+{
+	if (!queued) {
+		update_task_util(rq, p);
+		return;
+	}
+
+	rq->util += p->se.avg.util;
+	notify_util(rq, p);
+}
+
+/* Called before the task is taken off the rq, and after */
+static void dequeue_task_util(struct rq *rq, struct task_struct *p, int queued)
+{
+	if (queued) {
+		update_task_util(rq, p);
+		return;
+	}
+
+	rq->util -= p->se.avg.util;
+	notify_util(rq, p);
+}
+
+static void tick_task_util(struct rq *rq, struct task_struct *curr)
+{
+	update_task_util(rq, curr);
+	notify_util(rq, curr);
+}
+
+/* A new task's history starts now: it is as busy as its first periods */
+static void fork_task_util(struct rq *rq, struct task_struct *p)
+{
+	p->se.avg.last_update = rq->clock_task;
+}
+
+/**
+ * sched_cpu_util - recent utilization of a cpu by fair tasks
+ * @cpu: the cpu
+ *
+ * Returns the decaying average of the time the fair tasks now queued on
+ * @cpu have spent running, SCHED_UTIL_SCALE meaning all of the time.
+ */
+unsigned long sched_cpu_util(int cpu)
+{
+	return min(ACCESS_ONCE(cpu_rq(cpu)->util), SCHED_UTIL_SCALE);
+}
+EXPORT_SYMBOL_GPL(sched_cpu_util);
+
+/**
+ * sched_set_util_hook - have utilization changes on a cpu reported
+ * @cpu: the cpu
+ * @hook: the hook, or NULL to remove it
+ *
+ * After removing a hook, synchronize_sched() before freeing it.
+ */
+void sched_set_util_hook(int cpu, struct sched_util_hook *hook)
+{
+	rcu_assign_pointer(per_cpu(sched_util_hooks, cpu), hook);
+}
+EXPORT_SYMBOL_GPL(sched_set_util_hook);
+#else /* CONFIG_SCHED_UTIL_TRACKING */
+static inline void update_task_util(struct rq *rq, struct task_struct *p) {}
+static inline void
+enqueue_task_util(struct rq *rq, struct task_struct *p, int queued) {}
+static inline void
+dequeue_task_util(struct rq *rq, struct task_struct *p, int queued) {}
+static inline void tick_task_util(struct rq *rq, struct task_struct *curr) {}
+static inline void fork_task_util(struct rq *rq, struct task_struct *p) {}
+#endif /* CONFIG_SCHED_UTIL_TRACKING */
+
 /**************************************************
  * CFS operations on tasks:
  */
@@ -2196,6 +2447,8 @@ enqueue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 	struct cfs_rq *cfs_rq;
 	struct sched_entity *se = &p->se;
 
+	enqueue_task_util(rq, p, 0);
+
 	for_each_sched_entity(se) {
 		if (se->on_rq)
 			break;
@@ -2228,6 +2481,7 @@ enqueue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 
 	if (!se)
 		inc_nr_running(rq);
+	enqueue_task_util(rq, p, 1);
 	hrtick_update(rq);
 }
 
@@ -2244,6 +2498,8 @@ static void dequeue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 	struct sched_entity *se = &p->se;
 	int task_sleep = flags & DEQUEUE_SLEEP;
 
+	dequeue_task_util(rq, p, 1);
+
 	for_each_sched_entity(se) {
 		cfs_rq = cfs_rq_of(se);
 		dequeue_entity(cfs_rq, se, flags);
@@ -2287,6 +2543,7 @@ static void dequeue_task_fair(struct rq *rq, struct task_struct *p, int flags)
 
 	if (!se)
 		dec_nr_running(rq);
+	dequeue_task_util(rq, p, 0);
 	hrtick_update(rq);
 }
 
@@ -3009,6 +3266,8 @@ static struct task_struct *pick_next_task_fair(struct rq *rq)
 	} while (cfs_rq);
 
 	p = task_of(se);
+	/* Its wait on the rq ends */
+	update_task_util(rq, p);
 	if (hrtick_enabled(rq))
 		hrtick_start_fair(rq, p);
 
@@ -3023,6 +3282,8 @@ static void put_prev_task_fair(struct rq *rq, struct task_struct *prev)
 	struct sched_entity *se = &prev->se;
 	struct cfs_rq *cfs_rq;
 
+	update_task_util(rq, prev);
+
 	for_each_sched_entity(se) {
 		cfs_rq = cfs_rq_of(se);
 		put_prev_entity(cfs_rq, se);
@@ -5208,6 +5469,8 @@ static void task_tick_fair(struct rq *rq, struct task_struct *curr, int queued)
 		cfs_rq = cfs_rq_of(se);
 		entity_tick(cfs_rq, se, queued);
 	}
+
+	tick_task_util(rq, curr);
 }
 
 /*
@@ -5252,6 +5515,7 @@ static void task_fork_fair(struct task_struct *p)
 	}
 
 	se->vruntime -= cfs_rq->min_vruntime;
+	fork_task_util(rq, p);
 
 	raw_spin_unlock_irqrestore(&rq->lock, flags);
 }
@@ -383,6 +383,11 @@ struct rq {
 	struct cfs_rq cfs;
 	struct rt_rq rt;
 
+#ifdef CONFIG_SCHED_UTIL_TRACKING
+	/* sum of se.avg.util over the fair tasks queued here */
+	unsigned long util;
+#endif
+
 #ifdef CONFIG_FAIR_GROUP_SCHED
 	/* list of leaf cfs_rq on this cpu: */
 	struct list_head leaf_cfs_rq_list;
@@ -28,6 +28,9 @@
 #include <linux/init.h>
 #include <linux/atomic.h>
 #include "crc32defs.h"
+#ifdef CONFIG_CRC32_ARM_NEON
+#include <asm/crc32.h>
+#endif
 #if CRC_LE_BITS == 8
 # define tole(x) __constant_cpu_to_le32(x)
 #else
@@ -126,6 +129,13 @@ u32 __pure crc32_le(u32 crc, unsigned char const *p, size_t len)
 # if CRC_LE_BITS == 8
 	const u32      (*tab)[] = crc32table_le;
 
+#  ifdef CONFIG_CRC32_ARM_NEON
+	if (crc32_neon_usable(len)) {
+		crc = crc32_neon_update(crc, p, len, &crc32_neon_le_consts);
+		p += len & ~15;
+		len &= 15;
+	}
+#  endif
 	crc = __cpu_to_le32(crc);
 	crc = crc32_body(crc, p, len, tab);
 	return __le32_to_cpu(crc);
@@ -0,0 +1,199 @@
+/*
+ * Wrapper for decompressing LZ4-compressed kernel, initramfs, and initrd
+ *
+ * Copyright (C) ST-Ericsson SA 2012
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Images are in the legacy format written by "lz4c -l": a little endian
+ * magic number followed by blocks, each a little endian compressed size
+ * and an LZ4 block that decompresses to 8 MB, except for the last one.
+ * The magic may appear again between blocks where archives have been
+ * concatenated.
+ */
+
+#ifdef STATIC
+#include "lz4/lz4_decompress.c"
+#else
+#include <linux/decompress/unlz4.h>
+#endif
+#include <linux/types.h>
+#include <linux/lz4.h>
+#include <linux/decompress/mm.h>
+#include <linux/compiler.h>
+
+#include <asm/unaligned.h>
+
+#define LZ4_DEFAULT_UNCOMPRESSED_CHUNK_SIZE (8 << 20)
+#define ARCHIVE_MAGICNUMBER 0x184C2102
+
+STATIC inline int INIT unlz4(u8 *input, int in_len,
+				int (*fill) (void *, unsigned int),
+				int (*flush) (void *, unsigned int),
+				u8 *output, int *posp,
+				void (*error) (char *x))
+{
+	int ret = -1;
+	size_t chunksize = 0;
+	size_t uncomp_chunksize = LZ4_DEFAULT_UNCOMPRESSED_CHUNK_SIZE;
+	size_t max_chunksize = lz4_compressbound(uncomp_chunksize);
+	u8 *inp;
+	u8 *inp_start;
+	u8 *outp;
+	int size = in_len;
+	size_t dest_len;
+
+	if (output) {
+		outp = output;
+	} else if (!flush) {
+		error("NULL output pointer and no flush function provided");
+		goto exit_0;
+	} else {
+		outp = large_malloc(uncomp_chunksize);
+		if (!outp) {
+			error("Could not allocate output buffer");
+			goto exit_0;
+		}
+	}
+
+	if (input && fill) {
+		error("Both input pointer and fill function provided,");
+		goto exit_1;
+	} else if (input) {
+		inp = input;
+	} else if (!fill) {
+		error("NULL input pointer and missing fill function");
+		goto exit_1;
+	} else {
+		inp = large_malloc(max_chunksize);
+		if (!inp) {
+			error("Could not allocate input buffer");
+			goto exit_1;
+		}
+	}
+	inp_start = inp;
+
+	if (posp)
+		*posp = 0;
+
+	if (fill) {
+		size = fill(inp, 4);
+		if (size < 4) {
+			error("data corrupted");
+			goto exit_2;
+		}
+	} else if (size < 4) {
+		error("data corrupted");
+		goto exit_2;
+	}
+
+	chunksize = get_unaligned_le32(inp);
+	if (chunksize != ARCHIVE_MAGICNUMBER) {
+		error("invalid header");
+		goto exit_2;
+	}
+
+	if (posp)
+		*posp += 4;
+
+	if (!fill) {
+		inp += 4;
+		size -= 4;
+	}
+
+	for (;;) {
+		if (fill) {
+			size = fill(inp, 4);
+			if (size == 0)
+				break;
+			if (size < 4) {
+				error("data corrupted");
+				goto exit_2;
+			}
+		} else if (size <= 4) {
+			/*
+			 * Nothing but the uncompressed length appended by
+			 * size_append, if anything: the legacy format has
+			 * no end marker.
+			 */
+			break;
+		}
+
+		chunksize = get_unaligned_le32(inp);
+		if (chunksize == ARCHIVE_MAGICNUMBER) {
+			if (!fill) {
+				inp += 4;
+				size -= 4;
+			}
+			if (posp)
+				*posp += 4;
+			continue;
+		}
+
+		if (fill) {
+			/*
+			 * Likewise a word with nothing after it is the
+			 * size_append length, not a chunk header.
+			 */
+			size = fill(inp, chunksize < max_chunksize ?
+					 chunksize : max_chunksize);
+			if (size == 0)
+				break;
+		}
+
+		if (posp)
+			*posp += 4;
+
+		if (chunksize > max_chunksize) {
+			error("chunk length is longer than allowed");
+			goto exit_2;
+		}
+
+		if (!fill) {
+			inp += 4;
+			size -= 4;
+			if (chunksize > (size_t)size) {
+				error("data corrupted");
+				goto exit_2;
+			}
+		} else if (size < (int)chunksize) {
+			error("data corrupted");
+			goto exit_2;
+		}
+
+		dest_len = uncomp_chunksize;
+		ret = lz4_decompress_unknownoutputsize(inp, chunksize, outp,
+						       &dest_len);
+		if (ret < 0) {
+			error("Decoding failed");
+			goto exit_2;
+		}
+		ret = -1;
+
+		if (flush && flush(outp, dest_len) != dest_len)
+			goto exit_2;
+		if (output)
+			outp += dest_len;
+		if (posp)
+			*posp += chunksize;
+
+		if (!fill) {
+			size -= chunksize;
+			inp += chunksize;
+		}
+	}
+
+	ret = 0;
+exit_2:
+	if (!input)
+		large_free(inp_start);
+exit_1:
+	if (!output)
+		large_free(outp);
+exit_0:
+	return ret;
+}
+
+#define decompress unlz4
@@ -0,0 +1,218 @@
+/*
+ * LZ4 - Fast LZ compression algorithm
+ * Copyright (C) 2011-2012, Yann Collet.
+ * BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You can contact the author at :
+ * - LZ4 homepage : http://fastcompression.blogspot.com/p/lz4.html
+ * - LZ4 source repository : http://code.google.com/p/lz4/
+ */
+
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/string.h>
+#include <linux/lz4.h>
+#include <asm/unaligned.h>
+#include "lz4defs.h"
+
+/* Number of leading bytes two words differing by diff have in common */
+static inline int lz4_nbcommonbytes(u32 diff)
+{
+#if defined(__LITTLE_ENDIAN)
+	return __builtin_ctz(diff) >> 3;
+#else
+	return __builtin_clz(diff) >> 3;
+#endif
+}
+
+int lz4_compress(const unsigned char *src, size_t src_len,
+		unsigned char *dst, size_t *dst_len, void *wrkmem)
+{
+	u32 *hash_table = wrkmem;
+	const u8 *ip = src;
+	const u8 *anchor = ip;
+	const u8 *const iend = ip + src_len;
+	const u8 *const mflimit = iend - MFLIMIT;
+	const u8 *const matchlimit = iend - LASTLITERALS;
+	u8 *op = dst;
+	u8 *const oend = op + *dst_len;
+	const u8 *ref;
+	u8 *token, *cpy;
+	size_t length, len;
+	u32 h, fwd_h;
+
+	if (src_len < MINLENGTH)
+		goto last_literals;
+
+	memset(hash_table, 0, LZ4_MEM_COMPRESS);
+
+	/* First byte */
+	hash_table[LZ4_HASH(LZ4_GET32(ip))] = 0;
+	ip++;
+	fwd_h = LZ4_HASH(LZ4_GET32(ip));
+
+	for (;;) {
+		int attempts = 1 << SKIPSTRENGTH;
+		const u8 *fwd_ip = ip;
+
+		/* Find a match */
+		do {
+			int step = attempts++ >> SKIPSTRENGTH;
+
+			h = fwd_h;
+			ip = fwd_ip;
+			fwd_ip = ip + step;
+			if (unlikely(fwd_ip > mflimit))
+				goto last_literals;
+
+			fwd_h = LZ4_HASH(LZ4_GET32(fwd_ip));
+			ref = src + hash_table[h];
+			hash_table[h] = ip - src;
+		} while (ip - ref > MAX_DISTANCE ||
+			 LZ4_GET32(ref) != LZ4_GET32(ip));
+
+		/* Catch up */
+		while (ip > anchor && ref > src && unlikely(ip[-1] == ref[-1])) {
+			ip--;
+			ref--;
+		}
+
+		/* Encode literal length */
+		length = ip - anchor;
+		token = op++;
+		if (unlikely(op + length + (2 + 1 + LASTLITERALS) +
+			     (length >> 8) > oend))
+			return -1;
+
+		if (length >= RUN_MASK) {
+			*token = RUN_MASK << ML_BITS;
+			len = length - RUN_MASK;
+			for (; len > 254; len -= 255)
+				*op++ = 255;
+			*op++ = len;
+		} else
+			*token = length << ML_BITS;
+
+		/* Copy literals, overrunning into room the sequence needs */
+		cpy = op + length;
+		LZ4_WILDCOPY(anchor, op, cpy);
+		op = cpy;
+
+next_match:
+		/* Encode offset */
+		LZ4_WRITE_LE16(op, ip - ref);
+		op += 2;
+
+		/* Start counting */
+		ip += MINMATCH;
+		ref += MINMATCH;
+		anchor = ip;
+		while (likely(ip < matchlimit - 3)) {
+			u32 diff = LZ4_GET32(ref) ^ LZ4_GET32(ip);
+
+			if (!diff) {
+				ip += 4;
+				ref += 4;
+				continue;
+			}
+			ip += lz4_nbcommonbytes(diff);
+			goto endcount;
+		}
+		if (ip < matchlimit - 1 && ref[0] == ip[0] && ref[1] == ip[1]) {
+			ip += 2;
+			ref += 2;
+		}
+		if (ip < matchlimit && *ref == *ip)
+			ip++;
+endcount:
+		/* Encode match length */
+		len = ip - anchor;
+		if (unlikely(op + (1 + LASTLITERALS) + (len >> 8) > oend))
+			return -1;
+
+		if (len >= ML_MASK) {
+			*token += ML_MASK;
+			len -= ML_MASK;
+			for (; len > 509; len -= 510) {
+				*op++ = 255;
+				*op++ = 255;
+			}
+			if (len > 254) {
+				len -= 255;
+				*op++ = 255;
+			}
+			*op++ = len;
+		} else
+			*token += len;
+
+		/* Test end of chunk */
+		if (ip > mflimit) {
+			anchor = ip;
+			break;
+		}
+
+		/* Fill table */
+		hash_table[LZ4_HASH(LZ4_GET32(ip - 2))] = ip - 2 - src;
+
+		/* Test next position */
+		h = LZ4_HASH(LZ4_GET32(ip));
+		ref = src + hash_table[h];
+		hash_table[h] = ip - src;
+		if (ip - ref <= MAX_DISTANCE && LZ4_GET32(ref) == LZ4_GET32(ip)) {
+			token = op++;
+			*token = 0;
+			goto next_match;
+		}
+
+		/* Prepare next loop */
+		anchor = ip++;
+		fwd_h = LZ4_HASH(LZ4_GET32(ip));
+	}
+
+last_literals:
+	/* Encode last literals */
+	length = iend - anchor;
+	if (op + length + 1 + (length + 255 - RUN_MASK) / 255 > oend)
+		return -1;
+
+	if (length >= RUN_MASK) {
+		*op++ = RUN_MASK << ML_BITS;
+		len = length - RUN_MASK;
+		for (; len > 254; len -= 255)
+			*op++ = 255;
+		*op++ = len;
+	} else
+		*op++ = length << ML_BITS;
+	memcpy(op, anchor, length);
+	op += length;
+
+	*dst_len = op - dst;
+	return 0;
+}
+EXPORT_SYMBOL(lz4_compress);
+
+MODULE_LICENSE("Dual BSD/GPL");
+MODULE_DESCRIPTION("LZ4 compressor");
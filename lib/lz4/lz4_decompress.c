@@ -0,0 +1,214 @@
+/*
+ * LZ4 Decompressor for Linux kernel
+ *
+ * Copyright (C) 2011-2012, Yann Collet.
+ * BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are
+ * met:
+ *
+ *     * Redistributions of source code must retain the above copyright
+ * notice, this list of conditions and the following disclaimer.
+ *     * Redistributions in binary form must reproduce the above
+ * copyright notice, this list of conditions and the following disclaimer
+ * in the documentation and/or other materials provided with the
+ * distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ * LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR
+ * A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT
+ * LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE,
+ * DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY
+ * THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+ * (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ *
+ * You can contact the author at :
+ * - LZ4 homepage : http://fastcompression.blogspot.com/p/lz4.html
+ * - LZ4 source repository : http://code.google.com/p/lz4/
+ */
+
+#ifndef STATIC
+#include <linux/module.h>
+#include <linux/kernel.h>
+#endif
+#include <linux/types.h>
+#include <linux/string.h>
+#include <linux/lz4.h>
+
+#include <asm/unaligned.h>
+
+#include "lz4defs.h"
+
+/*
+ * Matches closer than 8 bytes overlap the 8 byte copies.  The first 8
+ * bytes are copied in two halves, stepping ref back so that each half
+ * repeats the pattern, after which op - ref is a multiple of the period
+ * that is at least 8.
+ */
+static const int dec32table[] = {0, 3, 2, 3, 0, 0, 0, 0};
+static const int dec64table[] = {0, 0, 0, -1, 0, 1, 2, 3};
+
+/*
+ * Decode one block into dest..oend.  With end_on_input the block is
+ * src..iend and both ends are checked; otherwise the input is trusted and
+ * decoding stops when the output is exactly full.
+ */
+static __always_inline int lz4_uncompress(const u8 *src, const u8 *iend,
+		u8 *dest, u8 *const oend, const bool end_on_input,
+		const u8 **in_end, u8 **out_end)
+{
+	const u8 *ip = src;
+	const u8 *ref;
+	u8 *op = dest;
+	u8 *cpy;
+	unsigned int token, s;
+	size_t length;
+
+	while (!end_on_input || ip < iend) {
+		/* Get run length */
+		token = *ip++;
+		length = token >> ML_BITS;
+		if (length == RUN_MASK) {
+			do {
+				if (end_on_input && unlikely(ip >= iend))
+					goto output_error;
+				s = *ip++;
+				length += s;
+				if (unlikely(length > (size_t)(oend - op)))
+					goto output_error;
+			} while (s == 255);
+		}
+
+		/* Copy literals */
+		if (unlikely(length > (size_t)(oend - op)))
+			goto output_error;
+		cpy = op + length;
+		if (oend - cpy < COPYLENGTH || (end_on_input &&
+		    length + COPYLENGTH > (size_t)(iend - ip))) {
+			/*
+			 * Only the last literals get this close to either
+			 * end: they must fill the output, or use up the
+			 * input, exactly.
+			 */
+			if (end_on_input) {
+				if (length != (size_t)(iend - ip))
+					goto output_error;
+			} else if (cpy != oend)
+				goto output_error;
+			memcpy(op, ip, length);
+			ip += length;
+			op = cpy;
+			break;
+		}
+		LZ4_WILDCOPY(ip, op, cpy);
+		ip -= op - cpy;
+		op = cpy;
+
+		/* Get offset */
+		length = LZ4_READ_LE16(ip);
+		ip += 2;
+		ref = cpy - length;
+		if (unlikely(length == 0 || length > (size_t)(cpy - dest)))
+			goto output_error;
+
+		/* Get match length */
+		length = token & ML_MASK;
+		if (length == ML_MASK) {
+			do {
+				if (end_on_input && unlikely(ip >= iend))
+					goto output_error;
+				s = *ip++;
+				length += s;
+				if (unlikely(length > (size_t)(oend - op)))
+					goto output_error;
+			} while (s == 255);
+		}
+		length += MINMATCH;
+		if (unlikely(length > (size_t)(oend - op)))
+			goto output_error;
+		cpy = op + length;
+
+		/* Copy repeated sequence; op <= oend - 8 after the literals */
+		if (unlikely(op - ref < 8)) {
+			const int dec64 = dec64table[op - ref];
+
+			op[0] = ref[0];
+			op[1] = ref[1];
+			op[2] = ref[2];
+			op[3] = ref[3];
+			op += 4;
+			ref += 4;
+			ref -= dec32table[op - ref];
+			COPY4(op, ref);
+			op += 4;
+			ref -= dec64;
+		} else {
+			COPY8(op, ref);
+			op += 8;
+			ref += 8;
+		}
+
+		if (unlikely(oend - cpy < COPYLENGTH)) {
+			LZ4_WILDCOPY(ref, op, oend - COPYLENGTH);
+			while (op < cpy)
+				*op++ = *ref++;
+			op = cpy;
+			continue;
+		}
+		LZ4_WILDCOPY(ref, op, cpy);
+		op = cpy;
+	}
+
+	*in_end = ip;
+	*out_end = op;
+	return 0;
+
+output_error:
+	return -1;
+}
+
+int lz4_decompress(const unsigned char *src, size_t *src_len,
+		unsigned char *dest, size_t actual_dest_len)
+{
+	const u8 *ip;
+	u8 *op;
+	int ret;
+
+	ret = lz4_uncompress(src, NULL, dest, dest + actual_dest_len, false,
+			     &ip, &op);
+	if (ret < 0)
+		return ret;
+
+	*src_len = ip - src;
+	return 0;
+}
+#ifndef STATIC
+EXPORT_SYMBOL(lz4_decompress);
+#endif
+
+int lz4_decompress_unknownoutputsize(const unsigned char *src, size_t src_len,
+		unsigned char *dest, size_t *dest_len)
+{
+	const u8 *ip;
+	u8 *op;
+	int ret;
+
+	ret = lz4_uncompress(src, src + src_len, dest, dest + *dest_len, true,
+			     &ip, &op);
+	if (ret < 0)
+		return ret;
+
+	*dest_len = op - dest;
+	return 0;
+}
+#ifndef STATIC
+EXPORT_SYMBOL(lz4_decompress_unknownoutputsize);
+
+MODULE_LICENSE("Dual BSD/GPL");
+MODULE_DESCRIPTION("LZ4 Decompressor");
+#endif
@@ -0,0 +1,80 @@
+/*
+ * lz4defs.h -- architecture specific defines
+ *
+ * Copyright (C) 2011-2012, Yann Collet.
+ * BSD 2-Clause License (http://www.opensource.org/licenses/bsd-license.php)
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ */
+
+/*
+ * Word sized loads and stores at any alignment, as in lib/lzo/lzodefs.h:
+ * ARM's get_unaligned() works a byte at a time, but ARMv6 and later do
+ * unaligned LDR and STR in hardware.  The accesses are volatile so that
+ * GCC cannot merge them into an LDRD or LDM, which still need alignment.
+ * The boot decompressor (STATIC) cannot rely on SCTLR.A being clear.
+ */
+#if defined(CONFIG_HAVE_EFFICIENT_UNALIGNED_ACCESS)
+#define LZ4_UNALIGNED		1
+#define LZ4_GET32(p)		get_unaligned((const u32 *)(p))
+#define LZ4_PUT32(p, v)		put_unaligned(v, (u32 *)(p))
+#elif defined(CONFIG_ARM) && __LINUX_ARM_ARCH__ >= 6 && !defined(STATIC)
+#define LZ4_UNALIGNED		1
+#define LZ4_GET32(p)		(*(const volatile u32 *)(p))
+#define LZ4_PUT32(p, v)		(*(volatile u32 *)(p) = (v))
+#else
+#define LZ4_GET32(p)		get_unaligned((const u32 *)(p))
+#define LZ4_PUT32(p, v)		put_unaligned(v, (u32 *)(p))
+#endif
+
+#define LZ4_READ_LE16(p)	get_unaligned_le16(p)
+#define LZ4_WRITE_LE16(p, v)	put_unaligned_le16(v, p)
+
+#define COPY4(d, s)		LZ4_PUT32(d, LZ4_GET32(s))
+#if defined(CONFIG_HAVE_EFFICIENT_UNALIGNED_ACCESS) && defined(CONFIG_64BIT)
+#define COPY8(d, s)	\
+		put_unaligned(get_unaligned((const u64 *)(s)), (u64 *)(d))
+#else
+#define COPY8(d, s)	\
+		do { COPY4(d, s); COPY4((d) + 4, (s) + 4); } while (0)
+#endif
+
+/*
+ * Copy in 8 byte steps from s to d until d reaches e, advancing both; may
+ * write up to 7 bytes past e.
+ */
+#define LZ4_WILDCOPY(s, d, e)		\
+	do {				\
+		while (d < e) {		\
+			COPY8(d, s);	\
+			d += 8;		\
+			s += 8;		\
+		}			\
+	} while (0)
+
+#define MINMATCH	4
+#define COPYLENGTH	8
+#define LASTLITERALS	5
+#define MFLIMIT		(COPYLENGTH + MINMATCH)
+#define MINLENGTH	(MFLIMIT + 1)
+
+#define MAXD_LOG	16
+#define MAX_DISTANCE	((1 << MAXD_LOG) - 1)
+
+#define ML_BITS		4
+#define ML_MASK		((1U << ML_BITS) - 1)
+#define RUN_BITS	(8 - ML_BITS)
+#define RUN_MASK	((1U << RUN_BITS) - 1)
+
+/*
+ * The compressor hashes 4 byte sequences into a table of 1 << HASH_LOG
+ * offsets; the size of LZ4_MEM_COMPRESS follows from it.
+ */
+#define HASH_LOG	12
+#define HASHTABLESIZE	(1 << HASH_LOG)
+#define LZ4_HASH(v)	(((v) * 2654435761U) >> ((MINMATCH * 8) - HASH_LOG))
+
+/* Search speeds up over incompressible data after 1 << SKIPSTRENGTH misses */
+#define SKIPSTRENGTH	6
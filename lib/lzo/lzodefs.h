@@ -1,7 +1,7 @@
 /*
  *  lzodefs.h -- architecture, OS and compiler specific defines
  *
- *  Copyright (C) 1996-2005 Markus F.X.J. Oberhumer <markus@oberhumer.com>
+ *  Copyright (C) 1996-2012 Markus F.X.J. Oberhumer <markus@oberhumer.com>
  *
  *  The full LZO package can be found at:
  *  http://www.oberhumer.com/opensource/lzo/
@@ -11,9 +11,51 @@
  *  Richard Purdie <rpurdie@openedhand.com>
  */
 
-#define LZO_VERSION		0x2020
-#define LZO_VERSION_STRING	"2.02"
-#define LZO_VERSION_DATE	"Oct 17 2005"
+#define LZO_VERSION		0x2060
+#define LZO_VERSION_STRING	"2.06"
+#define LZO_VERSION_DATE	"Aug 12 2011"
+
+/*
+ * LZO_UNALIGNED is set where word sized loads and stores at any alignment
+ * are cheap, and LZO_GET32()/LZO_PUT32() are then used for them.
+ *
+ * ARM's get_unaligned() works a byte at a time, but ARMv6 and later do
+ * unaligned LDR and STR in hardware once alignment_init() has cleared
+ * SCTLR.A.  The accesses are volatile so that GCC cannot merge two of
+ * them into an LDRD or LDM, which still need alignment.  The boot
+ * decompressor (STATIC) runs with whatever SCTLR.A the boot loader left
+ * and uses byte accesses.
+ */
+#if defined(CONFIG_HAVE_EFFICIENT_UNALIGNED_ACCESS)
+#define LZO_UNALIGNED		1
+#define LZO_GET32(p)		get_unaligned((const u32 *)(p))
+#define LZO_PUT32(p, v)		put_unaligned(v, (u32 *)(p))
+#elif defined(CONFIG_ARM) && __LINUX_ARM_ARCH__ >= 6 && !defined(STATIC)
+#define LZO_UNALIGNED		1
+#define LZO_GET32(p)		(*(const volatile u32 *)(p))
+#define LZO_PUT32(p, v)		(*(volatile u32 *)(p) = (v))
+#else
+#define LZO_GET32(p)		get_unaligned((const u32 *)(p))
+#define LZO_PUT32(p, v)		put_unaligned(v, (u32 *)(p))
+#endif
+
+#define COPY4(dst, src)		LZO_PUT32(dst, LZO_GET32(src))
+#if defined(CONFIG_HAVE_EFFICIENT_UNALIGNED_ACCESS) && defined(CONFIG_64BIT)
+#define COPY8(dst, src)	\
+		put_unaligned(get_unaligned((const u64 *)(src)), (u64 *)(dst))
+#else
+#define COPY8(dst, src)	\
+		do { COPY4(dst, src); COPY4((dst) + 4, (src) + 4); } while (0)
+#endif
+
+#if defined(__BIG_ENDIAN) && defined(__LITTLE_ENDIAN)
+#error "conflicting endian definitions"
+#elif defined(LZO_UNALIGNED) && defined(CONFIG_X86_64)
+#define LZO_USE_CTZ64	1
+#define LZO_USE_CTZ32	1
+#elif defined(LZO_UNALIGNED)
+#define LZO_USE_CTZ32	1
+#endif
 
 #define M1_MAX_OFFSET	0x0400
 #define M2_MAX_OFFSET	0x0800
@@ -34,10 +76,13 @@
 #define M3_MARKER	32
 #define M4_MARKER	16
 
-#define D_BITS		14
-#define D_MASK		((1u << D_BITS) - 1)
-#define D_HIGH		((D_MASK >> 1) + 1)
-
-#define DX2(p, s1, s2)	(((((size_t)((p)[2]) << (s2)) ^ (p)[1]) \
-							<< (s1)) ^ (p)[0])
-#define DX3(p, s1, s2, s3)	((DX2((p)+1, s2, s3) << (s1)) ^ (p)[0])
+/*
+ * The dictionary holds 16-bit offsets into the chunk being compressed, so
+ * chunks are limited to M4_MAX_OFFSET + 1 bytes.  Inputs of a page or less
+ * use half of it, which halves the memset() per call.
+ */
+#define lzo_dict_t	unsigned short
+#define D_BITS		13
+#define D_SIZE		(1u << D_BITS)
+#define D_BITS_SMALL	(D_BITS - 1)
+#define D_SMALL_LEN	4096
@@ -0,0 +1,24 @@
+/*
+ * Prototypes for the NEON RAID-6 routines, shared between the
+ * -mfpu=neon units and their kernel_neon_begin() wrappers.
+ */
+#ifndef LIB_RAID6_NEON_H
+#define LIB_RAID6_NEON_H
+
+void raid6_neon1_gen_syndrome_real(int disks, unsigned long bytes,
+				   void **ptrs);
+void raid6_neon2_gen_syndrome_real(int disks, unsigned long bytes,
+				   void **ptrs);
+void raid6_neon4_gen_syndrome_real(int disks, unsigned long bytes,
+				   void **ptrs);
+void raid6_neon8_gen_syndrome_real(int disks, unsigned long bytes,
+				   void **ptrs);
+
+void __raid6_2data_recov_neon(int bytes, uint8_t *p, uint8_t *q, uint8_t *dp,
+			      uint8_t *dq, const uint8_t *pbmul,
+			      const uint8_t *qmul);
+
+void __raid6_datap_recov_neon(int bytes, uint8_t *p, uint8_t *q, uint8_t *dq,
+			      const uint8_t *qmul);
+
+#endif /* LIB_RAID6_NEON_H */
@@ -0,0 +1,108 @@
+/* -*- linux-c -*- ------------------------------------------------------- *
+ *
+ *   Copyright (C) ST-Ericsson SA 2012
+ *
+ *   This program is free software; you can redistribute it and/or modify
+ *   it under the terms of the GNU General Public License as published by
+ *   the Free Software Foundation, Inc., 53 Temple Place Ste 330,
+ *   Boston MA 02111-1307, USA; either version 2 of the License, or
+ *   (at your option) any later version; incorporated herein by reference.
+ *
+ * ----------------------------------------------------------------------- */
+
+/*
+ * raid6/recov_neon_inner.c
+ *
+ * NEON inner loops for RAID-6 recovery, built with -mfpu=neon.
+ *
+ * Multiplication by a constant in GF(2^8) is done a nibble at a time with
+ * the 16-entry tables of raid6_vgfmul[]: c*x = lo[x & 15] ^ hi[x >> 4].
+ * ARMv7 has no 16-byte wide table lookup, so each lookup is a pair of
+ * VTBL.8 with a two register (16 byte) table.
+ */
+
+#include <arm_neon.h>
+#include "neon.h"
+
+static inline uint8x16_t vtbl16(uint8x8x2_t t, uint8x16_t idx)
+{
+	return vcombine_u8(vtbl2_u8(t, vget_low_u8(idx)),
+			   vtbl2_u8(t, vget_high_u8(idx)));
+}
+
+static inline uint8x8x2_t vld_tbl(const uint8_t *tbl)
+{
+	uint8x8x2_t t;
+
+	t.val[0] = vld1_u8(tbl);
+	t.val[1] = vld1_u8(tbl + 8);
+	return t;
+}
+
+static inline uint8x16_t gfmul(uint8x8x2_t lo, uint8x8x2_t hi, uint8x16_t x)
+{
+	const uint8x16_t x0f = vdupq_n_u8(0x0f);
+
+	return veorq_u8(vtbl16(lo, vandq_u8(x, x0f)),
+			vtbl16(hi, vshrq_n_u8(x, 4)));
+}
+
+void __raid6_2data_recov_neon(int bytes, uint8_t *p, uint8_t *q, uint8_t *dp,
+			      uint8_t *dq, const uint8_t *pbmul,
+			      const uint8_t *qmul)
+{
+	const uint8x8x2_t pm0 = vld_tbl(pbmul), pm1 = vld_tbl(pbmul + 16);
+	const uint8x8x2_t qm0 = vld_tbl(qmul), qm1 = vld_tbl(qmul + 16);
+	uint8x16_t px, qx, db;
+
+	/*
+	 * while ( bytes-- ) {
+	 *	uint8_t px, qx, db;
+	 *
+	 *	px    = *p ^ *dp;
+	 *	qx    = qmul[*q ^ *dq];
+	 *	*dq++ = db = pbmul[px] ^ qx;
+	 *	*dp++ = db ^ px;
+	 *	p++; q++;
+	 * }
+	 */
+	while (bytes) {
+		px = veorq_u8(vld1q_u8(p), vld1q_u8(dp));
+		qx = gfmul(qm0, qm1, veorq_u8(vld1q_u8(q), vld1q_u8(dq)));
+		db = veorq_u8(gfmul(pm0, pm1, px), qx);
+
+		vst1q_u8(dq, db);
+		vst1q_u8(dp, veorq_u8(db, px));
+
+		bytes -= 16;
+		p += 16;
+		q += 16;
+		dp += 16;
+		dq += 16;
+	}
+}
+
+void __raid6_datap_recov_neon(int bytes, uint8_t *p, uint8_t *q, uint8_t *dq,
+			      const uint8_t *qmul)
+{
+	const uint8x8x2_t qm0 = vld_tbl(qmul), qm1 = vld_tbl(qmul + 16);
+	uint8x16_t vx;
+
+	/*
+	 * while (bytes--) {
+	 *	*p++ ^= *dq = qmul[*q ^ *dq];
+	 *	q++; dq++;
+	 * }
+	 */
+	while (bytes) {
+		vx = gfmul(qm0, qm1, veorq_u8(vld1q_u8(q), vld1q_u8(dq)));
+
+		vst1q_u8(dq, vx);
+		vst1q_u8(p, veorq_u8(vld1q_u8(p), vx));
+
+		bytes -= 16;
+		p += 16;
+		q += 16;
+		dq += 16;
+	}
+}
@@ -0,0 +1,372 @@
+/*
+ * Checks and throughput of the LZO1X compressor and decompressor
+ *
+ * Copyright (C) ST-Ericsson SA 2012
+ * License terms:  GNU General Public License (GPL), version 2
+ *
+ * Loading the module
+ *  - decompresses streams produced by the previous in-kernel compressor
+ *    and compares them with the original data, so that existing zram,
+ *    squashfs, ubifs and hibernation images keep reading back bit-exact;
+ *  - round trips generated data of assorted sizes through
+ *    lzo1x_1_compress() and lzo1x_decompress_safe(), with guard bytes
+ *    around the output and checks that truncated input and a too small
+ *    output buffer are caught;
+ *  - times both directions on 4 KB pages that look like zram swap data
+ *    and on 128 KB squashfs-style datablocks and prints MB/s and ratio.
+ *
+ * The module always fails to load once done, there is nothing to unload.
+ */
+#define pr_fmt(fmt)	KBUILD_MODNAME ": " fmt
+
+#include <linux/hrtimer.h>
+#include <linux/kernel.h>
+#include <linux/lzo.h>
+#include <linux/math64.h>
+#include <linux/module.h>
+#include <linux/string.h>
+#include <linux/vmalloc.h>
+
+#define BLOCK_SIZE	(128 * 1024)
+#define BUF_SIZE	lzo1x_worst_compress(BLOCK_SIZE)
+#define GUARD		16
+#define MIN_BYTES	(16 * 1024 * 1024)
+
+static const char text[] =
+	"static int squashfs_readpage(struct file *file, struct page *page)\n"
+	"{\n\tstruct inode *inode = page->mapping->host;\n"
+	"\tif (page->index >= ((i_size_read(inode) + PAGE_CACHE_SIZE - 1) >>\n"
+	"\t\t\t\t\tPAGE_CACHE_SHIFT))\n\t\tgoto out;\n";
+
+static u32 seed;
+
+static u32 next_rand(void)
+{
+	seed = seed * 1103515245 + 12345;
+	return seed >> 8;
+}
+
+/*
+ * Fill buf with something resembling anonymous memory or file data: runs of
+ * zeroes, arrays of small integers and kernel-looking pointers, source text
+ * and a little noise.  The mix is fixed by the seed.
+ */
+static void fill(u8 *buf, size_t len, u32 s)
+{
+	size_t i = 0, run, j;
+	u32 word;
+
+	seed = s;
+	while (i < len) {
+		run = 16 + next_rand() % 240;
+		if (run > len - i)
+			run = len - i;
+
+		switch (next_rand() % 8) {
+		case 0:
+		case 1:
+			memset(buf + i, 0, run);
+			break;
+		case 2:
+		case 3:
+			word = (next_rand() & 1) ? 0xc0000000 |
+				(next_rand() & 0x3ffff0) : next_rand() & 0xff;
+			for (j = 0; j < run; j++) {
+				if (j % 4 == 0)
+					word += 4;
+				buf[i + j] = word >> (8 * (j % 4));
+			}
+			break;
+		case 4:
+			for (j = 0; j < run; j++)
+				buf[i + j] = next_rand();
+			break;
+		default:
+			word = next_rand() % (sizeof(text) - 1);
+			for (j = 0; j < run; j++)
+				buf[i + j] = text[(word + j) % (sizeof(text) - 1)];
+			break;
+		}
+		i += run;
+	}
+}
+
+/*
+ * Written by the LZO 2.02 based compressor this tree used to ship, from the
+ * first REF_LEN bytes of fill(.., REF_SEED) and from a testmgr vector.
+ */
+#define REF_SEED	2012
+#define REF_LEN		1024
+
+static const u8 ref_stream[] = {
+	0x00, 0x1d, 0x28, 0x69, 0x5f, 0x73, 0x69, 0x7a,
+	0x65, 0x5f, 0x72, 0x65, 0x61, 0x64, 0x28, 0x69,
+	0x6e, 0x6f, 0x64, 0x65, 0x29, 0x20, 0x2b, 0x20,
+	0x50, 0x41, 0x47, 0x45, 0x5f, 0x43, 0x41, 0x43,
+	0x48, 0x45, 0x5f, 0x53, 0x49, 0x5a, 0x45, 0x20,
+	0x2d, 0x20, 0x31, 0x29, 0x20, 0x3e, 0x3e, 0x0a,
+	0x09, 0x60, 0x00, 0x2a, 0x70, 0x00, 0x00, 0x0f,
+	0x48, 0x49, 0x46, 0x54, 0x29, 0x29, 0x0a, 0x09,
+	0x09, 0x67, 0x6f, 0x74, 0x6f, 0x20, 0x6f, 0x75,
+	0x74, 0x3b, 0x0a, 0x73, 0x74, 0x61, 0x74, 0x69,
+	0x63, 0x20, 0x69, 0x6e, 0x74, 0x20, 0x73, 0x71,
+	0x75, 0xf4, 0x08, 0x3f, 0xa0, 0x00, 0x02, 0x61,
+	0x73, 0x68, 0x66, 0x73, 0x98, 0x10, 0x05, 0x70,
+	0x61, 0x74, 0x72, 0x75, 0x63, 0x74, 0x20, 0x96,
+	0x11, 0x20, 0x2a, 0xb8, 0x00, 0x00, 0x0a, 0x3d,
+	0x20, 0x70, 0x61, 0x67, 0x65, 0x2d, 0x3e, 0x6d,
+	0x61, 0x70, 0x70, 0x69, 0x6e, 0x67, 0x2d, 0x3e,
+	0x68, 0x6f, 0x73, 0x74, 0x3b, 0x0a, 0x09, 0x69,
+	0x66, 0x20, 0x28, 0xa4, 0x03, 0x0b, 0x69, 0x6e,
+	0x64, 0x65, 0x78, 0x20, 0x3e, 0x3d, 0x20, 0x28,
+	0x28, 0x69, 0x5f, 0x73, 0x20, 0x1a, 0x4e, 0x03,
+	0x09, 0x73, 0x30, 0xfc, 0x01, 0x2e, 0x46, 0x01,
+	0x5f, 0x53, 0x20, 0x0c, 0x43, 0x03, 0x67, 0x65,
+	0x28, 0xd0, 0x0a, 0x03, 0x66, 0x69, 0x6c, 0x65,
+	0x20, 0x2a, 0x76, 0x00, 0x2c, 0x20, 0xc8, 0x02,
+	0x7a, 0x17, 0x20, 0x2a, 0x74, 0x00, 0x01, 0x29,
+	0x0a, 0x7b, 0x0a, 0x32, 0xf5, 0x01, 0x20, 0x3f,
+	0xf5, 0x03, 0x00, 0x20, 0x2e, 0x00, 0x00, 0x00,
+	0x97, 0xe7, 0x64, 0x02, 0x05, 0xbf, 0x27, 0xb2,
+	0xbc, 0x86, 0xa4, 0x65, 0x8b, 0x56, 0xc8, 0x99,
+	0x3e, 0x0c, 0x3e, 0x88, 0x63, 0x43, 0x74, 0x2f,
+	0x44, 0x59, 0x94, 0x4a, 0xee, 0x68, 0x8b, 0x54,
+	0x2d, 0x4d, 0x05, 0x8a, 0x8d, 0xa3, 0x6d, 0xe8,
+	0x59, 0xc8, 0xf0, 0x2a, 0x9e, 0xd6, 0x7a, 0xcc,
+	0x28, 0xaa, 0xb7, 0x09, 0x82, 0xdf, 0x12, 0xde,
+	0xfa, 0xd2, 0xb8, 0x07, 0x9a, 0xa0, 0x95, 0xff,
+	0x2e, 0x22, 0x55, 0x03, 0x44, 0xf7, 0x63, 0x0f,
+	0x26, 0x79, 0xec, 0xdf, 0xe1, 0xc6, 0xdc, 0xef,
+	0x41, 0xb7, 0xdf, 0x7a, 0xd2, 0xeb, 0x61, 0x7d,
+	0xdf, 0xbc, 0x8d, 0xb3, 0x75, 0x47, 0x50, 0x9a,
+	0x60, 0x68, 0x55, 0x6c, 0x2b, 0xbb, 0x0a, 0x26,
+	0x24, 0x9b, 0x99, 0x84, 0x55, 0x25, 0xef, 0x01,
+	0x8b, 0x35, 0xb7, 0xdb, 0x51, 0x67, 0x5f, 0x0c,
+	0xf4, 0x16, 0x11, 0x50, 0x80, 0x5f, 0xba, 0x25,
+	0xc1, 0x1e, 0x06, 0xc5, 0x43, 0xef, 0x60, 0x2d,
+	0x51, 0x2d, 0xf5, 0x19, 0xf8, 0xf5, 0xb1, 0x04,
+	0x04, 0x23, 0x40, 0x2b, 0x00, 0x53, 0x0d, 0x8a,
+	0x3a, 0xe0, 0x45, 0xdd, 0xbc, 0xe7, 0xd4, 0xa0,
+	0x53, 0x44, 0x66, 0x0e, 0x8a, 0x93, 0x66, 0x24,
+	0xae, 0x2f, 0x20, 0x12, 0x48, 0x0a, 0x2a, 0xa4,
+	0x09, 0x20, 0x12, 0x60, 0x06, 0x00, 0x73, 0xf7,
+	0xad, 0x81, 0x78, 0x6c, 0xe0, 0xaf, 0x6c, 0xf9,
+	0xaf, 0x1a, 0x2a, 0x5a, 0x27, 0xdf, 0x9f, 0x0b,
+	0x14, 0xda, 0x76, 0x47, 0x02, 0xa7, 0x1d, 0x0b,
+	0x3c, 0xa1, 0xbe, 0x13, 0xcf, 0xe5, 0x46, 0xda,
+	0x87, 0x4f, 0x61, 0x9d, 0xef, 0x7b, 0x7a, 0x58,
+	0x54, 0xc4, 0xbe, 0xc7, 0xc3, 0x47, 0x19, 0x65,
+	0x05, 0xe0, 0x37, 0x70, 0xa9, 0x2a, 0x83, 0xe2,
+	0xf9, 0x83, 0x2a, 0x77, 0x02, 0x05, 0x18, 0xad,
+	0x90, 0x8d, 0xf9, 0xbe, 0x2f, 0xb6, 0x38, 0xa7,
+	0x2a, 0xde, 0x03, 0x24, 0x8e, 0x1f, 0x43, 0xb0,
+	0x27, 0x56, 0xa7, 0x89, 0x80, 0x1e, 0x9a, 0xa9,
+	0xe7, 0xd5, 0x47, 0xcc, 0x66, 0x95, 0x9b, 0x70,
+	0xc9, 0x3b, 0x41, 0xcf, 0x9e, 0x62, 0xa7, 0xe6,
+	0x2f, 0x68, 0xf7, 0x71, 0x89, 0x67, 0x1e, 0xeb,
+	0x78, 0x3c, 0xc8, 0x91, 0x88, 0x82, 0x60, 0x5f,
+	0x04, 0x97, 0x13, 0x11, 0xf9, 0x95, 0xcd, 0x23,
+	0x33, 0x59, 0x3a, 0xd0, 0xc8, 0x47, 0x7c, 0x48,
+	0x20, 0x1d, 0x34, 0x09, 0x11, 0x00, 0x00,
+};
+
+static const struct {
+	const char *out;
+	size_t in_len;
+	const u8 *in;
+} ref_text[] = {
+	{
+		"Join us now and share the software "
+		"Join us now and share the software ",
+		46,
+		"\x00\x0d\x4a\x6f\x69\x6e\x20\x75\x73\x20\x6e\x6f\x77\x20\x61"
+		"\x6e\x64\x20\x73\x68\x61\x72\x65\x20\x74\x68\x65\x20\x73\x6f"
+		"\x66\x74\x77\x70\x01\x01\x4a\x6f\x69\x6e\x3d\x88\x00\x11\x00"
+		"\x00",
+	},
+};
+
+static int check_old_streams(u8 *src, u8 *dst)
+{
+	size_t len;
+	int i, ret;
+
+	fill(src, REF_LEN, REF_SEED);
+	len = REF_LEN;
+	ret = lzo1x_decompress_safe(ref_stream, sizeof(ref_stream), dst, &len);
+	if (ret != LZO_E_OK || len != REF_LEN || memcmp(dst, src, len)) {
+		pr_err("old stream: error %d, length %zu\n", ret, len);
+		return -EINVAL;
+	}
+
+	for (i = 0; i < ARRAY_SIZE(ref_text); i++) {
+		len = BUF_SIZE;
+		ret = lzo1x_decompress_safe(ref_text[i].in, ref_text[i].in_len,
+					    dst, &len);
+		if (ret != LZO_E_OK || len != strlen(ref_text[i].out) ||
+		    memcmp(dst, ref_text[i].out, len)) {
+			pr_err("old text stream %d: error %d\n", i, ret);
+			return -EINVAL;
+		}
+	}
+	return 0;
+}
+
+static const size_t check_lens[] = {
+	0, 1, 3, 4, 15, 16, 17, 18, 20, 21, 64, 238, 239, 300, 1000,
+	PAGE_SIZE - 1, PAGE_SIZE, PAGE_SIZE + 1, 49151, 49152, 49153, 65536,
+	BLOCK_SIZE,
+};
+
+static int check_one(u8 *src, u8 *cmp, u8 *dst, void *wrkmem, size_t len)
+{
+	size_t clen, dlen, cut;
+	int ret;
+
+	memset(cmp + BUF_SIZE, 0x5a, GUARD);
+	clen = BUF_SIZE;
+	ret = lzo1x_1_compress(src, len, cmp, &clen, wrkmem);
+	if (ret != LZO_E_OK || clen > lzo1x_worst_compress(len) ||
+	    memchr_inv(cmp + BUF_SIZE, 0x5a, GUARD)) {
+		pr_err("compress: length %zu: error %d, %zu bytes\n",
+		       len, ret, clen);
+		return -EINVAL;
+	}
+
+	/* Decompress into an exactly sized buffer followed by guard bytes */
+	memset(dst + len, 0xa5, GUARD);
+	dlen = len;
+	ret = lzo1x_decompress_safe(cmp, clen, dst, &dlen);
+	if (ret != LZO_E_OK || dlen != len || memcmp(dst, src, len) ||
+	    memchr_inv(dst + len, 0xa5, GUARD)) {
+		pr_err("decompress: length %zu: error %d, %zu bytes\n",
+		       len, ret, dlen);
+		return -EINVAL;
+	}
+
+	if (len) {
+		dlen = len - 1;
+		ret = lzo1x_decompress_safe(cmp, clen, dst, &dlen);
+		if (ret != LZO_E_OUTPUT_OVERRUN || dlen > len - 1) {
+			pr_err("short output: length %zu: error %d\n",
+			       len, ret);
+			return -EINVAL;
+		}
+	}
+
+	for (cut = 0; cut < clen; cut += 1 + clen / 32) {
+		dlen = len;
+		ret = lzo1x_decompress_safe(cmp, cut, dst, &dlen);
+		if (ret == LZO_E_OK || dlen > len ||
+		    memchr_inv(dst + len, 0xa5, GUARD)) {
+			pr_err("truncated input: length %zu cut at %zu: "
+			       "error %d\n", len, cut, ret);
+			return -EINVAL;
+		}
+	}
+	return 0;
+}
+
+static int check(u8 *src, u8 *cmp, u8 *dst, void *wrkmem)
+{
+	int i, s, ret;
+
+	for (s = 0; s < 4; s++) {
+		fill(src, BLOCK_SIZE, s);
+		if (s == 3)
+			memset(src, 0, BLOCK_SIZE);
+		for (i = 0; i < ARRAY_SIZE(check_lens); i++) {
+			ret = check_one(src, cmp, dst, wrkmem, check_lens[i]);
+			if (ret)
+				return ret;
+		}
+	}
+	return 0;
+}
+
+/* MB/s of compressing, then decompressing, src in chunks of len bytes */
+static void bench(const char *name, u8 *src, u8 *cmp, u8 *dst, void *wrkmem,
+		  size_t len)
+{
+	size_t clen[BLOCK_SIZE / PAGE_SIZE];
+	unsigned long c_mbs, d_mbs;
+	size_t off, pos, total, n, i;
+	u64 bytes;
+	s64 ns;
+	ktime_t start;
+
+	n = BLOCK_SIZE / len;
+	bytes = 0;
+	start = ktime_get();
+	do {
+		for (i = 0, pos = 0; i < n; i++) {
+			clen[i] = BUF_SIZE - pos;
+			lzo1x_1_compress(src + i * len, len, cmp + pos,
+					 &clen[i], wrkmem);
+			pos += clen[i];
+		}
+		bytes += n * len;
+	} while (bytes < MIN_BYTES);
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	c_mbs = ns > 0 ? div64_u64(bytes * 1000, ns) : 0;
+	total = pos;
+
+	bytes = 0;
+	start = ktime_get();
+	do {
+		for (i = 0, pos = 0; i < n; i++) {
+			off = len;
+			lzo1x_decompress_safe(cmp + pos, clen[i], dst, &off);
+			pos += clen[i];
+		}
+		bytes += n * len;
+	} while (bytes < MIN_BYTES);
+	ns = ktime_to_ns(ktime_sub(ktime_get(), start));
+	d_mbs = ns > 0 ? div64_u64(bytes * 1000, ns) : 0;
+
+	pr_info("%-8s %6zu %8lu %8lu %5zu%%\n", name, len, c_mbs, d_mbs,
+		total * 100 / (n * len));
+}
+
+static int __init test_lzo_init(void)
+{
+	u8 *src, *cmp, *dst;
+	void *wrkmem;
+	int ret;
+
+	src = vmalloc(BLOCK_SIZE);
+	cmp = vmalloc(BUF_SIZE + GUARD);
+	dst = vmalloc(BUF_SIZE + GUARD);
+	wrkmem = vmalloc(LZO1X_1_MEM_COMPRESS);
+	if (!src || !cmp || !dst || !wrkmem) {
+		ret = -ENOMEM;
+		goto out;
+	}
+
+	ret = check_old_streams(src, dst);
+	if (ret)
+		goto out;
+	ret = check(src, cmp, dst, wrkmem);
+	if (ret)
+		goto out;
+	pr_info("LZO1X round trips and old streams check out\n");
+
+	pr_info("data       size comp MB/s dec MB/s ratio\n");
+	fill(src, BLOCK_SIZE, 1);
+	bench("zram", src, cmp, dst, wrkmem, PAGE_SIZE);
+	fill(src, BLOCK_SIZE, 2);
+	bench("squashfs", src, cmp, dst, wrkmem, BLOCK_SIZE);
+
+	/* Nothing to keep loaded */
+	ret = -EAGAIN;
+out:
+	vfree(wrkmem);
+	vfree(dst);
+	vfree(cmp);
+	vfree(src);
+	return ret;
+}
+module_init(test_lzo_init);
+
+MODULE_DESCRIPTION("Checks and throughput of the LZO1X compressor");
+MODULE_LICENSE("GPL");
@@ -0,0 +1,339 @@
+/*
+ * Pseudo-tty stand-in for a CG2900 controller
+ *
+ * Copyright (C) ST-Ericsson SA 2012
+ * License terms:  GNU General Public License (GPL), version 2
+ *
+ * Creates a pseudo-tty, attaches the CG2900 HCI line discipline to its
+ * slave side and plays the controller on the master side, so that the
+ * cg2900_uart transport can be driven at full speed without hardware:
+ *
+ *  - every HCI command gets a successful Command Complete event, HCI Read
+ *    Local Version Information reports a CG2900 so the chip driver accepts
+ *    it (the patch and settings files it requests must still exist);
+ *  - every ACL packet from the host is acknowledged with a Number Of
+ *    Completed Packets event and, with -l, sent back to the host;
+ *  - with -r, ACL packets of -s bytes are generated at the given rate.
+ *
+ * Packet and byte rates in both directions are printed every second. ACL
+ * load from the host side is easiest generated by writing raw H:4 ACL
+ * packets to /dev/cg2900_bt_acl.
+ *
+ * The cg2900_uart platform device must exist as for a real chip.
+ *
+ * Command line parameters
+ * cg2900_pty_chip [-l] [-r <packets/s>] [-s <ACL payload bytes>]
+ *		   [-v <HCI revision>]
+ */
+
+#define _XOPEN_SOURCE 600
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+
+#define N_CG2900_HCI		23
+#define HCIUARTSETPROTO		_IOW('U', 200, int)
+#define HCI_UART_STE		6
+
+#define H4_CMD			0x01
+#define H4_ACL			0x02
+#define H4_EVT			0x04
+#define H4_FM_RADIO		0x08
+#define H4_GNSS			0x09
+
+#define EVT_CMD_COMPLETE	0x0E
+#define EVT_NUM_COMP_PKTS	0x13
+#define OP_READ_LOCAL_VERSION	0x1001
+#define ST_ERICSSON_MANUFACTURER 0x0030
+
+#define ACL_HANDLE		0x0001
+#define ACL_MAX_PAYLOAD		1021
+
+struct stats {
+	unsigned long pkts;
+	unsigned long bytes;
+};
+
+static int master;
+static int loopback;
+static unsigned int rx_rate;
+static unsigned int rx_size = 512;
+static unsigned int hci_revision = 0x0200;
+
+static struct stats from_host;
+static struct stats to_host;
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void put_le16(uint8_t *p, unsigned int val)
+{
+	p[0] = val & 0xFF;
+	p[1] = val >> 8;
+}
+
+static void send_to_host(const uint8_t *data, size_t len)
+{
+	while (len) {
+		ssize_t n = write(master, data, len);
+
+		if (n < 0) {
+			if (errno == EINTR || errno == EAGAIN)
+				continue;
+			perror("write");
+			exit(1);
+		}
+		data += n;
+		len -= n;
+	}
+}
+
+static void send_acl(const uint8_t *payload, unsigned int len)
+{
+	uint8_t pkt[5 + ACL_MAX_PAYLOAD];
+
+	pkt[0] = H4_ACL;
+	put_le16(&pkt[1], ACL_HANDLE | 0x2000);	/* First flushable */
+	put_le16(&pkt[3], len);
+	if (payload)
+		memcpy(&pkt[5], payload, len);
+	else
+		memset(&pkt[5], 0, len);
+	send_to_host(pkt, 5 + len);
+	to_host.pkts++;
+	to_host.bytes += 5 + len;
+}
+
+static void handle_cmd(const uint8_t *pkt)
+{
+	unsigned int opcode = pkt[1] | pkt[2] << 8;
+	uint8_t evt[16] = { H4_EVT, EVT_CMD_COMPLETE, 4, 1 };
+	size_t len = 7;
+
+	put_le16(&evt[4], opcode);
+	evt[6] = 0;				/* Success */
+
+	if (opcode == OP_READ_LOCAL_VERSION) {
+		evt[7] = 4;			/* HCI version */
+		put_le16(&evt[8], hci_revision);
+		evt[10] = 4;			/* LMP version */
+		put_le16(&evt[11], ST_ERICSSON_MANUFACTURER);
+		put_le16(&evt[13], 0);		/* LMP subversion */
+		len = 15;
+	}
+	evt[2] = len - 3;
+	send_to_host(evt, len);
+}
+
+static void handle_acl(const uint8_t *pkt, unsigned int len)
+{
+	uint8_t evt[] = { H4_EVT, EVT_NUM_COMP_PKTS, 5, 1, 0, 0, 1, 0 };
+
+	put_le16(&evt[4], (pkt[1] | pkt[2] << 8) & 0x0FFF);
+	send_to_host(evt, sizeof(evt));
+
+	if (loopback)
+		send_acl(&pkt[5], len - 5);
+}
+
+/* Return length of the H:4 packet in buf, 0 if incomplete, -1 if invalid */
+static int packet_len(const uint8_t *buf, size_t count)
+{
+	size_t hdr;
+
+	switch (buf[0]) {
+	case H4_CMD:
+		hdr = 4;
+		break;
+	case H4_ACL:
+		hdr = 5;
+		break;
+	case H4_FM_RADIO:
+		hdr = 2;
+		break;
+	case H4_GNSS:
+		hdr = 4;
+		break;
+	default:
+		return -1;
+	}
+	if (count < hdr)
+		return 0;
+
+	switch (buf[0]) {
+	case H4_CMD:
+		hdr += buf[3];
+		break;
+	case H4_ACL:
+		hdr += buf[3] | buf[4] << 8;
+		break;
+	case H4_FM_RADIO:
+		hdr += buf[1];
+		break;
+	case H4_GNSS:
+		hdr += buf[2] | buf[3] << 8;
+		break;
+	}
+	return count < hdr ? 0 : (int)hdr;
+}
+
+static void handle_host_data(uint8_t *buf, size_t *fill)
+{
+	size_t pos = 0;
+	int len;
+
+	while (pos < *fill) {
+		len = packet_len(&buf[pos], *fill - pos);
+		if (len < 0) {
+			fprintf(stderr, "Unknown H:4 type 0x%02X\n", buf[pos]);
+			pos++;
+			continue;
+		}
+		if (!len)
+			break;
+
+		from_host.pkts++;
+		from_host.bytes += len;
+		if (buf[pos] == H4_CMD)
+			handle_cmd(&buf[pos]);
+		else if (buf[pos] == H4_ACL)
+			handle_acl(&buf[pos], len);
+		pos += len;
+	}
+
+	memmove(buf, &buf[pos], *fill - pos);
+	*fill -= pos;
+}
+
+static int open_pty(void)
+{
+	int ldisc = N_CG2900_HCI;
+	int slave;
+	char *name;
+
+	master = posix_openpt(O_RDWR | O_NOCTTY);
+	if (master < 0 || grantpt(master) || unlockpt(master)) {
+		perror("pty");
+		return -1;
+	}
+
+	name = ptsname(master);
+	slave = open(name, O_RDWR | O_NOCTTY);
+	if (slave < 0) {
+		perror(name);
+		return -1;
+	}
+
+	if (ioctl(slave, TIOCSETD, &ldisc) < 0) {
+		perror("TIOCSETD");
+		return -1;
+	}
+	if (ioctl(slave, HCIUARTSETPROTO, HCI_UART_STE) < 0) {
+		perror("HCIUARTSETPROTO");
+		return -1;
+	}
+
+	printf("CG2900 stand-in on %s\n", name);
+	return slave;
+}
+
+static void print_stats(double secs)
+{
+	static struct stats last_from, last_to;
+
+	printf("host->chip %8.0f pkts/s %10.0f B/s   "
+	       "chip->host %8.0f pkts/s %10.0f B/s\n",
+	       (from_host.pkts - last_from.pkts) / secs,
+	       (from_host.bytes - last_from.bytes) / secs,
+	       (to_host.pkts - last_to.pkts) / secs,
+	       (to_host.bytes - last_to.bytes) / secs);
+	fflush(stdout);
+	last_from = from_host;
+	last_to = to_host;
+}
+
+int main(int argc, char **argv)
+{
+	static uint8_t buf[65536];
+	size_t fill = 0;
+	double start, last_report, t;
+	unsigned long generated = 0;
+	int c;
+
+	while ((c = getopt(argc, argv, "lr:s:v:")) != -1) {
+		switch (c) {
+		case 'l':
+			loopback = 1;
+			break;
+		case 'r':
+			rx_rate = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			rx_size = strtoul(optarg, NULL, 0);
+			if (rx_size > ACL_MAX_PAYLOAD)
+				rx_size = ACL_MAX_PAYLOAD;
+			break;
+		case 'v':
+			hci_revision = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			fprintf(stderr, "Usage: %s [-l] [-r <packets/s>] "
+				"[-s <ACL payload bytes>] [-v <HCI revision>]\n",
+				argv[0]);
+			return 1;
+		}
+	}
+
+	if (open_pty() < 0)
+		return 1;
+
+	start = last_report = now();
+	for (;;) {
+		struct pollfd pfd = { .fd = master, .events = POLLIN };
+		ssize_t n;
+
+		if (poll(&pfd, 1, rx_rate ? 1 : 1000) < 0 && errno != EINTR) {
+			perror("poll");
+			return 1;
+		}
+
+		if (pfd.revents & POLLIN) {
+			n = read(master, &buf[fill], sizeof(buf) - fill);
+			if (n < 0 && errno != EINTR && errno != EAGAIN) {
+				perror("read");
+				return 1;
+			}
+			if (n > 0) {
+				fill += n;
+				handle_host_data(buf, &fill);
+			}
+		}
+
+		t = now();
+		if (rx_rate) {
+			unsigned long due = (t - start) * rx_rate;
+
+			while (generated < due) {
+				send_acl(NULL, rx_size);
+				generated++;
+			}
+		}
+
+		if (t - last_report >= 1.0) {
+			print_stats(t - last_report);
+			last_report = t;
+		}
+	}
+}
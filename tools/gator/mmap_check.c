@@ -0,0 +1,236 @@
+/*
+ * mmap_check: check the gator zero-copy buffer export on an SMP target
+ *
+ * Copyright (C) ARM Limited 2012. All rights reserved.
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation.
+ *
+ * Starts a capture the way gatord does, keeps every cpu busy, and for each
+ * frame GATOR_IOC_COMMIT_WAIT hands out checks the bytes mapped at
+ * offset1/offset2 against what the driver committed there: the length
+ * it post-populated, the frame type of the buffer and the core number of
+ * the cpu.  A mapping laid out in another order than the offsets shows up
+ * as frames of the wrong type or core.  Fails unless frames from at least
+ * two cpus were checked.  gatord must not be running.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <time.h>
+#include <stdint.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+/* From drivers/gator/gator.h */
+struct gator_buffer_segment {
+	__u32 cpu;
+	__u32 buftype;
+	__u32 offset1;
+	__u32 length1;
+	__u32 offset2;
+	__u32 length2;
+};
+
+#define GATOR_IOC_MAGIC			'G'
+#define GATOR_IOC_COMMIT_WAIT		_IOR(GATOR_IOC_MAGIC, 1, struct gator_buffer_segment)
+#define GATOR_IOC_COMMIT_RELEASE	_IO(GATOR_IOC_MAGIC, 2)
+
+#define MAX_CPUS	32
+
+/* Frame type by buffer, as in gator_buffer_header() */
+static const unsigned int frame_type[] = { 1, 2, 4, 5, 3, 6, 7 };
+
+static int write_driver(const char *name, const char *value)
+{
+	char path[64];
+	int fd, ret;
+
+	snprintf(path, sizeof(path), "/dev/gator/%s", name);
+	fd = open(path, O_WRONLY);
+	if (fd < 0) {
+		perror(path);
+		return -1;
+	}
+	ret = write(fd, value, strlen(value)) < 0 ? -1 : 0;
+	if (ret)
+		perror(path);
+	close(fd);
+	return ret;
+}
+
+static long read_driver(const char *name)
+{
+	char path[64], buf[32];
+	ssize_t len;
+	int fd;
+
+	snprintf(path, sizeof(path), "/dev/gator/%s", name);
+	fd = open(path, O_RDONLY);
+	if (fd < 0) {
+		perror(path);
+		return -1;
+	}
+	len = read(fd, buf, sizeof(buf) - 1);
+	close(fd);
+	if (len <= 0)
+		return -1;
+	buf[len] = '\0';
+	return strtol(buf, NULL, 0);
+}
+
+/* Byte i of a frame that may wrap from offset1 to offset2 */
+static unsigned char frame_byte(const unsigned char *map,
+				const struct gator_buffer_segment *seg,
+				unsigned int i)
+{
+	if (i < seg->length1)
+		return map[seg->offset1 + i];
+	return map[seg->offset2 + i - seg->length1];
+}
+
+static unsigned int frame_packed_int(const unsigned char *map,
+				     const struct gator_buffer_segment *seg,
+				     unsigned int *pos)
+{
+	unsigned int x = 0, shift = 0;
+	unsigned char b;
+
+	do {
+		b = frame_byte(map, seg, (*pos)++);
+		x |= (b & 0x7f) << shift;
+		shift += 7;
+	} while ((b & 0x80) && shift < 35);
+	return x;
+}
+
+static int check_frame(const unsigned char *map,
+		       const struct gator_buffer_segment *seg)
+{
+	unsigned int total = seg->length1 + seg->length2;
+	unsigned int pos = 1, length = 0, type, core, i;
+
+	/* response type, then the length of what follows it */
+	for (i = 0; i < 4; i++)
+		length |= frame_byte(map, seg, pos++) << (i * 8);
+	if (length != total - 5) {
+		fprintf(stderr, "cpu%u buf%u: length %u, frame is %u bytes\n",
+			seg->cpu, seg->buftype, length, total);
+		return -1;
+	}
+
+	type = frame_packed_int(map, seg, &pos);
+	core = frame_packed_int(map, seg, &pos);
+	if (seg->buftype >= sizeof(frame_type) / sizeof(frame_type[0]) ||
+	    type != frame_type[seg->buftype] || core != seg->cpu) {
+		fprintf(stderr, "cpu%u buf%u: mapped frame has type %u core %u\n",
+			seg->cpu, seg->buftype, type, core);
+		return -1;
+	}
+	return 0;
+}
+
+/* Keep a cpu busy with a mix of spinning and context switches */
+static pid_t spin_on(int cpu)
+{
+	cpu_set_t set;
+	pid_t pid;
+
+	pid = fork();
+	if (pid)
+		return pid;
+
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	sched_setaffinity(0, sizeof(set), &set);
+	for (;;) {
+		volatile int i;
+
+		for (i = 0; i < 100000; i++)
+			;
+		usleep(100);
+	}
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long frames[MAX_CPUS] = { 0 };
+	struct gator_buffer_segment seg;
+	pid_t pids[MAX_CPUS];
+	unsigned char *map;
+	long cores, map_size;
+	unsigned int seconds = argc > 1 ? strtoul(argv[1], NULL, 0) : 5;
+	int fd, cpu, cpus_seen = 0, errors = 0;
+	time_t end;
+	long ret;
+
+	if (read_driver("enable") != 0) {
+		fprintf(stderr, "gator already enabled, is gatord running?\n");
+		return 1;
+	}
+	cores = read_driver("cpu_cores");
+	if (cores < 2 || cores > MAX_CPUS) {
+		fprintf(stderr, "needs 2 to %d cpus, driver reports %ld\n",
+			MAX_CPUS, cores);
+		return 1;
+	}
+
+	/* calls gator_op_setup(), which lays out buffer_mmap_size */
+	fd = open("/dev/gator/buffer", O_RDONLY);
+	if (fd < 0) {
+		perror("/dev/gator/buffer");
+		return 1;
+	}
+	map_size = read_driver("buffer_mmap_size");
+	map = mmap(NULL, map_size, PROT_READ, MAP_SHARED, fd, 0);
+	if (map == MAP_FAILED) {
+		perror("mmap");
+		return 1;
+	}
+
+	if (write_driver("tick", "1000") || write_driver("response_type", "3"))
+		return 1;
+
+	for (cpu = 0; cpu < cores; cpu++)
+		pids[cpu] = spin_on(cpu);
+
+	if (write_driver("enable", "1"))
+		return 1;
+
+	end = time(NULL) + seconds;
+	while (time(NULL) < end) {
+		ret = ioctl(fd, GATOR_IOC_COMMIT_WAIT, &seg);
+		if (ret <= 0)
+			break;
+		if (check_frame(map, &seg))
+			errors++;
+		else if (seg.cpu < MAX_CPUS && !frames[seg.cpu]++)
+			cpus_seen++;
+	}
+
+	ioctl(fd, GATOR_IOC_COMMIT_RELEASE);
+	write_driver("enable", "0");
+	for (cpu = 0; cpu < cores; cpu++) {
+		kill(pids[cpu], SIGKILL);
+		waitpid(pids[cpu], NULL, 0);
+	}
+	munmap(map, map_size);
+	close(fd);
+
+	for (cpu = 0; cpu < cores; cpu++)
+		printf("cpu%d: %lu frames\n", cpu, frames[cpu]);
+	printf("%d bad frames\n", errors);
+
+	return errors || cpus_seen < 2;
+}
@@ -0,0 +1,156 @@
+/*
+ * mmc_blkbench - random 4K and sequential read throughput of a block device
+ *
+ * Reads the device with O_DIRECT, so that every read is a request to the
+ * host driver, first at random 4 KiB aligned offsets and then
+ * sequentially in -b sized reads, each for -t seconds, and prints IOPS
+ * and MB/s for both.
+ *
+ * To compare the measured MMCI PIO/DMA crossover with the old fixed
+ * one, run it once with automatic adjustment (the default) and once with
+ * the threshold pinned to the FIFO size (120 bytes on ux500), e.g. for
+ * the first host:
+ *	echo 120 > /sys/bus/amba/devices/sdi0/dma_threshold
+ * The host's xfer_stats file shows the per-size averages behind the
+ * automatic threshold.
+ *
+ * Usage: mmc_blkbench [-t <seconds>] [-b <sequential block size>] <device>
+ *
+ * Example:
+ *	mmc_blkbench -t 10 -b 65536 /dev/mmcblk0
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/fs.h>
+
+#define RANDOM_SIZE	4096
+
+static unsigned int seconds = 5;
+static size_t seq_size = 65536;
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static void report(const char *what, unsigned long long ios,
+		   unsigned long long bytes, double elapsed)
+{
+	printf("%-10s %8llu reads %10.1f IOPS %8.2f MB/s\n", what, ios,
+	       ios / elapsed, bytes / elapsed / 1e6);
+}
+
+static int run_random(int fd, void *buf, unsigned long long dev_size)
+{
+	unsigned long long blocks = dev_size / RANDOM_SIZE, ios = 0;
+	double start = now(), end = start + seconds, t;
+	off_t off;
+
+	srandom(start * 1000);
+	do {
+		off = (off_t)((((unsigned long long)random() << 31) |
+			       random()) % blocks) * RANDOM_SIZE;
+		if (pread(fd, buf, RANDOM_SIZE, off) != RANDOM_SIZE) {
+			perror("pread");
+			return -1;
+		}
+		ios++;
+	} while ((t = now()) < end);
+
+	report("random 4K", ios, ios * RANDOM_SIZE, t - start);
+	return 0;
+}
+
+static int run_sequential(int fd, void *buf, unsigned long long dev_size)
+{
+	unsigned long long ios = 0;
+	double start = now(), end = start + seconds, t;
+	off_t off = 0;
+
+	do {
+		if (off + seq_size > dev_size)
+			off = 0;
+		if (pread(fd, buf, seq_size, off) != (ssize_t)seq_size) {
+			perror("pread");
+			return -1;
+		}
+		off += seq_size;
+		ios++;
+	} while ((t = now()) < end);
+
+	report("sequential", ios, ios * seq_size, t - start);
+	return 0;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "Usage: %s [-t <seconds>] [-b <block size>] <device>\n",
+		name);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long long dev_size;
+	void *buf;
+	int fd, c;
+
+	while ((c = getopt(argc, argv, "t:b:")) != -1) {
+		switch (c) {
+		case 't':
+			seconds = strtoul(optarg, NULL, 0);
+			break;
+		case 'b':
+			seq_size = strtoul(optarg, NULL, 0);
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (optind != argc - 1 || !seconds || !seq_size ||
+	    seq_size % RANDOM_SIZE) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	fd = open(argv[optind], O_RDONLY | O_DIRECT);
+	if (fd < 0) {
+		perror(argv[optind]);
+		return 1;
+	}
+
+	if (ioctl(fd, BLKGETSIZE64, &dev_size)) {
+		perror("BLKGETSIZE64");
+		return 1;
+	}
+	if (dev_size < seq_size) {
+		fprintf(stderr, "%s: smaller than %zu bytes\n", argv[optind],
+			seq_size);
+		return 1;
+	}
+
+	errno = posix_memalign(&buf, RANDOM_SIZE, seq_size);
+	if (errno) {
+		perror("posix_memalign");
+		return 1;
+	}
+
+	if (run_random(fd, buf, dev_size) || run_sequential(fd, buf, dev_size))
+		return 1;
+
+	free(buf);
+	close(fd);
+	return 0;
+}
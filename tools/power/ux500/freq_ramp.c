@@ -0,0 +1,251 @@
+/*
+ * freq_ramp: measure how fast the ARM frequency follows a burst of load
+ *
+ * Copyright (C) ST-Ericsson SA 2012
+ * License terms: GNU General Public License (GPL) version 2
+ *
+ * Leaves the cpu idle for -s milliseconds, so that the governor brings the
+ * frequency down, then spins on it and polls scaling_cur_freq until the
+ * policy's maximum frequency is reached or -t milliseconds have passed.
+ * For each of the -n bursts it prints the time to the first frequency
+ * increase and to the maximum, followed by their minimum, mean and
+ * maximum over the run.
+ *
+ * With -f each burst runs in a newly forked process, whose utilization
+ * history starts with the burst, instead of in a task that has been
+ * asleep.
+ *
+ * To compare the governor sampling alone with the scheduler driven ramp
+ * of the DBX500 cpufreq driver (CONFIG_ARM_DBX500_CPUFREQ_SCHED_UTIL),
+ * run it under the same governor with
+ *	echo 0 > /sys/module/dbx500_cpufreq/parameters/sched_util_up
+ * and with the default of 80.  The sched_util trace event shows the
+ * utilization the driver was given.
+ */
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <time.h>
+#include <sys/wait.h>
+
+#define CPUFREQ_DIR	"/sys/devices/system/cpu/cpu%d/cpufreq/%s"
+
+static unsigned int iterations = 10;
+static unsigned int sleep_ms = 500;
+static unsigned int timeout_ms = 1000;
+static int cpu;
+static int fresh;
+
+struct ramp {
+	double first_ms;
+	double max_ms;
+};
+
+static double now_ms(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static int open_attr(const char *name)
+{
+	char path[128];
+	int fd;
+
+	snprintf(path, sizeof(path), CPUFREQ_DIR, cpu, name);
+	fd = open(path, O_RDONLY);
+	if (fd < 0)
+		perror(path);
+	return fd;
+}
+
+static unsigned long read_attr(int fd)
+{
+	char buf[32];
+	ssize_t len;
+
+	len = pread(fd, buf, sizeof(buf) - 1, 0);
+	if (len <= 0)
+		return 0;
+	buf[len] = '\0';
+	return strtoul(buf, NULL, 10);
+}
+
+/* Spin from now on, polling the frequency about every 100us */
+static void burst(int fd, unsigned long max_freq, struct ramp *r)
+{
+	double start = now_ms(), t = start;
+	unsigned long first_freq = read_attr(fd), freq;
+
+	r->first_ms = -1;
+	r->max_ms = -1;
+
+	while (t - start < timeout_ms) {
+		double until = t + 0.1;
+
+		while ((t = now_ms()) < until)
+			;
+
+		freq = read_attr(fd);
+		if (r->first_ms < 0 && freq > first_freq)
+			r->first_ms = t - start;
+		if (freq >= max_freq) {
+			r->max_ms = t - start;
+			break;
+		}
+	}
+}
+
+/* Run the burst in a child, handing the result back through a pipe */
+static int fresh_burst(int fd, unsigned long max_freq, struct ramp *r)
+{
+	int pfd[2];
+	pid_t pid;
+
+	if (pipe(pfd)) {
+		perror("pipe");
+		return -1;
+	}
+
+	pid = fork();
+	if (pid < 0) {
+		perror("fork");
+		return -1;
+	}
+	if (!pid) {
+		burst(fd, max_freq, r);
+		if (write(pfd[1], r, sizeof(*r)) != sizeof(*r))
+			_exit(1);
+		_exit(0);
+	}
+
+	close(pfd[1]);
+	if (read(pfd[0], r, sizeof(*r)) != sizeof(*r))
+		r->first_ms = r->max_ms = -1;
+	close(pfd[0]);
+	waitpid(pid, NULL, 0);
+	return 0;
+}
+
+static void print_stats(const char *what, double *v, unsigned int n)
+{
+	double min = 0, max = 0, sum = 0;
+	unsigned int i, seen = 0;
+
+	for (i = 0; i < n; i++) {
+		if (v[i] < 0)
+			continue;
+		if (!seen || v[i] < min)
+			min = v[i];
+		if (!seen || v[i] > max)
+			max = v[i];
+		sum += v[i];
+		seen++;
+	}
+
+	if (seen)
+		printf("%s: min %.1f mean %.1f max %.1f ms (%u of %u)\n",
+		       what, min, sum / seen, max, seen, n);
+	else
+		printf("%s: never within %u ms\n", what, timeout_ms);
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+		"Usage: %s [-n bursts] [-s sleep_ms] [-t timeout_ms] "
+		"[-c cpu] [-f]\n", name);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned long max_freq;
+	double *first, *max;
+	struct ramp r;
+	cpu_set_t set;
+	unsigned int i;
+	int fd, c;
+
+	while ((c = getopt(argc, argv, "n:s:t:c:f")) != -1) {
+		switch (c) {
+		case 'n':
+			iterations = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			sleep_ms = strtoul(optarg, NULL, 0);
+			break;
+		case 't':
+			timeout_ms = strtoul(optarg, NULL, 0);
+			break;
+		case 'c':
+			cpu = strtol(optarg, NULL, 0);
+			break;
+		case 'f':
+			fresh = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (!iterations || !timeout_ms || cpu < 0) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	CPU_ZERO(&set);
+	CPU_SET(cpu, &set);
+	if (sched_setaffinity(0, sizeof(set), &set)) {
+		perror("sched_setaffinity");
+		return 1;
+	}
+
+	fd = open_attr("scaling_max_freq");
+	if (fd < 0)
+		return 1;
+	max_freq = read_attr(fd);
+	close(fd);
+
+	fd = open_attr("scaling_cur_freq");
+	if (fd < 0)
+		return 1;
+
+	first = calloc(iterations, sizeof(*first));
+	max = calloc(iterations, sizeof(*max));
+	if (!first || !max) {
+		perror("calloc");
+		return 1;
+	}
+
+	printf("cpu%d: ramp to %lu kHz after %u ms idle, %s task\n",
+	       cpu, max_freq, sleep_ms, fresh ? "new" : "sleeping");
+
+	for (i = 0; i < iterations; i++) {
+		usleep(sleep_ms * 1000);
+
+		if (fresh) {
+			if (fresh_burst(fd, max_freq, &r))
+				return 1;
+		} else
+			burst(fd, max_freq, &r);
+
+		first[i] = r.first_ms;
+		max[i] = r.max_ms;
+		printf("%2u: first step %.1f ms, max %.1f ms\n",
+		       i, r.first_ms, r.max_ms);
+	}
+
+	print_stats("first step", first, iterations);
+	print_stats("max", max, iterations);
+
+	close(fd);
+	return 0;
+}
@@ -0,0 +1,321 @@
+/*
+ * usecase_replay: run the ux500 use-case governor load model on a trace
+ *
+ * Copyright (C) ST-Ericsson SA 2012
+ * License terms: GNU General Public License (GPL) version 2
+ *
+ * Reads a load trace and replays it through the decision logic of
+ * arch/arm/mach-ux500/pm/usecase_model.c, the same code the governor
+ * runs, to compare parameter sets offline.
+ *
+ * Trace lines are
+ *	<time ms> <load %> [<interrupts/s> [<input>]]
+ * where load is the busy time summed over the cpus (up to 100 per cpu)
+ * and input is non zero if an input event happened in the interval. Lines
+ * holding "usecase-gov: sample", as logged by the governor with debug set,
+ * are read from after that tag so a dmesg capture can be fed directly.
+ * Everything else is skipped.
+ *
+ * The replay models a system with -c cpus in performance mode and one in
+ * power save mode, switching immediately on each decision. For each run
+ * it reports:
+ *  - missed: time during which the trace wanted more cpu than was online,
+ *    and the worst and mean delay from a load exceeding one cpu until
+ *    performance mode was entered (the missed-deadline proxy);
+ *  - energy: cpu-online time plus busy time weighted by -b, in
+ *    milliseconds (the energy proxy).
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "usecase_model.h"
+
+#define TRACE_TAG	"usecase-gov: sample"
+
+static struct uc_model_params params = {
+	.rise_weight	= 512,
+	.fall_weight	= 128,
+	.up_load	= 85,
+	.down_load	= 40,
+	.down_delay_ms	= 1000,
+	.boost_ms	= 500,
+	.exit_irq_per_s	= 1000,
+};
+
+static unsigned long sample_ms = 50;
+static unsigned int perf_cpus = 2;
+static double busy_weight = 2.0;
+static int verbose;
+
+struct replay {
+	struct uc_model_state st;
+	unsigned int online;
+
+	/* current sampling window */
+	unsigned long window_start;
+	double window_load;
+	double window_irqs;
+	unsigned long window_len;
+
+	/* results */
+	unsigned long total_ms;
+	double missed_ms;
+	double online_ms;
+	double busy_ms;
+	unsigned long switches;
+
+	/* missed-deadline tracking */
+	int overloaded;
+	unsigned long overload_start;
+	unsigned long bursts;
+	unsigned long delay_sum;
+	unsigned long delay_max;
+};
+
+static void set_online(struct replay *r, unsigned int online,
+		       unsigned long now)
+{
+	if (online == r->online)
+		return;
+
+	if (verbose)
+		printf("%10lu ms: %u -> %u cpus (predicted %lu%%)\n",
+		       now, r->online, online, r->st.predicted);
+
+	if (online > r->online && r->overloaded) {
+		unsigned long delay = now - r->overload_start;
+
+		r->bursts++;
+		r->delay_sum += delay;
+		if (delay > r->delay_max)
+			r->delay_max = delay;
+		r->overloaded = 0;
+	}
+
+	r->online = online;
+	r->switches++;
+}
+
+static void apply(struct replay *r, enum uc_model_decision d,
+		  unsigned long now)
+{
+	if (d == UC_MODEL_INC_PERF)
+		set_online(r, perf_cpus, now);
+	else if (d == UC_MODEL_DEC_PERF)
+		set_online(r, 1, now);
+}
+
+/* What the governor would measure for a load on the online cpus */
+static void split_load(const struct replay *r, double load,
+		       unsigned int *cpu_load)
+{
+	unsigned int i;
+
+	for (i = 0; i < UC_MODEL_MAX_CPUS; i++) {
+		double l = i < r->online ? load / r->online : 0;
+
+		cpu_load[i] = l > 100 ? 100 : (unsigned int)(l + 0.5);
+	}
+}
+
+static void end_window(struct replay *r, unsigned long now)
+{
+	unsigned int cpu_load[UC_MODEL_MAX_CPUS];
+	double load = 0, irqs = 0;
+
+	if (r->window_len) {
+		load = r->window_load / r->window_len;
+		irqs = r->window_irqs / r->window_len;
+	}
+
+	split_load(r, load, cpu_load);
+	apply(r, uc_model_sample(&params, &r->st, now, cpu_load,
+				 UC_MODEL_MAX_CPUS, (unsigned long)irqs), now);
+
+	r->window_start = now;
+	r->window_load = 0;
+	r->window_irqs = 0;
+	r->window_len = 0;
+}
+
+/* Account the interval [t, t + dt) of the trace with the given load */
+static void account(struct replay *r, unsigned long t, unsigned long dt,
+		    double load, double irqs)
+{
+	double capacity;
+
+	while (dt) {
+		unsigned long step = r->window_start + sample_ms - t;
+
+		if (step > dt)
+			step = dt;
+
+		capacity = 100.0 * r->online;
+		if (load > capacity)
+			r->missed_ms += step * (load - capacity) / load;
+		r->online_ms += (double)step * r->online;
+		r->busy_ms += step * (load > capacity ? capacity : load) / 100;
+
+		if (load > 100 && r->online < perf_cpus && !r->overloaded) {
+			r->overloaded = 1;
+			r->overload_start = t;
+		} else if (load <= 100) {
+			r->overloaded = 0;
+		}
+
+		r->window_load += load * step;
+		r->window_irqs += irqs * step;
+		r->window_len += step;
+		r->total_ms += step;
+		t += step;
+		dt -= step;
+
+		if (t - r->window_start >= sample_ms)
+			end_window(r, t);
+	}
+}
+
+static int parse_line(char *line, unsigned long *t, double *load,
+		      double *irqs, int *input)
+{
+	char *p = strstr(line, TRACE_TAG);
+	int n;
+
+	if (p)
+		line = p + strlen(TRACE_TAG);
+
+	*irqs = 0;
+	*input = 0;
+	n = sscanf(line, "%lu %lf %lf %d", t, load, irqs, input);
+
+	return n >= 2;
+}
+
+static int replay(FILE *f)
+{
+	struct replay r;
+	char line[512];
+	unsigned long t, prev_t = 0;
+	double load, irqs, prev_load = 0, prev_irqs = 0;
+	int input, started = 0;
+
+	memset(&r, 0, sizeof(r));
+	uc_model_reset(&r.st);
+	r.online = perf_cpus;
+
+	while (fgets(line, sizeof(line), f)) {
+		if (line[0] == '#' || !parse_line(line, &t, &load, &irqs,
+						   &input))
+			continue;
+
+		if (!started) {
+			r.window_start = t;
+			started = 1;
+		} else if (t > prev_t) {
+			account(&r, prev_t, t - prev_t, prev_load, prev_irqs);
+		}
+
+		/* Input events act at once, as in the governor */
+		if (input && uc_model_input(&params, &r.st, t))
+			set_online(&r, perf_cpus, t);
+
+		prev_t = t;
+		prev_load = load;
+		prev_irqs = irqs;
+	}
+
+	if (!r.total_ms) {
+		fprintf(stderr, "usecase_replay: empty trace\n");
+		return 1;
+	}
+
+	printf("replayed %lu ms at %lu ms sampling, %lu switches\n",
+	       r.total_ms, sample_ms, r.switches);
+	printf("missed: %.0f ms (%.3f%%), %lu bursts, delay max %lu ms "
+	       "mean %.1f ms\n",
+	       r.missed_ms, 100.0 * r.missed_ms / r.total_ms, r.bursts,
+	       r.delay_max, r.bursts ? (double)r.delay_sum / r.bursts : 0.0);
+	printf("energy: %.0f (cpu online %.0f ms, busy %.0f ms)\n",
+	       r.online_ms + busy_weight * r.busy_ms, r.online_ms, r.busy_ms);
+
+	return 0;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr,
+		"Usage: %s [-s sample_ms] [-r rise_weight] [-f fall_weight]\n"
+		"\t[-u up_load] [-d down_load] [-D down_delay_ms] "
+		"[-B boost_ms]\n"
+		"\t[-i exit_irq_per_s] [-c cpus] [-b busy_weight] [-v] "
+		"[trace]\n", name);
+}
+
+int main(int argc, char **argv)
+{
+	FILE *f = stdin;
+	int c, ret;
+
+	while ((c = getopt(argc, argv, "s:r:f:u:d:D:B:i:c:b:v")) != -1) {
+		switch (c) {
+		case 's':
+			sample_ms = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			params.rise_weight = strtoul(optarg, NULL, 0);
+			break;
+		case 'f':
+			params.fall_weight = strtoul(optarg, NULL, 0);
+			break;
+		case 'u':
+			params.up_load = strtoul(optarg, NULL, 0);
+			break;
+		case 'd':
+			params.down_load = strtoul(optarg, NULL, 0);
+			break;
+		case 'D':
+			params.down_delay_ms = strtoul(optarg, NULL, 0);
+			break;
+		case 'B':
+			params.boost_ms = strtoul(optarg, NULL, 0);
+			break;
+		case 'i':
+			params.exit_irq_per_s = strtoul(optarg, NULL, 0);
+			break;
+		case 'c':
+			perf_cpus = strtoul(optarg, NULL, 0);
+			break;
+		case 'b':
+			busy_weight = strtod(optarg, NULL);
+			break;
+		case 'v':
+			verbose = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+
+	if (!sample_ms || !perf_cpus || perf_cpus > UC_MODEL_MAX_CPUS) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	if (optind < argc) {
+		f = fopen(argv[optind], "r");
+		if (!f) {
+			perror(argv[optind]);
+			return 1;
+		}
+	}
+
+	ret = replay(f);
+
+	if (f != stdin)
+		fclose(f);
+	return ret;
+}
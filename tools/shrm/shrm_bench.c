@@ -0,0 +1,228 @@
+/*
+ * shrm_bench - message rate and round trip time of a SHRM char device
+ *
+ * Copyright (C) ST-Ericsson SA 2012
+ * License terms: GNU General Public License (GPL) version 2
+ *
+ * Meant for a kernel built with CONFIG_U8500_SHRM_STANDIN, whose modem
+ * stand-in sends every message back on the channel it came from. For -t
+ * seconds it writes -w messages of -s bytes to the device and then reads
+ * back the same number, checking their contents, and prints the message
+ * rate, the throughput and the time from the first write of a window to
+ * its last reply. With -w 1 that is the round trip time of a message.
+ *
+ * Replies are read with readv() into -w buffers, so a whole window can
+ * come back in one call. -r reads them one read() at a time instead, for
+ * comparison.
+ *
+ * Usage: shrm_bench [-t <seconds>] [-s <bytes>] [-w <window>] [-r] [device]
+ *
+ * Example:
+ *	shrm_bench -s 1500 -w 16 /dev/rpc
+ */
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/uio.h>
+
+/* isa_write() copies into a 10 KiB buffer */
+#define MAX_MSG_SIZE	(10 * 1024)
+#define MAX_WINDOW	64
+/* a window must fit the 128 KiB common FIFO, with its 8 byte headers */
+#define MAX_WINDOW_BYTES	(64 * 1024)
+
+static unsigned int seconds = 5;
+static size_t msg_size = 256;
+static unsigned int window = 1;
+static int use_read;
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Message n starts with its number, the rest is a pattern derived from it */
+static void fill(unsigned char *buf, unsigned int n)
+{
+	size_t i;
+
+	memcpy(buf, &n, sizeof(n));
+	for (i = sizeof(n); i < msg_size; i++)
+		buf[i] = n + i;
+}
+
+static int check(const unsigned char *buf, size_t len, unsigned int n)
+{
+	unsigned int got;
+	size_t i;
+
+	memcpy(&got, buf, sizeof(got));
+	if (len != msg_size || got != n) {
+		fprintf(stderr, "expected message %u of %zu bytes, got %u of %zu\n",
+			n, msg_size, got, len);
+		return -1;
+	}
+	for (i = sizeof(n); i < msg_size; i++)
+		if (buf[i] != (unsigned char)(n + i)) {
+			fprintf(stderr, "message %u differs at byte %zu\n",
+				n, i);
+			return -1;
+		}
+	return 0;
+}
+
+/* Read replies into bufs until count have arrived, returns their number */
+static int receive(int fd, unsigned char **bufs, unsigned int count,
+		   unsigned int first)
+{
+	struct iovec iov[MAX_WINDOW];
+	unsigned int done = 0, i, calls = 0;
+	ssize_t len;
+
+	while (done < count) {
+		if (use_read) {
+			len = read(fd, bufs[done], MAX_MSG_SIZE);
+			if (len < 0) {
+				perror("read");
+				return -1;
+			}
+			if (check(bufs[done], len, first + done))
+				return -1;
+			done++;
+		} else {
+			for (i = done; i < count; i++) {
+				iov[i - done].iov_base = bufs[i];
+				iov[i - done].iov_len = msg_size;
+			}
+			len = readv(fd, iov, count - done);
+			if (len < 0) {
+				perror("readv");
+				return -1;
+			}
+			if (!len || len % msg_size) {
+				fprintf(stderr, "readv returned %zd bytes\n",
+					len);
+				return -1;
+			}
+			for (i = 0; i < len / msg_size; i++)
+				if (check(bufs[done + i], msg_size,
+					  first + done + i))
+					return -1;
+			done += len / msg_size;
+		}
+		calls++;
+	}
+	return calls;
+}
+
+static void usage(const char *name)
+{
+	fprintf(stderr, "Usage: %s [-t <seconds>] [-s <bytes>] [-w <window>] "
+		"[-r] [device]\n", name);
+}
+
+int main(int argc, char **argv)
+{
+	unsigned char *out, *bufs[MAX_WINDOW];
+	const char *dev = "/dev/rpc";
+	double start, end, t, w_start, w_time, min_w = 0, max_w = 0;
+	unsigned long long msgs = 0, calls = 0, windows = 0;
+	unsigned int n = 0, i;
+	int fd, c, ret;
+
+	while ((c = getopt(argc, argv, "t:s:w:r")) != -1) {
+		switch (c) {
+		case 't':
+			seconds = strtoul(optarg, NULL, 0);
+			break;
+		case 's':
+			msg_size = strtoul(optarg, NULL, 0);
+			break;
+		case 'w':
+			window = strtoul(optarg, NULL, 0);
+			break;
+		case 'r':
+			use_read = 1;
+			break;
+		default:
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	if (optind < argc)
+		dev = argv[optind++];
+
+	if (optind != argc || !seconds || msg_size < sizeof(n) ||
+	    msg_size > MAX_MSG_SIZE || !window || window > MAX_WINDOW ||
+	    window * (msg_size + 8) > MAX_WINDOW_BYTES) {
+		usage(argv[0]);
+		return 1;
+	}
+
+	fd = open(dev, O_RDWR);
+	if (fd < 0) {
+		perror(dev);
+		return 1;
+	}
+
+	out = malloc(msg_size);
+	if (!out) {
+		perror("malloc");
+		return 1;
+	}
+	for (i = 0; i < window; i++) {
+		bufs[i] = malloc(MAX_MSG_SIZE);
+		if (!bufs[i]) {
+			perror("malloc");
+			return 1;
+		}
+	}
+
+	start = now();
+	end = start + seconds;
+	do {
+		w_start = now();
+		for (i = 0; i < window; i++) {
+			fill(out, n + i);
+			if (write(fd, out, msg_size) != (ssize_t)msg_size) {
+				perror("write");
+				return 1;
+			}
+		}
+
+		ret = receive(fd, bufs, window, n);
+		if (ret < 0)
+			return 1;
+
+		t = now();
+		w_time = t - w_start;
+		if (!windows || w_time < min_w)
+			min_w = w_time;
+		if (w_time > max_w)
+			max_w = w_time;
+
+		n += window;
+		msgs += window;
+		calls += ret;
+		windows++;
+	} while (t < end);
+
+	t -= start;
+	printf("%s: %llu messages of %zu bytes in windows of %u, %s\n", dev,
+	       msgs, msg_size, window, use_read ? "read()" : "readv()");
+	printf("%10.1f msg/s %8.2f MB/s %6.2f msg per read call\n",
+	       msgs / t, msgs * msg_size / t / 1e6, (double)msgs / calls);
+	printf("window: min %.1f mean %.1f max %.1f us\n", min_w * 1e6,
+	       t / windows * 1e6, max_w * 1e6);
+
+	close(fd);
+	return 0;
+}
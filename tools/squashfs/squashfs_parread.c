@@ -0,0 +1,229 @@
+/*
+ * squashfs_parread - parallel read throughput of a squashfs filesystem
+ *
+ * Reads the given files with 1, 2, ... N concurrent readers and prints
+ * the aggregate throughput for each reader count, to show how
+ * decompression scales with the threads= mount option.  Each reader gets
+ * its own files (round robin), or, with a single file, its own slice of
+ * the file.  With -d the page cache is dropped before each run (needs
+ * root) so that every read goes through the decompressor; otherwise the
+ * filesystem should be remounted between runs.
+ *
+ * Usage: squashfs_parread [-d] [-n <max readers>] [-b <block size>]
+ *	  [-r <repeats>] <file>...
+ *
+ * Example:
+ *	mount -o loop,threads=percpu test.sqfs /mnt
+ *	squashfs_parread -d -n 4 /mnt/file*
+ */
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+struct reader {
+	pthread_t thread;
+	int id;
+	int readers;
+	unsigned long long bytes;
+	int err;
+};
+
+static char **files;
+static int nr_files;
+static size_t block_size = 128 * 1024;
+static pthread_barrier_t start_barrier;
+
+static double now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int read_range(struct reader *r, const char *name, off_t start,
+		      off_t end, char *buf)
+{
+	int fd = open(name, O_RDONLY);
+	off_t pos = start;
+
+	if (fd < 0) {
+		perror(name);
+		return -1;
+	}
+
+	while (end < 0 || pos < end) {
+		size_t len = block_size;
+		ssize_t n;
+
+		if (end >= 0 && (off_t)len > end - pos)
+			len = end - pos;
+		n = pread(fd, buf, len, pos);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			perror(name);
+			close(fd);
+			return -1;
+		}
+		if (n == 0)
+			break;
+		pos += n;
+		r->bytes += n;
+	}
+
+	close(fd);
+	return 0;
+}
+
+static void *reader_fn(void *arg)
+{
+	struct reader *r = arg;
+	char *buf = malloc(block_size);
+	int i;
+
+	if (buf == NULL) {
+		r->err = 1;
+		return NULL;
+	}
+
+	pthread_barrier_wait(&start_barrier);
+
+	if (nr_files == 1) {
+		struct stat st;
+		off_t slice;
+
+		if (stat(files[0], &st) < 0) {
+			perror(files[0]);
+			r->err = 1;
+			goto out;
+		}
+		slice = (st.st_size + r->readers - 1) / r->readers;
+		if (read_range(r, files[0], slice * r->id,
+			       slice * (r->id + 1), buf))
+			r->err = 1;
+	} else {
+		for (i = r->id; i < nr_files; i += r->readers)
+			if (read_range(r, files[i], 0, -1, buf))
+				r->err = 1;
+	}
+
+out:
+	free(buf);
+	return NULL;
+}
+
+static void drop_caches(void)
+{
+	int fd;
+
+	sync();
+	fd = open("/proc/sys/vm/drop_caches", O_WRONLY);
+	if (fd < 0 || write(fd, "3", 1) != 1)
+		perror("drop_caches");
+	if (fd >= 0)
+		close(fd);
+}
+
+static int run(int readers, int drop, double *mbs)
+{
+	struct reader *r = calloc(readers, sizeof(*r));
+	unsigned long long bytes = 0;
+	double start, elapsed;
+	int i, err = 0;
+
+	if (r == NULL)
+		return -1;
+
+	if (drop)
+		drop_caches();
+
+	pthread_barrier_init(&start_barrier, NULL, readers + 1);
+	for (i = 0; i < readers; i++) {
+		r[i].id = i;
+		r[i].readers = readers;
+		if (pthread_create(&r[i].thread, NULL, reader_fn, &r[i])) {
+			fprintf(stderr, "pthread_create failed\n");
+			exit(1);
+		}
+	}
+
+	pthread_barrier_wait(&start_barrier);
+	start = now();
+	for (i = 0; i < readers; i++) {
+		pthread_join(r[i].thread, NULL);
+		bytes += r[i].bytes;
+		err |= r[i].err;
+	}
+	elapsed = now() - start;
+	pthread_barrier_destroy(&start_barrier);
+	free(r);
+
+	*mbs = elapsed > 0 ? bytes / elapsed / (1024 * 1024) : 0;
+	return err ? -1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+	int max_readers = sysconf(_SC_NPROCESSORS_ONLN);
+	int repeats = 1, drop = 0;
+	double base = 0;
+	int c, n, i;
+
+	while ((c = getopt(argc, argv, "b:dn:r:")) != -1) {
+		switch (c) {
+		case 'b':
+			block_size = strtoul(optarg, NULL, 0);
+			break;
+		case 'd':
+			drop = 1;
+			break;
+		case 'n':
+			max_readers = atoi(optarg);
+			break;
+		case 'r':
+			repeats = atoi(optarg);
+			break;
+		default:
+			goto usage;
+		}
+	}
+
+	if (optind >= argc || max_readers < 1 || repeats < 1 || !block_size)
+		goto usage;
+
+	files = &argv[optind];
+	nr_files = argc - optind;
+
+	printf("readers      MB/s   speedup\n");
+	for (n = 1; n <= max_readers; n++) {
+		double best = 0, mbs;
+
+		for (i = 0; i < repeats; i++) {
+			if (run(n, drop, &mbs))
+				return 1;
+			if (mbs > best)
+				best = mbs;
+		}
+		if (n == 1)
+			base = best;
+		printf("%7d %9.1f %8.2fx\n", n, best,
+		       base > 0 ? best / base : 0);
+		fflush(stdout);
+	}
+
+	return 0;
+
+usage:
+	fprintf(stderr, "Usage: %s [-d] [-n <max readers>] [-b <block size>] "
+		"[-r <repeats>] <file>...\n", argv[0]);
+	return 1;
+}